@@ -6,11 +6,14 @@ DIR_OBJS 			= objs/
 DIR_ASYNC			= async/
 DIR_ASYNC_IO 		= $(DIR_ASYNC)IOProcessor/
 DIR_ASYNCFILE		= $(DIR_ASYNC)FileIOHandler/
+DIR_ASYNCTASKPOOL	= $(DIR_ASYNC)FileTaskPool/
 DIR_ASYNCLOGGER		= $(DIR_ASYNC)Logger/
 DIR_CONFIG_PARSER 	= ConfigParser/
 DIR_HTTP 			= HTTP/
 DIR_CGI 			= CGI/
 DIR_WEBSERVER		= WebServer/
+DIR_WORKERSUPERVISOR	= WorkerSupervisor/
+DIR_EVENTLOOPPOOL	= EventLoopPool/
 
 DIR_TESTSRCS 		= test/testsrcs/
 DIR_TESTOBJS 		= test/objs/
@@ -30,12 +33,25 @@ TESTDRIVERNAMES		=	\
 					test_asynclogger \
 					test_asyncfilereader \
 					test_asyncfilewriter \
+					test_filetaskpool \
 					test_configparser \
 					test_http_request \
 					test_http_response \
 					test_http_server_constructor \
 					test_bidimap \
 					test_shared_ptr \
+					test_arena \
+					test_cgi_slow_reader \
+					test_cgi_pipelined \
+					bench_event_loops \
+					bench_accept_storm \
+					bench_cgi_fastcgi \
+					bench_cgi_spawn \
+					bench_cgi_env \
+					bench_proxy \
+					bench_logger \
+					bench_load \
+					bench_micro \
 
 TESTDRIVERSRCS		= $(addprefix $(DIR_TESTSRCS), $(addsuffix .cpp, $(TESTDRIVERNAMES)))
 TESTDRIVEROBJS		= $(addprefix $(DIR_TESTOBJS), $(addsuffix .o, $(TESTDRIVERNAMES)))
@@ -47,14 +63,21 @@ FILENAMES			= \
 					utils/string \
 					utils/file \
 					utils/hash \
+					utils/time \
+					utils/alloc_profile \
+					utils/arena \
 					Header/Header \
 					$(DIR_ASYNC)generateErrorMsg \
+					$(DIR_ASYNC)TaskTimer \
 					$(DIR_ASYNC_IO)IOProcessor \
 					$(DIR_ASYNC_IO)SingleIOProcessor \
 					$(DIR_ASYNC_IO)TCPIOProcessor \
+					$(DIR_ASYNC_IO)ProcessWatcher \
 					$(DIR_ASYNCFILE)FileIOHandler \
 					$(DIR_ASYNCFILE)FileReader \
 					$(DIR_ASYNCFILE)FileWriter \
+					$(DIR_ASYNCTASKPOOL)FileTask \
+					$(DIR_ASYNCTASKPOOL)FileTaskPool \
 					$(DIR_ASYNCLOGGER)Logger \
 					$(DIR_ASYNCLOGGER)EndMarker \
 					$(DIR_CONFIG_PARSER)ConfigDirective \
@@ -73,18 +96,27 @@ FILENAMES			= \
 					$(DIR_HTTP)Response/Response \
 					$(DIR_HTTP)Response/ResponseInit \
 					$(DIR_HTTP)Response/ResponseSetter \
+					$(DIR_HTTP)UpstreamPool \
+					$(DIR_HTTP)DiskCache \
+					$(DIR_HTTP)AccessLog \
+					$(DIR_HTTP)Metrics \
 					$(DIR_HTTP)Server/RequestHandler/RequestHandler \
 					$(DIR_HTTP)Server/RequestHandler/RequestGetHandler \
 					$(DIR_HTTP)Server/RequestHandler/RequestHeadHandler \
 					$(DIR_HTTP)Server/RequestHandler/RequestPostHandler \
 					$(DIR_HTTP)Server/RequestHandler/RequestPutHandler \
 					$(DIR_HTTP)Server/RequestHandler/RequestDeleteHandler \
+					$(DIR_HTTP)Server/RequestHandler/RequestCachedHandler \
 					$(DIR_HTTP)Server/ErrorResponseHandler \
+					$(DIR_HTTP)Server/ProxyHandler \
 					$(DIR_HTTP)Server/Location \
 					$(DIR_HTTP)Server/LocationParseDirective \
 					$(DIR_HTTP)Server/Server \
 					$(DIR_HTTP)Server/ServerMethods \
 					$(DIR_HTTP)Server/ServerInterfaces \
+					$(DIR_HTTP)Server/ServerCGIAdmission \
+					$(DIR_HTTP)Server/ServerCGICache \
+					$(DIR_HTTP)Server/ServerDiskCache \
 					$(DIR_HTTP)Server/ServerParseDirective \
 					$(DIR_HTTP)Server/ServerError \
 					$(DIR_CGI)const_values \
@@ -93,9 +125,19 @@ FILENAMES			= \
 					$(DIR_CGI)RequestHandler \
 					$(DIR_CGI)RequestHandlerPipe \
 					$(DIR_CGI)RequestHandlerVnode \
+					$(DIR_CGI)RequestHandlerFastCGI \
+					$(DIR_CGI)RequestHandlerCached \
+					$(DIR_CGI)ResponseCache \
+					$(DIR_CGI)FastCGIPool \
+					$(DIR_CGI)fastcgi \
+					$(DIR_CGI)spawn \
 					$(DIR_WEBSERVER)WebServer \
 					$(DIR_WEBSERVER)WebServerMethod \
 					$(DIR_WEBSERVER)WebServerParseDirective \
+					$(DIR_WEBSERVER)WebServerAccessLog \
+					$(DIR_WORKERSUPERVISOR)WorkerSupervisor \
+					$(DIR_WORKERSUPERVISOR)WorkerSupervisorParseDirective \
+					$(DIR_EVENTLOOPPOOL)EventLoopPool \
 
 SRCS				= $(addprefix $(DIR_SRCS), $(addsuffix .cpp, $(FILENAMES)))
 OBJS				= $(addprefix $(DIR_OBJS), $(addsuffix .o, $(FILENAMES)))
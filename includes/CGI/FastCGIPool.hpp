@@ -0,0 +1,74 @@
+#ifndef CGI_FASTCGIPOOL_HPP
+#define CGI_FASTCGIPOOL_HPP
+
+#include "async/Logger.hpp"
+#include "async/SingleIOProcessor.hpp"
+#include <ctime>
+#include <deque>
+#include <set>
+#include <string>
+#include <sys/types.h>
+
+namespace CGI
+{
+/*
+ * 하나의 FastCGI 앱을 실행하는 워커 프로세스 묶음.
+ * 워커들은 fd 0으로 넘겨받은 유닉스 소켓에서 accept하며, 워커 하나는 한 번에
+ * 연결 하나만 처리하므로 연결 수를 워커 수로 제한한다. 남는 연결이 없으면
+ * acquire()가 NULL을 반환하고 요청은 연결이 반납될 때까지 기다린다.
+ * 이벤트 루프 스레드마다 따로 만들어지며 처음 사용될 때 워커를 띄운다.
+ */
+class FastCGIPool
+{
+  public:
+	class Connection
+	{
+	  private:
+		Connection(const Connection &orig);
+		Connection &operator=(const Connection &orig);
+
+	  public:
+		const int fd;
+		async::SingleIOProcessor io;
+
+		Connection(const int fd);
+		~Connection();
+	};
+
+  private:
+	static const int _max_requests_per_worker;
+	static const time_t _respawn_interval;
+	static volatile int _n_pools;
+
+	const std::string _exec_path;
+	const std::string _socket_path;
+	const size_t _n_workers;
+	int _listen_fd;
+	std::set<pid_t> _workers;
+	std::deque<Connection *> _idle;
+	size_t _n_busy;
+	time_t _respawn_after;
+	async::Logger &_logger;
+
+	FastCGIPool(const FastCGIPool &orig);
+	FastCGIPool &operator=(const FastCGIPool &orig);
+
+	void start(void);
+	pid_t spawn(void);
+	void maintain(void);
+	Connection *connect(void);
+
+  public:
+	FastCGIPool(const std::string &exec_path,
+				const std::string &socket_dir,
+				const size_t n_workers);
+	~FastCGIPool();
+
+	Connection *acquire(bool &reused);
+	void release(Connection *conn, const bool reusable);
+	const std::string &getExecPath(void) const;
+	size_t nWorkers(void) const;
+};
+} // namespace CGI
+
+#endif
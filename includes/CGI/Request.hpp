@@ -3,17 +3,27 @@
 
 #include "HTTP/Request.hpp"
 #include "async/Logger.hpp"
+#include <map>
+#include <string>
+#include <vector>
 
 namespace CGI
 {
 class Request
 {
   private:
+	typedef std::map<std::string, std::string> _MetaVariables;
+
 	static const std::string _version;
-	std::map<std::string, std::string> _meta_variables;
+	_MetaVariables _meta_variables;
 	std::string _message_body;
+	// getEnv()가 처음 불릴 때 "NAME=VALUE\0"을 이어 붙여 한 번에 만든다
+	mutable std::vector<char> _env_arena;
+	mutable std::vector<char *> _envp;
 	async::Logger &_logger;
 
+	static const _MetaVariables &defaultMetaVariables(void);
+
   public:
 	Request(const HTTP::Request &http_req, const std::string &resource_path);
 	~Request();
@@ -21,7 +31,9 @@ class Request
 	const Request &operator=(const Request &orig);
 
 	// getter
+	// 반환한 배열은 Request가 가지며 해제하지 않는다
 	char *const *getEnv(void) const;
+	const std::map<std::string, std::string> &getMetaVariables(void) const;
 	const std::string &getPath(void) const;
 	const std::string &getMessageBody(void) const;
 
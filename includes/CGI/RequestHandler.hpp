@@ -1,16 +1,23 @@
 #ifndef CGI_REQUESTHANDLER_HPP
 #define CGI_REQUESTHANDLER_HPP
 
+#include "CGI/FastCGIPool.hpp"
 #include "CGI/Request.hpp"
 #include "CGI/Response.hpp"
+#include "CGI/ResponseCache.hpp"
+#include "CGI/spawn.hpp"
+#include "HTTP/DiskCache.hpp"
 #include "HTTP/Request.hpp"
 #include "async/FileIOHandler.hpp"
 #include "async/Logger.hpp"
+#include "async/ProcessWatcher.hpp"
 #include "async/status.hpp"
+#include "utils/shared_ptr.hpp"
+#include "utils/time.hpp"
 
 namespace CGI
 {
-class RequestHandler
+class RequestHandler : public ft::RefCounted
 {
   protected:
 	enum cgi_response_inner_status_e
@@ -21,6 +28,7 @@ class RequestHandler
 		CGI_RESPONSE_INNER_STATUS_READ_AGAIN,
 		CGI_RESPONSE_INNER_STATUS_FORK_AGAIN,
 		CGI_RESPONSE_INNER_STATUS_WAITPID_AGAIN,
+		CGI_RESPONSE_INNER_STATUS_CONNECT_AGAIN,
 		CGI_RESPONSE_INNER_STATUS_OK
 	};
 
@@ -29,14 +37,42 @@ class RequestHandler
 	async::FileReader *_reader;
 	async::FileWriter *_writer;
 	std::string _exec_path;
-	pid_t _pid;
+	pid_t _pid; // 거두고 나면 -1
+	async::ProcessWatcher *_watcher;
 	int _waitpid_status;
 	int _status;
 	unsigned int _timeout_ms;
-	clock_t _timeout;
+	msec_t _timeout;
 	async::Logger &_logger;
 
+	// 출력을 다 받기 전에 헤더와 본문을 클라이언트로 흘려보내기 위한 상태
+	static const size_t _max_header_size;
+	// 클라이언트로 못 보낸 본문이 high를 넘으면 CGI 출력 읽기를 멈추고
+	// low 아래로 줄면 다시 읽는다
+	static const size_t _output_high_watermark;
+	static const size_t _output_low_watermark;
+	std::string _header_buf; // 빈 줄이 오기 전까지의 출력
+	std::string _body_buf;	 // 보낼 본문. chunked면 인코딩된 상태
+	bool _head_parsed;
+	bool _head_retrieved;
+	bool _chunked;
+	size_t _body_remaining; // Content-Length가 있을 때 남은 바이트 수
+	bool _output_paused;
+
+	// 캐시를 채우는 실행이면 출력 전체를 모아 두었다가 끝날 때 넣는다
+	bool _caching;
+	ResponseCache::EntryPtr _cache_entry;
+	msec_t _cache_ttl_ms;
+	msec_t _cache_stale_ms;
+	std::string _cache_output;
+	HTTP::DiskCache::Capture _disk_capture;
+
+	void feedOutput(const std::string &data);
+	void finishOutput(void);
+	void storeCacheEntry(void);
 	char **getArgv(void);
+	void spawnChild(posix_spawn_file_actions_t &file_actions);
+	bool reapChild(void);
 	void setTimeout(void);
 	bool checkTimeout(void);
 
@@ -46,8 +82,6 @@ class RequestHandler
 		CGI_RESPONSE_STATUS_AGAIN,
 		CGI_RESPONSE_STATUS_OK,
 	};
-	static const size_t pipeThreshold;
-
 	RequestHandler(const Request &request,
 				   const std::string &exec_path,
 				   unsigned int timeout_ms);
@@ -55,7 +89,20 @@ class RequestHandler
 
 	virtual int task(void) = 0;
 	const Response &retrieve(void);
+	bool hasHead(void) const;
+	HTTP::Response retrieveHead(void);
+	bool headRetrieved(void) const;
+	bool hasBody(void) const;
+	std::string retrieveBody(void);
 	std::string getMethod(void) const;
+	virtual bool spawnsProcess(void) const;
+	virtual bool capturesOutput(void) const;
+	const Request &getRequest(void) const;
+	const std::string &getExecPath(void) const;
+	void cacheOutput(const ResponseCache::EntryPtr &entry,
+					 const msec_t ttl_ms,
+					 const msec_t stale_ms);
+	HTTP::DiskCache::Capture &diskCapture(void);
 };
 
 class RequestHandlerPipe : public RequestHandler
@@ -65,7 +112,7 @@ class RequestHandlerPipe : public RequestHandler
 	int _write_pipe_fd[2];
 
 	void closePipe(int &fd);
-	int fork(void);
+	int spawn(void);
 	int waitRWOperation(void);
 	int waitExecution(void);
 	void closeAllPipes(void);
@@ -87,7 +134,7 @@ class RequestHandlerVnode : public RequestHandler
 	unsigned int _timeout_ms;
 
 	int waitWriteInputOperation(void);
-	int fork(void);
+	int spawn(void);
 	int waitExecution(void);
 	int waitReadOutputOperation(void);
 
@@ -99,6 +146,56 @@ class RequestHandlerVnode : public RequestHandler
 	virtual ~RequestHandlerVnode();
 
 	virtual int task(void);
+	virtual bool capturesOutput(void) const;
+};
+// 요청마다 프로세스를 띄우지 않고 FastCGIPool의 워커에게 요청을 보낸다
+class RequestHandlerFastCGI : public RequestHandler
+{
+  public:
+	typedef ft::shared_ptr<FastCGIPool> FastCGIPoolPtr;
+
+  private:
+	// 연결 하나에 요청 하나만 보내므로 요청 ID는 항상 같다
+	static const int _request_id;
+
+	FastCGIPoolPtr _pool;
+	FastCGIPool::Connection *_conn;
+	std::string _request_records;
+	std::string _rdbuf;
+	bool _reused;
+	bool _received;
+	bool _retried;
+
+	int acquireConnection(void);
+	int waitResponse(void);
+	void releaseConnection(const bool reusable);
+
+  public:
+	RequestHandlerFastCGI(const Request &request,
+						  const FastCGIPoolPtr &pool,
+						  const unsigned int timeout_ms);
+	virtual ~RequestHandlerFastCGI();
+
+	virtual int task(void);
+	virtual bool spawnsProcess(void) const;
+};
+// CGI를 실행하지 않고 ResponseCache 항목에 담긴 출력으로 응답한다.
+// 항목이 아직 채워지는 중이면 기다린다.
+class RequestHandlerCached : public RequestHandler
+{
+  private:
+	ResponseCache::EntryPtr _entry;
+
+  public:
+	RequestHandlerCached(const Request &request,
+						 const std::string &exec_path,
+						 const ResponseCache::EntryPtr &entry,
+						 const unsigned int timeout_ms);
+	virtual ~RequestHandlerCached();
+
+	virtual int task(void);
+	virtual bool spawnsProcess(void) const;
+	virtual bool capturesOutput(void) const;
 };
 } // namespace CGI
 
@@ -22,9 +22,16 @@ class Response
 	const Response &operator=(const Response &orig);
 
 	void makeResponse(std::string &cgi_output);
+	bool parseHeader(std::string &cgi_output);
 	void consumeHeader(std::string &buffer);
+	bool hasContentLength(void) const;
+	size_t getContentLength(void) const;
+	int getStatusCode(void) const;
+	long getMaxAge(void) const;
+	const Header &getHeader(void) const;
 
 	HTTP::Response toHTTPResponse(void) const;
+	HTTP::Response toHTTPResponseHead(void) const;
 };
 } // namespace CGI
 
@@ -0,0 +1,72 @@
+#ifndef CGI_RESPONSECACHE_HPP
+#define CGI_RESPONSECACHE_HPP
+
+#include "CGI/Request.hpp"
+#include "utils/shared_ptr.hpp"
+#include "utils/time.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace CGI
+{
+/*
+ * 같은 GET 요청에 대한 CGI 출력을 잠시 보관해 다시 실행하지 않는다.
+ * 항목은 처음 실행하는 핸들러가 채우며(PENDING -> READY/FAILED), 그동안
+ * 같은 키로 들어온 요청은 그 결과를 기다린다. 신선 기간이 지나도
+ * stale_until까지는 옛 출력을 내주면서 뒤에서 한 번만 다시 실행한다.
+ * 이벤트 루프 스레드의 Server마다 따로 가진다.
+ */
+class ResponseCache
+{
+  public:
+	class Unavailable : public std::runtime_error
+	{
+	  public:
+		Unavailable(void);
+	};
+
+	struct Entry
+	{
+		enum state_e
+		{
+			PENDING,
+			READY,
+			FAILED
+		};
+
+		int state;
+		std::string output; // 헤더를 포함한 CGI 출력 그대로
+		msec_t fresh_until;
+		msec_t stale_until;
+		bool revalidating;
+
+		Entry(void);
+	};
+	typedef ft::shared_ptr<Entry> EntryPtr;
+
+	static const size_t max_output_size;
+
+  private:
+	static const size_t _max_entries;
+	std::map<std::string, EntryPtr> _entries;
+
+	void evict(void);
+
+  public:
+	ResponseCache();
+	~ResponseCache();
+
+	static std::string makeKey(const std::string &exec_path,
+							   const Request &request,
+							   const std::vector<std::string> &vary);
+	static bool fill(Entry &entry,
+					 std::string output,
+					 const msec_t default_ttl_ms,
+					 const msec_t stale_ms);
+	bool find(const std::string &key, EntryPtr &entry);
+	EntryPtr reserve(const std::string &key);
+};
+} // namespace CGI
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CGI_FASTCGI_HPP
+#define CGI_FASTCGI_HPP
+
+#include <map>
+#include <string>
+
+// FastCGI 1.0 레코드 인코딩/디코딩. 서버와 www/cgi-code의 FastCGI 앱이
+// 함께 쓰므로 로거 등 서버 코드에 의존하지 않는다.
+namespace CGI
+{
+namespace fcgi
+{
+enum record_type_e
+{
+	BEGIN_REQUEST = 1,
+	ABORT_REQUEST = 2,
+	END_REQUEST = 3,
+	PARAMS = 4,
+	STDIN = 5,
+	STDOUT = 6,
+	STDERR = 7
+};
+
+enum protocol_status_e
+{
+	REQUEST_COMPLETE = 0,
+	CANT_MPX_CONN = 1,
+	OVERLOADED = 2,
+	UNKNOWN_ROLE = 3
+};
+
+extern const unsigned char VERSION;
+extern const int ROLE_RESPONDER;
+extern const int FLAG_KEEP_CONN;
+extern const size_t HEADER_LEN;
+extern const size_t MAX_CONTENT_LEN;
+
+struct Record
+{
+	int type;
+	int request_id;
+	std::string content;
+};
+
+void appendRecord(std::string &out,
+				  const int type,
+				  const int request_id,
+				  const std::string &content);
+void appendStream(std::string &out,
+				  const int type,
+				  const int request_id,
+				  const std::string &content);
+void appendBeginRequest(std::string &out,
+						const int request_id,
+						const bool keep_conn);
+void appendEndRequest(std::string &out,
+					  const int request_id,
+					  const int app_status,
+					  const int protocol_status);
+void appendNameValue(std::string &out,
+					 const std::string &name,
+					 const std::string &value);
+bool consumeRecord(std::string &buffer, Record &record);
+bool decodeNameValues(const std::string &content,
+					  std::map<std::string, std::string> &params);
+int decodeBeginRequestFlags(const std::string &content);
+int decodeEndRequestStatus(const std::string &content);
+} // namespace fcgi
+} // namespace CGI
+
+#endif
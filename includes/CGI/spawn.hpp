@@ -0,0 +1,23 @@
+#ifndef CGI_SPAWN_HPP
+#define CGI_SPAWN_HPP
+
+#include <spawn.h>
+#include <string>
+#include <sys/types.h>
+
+namespace CGI
+{
+// fork(2) 대신 posix_spawn(3)으로 CGI 프로세스를 띄운다. 서버의 주소 공간을
+// 복사하지 않으므로 힙이 커져도 생성 비용이 늘지 않는다. 자식은 빈
+// 시그널 마스크와 기본 SIGPIPE 처리로 시작한다. 실패하면 -1을 반환하고
+// errno를 설정한다.
+pid_t spawnProcess(const std::string &exec_path,
+				   char *const *argv,
+				   char *const *envp,
+				   const posix_spawn_file_actions_t *file_actions);
+// file action으로 dup2하지 않는 fd를 자식에게 그대로 물려준다
+void inheritFd(posix_spawn_file_actions_t &file_actions, const int fd);
+void deleteStrArray(char *const *arr);
+} // namespace CGI
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef EVENTLOOPPOOL_HPP
+#define EVENTLOOPPOOL_HPP
+
+#include "ConfigDirective.hpp"
+#include "async/Logger.hpp"
+#include <pthread.h>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// 메인 스레드가 accept만 담당하고, 받은 클라이언트를 각자 kqueue와 연결
+// 테이블을 가진 이벤트 루프 스레드들에게 나누어 준다.
+class EventLoopPool
+{
+  public:
+	enum balance_e
+	{
+		BALANCE_ROUND_ROBIN,
+		BALANCE_LEAST_CONN
+	};
+
+  private:
+	typedef std::queue<std::pair<int, int> > _Inbox; // (port, client fd)
+
+	class Loop
+	{
+	  private:
+		Loop(const Loop &orig);
+		Loop &operator=(const Loop &orig);
+
+	  public:
+		EventLoopPool &pool;
+		const int id;
+		pthread_t thread;
+		pthread_mutex_t mutex; // inbox, n_clients 보호
+		_Inbox inbox;
+		size_t n_clients;
+
+		Loop(EventLoopPool &pool, const int id);
+		~Loop();
+		void push(int port, int client_fd);
+		size_t load(void);
+	};
+	typedef std::vector<Loop *> _Loops;
+
+	const ConfigContext &_root_context;
+	const int _n_threads;
+	const int _balance;
+	const int _tcp_options;
+	_Loops _loops;
+	size_t _next;
+	async::Logger &_logger;
+
+	EventLoopPool(const EventLoopPool &orig);
+	EventLoopPool &operator=(const EventLoopPool &orig);
+
+	static void *runLoop(void *arg);
+	void start(void);
+	void join(void);
+	Loop &pick(void);
+
+  public:
+	EventLoopPool(const ConfigContext &root_context,
+				  const int n_threads,
+				  const int balance,
+				  const int tcp_options);
+	~EventLoopPool();
+
+	int run(void);
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef HTTP_ACCESSLOG_HPP
+#define HTTP_ACCESSLOG_HPP
+
+#include "async/FileTaskPool.hpp"
+#include "async/Logger.hpp"
+#include "utils/time.hpp"
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <string>
+
+namespace HTTP
+{
+// 모아둔 로그 줄을 access_log 파일에 덧붙인다
+class AccessLogTask : public async::FileTask
+{
+  public:
+	const int fd;
+	std::string data;
+
+	AccessLogTask(const int fd, std::string &data);
+	virtual void run(void);
+};
+
+/*
+ * 요청마다 한 줄씩 남기는 접근 로그. 파일은 프로세스에 하나만 열고,
+ * 줄은 이벤트 루프 스레드의 WebServer마다 따로 버퍼에 모았다가 크기나
+ * 시간이 차면 스레드 풀에서 한꺼번에 쓴다. O_APPEND로 열어서 여러
+ * 스레드와 워커 프로세스가 쓴 덩어리가 섞이지 않는다. SIGUSR1을 받으면
+ * 같은 경로로 파일을 다시 열어 로그 회전을 지원한다.
+ */
+class AccessLog
+{
+  public:
+	enum format_e
+	{
+		FORMAT_COMBINED,
+		FORMAT_JSON
+	};
+
+	// 요청 하나. 시각은 모두 monotonicUs() 기준이다
+	struct Entry
+	{
+		std::string remote_addr;
+		std::string method;
+		std::string uri;
+		std::string protocol;
+		std::string host;
+		std::string referer;
+		std::string user_agent;
+		int status;
+		size_t bytes_sent;
+		usec_t ready_at; // 연결을 받았거나 앞선 응답을 끝낸 시각
+		usec_t first_byte_at;
+		usec_t parsed_at;
+
+		Entry(void);
+	};
+
+  private:
+	static int _fd;
+	static int _format;
+	static std::string _path;
+	static volatile sig_atomic_t _reopen;
+	static pthread_mutex_t _mutex; // _fd 다시 열기 보호
+	static const size_t _flush_size;
+	static const usec_t _flush_interval_us;
+	static const size_t _max_buffer_size;
+
+	std::string _buffer;
+	usec_t _last_flush;
+	AccessLogTask *_task; // 쓰는 중이면 NULL이 아님
+	size_t _dropped;
+	time_t _cached_sec;
+	std::string _cached_time;
+	async::Logger &_logger;
+
+	AccessLog(const AccessLog &orig);
+	AccessLog &operator=(const AccessLog &orig);
+
+	const std::string &localTime(void);
+	void appendCombined(const Entry &entry, usec_t done_at);
+	void appendJSON(const Entry &entry, usec_t done_at);
+	void submit(void);
+
+  public:
+	AccessLog(void);
+	~AccessLog();
+
+	static void open(const std::string &path, const std::string &format);
+	static bool enabled(void);
+	static void requestReopen(void);
+	static void reopenIfRequested(void);
+	void append(const Entry &entry, usec_t done_at);
+	void flush(bool force = false);
+};
+} // namespace HTTP
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef HTTP_DISKCACHE_HPP
+#define HTTP_DISKCACHE_HPP
+
+#include "HTTP/Request.hpp"
+#include "HTTP/Response.hpp"
+#include "Header.hpp"
+#include "async/FileTaskPool.hpp"
+#include "utils/shared_ptr.hpp"
+#include "utils/time.hpp"
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace HTTP
+{
+// 캐시 파일을 쓰거나 지우는 작업. 디렉토리도 이 작업 안에서 만든다.
+class DiskCacheTask : public async::FileTask
+{
+  public:
+	enum mode_e
+	{
+		MODE_STORE,
+		MODE_REMOVE
+	};
+
+	const int mode;
+	const std::string path;
+	const std::string data;
+	bool ok;
+
+	DiskCacheTask(const int mode,
+				  const std::string &path,
+				  const std::string &data);
+	virtual void run(void);
+};
+
+/*
+ * proxy_pass와 CGI 응답을 temp_dir_path 아래 파일로 보관한다 (nginx의
+ * proxy_cache와 비슷하다). 키는 메서드, Host, URI이고 파일은 키 해시로
+ * 두 단계 디렉토리에 나눠 둔다. 메모리에는 파일 경로와 크기, 만료 시각만
+ * 두며 전체 크기가 상한을 넘으면 가장 오래 쓰이지 않은 항목부터 지운다.
+ * 적중한 응답은 정적 파일처럼 FileReader로 읽어 보내므로 백엔드를 깨우지
+ * 않는다. 이벤트 루프 스레드의 Server마다 따로 가진다.
+ */
+class DiskCache
+{
+  public:
+	enum cache_status_e
+	{
+		STATUS_NONE, // 캐시를 쓰지 않는 location
+		STATUS_BYPASS,
+		STATUS_MISS,
+		STATUS_HIT
+	};
+
+	// 파일 하나. 마지막 참조가 사라질 때 파일을 지운다
+	class Entry
+	{
+	  private:
+		Entry(const Entry &orig);
+		Entry &operator=(const Entry &orig);
+
+	  public:
+		const std::string key;
+		const std::string path;
+		const size_t size;
+		const msec_t stored_at;
+		const msec_t expires;
+		bool stored;
+		DiskCacheTask *task; // 쓰는 중이면 NULL이 아님
+		std::list<std::string>::iterator lru;
+
+		Entry(const std::string &key,
+			  const std::string &path,
+			  const size_t size,
+			  const msec_t ttl_ms);
+		~Entry();
+	};
+	typedef ft::shared_ptr<Entry> EntryPtr;
+
+	// 백엔드가 보내는 응답을 모아 두었다가 끝나면 캐시에 넣는다
+	class Capture
+	{
+	  public:
+		int cache_status;
+		bool enabled;
+		bool complete; // 본문을 끝까지 받았는지
+		std::string key;
+		msec_t ttl_ms;
+		int status_code;
+		std::string reason;
+		Header header;
+		std::string body;
+
+		Capture(void);
+
+		void begin(const std::string &key, const msec_t ttl_ms);
+		void setHead(const int status_code,
+					 const std::string &reason,
+					 const Header &header);
+		void appendBody(const std::string &data);
+		void end(void);
+		void annotate(Response &head) const;
+	};
+
+	struct Stats
+	{
+		size_t hits;
+		size_t misses;
+		size_t bypasses;
+		size_t stores;
+		size_t evictions;
+		size_t entries;
+		size_t bytes;
+	};
+
+	static const size_t max_object_size;
+
+  private:
+	static const size_t _max_size_default;
+	std::string _root;
+	size_t _max_size;
+	size_t _serial;
+	std::map<std::string, EntryPtr> _index;
+	std::list<std::string> _lru; // 앞쪽이 최근에 쓰인 키
+	std::vector<EntryPtr> _pending;
+	std::set<std::string> _dirs; // 만든 샤드 디렉토리
+	Stats _stats;
+
+	DiskCache(const DiskCache &orig);
+	DiskCache &operator=(const DiskCache &orig);
+
+	void insert(EntryPtr entry);
+	void erase(const std::string &key);
+	void evict(void);
+
+  public:
+	DiskCache();
+	~DiskCache();
+
+	static bool isCacheable(const Request &request);
+	static std::string makeKey(const Request &request);
+	static long getMaxAge(const Header &header);
+	static std::string serializeHead(const Capture &capture);
+	static bool parseHead(const std::string &head,
+						  int &status_code,
+						  std::string &reason,
+						  Header &header);
+
+	void configure(const std::string &temp_dir_path, const size_t max_size);
+	bool find(const std::string &key, EntryPtr &entry);
+	void store(const Capture &capture);
+	void poll(void);
+	void countBypass(void);
+	void countMiss(void);
+	const Stats &getStats(void);
+};
+} // namespace HTTP
+
+#endif
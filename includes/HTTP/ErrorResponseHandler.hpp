@@ -10,7 +10,8 @@
 
 namespace HTTP
 {
-class Server::ErrorResponseHandler
+class Server::ErrorResponseHandler : public ft::RefCounted,
+								   public ft::ArenaObject
 {
   private:
 	int _request_method;
@@ -19,9 +20,13 @@ class Server::ErrorResponseHandler
 	int _status;
 	int _code;
 	unsigned int _timeout_ms;
-	ft::shared_ptr<async::FileReader> _reader;
+	unsigned int _retry_after_sec; // 0이면 Retry-After를 보내지 않는다
+	// 핸들러와 함께 아레나에 담기도록 값으로 가진다
+	async::FileReader _reader;
 	async::Logger &_logger;
 
+	static const std::string &errorPagePath(const Server *server,
+											const int code);
 	void generateDefaultErrorResponse(void);
 	void generateResponse(const std::string &body, bool is_head);
 
@@ -35,8 +40,9 @@ class Server::ErrorResponseHandler
 	ErrorResponseHandler(Server *server,
 						 const int request_method,
 						 const int code,
-						 const unsigned int timeout_ms);
-	~ErrorResponseHandler();
+						 const unsigned int timeout_ms,
+						 const unsigned int retry_after_sec = 0);
+	virtual ~ErrorResponseHandler();
 
 	int task(void);
 	Response retrieve(void);
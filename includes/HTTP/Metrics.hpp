@@ -0,0 +1,125 @@
+#ifndef HTTP_METRICS_HPP
+#define HTTP_METRICS_HPP
+
+#include "HTTP/const_values.hpp"
+#include "utils/time.hpp"
+#include <cstddef>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace HTTP
+{
+/*
+ * 지연 시간 히스토그램. HDR 히스토그램처럼 2의 거듭제곱 구간을 4칸씩 나눠
+ * 상대 오차가 25%를 넘지 않게 센다. 1us부터 약 67초까지 다루고 그보다 긴
+ * 값은 마지막 칸에 넣는다.
+ */
+class LatencyHistogram
+{
+  public:
+	static const int n_buckets = 104;
+
+	unsigned long long buckets[n_buckets];
+	unsigned long long count;
+	unsigned long long sum_us;
+
+	LatencyHistogram(void);
+	void record(usec_t us);
+	void add(const LatencyHistogram &other);
+	static int bucketOf(usec_t us);
+	static usec_t upperBound(int bucket); // 이 칸에 드는 값은 이보다 작다
+};
+
+/*
+ * stub_status location으로 내보내는 서버 지표. 이벤트 루프 스레드의
+ * WebServer가 하나씩 가지며 그 스레드만 값을 바꾸므로 잠금 없이 센다.
+ * 주인 스레드가 publish()로 가끔 복사본을 잠근 채 옮겨 두면, 요청을 받은
+ * 스레드가 모든 스레드의 복사본을 읽어 Prometheus 형식으로 합친다. 그래서
+ * 막 바뀐 값은 다음 번에 보일 수 있다. 워커 프로세스끼리는 합치지 않는다.
+ */
+class Metrics
+{
+  public:
+	enum stage_e
+	{
+		STAGE_PARSE,   // 첫 바이트부터 요청을 다 읽을 때까지
+		STAGE_HANDLER, // 요청을 다 읽고 응답을 다 만들 때까지
+		STAGE_WRITE,   // 응답을 다 만들고 쓰기 버퍼가 빌 때까지
+		N_STAGES
+	};
+
+	// event_loop_profile을 켜면 WebServer::task 한 번을 나눠 잰다
+	enum loop_phase_e
+	{
+		LOOP_FLUSH,	   // 로그 버퍼 넘기기
+		LOOP_IO,	   // IOProcessor::doAllTasks
+		LOOP_PARSE,	   // 끊긴 연결 정리와 요청 해석
+		LOOP_HANDLERS, // Server::task와 응답 옮기기
+		LOOP_TOTAL,
+		N_LOOP_PHASES
+	};
+
+	// 다른 객체가 가진 값. 주인 스레드가 publish()로 넘긴다
+	struct Gauges
+	{
+		size_t connections_active;
+		size_t connections_idle;
+		unsigned long long connections_accepted;
+		unsigned long long bytes_received;
+		unsigned long long bytes_sent;
+		size_t request_handlers;
+		size_t cgi_handlers;
+		size_t proxy_handlers;
+		size_t error_handlers;
+		size_t queued_responses;
+		size_t cgi_running;
+		size_t cgi_waiting;
+		size_t cgi_rejected;
+		size_t disk_cache_hits;
+		size_t disk_cache_misses;
+		unsigned long long slow_tasks;
+	};
+
+	static const int n_methods = METHOD_DELETE + 1;
+	static const int n_status_classes = 5; // 1xx ~ 5xx
+
+  private:
+	struct Counters
+	{
+		unsigned long long requests[n_methods][n_status_classes];
+		LatencyHistogram stages[N_STAGES];
+		LatencyHistogram loop_phases[N_LOOP_PHASES];
+		unsigned long long loop_events;
+
+		Counters(void);
+	};
+
+	static bool _enabled;
+	static std::vector<const Metrics *> _instances;
+	// _instances와 모든 인스턴스의 _published, _gauges 보호
+	static pthread_mutex_t _mutex;
+
+	Counters _counters; // 주인 스레드만 읽고 쓴다
+	Counters _published;
+	Gauges _gauges;
+
+	Metrics(const Metrics &orig);
+	Metrics &operator=(const Metrics &orig);
+
+  public:
+	Metrics(void);
+	~Metrics();
+
+	static void enable(void);
+	static bool enabled(void);
+	void countRequest(int method, int status);
+	void recordStage(int stage, usec_t us);
+	void recordLoopPhase(int phase, usec_t us);
+	void countLoopEvents(size_t n_events);
+	void publish(const Gauges &gauges);
+	static std::string render(void);
+};
+} // namespace HTTP
+
+#endif
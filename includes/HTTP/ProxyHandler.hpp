@@ -0,0 +1,102 @@
+#ifndef HTTP_PROXYHANDLER_HPP
+#define HTTP_PROXYHANDLER_HPP
+
+#include "HTTP/DiskCache.hpp"
+#include "HTTP/Request.hpp"
+#include "HTTP/Response.hpp"
+#include "HTTP/Server.hpp"
+#include "HTTP/UpstreamPool.hpp"
+#include "utils/time.hpp"
+
+namespace HTTP
+{
+/*
+ * proxy_pass location으로 온 요청을 업스트림에 전달하고 응답을 흘려보낸다.
+ * CGI 핸들러처럼 헤더가 준비되면 먼저 내보내고 본문은 조각으로 넘긴다.
+ * 업스트림이 본문 길이를 알려주지 않으면 클라이언트에는 chunked로 보낸다.
+ */
+class Server::ProxyHandler : public ft::RefCounted, public ft::ArenaObject
+{
+  private:
+	enum body_e
+	{
+		BODY_NONE,
+		BODY_LENGTH,
+		BODY_CHUNKED,
+		BODY_UNTIL_CLOSE
+	};
+
+	enum chunk_state_e
+	{
+		CHUNK_SIZE,
+		CHUNK_DATA,
+		CHUNK_TRAILER
+	};
+
+	static const size_t _max_header_size;
+	static const size_t _output_high_watermark;
+	static const size_t _output_low_watermark;
+
+	const Request _request;
+	_UpstreamPoolPtr _pool;
+	UpstreamPool::Connection *_conn;
+	std::string _request_msg;
+	std::string _rdbuf;
+	std::string _body_buf;
+	Response _response;
+	const unsigned int _timeout_ms;
+	msec_t _deadline;
+	bool _reused;
+	bool _received; // 업스트림에서 한 바이트라도 받았는지
+	bool _retried;
+	bool _head_parsed;
+	bool _head_retrieved;
+	bool _done;
+	bool _keep_alive;
+	bool _output_paused;
+	bool _timed_out;
+	int _body_type;
+	size_t _body_remaining; // BODY_LENGTH는 남은 본문, BODY_CHUNKED는 남은 조각
+	int _chunk_state;
+	DiskCache::Capture _disk_capture;
+	async::Logger &_logger;
+
+	ProxyHandler(const ProxyHandler &orig);
+	ProxyHandler &operator=(const ProxyHandler &orig);
+
+	static bool isHopByHop(const std::string &name);
+	void buildRequestMessage(void);
+	bool retryable(void) const;
+	void acquireConnection(const bool fresh = false);
+	void releaseConnection(const bool reusable);
+	bool parseHead(void);
+	void feedBody(void);
+	void feedChunked(void);
+	void finish(void);
+	void checkTimeout(void);
+
+  public:
+	enum proxy_status_e
+	{
+		PROXY_STATUS_OK = 0,
+		PROXY_STATUS_AGAIN
+	};
+
+	ProxyHandler(const Request &request,
+				 const _UpstreamPoolPtr &pool,
+				 const unsigned int timeout_ms);
+	virtual ~ProxyHandler();
+
+	int task(void);
+	bool hasHead(void) const;
+	Response retrieveHead(void);
+	bool headRetrieved(void) const;
+	bool hasBody(void) const;
+	std::string retrieveBody(void);
+	int getMethod(void) const;
+	int errorCode(void) const;
+	DiskCache::Capture &diskCapture(void);
+};
+} // namespace HTTP
+
+#endif
@@ -6,11 +6,24 @@
 #include "HTTP/Response.hpp"
 #include "HTTP/Server.hpp"
 #include "async/FileIOHandler.hpp"
+#include "async/FileTaskPool.hpp"
 #include "async/status.hpp"
 
 namespace HTTP
 {
-class Server::RequestHandler
+// readdir과 항목별 stat으로 자동 인덱스 페이지를 만드는 작업
+class DirectoryListingTask : public async::FileTask
+{
+  public:
+	const std::string path;
+	const std::string uri;
+	std::string listing;
+
+	DirectoryListingTask(const std::string &path, const std::string &uri);
+	virtual void run(void);
+};
+
+class Server::RequestHandler : public ft::RefCounted, public ft::ArenaObject
 {
   protected:
 	const Request _request;
@@ -42,8 +55,7 @@ class Server::RequestHandler
 	Response retrieve(void);
 	const int &errorCode(void) const;
 
-	bool isDirectory(void) const;
-	bool isInvalidDirectoryFormat(void) const;
+	bool isDirectoryFormat(void) const;
 	const Request &getRequest(void) const;
 };
 
@@ -51,6 +63,9 @@ class Server::RequestGetHandler : public Server::RequestHandler
 {
   private:
 	async::FileReader _reader;
+	DirectoryListingTask *_listing;
+
+	int waitDirectoryListing(void);
 
   public:
 	RequestGetHandler(Server *server,
@@ -118,6 +133,22 @@ class Server::RequestDeleteHandler : public Server::RequestHandler
 
 	virtual int task(void);
 };
+// 디스크 캐시에 적중한 응답을 파일에서 읽어 그대로 보낸다
+class Server::RequestCachedHandler : public Server::RequestHandler
+{
+  private:
+	DiskCache::EntryPtr _entry; // 읽는 동안 파일이 지워지지 않게 잡아 둔다
+	async::FileReader _reader;
+
+  public:
+	RequestCachedHandler(Server *server,
+						 const Request &request,
+						 const Server::Location &location,
+						 const DiskCache::EntryPtr &entry);
+	virtual ~RequestCachedHandler();
+
+	virtual int task(void);
+};
 } // namespace HTTP
 
 #endif
@@ -33,7 +33,9 @@ class Response
 	void makeStatusLine(void);
 	void makeHeader(void);
 	void makeBody(void);
-	void alignAutoIndex(size_t minus_len, int to_align);
+	static void alignAutoIndex(std::string &body,
+							   size_t minus_len,
+							   int to_align);
 
 	std::string _response;
 
@@ -42,6 +44,10 @@ class Response
 	std::string _reason_phrase;
 	Header _header;
 	std::string _body;
+	bool _is_fragment;		  // 앞서 보낸 응답에 이어지는 본문 조각
+	bool _is_streaming;		  // 본문이 뒤따르는 조각으로 온다
+	bool _is_end_of_stream;	  // 나눠 보낸 응답의 마지막 조각
+	bool _close_after_write; // 보낸 뒤 연결을 끊는다
 	async::Logger &_logger;
 
 	enum e_autoindex
@@ -57,22 +63,35 @@ class Response
 	Response &operator=(Response const &other);
 	~Response();
 
+	static Response fragment(const std::string &data);
+	static Response endOfStream(void);
 	const std::string &toString(void);
 	const std::string getDescription(void) const;
+	int getStatusCode(void) const;
+	bool isFragment(void) const;
+	bool isStreaming(void) const;
+	bool isEndOfStream(void) const;
+	bool closeAfterWrite(void) const;
 
 	// setter
 	void setValue(const std::string &key, const std::string &val);
 
 	void setDate(void);
 	void setStatus(int status_code);
+	void setStatus(int status_code, const std::string &reason_phrase);
 	void setContent(const std::string &content, const std::string &file_path);
 	void setContentType(const std::string &file_path);
 	void setContentLength(void);
 	void setContentLength(size_t length);
 	void setConnection(bool is_persistent);
+	void setCloseAfterWrite(void);
+	void setStreaming(void);
 	void setBody(const std::string &body);
 	void setLocation(const std::string &uri);
 	void makeDirectoryListing(const std::string &path, const std::string &uri);
+	void setDirectoryListing(const std::string &listing);
+	static std::string generateDirectoryListing(const std::string &path,
+												const std::string &uri);
 };
 } // namespace HTTP
 
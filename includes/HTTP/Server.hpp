@@ -2,13 +2,19 @@
 #define HTTP_SERVER_HPP
 
 #include "CGI/RequestHandler.hpp"
+#include "CGI/ResponseCache.hpp"
 #include "ConfigDirective.hpp"
+#include "HTTP/DiskCache.hpp"
 #include "HTTP/Request.hpp"
 #include "HTTP/Response.hpp"
+#include "HTTP/UpstreamPool.hpp"
 #include "async/FileIOHandler.hpp"
 #include "async/Logger.hpp"
 #include "async/TCPIOProcessor.hpp"
+#include "utils/arena.hpp"
 #include "utils/shared_ptr.hpp"
+#include "utils/time.hpp"
+#include <deque>
 #include <queue>
 #include <set>
 #include <string>
@@ -25,18 +31,65 @@ class Server
 	class RequestPostHandler;
 	class RequestPutHandler;
 	class RequestDeleteHandler;
+	class RequestCachedHandler;
 	class ErrorResponseHandler;
+	class ProxyHandler;
+
+	// CGI 대기열 통계. 대기 시간은 자리를 배정받을 때 집계한다
+	struct CGIAdmissionStats
+	{
+		size_t admitted;
+		size_t rejected;
+		size_t waiting;
+		size_t running;
+		msec_t wait_ms_total;
+		msec_t wait_ms_max;
+	};
+
+	// 클라이언트별 대기열에 쌓인 핸들러와 응답 수의 합
+	struct QueueDepths
+	{
+		size_t requests;
+		size_t cgi;
+		size_t proxy;
+		size_t errors;
+		size_t responses;
+	};
 
   private:
 	class Location;
 
+	// 클라이언트별 요청 순서에 쌓이는 항목
+	enum _turn_e
+	{
+		TURN_REQUEST,
+		TURN_CGI,
+		TURN_PROXY,
+		TURN_ERROR,
+		TURN_RESPONSE // 바로 만든 응답. _held_responses에서 꺼낸다
+	};
+
 	typedef ft::shared_ptr<async::FileReader> _FileReaderPtr;
 	typedef ft::shared_ptr<RequestHandler> _RequestHandlerPtr;
 	typedef ft::shared_ptr<CGI::RequestHandler> _CGIRequestHandlerPtr;
 	typedef ft::shared_ptr<ErrorResponseHandler> _ErrorResponseHandlerPtr;
+	typedef CGI::RequestHandlerFastCGI::FastCGIPoolPtr _FastCGIPoolPtr;
+	typedef ft::shared_ptr<ProxyHandler> _ProxyHandlerPtr;
+	typedef ft::shared_ptr<UpstreamPool> _UpstreamPoolPtr;
 
 	static const int _http_min_version; // should be min <= ver <= max
 	static const int _http_max_version; // (note that it is not min < ver < max)
+	static const size_t _fastcgi_workers_default;
+	static const size_t _fastcgi_workers_max;
+	static const size_t _cgi_spill_threshold_default;
+	static const size_t _cgi_max_processes_default;
+	static const size_t _cgi_queue_size_default;
+	static const unsigned int _cgi_retry_after_sec;
+	static const size_t _disk_cache_max_size_default;
+	static const size_t _spare_arenas_max;
+	// 프로세스 안의 모든 이벤트 루프 스레드가 함께 쓰는 상한. 0이면 무제한
+	static size_t _cgi_max_processes_global;
+	static volatile size_t _cgi_processes_global;
 	int _port;
 	bool _has_server_name;
 	bool _cgi_enabled;
@@ -44,12 +97,34 @@ class Server
 	std::map<int, std::string> _error_page_paths;
 	std::map<std::string, Location> _locations;
 	std::map<std::string, std::string> _cgi_ext_to_path;
+	std::map<std::string, _FastCGIPoolPtr> _fastcgi_pools; // 실행 파일 경로별
+	std::map<std::string, _UpstreamPoolPtr> _upstream_pools; // location 경로별
 	std::string _temp_dir_path;
+	size_t _cgi_spill_threshold; // 본문이 이보다 크면 임시 파일로 CGI 실행
 	std::set<int> _allowed_cgi_methods;
+	// CGI 프로세스 수 제한. 클라이언트마다 맨 앞의 핸들러만 실행되므로
+	// 클라이언트 fd 단위로 자리를 배정한다
+	size_t _cgi_max_processes;
+	size_t _cgi_queue_size;
+	std::set<int> _cgi_admitted;
+	std::deque<std::pair<int, msec_t> > _cgi_waiting; // (fd, 대기 시작 시각)
+	CGIAdmissionStats _cgi_stats;
+	CGI::ResponseCache _cgi_cache;
+	std::vector<_CGIRequestHandlerPtr> _cgi_revalidations; // 응답할 곳이 없음
+	size_t _cgi_revalidating; // 그중 자리를 차지한 프로세스 수
+	DiskCache _disk_cache;
 	std::map<int, std::queue<_RequestHandlerPtr> > _request_handlers;
 	std::map<int, std::queue<_CGIRequestHandlerPtr> > _cgi_handlers;
-	std::map<int, std::queue<_ErrorResponseHandlerPtr> > _error_handlers;
+	std::map<int, std::deque<_ErrorResponseHandlerPtr> > _error_handlers;
+	std::map<int, std::queue<_ProxyHandlerPtr> > _proxy_handlers;
+	// 핸들러 종류와 상관없이 요청이 들어온 순서. 맨 앞 차례의 핸들러만
+	// 실행되므로 이어지는 요청의 응답이 스트리밍 중인 본문에 끼지 않는다
+	std::map<int, std::queue<int> > _turns;
+	std::map<int, std::queue<Response> > _held_responses; // 차례를 기다림
 	std::map<int, std::queue<Response> > _output_queue;
+	std::map<int, ft::Arena *> _arenas; // 클라이언트가 만든 핸들러를 담는다
+	std::vector<ft::Arena *> _spare_arenas; // 끊긴 연결에서 돌려받은 것
+	std::set<int> _paused_clients; // 쓰기 버퍼가 가득 찬 클라이언트
 	size_t _max_body_size;
 	const unsigned int _timeout_ms;
 	async::Logger &_logger;
@@ -62,12 +137,58 @@ class Server
 	void parseDirectiveServerName(const ConfigContext &server_context);
 	void parseDirectiveLocation(const ConfigContext &server_context);
 	void parseDirectiveCGI(const ConfigContext &server_context);
+	void parseDirectiveFastCGI(const ConfigDirective &cgi_directive);
 	void parseDirectiveCGILimitExcept(const ConfigContext &server_context);
 	void parseDirectiveTmpDirPath(const ConfigContext &server_context);
+	void parseDirectiveCGISpillThreshold(const ConfigContext &server_context);
+	void parseDirectiveCGIMaxProcesses(const ConfigContext &server_context);
+	void parseDirectiveCGIQueueSize(const ConfigContext &server_context);
+	void parseDirectiveDiskCacheMaxSize(const ConfigContext &server_context);
+
+	// CGI admission
+	static bool acquireGlobalCGISlot(void);
+	static void releaseGlobalCGISlot(void);
+	bool cgiSlotAvailable(void) const;
+	bool admitCGIHandler(int client_fd);
+	void admitWaitingCGIHandlers(void);
+	void releaseCGISlot(int client_fd);
+	void cancelWaitingCGIHandler(int client_fd);
+
+	// CGI cache
+	_CGIRequestHandlerPtr createCGIHandler(const CGI::Request &cgi_request,
+										   const std::string &exec_path);
+	_CGIRequestHandlerPtr createCachedCGIHandler(
+		const CGI::Request &cgi_request,
+		const Location &location,
+		const std::string &exec_path);
+	void revalidateCGICache(const CGI::Request &cgi_request,
+							const Location &location,
+							const std::string &exec_path,
+							CGI::ResponseCache::EntryPtr &entry);
+	void iterateCGIRevalidations(void);
+
+	// disk cache
+	bool serveFromDiskCache(int client_fd,
+							const Request &request,
+							const Location &location);
+	void prepareDiskCache(const Request &request,
+						  const Location &location,
+						  DiskCache::Capture &capture);
 
 	// utils of interfaces
+	ft::Arena &arena(int client_fd);
+	bool isTurnOf(int client_fd, int kind) const;
+	void finishTurn(int client_fd);
+	void pushResponse(int client_fd, const Response &response);
+	_ErrorResponseHandlerPtr createErrorResponseHandler(
+		int client_fd,
+		int method,
+		int code,
+		unsigned int retry_after_sec);
+	void replaceTurnWithError(int client_fd, int method, int code);
 	void iterateRequestHandlers(void);
 	void iterateCGIHandlers(void);
+	void iterateProxyHandlers(void);
 	void iterateErrorHandlers(void);
 
   public:
@@ -81,21 +202,33 @@ class Server
 		   const unsigned int timeout_ms);
 	~Server();
 
+	static void setGlobalCGIMaxProcesses(const size_t max_processes);
+
 	// interfaces
 	void task(void);
 	void registerCGIRequest(int client_fd,
 							const Request &request,
+							const Location &location,
 							const std::string &exec_path,
 							const std::string &resource_path);
 	void registerHTTPRequest(int client_fd,
 							 const Request &request,
 							 const Location &location,
 							 const std::string &resource_path);
-	void registerErrorResponseHandler(int client_fd, int method, int code);
+	void registerProxyRequest(int client_fd,
+							  const Request &request,
+							  const Location &location);
+	void registerErrorResponseHandler(int client_fd,
+									  int method,
+									  int code,
+									  unsigned int retry_after_sec = 0);
 	void registerRequest(int client_fd, const Request &request);
 	Response retrieveResponse(int client_fd);
 	void registerRedirectResponse(int fd, const Server::Location &location);
+	void registerStatusResponse(int client_fd, int method);
 	void disconnect(int client_fd);
+	void pauseOutput(int client_fd);
+	void resumeOutput(int client_fd);
 
 	// methods
 	void ensureClientConnected(int client_fd) const;
@@ -108,10 +241,14 @@ class Server
 	int getPort(void) const;
 	unsigned int getTimeout(void) const;
 	const Location &getLocation(const std::string &location) const;
+	const CGIAdmissionStats &getCGIAdmissionStats(void);
+	const DiskCache::Stats &getDiskCacheStats(void);
+	QueueDepths getQueueDepths(void) const;
 };
 } // namespace HTTP
 
 #include "ErrorResponseHandler.hpp"
+#include "HTTP/ProxyHandler.hpp"
 #include "HTTP/ServerError.hpp"
 #include "HTTP/ServerLocation.hpp"
 #include "RequestHandler.hpp"
@@ -19,6 +19,16 @@ class Server::Location
 	std::set<int> _allowed_methods;
 	std::string _upload_store_path;
 	size_t _max_body_size;
+	// GET으로 실행한 CGI 출력을 캐시할지. 유효 기간은 CGI 헤더가 우선
+	bool _cgi_cache;
+	msec_t _cgi_cache_ttl_ms;
+	msec_t _cgi_cache_stale_ms;
+	std::vector<std::string> _cgi_cache_vary; // 캐시 키에 넣을 요청 헤더
+	std::vector<std::string> _proxy_pass;	  // 비어 있지 않으면 프록시
+	int _proxy_balance;						  // UpstreamPool::balance_e
+	bool _disk_cache; // 프록시와 CGI 응답을 디스크에 캐시할지
+	msec_t _disk_cache_ttl_ms;
+	bool _stub_status; // 본문 대신 서버 지표를 내보내는 location
 	async::Logger &_logger;
 
 	void parseDirectiveAlias(const ConfigContext &location_context);
@@ -28,6 +38,12 @@ class Server::Location
 	void parseDirectiveIndex(const ConfigContext &location_context);
 	void parseDirectiveUpload(const ConfigContext &location_context);
 	void parseDirectiveMaxBodySize(const ConfigContext &location_context);
+	void parseDirectiveCGICache(const ConfigContext &location_context);
+	void parseDirectiveCGICacheVary(const ConfigContext &location_context);
+	void parseDirectiveProxyPass(const ConfigContext &location_context);
+	void parseDirectiveProxyBalance(const ConfigContext &location_context);
+	void parseDirectiveDiskCache(const ConfigContext &location_context);
+	void parseDirectiveStubStatus(const ConfigContext &location_context);
 
   public:
 	Location();
@@ -46,6 +62,16 @@ class Server::Location
 	bool hasAutoIndex(void) const;
 	bool doRedirect() const;
 	bool uploadAllowed() const;
+	bool cgiCacheEnabled(void) const;
+	msec_t getCGICacheTTL(void) const;
+	msec_t getCGICacheStale(void) const;
+	const std::vector<std::string> &getCGICacheVary(void) const;
+	bool isProxy(void) const;
+	const std::vector<std::string> &getProxyPass(void) const;
+	int getProxyBalance(void) const;
+	bool diskCacheEnabled(void) const;
+	msec_t getDiskCacheTTL(void) const;
+	bool isStubStatus(void) const;
 	Response generateRedirectResponse(void) const;
 };
 } // namespace HTTP
@@ -0,0 +1,76 @@
+#ifndef HTTP_UPSTREAMPOOL_HPP
+#define HTTP_UPSTREAMPOOL_HPP
+
+#include "async/Logger.hpp"
+#include "async/SingleIOProcessor.hpp"
+#include <deque>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+namespace HTTP
+{
+/*
+ * proxy_pass로 지정한 업스트림 서버들과의 keep-alive 연결 묶음.
+ * 요청마다 업스트림을 하나 골라 쉬고 있는 연결을 다시 쓰거나 새로
+ * non-blocking connect한다. 응답을 끝까지 받은 연결만 돌려받아 재사용한다.
+ * 이벤트 루프 스레드의 Server마다 location별로 따로 만들어진다.
+ */
+class UpstreamPool
+{
+  public:
+	enum balance_e
+	{
+		BALANCE_ROUND_ROBIN,
+		BALANCE_LEAST_CONN
+	};
+
+	class Connection
+	{
+	  private:
+		Connection(const Connection &orig);
+		Connection &operator=(const Connection &orig);
+
+	  public:
+		const int fd;
+		const size_t upstream; // UpstreamPool 안에서의 번호
+		async::SingleIOProcessor io;
+
+		Connection(const int fd, const size_t upstream);
+		~Connection();
+	};
+
+  private:
+	struct Upstream
+	{
+		std::string name; // host:port
+		struct sockaddr_in addr;
+		std::deque<Connection *> idle;
+		size_t n_busy;
+	};
+
+	static const size_t _max_idle_per_upstream;
+
+	std::vector<Upstream> _upstreams;
+	const int _balance;
+	size_t _next;
+	async::Logger &_logger;
+
+	UpstreamPool(const UpstreamPool &orig);
+	UpstreamPool &operator=(const UpstreamPool &orig);
+
+	size_t pick(void);
+	Connection *connect(const size_t upstream);
+
+  public:
+	UpstreamPool(const std::vector<std::string> &urls, const int balance);
+	~UpstreamPool();
+
+	// fresh면 쉬고 있는 연결을 쓰지 않고 새로 연결한다
+	Connection *acquire(bool &reused, const bool fresh = false);
+	void release(Connection *conn, const bool reusable);
+	const std::string &getName(const size_t upstream) const;
+};
+} // namespace HTTP
+
+#endif
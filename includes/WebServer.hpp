@@ -2,12 +2,16 @@
 #define WEBSERVER_HPP
 
 #include "ConfigDirective.hpp"
+#include "HTTP/AccessLog.hpp"
+#include "HTTP/Metrics.hpp"
 #include "HTTP/Request.hpp"
 #include "HTTP/Response.hpp"
 #include "HTTP/Server.hpp"
 #include "async/Logger.hpp"
 #include "async/TCPIOProcessor.hpp"
 #include "utils/shared_ptr.hpp"
+#include <csignal>
+#include <deque>
 #include <map>
 #include <string>
 #include <vector>
@@ -23,22 +27,57 @@ class WebServer
 	typedef std::map<int, _Servers> _ServerMap;
 	typedef std::map<int, HTTP::Request> _ReqBufFdMap;
 	typedef std::map<int, _ReqBufFdMap> _ReqBufPortMap;
+	typedef std::map<int, _ServerPtr> _PausedFdMap; // fd -> 응답을 만든 서버
+	typedef std::map<int, _PausedFdMap> _PausedPortMap;
 
-	static bool _terminate;
+	// 응답을 기다리는 요청 하나
+	struct TrackedRequest
+	{
+		int method;
+		HTTP::AccessLog::Entry entry; // 문자열은 접근 로그를 쓸 때만 채운다
+	};
+
+	// 접근 로그와 지표를 남기려고 연결마다 두는 상태
+	struct AccessClient
+	{
+		std::string remote_addr;
+		usec_t ready_at;	  // 연결을 받았거나 앞선 응답을 끝낸 시각
+		usec_t first_byte_at; // 받는 중인 요청의 첫 바이트, 없으면 0
+		std::deque<TrackedRequest> entries;
+		std::deque<usec_t> unsent; // 다 만들었지만 쓰기 버퍼에 남은 응답
+	};
+	typedef std::map<int, AccessClient> _AccessFdMap;
+	typedef std::map<int, _AccessFdMap> _AccessPortMap;
+
+	static volatile sig_atomic_t _terminate;
+	// 클라이언트 쓰기 버퍼가 high를 넘으면 서버가 본문을 넘기지 않도록
+	// 멈추고, low 아래로 줄면 다시 받는다
+	static const size_t _output_high_watermark;
+	static const size_t _output_low_watermark;
+	static const size_t _cgi_max_processes_default;
+	static const usec_t _metrics_interval_us;
 
 	size_t _max_body_size;
 	std::string _upload_store;
 	_TCPProcMap _tcp_procs;
 	_ServerMap _servers;
 	_ReqBufPortMap _request_buffer;
+	_PausedPortMap _paused_clients;
+	HTTP::AccessLog _access_log;
+	_AccessPortMap _access_clients;
+	HTTP::Metrics _metrics;
+	usec_t _metrics_published_at;
 	unsigned int _timeout_ms;
 	int _backlog_size;
+	const int _tcp_options;
 	async::Logger &_logger;
 
 	void parseMaxBodySize(const ConfigContext &root_context);
 	void parseUploadStore(const ConfigContext &root_context);
 	void parseTimeout(const ConfigContext &root_context);
 	void parseBacklogSize(const ConfigContext &root_context);
+	void parseCGIMaxProcesses(const ConfigContext &root_context);
+	void parseEventLoopProfile(const ConfigContext &root_context);
 	void parseServer(const ConfigContext &server_context);
 
 	void parseRequestForEachFd(int port, async::TCPIOProcessor &tcp_proc);
@@ -47,15 +86,36 @@ class WebServer
 	void resetRequestBuffer(int port, int client_fd);
 	void registerRequest(int port, int client_fd, HTTP::Request &request);
 	void retrieveResponseForEachFd(int port, _Servers &servers);
+	void resumePausedClients(int port);
+	static bool tracksRequests(void);
+	AccessClient &getAccessClient(int port, int client_fd);
+	void noteFirstByte(int port, int client_fd);
+	void openAccessEntry(int port, int client_fd, const HTTP::Request &request);
+	void logParseFailure(int port, int client_fd, int status, size_t n_bytes);
+	void recordResponse(int port,
+						int client_fd,
+						const HTTP::Response &res,
+						size_t n_bytes);
+	void finishRequest(AccessClient &client,
+					   const TrackedRequest &request,
+					   usec_t done_at);
+	void closeAccessEntries(int port, int client_fd);
+	void noteDrainedWrites(int port, async::TCPIOProcessor &tcp_proc);
+	usec_t recordLoopPhase(int phase, usec_t since);
+	void publishMetrics(void);
 	HTTP::Response generateErrorResponse(const int code);
 	void disconnect(int port, int client_fd);
 	void terminate(void);
 
   public:
-	WebServer(const ConfigContext &root_context);
+	WebServer(const ConfigContext &root_context,
+			  const int tcp_options = async::TCPIOProcessor::TCP_OPTION_NONE);
 	~WebServer();
 
 	int task(void);
+	void adoptClient(int port, int client_fd);
+	bool popAcceptedClient(int &port, int &client_fd);
+	size_t nClients(void) const;
 	static void setTerminationFlag(void);
 };
 
@@ -0,0 +1,67 @@
+#ifndef WORKERSUPERVISOR_HPP
+#define WORKERSUPERVISOR_HPP
+
+#include "ConfigDirective.hpp"
+#include "async/Logger.hpp"
+#include "utils/time.hpp"
+#include <csignal>
+#include <ctime>
+#include <map>
+#include <sys/types.h>
+
+class WorkerSupervisor
+{
+  private:
+	typedef std::map<pid_t, time_t> _Workers; // pid -> 생성 시각
+
+	static volatile sig_atomic_t _terminate;
+	static volatile sig_atomic_t _reopen_logs;
+	static volatile sig_atomic_t _dump_allocs;
+	static const int _n_workers_max;
+	static const int _n_threads_max;
+	static const time_t _respawn_interval;
+	static const int _max_fast_failures;
+	static const useconds_t _wait_interval_us; // 워커 종료를 확인하는 간격
+
+	const ConfigContext &_root_context;
+	int _n_workers;
+	int _n_threads;
+	int _balance;
+	_Workers _workers;
+	bool _terminating; // 워커에게 SIGTERM을 보냈는지
+	int _n_respawns;   // _respawn_at에 다시 띄울 워커 수
+	msec_t _respawn_at;
+	int _fast_failures; // 시작하자마자 연달아 죽은 워커 수
+	bool _gave_up;
+	async::Logger &_logger;
+
+	WorkerSupervisor(const WorkerSupervisor &orig);
+	WorkerSupervisor &operator=(const WorkerSupervisor &orig);
+
+	void parseWorkerProcesses(const ConfigContext &root_context);
+	void parseWorkerThreads(const ConfigContext &root_context);
+	void parseWorkerBalance(const ConfigContext &root_context);
+	void parseFileIOThreads(const ConfigContext &root_context);
+	void parseAccessLog(const ConfigContext &root_context);
+
+	pid_t spawn(void);
+	void runWorker(void);
+	void reap(pid_t pid, int wait_status);
+	void respawnWorkers(void);
+	void terminateWorkers(void);
+	void reopenWorkerLogs(void);
+	void dumpWorkerAllocs(void);
+	int runWebServer(const int tcp_options);
+
+  public:
+	WorkerSupervisor(const ConfigContext &root_context);
+	~WorkerSupervisor();
+
+	int run(void);
+	int nWorkers(void) const;
+	static void setTerminationFlag(void);
+	static void setReopenLogsFlag(void);
+	static void setDumpAllocsFlag(void);
+};
+
+#endif
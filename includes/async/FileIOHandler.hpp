@@ -1,10 +1,10 @@
 #ifndef ASYNC_FILEIOHANDLER_HPP
 #define ASYNC_FILEIOHANDLER_HPP
 
+#include "async/FileTaskPool.hpp"
 #include "async/SingleIOProcessor.hpp"
 #include "utils/shared_ptr.hpp"
-#include <cstdio>
-#include <ctime>
+#include "utils/time.hpp"
 #include <string>
 
 namespace async
@@ -12,23 +12,55 @@ namespace async
 class FileIOHandler
 {
   protected:
+	// 경로로 지정된 일반 파일은 kqueue가 항상 준비됨으로 보고하므로
+	// 열기부터 읽기/쓰기까지 FileTaskPool에서 한 번에 처리한다
+	class PathTask : public FileTask
+	{
+	  public:
+		enum mode_e
+		{
+			MODE_READ,
+			MODE_WRITE
+		};
+
+		const int mode;
+		const std::string path;
+		std::string buffer;
+		int status;
+		std::string error_msg;
+
+		PathTask(const int mode,
+				 const std::string &path,
+				 const std::string &content);
+		virtual void run(void);
+
+	  private:
+		void readFile(void);
+		void writeFile(void);
+	};
+
 	ft::shared_ptr<SingleIOProcessor> _processor;
-	FILE *_stream;
+	PathTask *_task;
 	int _fd;
 	const std::string _path;
 	int _status;
 	std::string _error_msg;
 	std::string _buffer;
-	const clock_t _timeout;
-	clock_t _next_timeout;
-	const bool _should_close; // 소멸자 호출시 fd를 close()해야하는지 여부
+	const unsigned int _timeout; // ms
+	msec_t _next_timeout;
+	const bool _by_path; // 경로로 생성되어 파일을 직접 열고 닫는지 여부
 
 	FileIOHandler(unsigned int timeout_ms, int fd);
 	FileIOHandler(unsigned int timeout_ms, const std::string &path);
 
 	void renewTimeout(void);
 	bool checkTimeout(void);
-	bool openFdByPath(const char *mode);
+	void submitPathTask(const int mode, const std::string &content);
+	void pollPathTask(void);
+
+  private:
+	FileIOHandler(const FileIOHandler &orig);
+	FileIOHandler &operator=(const FileIOHandler &orig);
 
   public:
 	virtual ~FileIOHandler();
@@ -36,6 +68,7 @@ class FileIOHandler
 	virtual int task(void) = 0;
 	const std::string &errorMsg(void) const;
 	std::string retrieve(void);
+	std::string retrievePartial(void);
 };
 
 class FileWriter : public FileIOHandler
@@ -65,6 +98,8 @@ class FileReader : public FileIOHandler
 	virtual ~FileReader();
 
 	virtual int task(void);
+	void pause(void);
+	void resume(void);
 };
 } // namespace async
 
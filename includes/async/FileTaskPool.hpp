@@ -0,0 +1,83 @@
+#ifndef ASYNC_FILETASKPOOL_HPP
+#define ASYNC_FILETASKPOOL_HPP
+
+#include <cstddef>
+#include <deque>
+#include <pthread.h>
+#include <vector>
+
+namespace async
+{
+// 스레드 풀에서 실행할 블로킹 파일시스템 작업.
+// 제출한 쪽과 풀이 참조를 하나씩 가지므로, 제출한 쪽은 delete 대신
+// release()를 호출해야 한다. 이벤트 루프는 isDone()을 폴링해 결과를 가져간다.
+class FileTask
+{
+  private:
+	volatile int _refcount;
+	volatile int _done;
+
+	FileTask(const FileTask &orig);
+	FileTask &operator=(const FileTask &orig);
+
+  public:
+	FileTask(void);
+	virtual ~FileTask();
+
+	virtual void run(void) = 0;
+	bool isDone(void);
+	void complete(void);
+	void retain(void);
+	void release(void);
+};
+
+// 워커마다 큐를 두고, 자기 큐가 비면 다른 워커의 큐에서 작업을 훔쳐온다.
+// 큐에 쌓인 작업 수가 한도를 넘거나 스레드 수가 0이면 호출한 스레드에서
+// 바로 실행한다.
+class FileTaskPool
+{
+  private:
+	class Worker
+	{
+	  public:
+		FileTaskPool &pool;
+		const size_t index;
+		pthread_t thread;
+		pthread_mutex_t mutex; // tasks 보호
+		std::deque<FileTask *> tasks;
+
+		Worker(FileTaskPool &pool, const size_t index);
+		~Worker();
+	};
+
+	static FileTaskPool *_pool;
+	static size_t _n_threads;
+	static const size_t _n_threads_max;
+	static const size_t _queue_limit;
+	static pthread_mutex_t _pool_mutex; // _pool, _n_threads 보호
+
+	std::vector<Worker *> _workers;
+	pthread_mutex_t _idle_mutex; // _n_queued 보호
+	pthread_cond_t _idle_cond;
+	size_t _n_queued; // 아직 아무 워커도 맡지 않은 작업 수
+	size_t _next;
+
+	FileTaskPool(const size_t n_threads);
+	~FileTaskPool();
+	FileTaskPool(const FileTaskPool &orig);
+	FileTaskPool &operator=(const FileTaskPool &orig);
+
+	static FileTaskPool *getPool(void);
+	static void *runWorker(void *arg);
+	bool push(FileTask *task);
+	FileTask *take(const size_t index);
+
+  public:
+	static void setNumThreads(const size_t n_threads);
+	static size_t getNumThreads(void);
+	static size_t getMaxNumThreads(void);
+	static void submit(FileTask *task);
+};
+} // namespace async
+
+#endif
@@ -14,18 +14,29 @@ namespace async
 class IOProcessor
 {
   private:
-	static std::vector<IOProcessor *> _objs;
+	// 이벤트 루프 스레드마다 자신이 만든 객체만 처리하도록 스레드별로 관리
+	static __thread std::vector<IOProcessor *> *_objs;
+	// 같은 스레드의 모든 객체의 kqueue를 감시하는 kqueue
+	static __thread int _master_kq;
+	static __thread size_t _n_kevents; // 이번 doAllTasks에서 받은 이벤트 수
 	static const size_t _buffsize;
+	static const int _size_eventbuf;
 	int _kq;
+	bool _idle;
 
+	static std::vector<IOProcessor *> &objs(void);
+	static int masterKQueue(void);
+	static void watchKQueue(IOProcessor *obj);
 	static void registerObject(IOProcessor *task);
 	static void unregisterObject(IOProcessor *task);
+	static void markIdleObjects(void);
 
   protected:
 	int _status;
 	int _event_count;
 	std::string _error_msg;
-	std::deque<struct kevent> _watchlist;
+	// kevent(2)에 배열로 그대로 넘기므로 연속된 메모리여야 함
+	std::vector<struct kevent> _watchlist;
 	std::deque<struct kevent> _eventlist;
 	std::map<int, std::string> _rdbuf;
 	std::map<int, std::string> _wrbuf;
@@ -35,6 +46,7 @@ class IOProcessor
 	int read(const int fd, const size_t size);
 	int write(const int fd, const size_t size);
 	virtual void task(void) = 0;
+	virtual void watch(void);
 
   public:
 	IOProcessor(void);
@@ -42,8 +54,10 @@ class IOProcessor
 
 	const int &stat(void) const;
 	const std::string &errorMsg(void) const;
-	static void doAllTasks(void);
+	static size_t doAllTasks(void);
 	static void blockingWriteAll(void);
+	static void reinitializeAll(void);
+	static void releaseThread(void);
 	void blockingWrite(void);
 	int eventCount(void);
 };
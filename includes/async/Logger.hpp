@@ -1,31 +1,102 @@
 #ifndef ASYNC_LOGGER_HPP
 #define ASYNC_LOGGER_HPP
 
-#include "async/SingleIOProcessor.hpp"
 #include "utils/shared_ptr.hpp"
+#include <cstddef>
 #include <map>
+#include <pthread.h>
 #include <sstream>
 #include <string>
-#include <vector>
+
+// make LOG_MIN_LEVEL=INFO처럼 빌드하면 그보다 낮은 수준의 로그는 인자까지
+// 컴파일 시점에 사라진다. 실행 중에는 log_level로 더 올릴 수만 있다
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL DEBUG
+#endif
 
 namespace async
 {
-class Logger
+// 로그 한 줄은 호출한 스레드에서 (레벨, 로거, 시각, 인자들)의 이진 레코드로만
+// 기록해 고정 크기 링 버퍼에 넣는다. 문자열로 만들고 fd에 쓰는 일은 전용
+// 스레드가 한다. 링이 가득 차면 레코드를 버리고 그 수를 센다.
+// 모든 스레드가 함께 쓰는 전역 객체라 참조 카운트는 원자적으로 센다.
+class Logger : public ft::AtomicRefCounted
 {
   private:
-	typedef ft::shared_ptr<SingleIOProcessor> _SingleIOPtr;
-	typedef std::map<int, _SingleIOPtr> _Procs;
+	static const size_t _slot_data_size = 256 - sizeof(size_t);
+	static const size_t _max_record_slots = 32;
+
+	// 링의 한 칸. 레코드는 연속된 칸 여러 개를 차지할 수 있다
+	struct Slot
+	{
+		volatile size_t seq;
+		char data[_slot_data_size];
+	};
+	struct RecordHead
+	{
+		long sec;
+		const Logger *logger;
+		unsigned short len; // RecordHead를 뺀 인자 바이트 수
+		unsigned char level;
+		unsigned char n_slots;
+		bool truncated;
+	};
+	// 호출한 스레드가 작성 중인 레코드. 스레드마다 하나씩 고정으로 둔다
+	struct Pending
+	{
+		RecordHead head;
+		bool open;
+		char args[_max_record_slots * _slot_data_size - sizeof(RecordHead)];
+	};
+	enum arg_tag_e
+	{
+		ARG_STR = 0,
+		ARG_INT,
+		ARG_UINT,
+		ARG_CHAR
+	};
 
 	static std::map<std::string, ft::shared_ptr<Logger> > _loggers;
-	static _Procs _target;
 	static const std::string _name_default;
 	static int _log_level;
 	static const char *_level_names[];
 	static const char *_level_prefixes[];
-	static bool _active;
+	static __thread Pending _pending;
+	static pthread_mutex_t _mutex; // _loggers, _fds 보호
+	static int _fds[];
+	static size_t _n_fds;
+	static const size_t _max_fds;
+
+	static const size_t _ring_size; // 칸 수, 2의 거듭제곱
+	static Slot *_ring;
+	static volatile size_t _head; // 다음에 예약할 위치 (생산자들)
+	static size_t _tail;		  // 다음에 읽을 위치 (기록 스레드)
+	static volatile size_t _dropped;
+	static size_t _dropped_reported;
+
+	static pthread_t _writer;
+	static volatile bool _writer_running;
+	static volatile bool _writer_stop;
+	static pthread_mutex_t _drain_mutex; // 링 소비, fd 쓰기 보호
+	static const long _idle_min_us;
+	static const long _idle_max_us;
 
 	const std::string _name;
 
+	static void append(arg_tag_e tag, const void *data, size_t size);
+	static void commit(void);
+	static bool reserve(size_t n_slots, size_t &pos);
+	static void startWriter(void);
+	static void stopWriter(void);
+	static void *runWriter(void *arg);
+	static size_t drain(void);
+	static void format(std::string &out, const RecordHead &head,
+					   const std::string &args);
+	static void writeAll(const std::string &out);
+	static void prepareFork(void);
+	static void afterForkParent(void);
+	static void afterForkChild(void);
+
 	Logger(void);
 	Logger(const std::string &name);
 	Logger(const Logger &orig);
@@ -50,21 +121,34 @@ class Logger
 		~EndMarker();
 	};
 
+	// 이보다 낮은 수준의 로그는 컴파일되지 않는다
+	static const int compiled_min_level = LOG_MIN_LEVEL;
+
 	~Logger();
-	std::string getPrefix(int level);
+	void begin(int level);
 	void log(const std::string &content);
+	void log(const char *content);
+	void log(char content);
+	void log(long long content);
+	void log(unsigned long long content);
 	static bool isActive(void);
-	static void activate(void);
-	static void deactivate(void);
 	static void registerFd(int fd);
 	static void setLogLevel(int log_level);
 	static void setLogLevel(const std::string &log_level);
 	static int getLogLevel(void);
 	static Logger &getLogger(const std::string &name);
+	static size_t getDroppedCount(void);
+	static void flush(void);
 	static void doAllTasks(void);
 	static void blockingWriteAll(void);
 };
 
+// 매 로그마다 부르므로 인라인으로 둔다
+inline int Logger::getLogLevel(void)
+{
+	return (_log_level);
+}
+
 extern const Logger::EndMarker debug;
 extern const Logger::EndMarker verbose;
 extern const Logger::EndMarker info;
@@ -74,7 +158,17 @@ extern const Logger::EndMarker error;
 
 async::Logger &operator<<(async::Logger &io,
 						  const async::Logger::EndMarker mark);
-
+async::Logger &operator<<(async::Logger &io, const std::string &content);
+async::Logger &operator<<(async::Logger &io, const char *content);
+async::Logger &operator<<(async::Logger &io, char content);
+async::Logger &operator<<(async::Logger &io, int content);
+async::Logger &operator<<(async::Logger &io, long content);
+async::Logger &operator<<(async::Logger &io, long long content);
+async::Logger &operator<<(async::Logger &io, unsigned int content);
+async::Logger &operator<<(async::Logger &io, unsigned long content);
+async::Logger &operator<<(async::Logger &io, unsigned long long content);
+
+// 위에서 다루지 않는 타입만 호출한 스레드에서 문자열로 바꾼다
 template <typename T>
 inline async::Logger &operator<<(async::Logger &io, T content)
 {
@@ -86,11 +180,15 @@ inline async::Logger &operator<<(async::Logger &io, T content)
 	return (io);
 }
 
+#define LOG_ENABLED(level)                                                     \
+	(async::Logger::level >= async::Logger::compiled_min_level                 \
+	 && async::Logger::level >= async::Logger::getLogLevel())
+
 // _logger라는 이름의 로거 객체가 있을때 사용 가능
 #define LOG_DEBUG(message)                                                     \
 	do                                                                         \
 	{                                                                          \
-		if (async::Logger::DEBUG >= async::Logger::getLogLevel())              \
+		if (LOG_ENABLED(DEBUG))                                                \
 			_logger << async::debug << message;                                \
 	} while (0)
 
@@ -98,7 +196,7 @@ inline async::Logger &operator<<(async::Logger &io, T content)
 #define LOG_VERBOSE(message)                                                   \
 	do                                                                         \
 	{                                                                          \
-		if (async::Logger::VERBOSE >= async::Logger::getLogLevel())            \
+		if (LOG_ENABLED(VERBOSE))                                              \
 			_logger << async::verbose << message;                              \
 	} while (0)
 
@@ -106,7 +204,7 @@ inline async::Logger &operator<<(async::Logger &io, T content)
 #define LOG_INFO(message)                                                      \
 	do                                                                         \
 	{                                                                          \
-		if (async::Logger::INFO >= async::Logger::getLogLevel())               \
+		if (LOG_ENABLED(INFO))                                                 \
 			_logger << async::info << message;                                 \
 	} while (0)
 
@@ -114,7 +212,7 @@ inline async::Logger &operator<<(async::Logger &io, T content)
 #define LOG_WARNING(message)                                                   \
 	do                                                                         \
 	{                                                                          \
-		if (async::Logger::WARNING >= async::Logger::getLogLevel())            \
+		if (LOG_ENABLED(WARNING))                                              \
 			_logger << async::warning << message;                              \
 	} while (0)
 
@@ -122,7 +220,7 @@ inline async::Logger &operator<<(async::Logger &io, T content)
 #define LOG_ERROR(message)                                                     \
 	do                                                                         \
 	{                                                                          \
-		if (async::Logger::ERROR >= async::Logger::getLogLevel())              \
+		if (LOG_ENABLED(ERROR))                                                \
 			_logger << async::error << message;                                \
 	} while (0)
 
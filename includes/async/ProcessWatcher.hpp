@@ -0,0 +1,33 @@
+#ifndef ASYNC_PROCESSWATCHER_HPP
+#define ASYNC_PROCESSWATCHER_HPP
+
+#include "async/IOProcessor.hpp"
+#include <sys/types.h>
+
+namespace async
+{
+// 자식 프로세스의 종료를 EVFILT_PROC으로 기다린다. 종료 전까지는 kqueue에
+// 이벤트가 없어 doAllTasks에서 건너뛰므로 waitpid(2)를 반복하지 않는다.
+// 좀비를 거두는 것은 호출자의 몫이다.
+class ProcessWatcher : public IOProcessor
+{
+  private:
+	const pid_t _pid;
+	bool _exited;
+
+	ProcessWatcher();
+	ProcessWatcher(const ProcessWatcher &orig);
+	ProcessWatcher &operator=(const ProcessWatcher &orig);
+
+	virtual void task(void);
+	virtual void watch(void);
+
+  public:
+	ProcessWatcher(const pid_t pid);
+	virtual ~ProcessWatcher();
+
+	bool exited(void);
+};
+} // namespace async
+
+#endif
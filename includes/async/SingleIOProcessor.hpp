@@ -2,6 +2,7 @@
 #define ASYNC_SINGLEIOPROCESSOR_HPP
 
 #include "async/IOProcessor.hpp"
+#include <pthread.h>
 #include <sstream>
 
 namespace async
@@ -11,9 +12,13 @@ class SingleIOProcessor : public IOProcessor
   private:
 	int _fd;
 	int _event_option;
+	bool _read_paused;
+	// 로거처럼 여러 스레드가 같은 fd에 쓰는 경우를 위해 버퍼 접근을 보호
+	pthread_mutex_t _mutex;
 
 	SingleIOProcessor();
 	virtual void task(void);
+	virtual void watch(void);
 
   public:
 	enum IO_event_option
@@ -30,6 +35,8 @@ class SingleIOProcessor : public IOProcessor
 	void getReadBuf(std::string &str);
 	bool writeDone(void);
 	int getFd(void);
+	void pauseRead(void);
+	void resumeRead(void);
 };
 
 extern SingleIOProcessor cin;
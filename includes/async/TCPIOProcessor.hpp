@@ -3,22 +3,43 @@
 
 #include "async/IOProcessor.hpp"
 #include "async/Logger.hpp"
+#include "utils/time.hpp"
 #include <queue>
+#include <set>
+#include <sys/socket.h>
 
 namespace async
 {
 class TCPIOProcessor : public IOProcessor
 {
+  public:
+	// 받은 연결과 주고받은 바이트 수. 이 프로세서를 돌리는 스레드만 바꾼다
+	struct Stats
+	{
+		unsigned long long accepted;
+		unsigned long long bytes_received;
+		unsigned long long bytes_sent;
+	};
+
   private:
 	typedef std::map<int, std::string>::iterator _iterator;
 	int _port;
 	int _backlog_size;
+	int _options;
 	int _listening_socket;
+	int _reserve_fd; // fd가 바닥났을 때 연결을 끊기 위해 남겨두는 fd
+	std::set<int> _closing; // 쓰기 버퍼를 비운 뒤 끊을 클라이언트
+	std::map<int, usec_t> _adopted_at;
+	Stats _stats;
 	Logger &_logger;
 
+	static const int _max_accepts_per_event;
+
 	void accept(void);
+	void shedConnection(void);
 	void disconnect(const int client_socket);
 	virtual void task(void);
+	virtual void watch(void);
 
 	class fdIterator
 	{
@@ -39,12 +60,32 @@ class TCPIOProcessor : public IOProcessor
 	};
 
   public:
-	static std::queue<int> disconnected_clients;
+	enum tcp_option_e
+	{
+		TCP_OPTION_NONE = 0,
+		TCP_OPTION_REUSEPORT = 1 << 0,
+		// 소켓을 열지 않고 adopt()로 넘겨받은 클라이언트만 처리
+		TCP_OPTION_NOLISTEN = 1 << 1,
+		// accept한 클라이언트를 직접 처리하지 않고 accepted_clients에 쌓음
+		TCP_OPTION_HANDOFF = 1 << 2
+	};
+
+	std::queue<int> disconnected_clients;
+	std::queue<int> accepted_clients;
 
-	TCPIOProcessor(const int port = 80, const int backlog = 8);
+	TCPIOProcessor(const int port = 80,
+				   const int backlog = SOMAXCONN,
+				   const int options = TCP_OPTION_NONE);
 	virtual ~TCPIOProcessor();
 
+	static int maxBacklogSize(void);
 	void finalize(const char *with_error);
+	// 논블로킹으로 설정된 클라이언트 소켓만 넘겨받는다
+	void adopt(const int client_socket);
+	size_t nClients(void) const;
+	usec_t adoptedAt(const int client_socket) const;
+	const Stats &getStats(void) const;
+	void closeAfterWrite(const int client_socket);
 	std::string &rdbuf(const int fd);
 	std::string &wrbuf(const int fd);
 
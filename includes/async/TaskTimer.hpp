@@ -0,0 +1,45 @@
+#ifndef ASYNC_TASKTIMER_HPP
+#define ASYNC_TASKTIMER_HPP
+
+#include "utils/time.hpp"
+#include <cstddef>
+#include <typeinfo>
+
+namespace async
+{
+/*
+ * 이벤트 루프를 오래 붙잡은 task() 호출을 찾는다. event_loop_profile
+ * 지시어로 켜며, 꺼져 있으면 시각을 재지 않는다. 기준을 넘은 호출은
+ * 스레드마다 세고, 경고는 1초에 한 번만 남기고 나머지는 개수로 알린다.
+ *
+ *     async::TaskTimer timer;
+ *     int rc = handler->task();
+ *     timer.check(typeid(*handler), client_fd);
+ */
+class TaskTimer
+{
+  private:
+	static usec_t _threshold_us; // 0이면 꺼짐
+	static const usec_t _warning_interval_us;
+	static __thread unsigned long long _n_slow;
+	static __thread usec_t _last_warning;
+	static __thread size_t _suppressed;
+
+	const usec_t _started_at;
+
+	TaskTimer(const TaskTimer &orig);
+	TaskTimer &operator=(const TaskTimer &orig);
+
+	static void report(const std::type_info &type, int fd, usec_t elapsed);
+
+  public:
+	TaskTimer(void);
+
+	static void enable(usec_t threshold_us);
+	static bool enabled(void);
+	static unsigned long long slowTaskCount(void);
+	void check(const std::type_info &type, int fd) const;
+};
+} // namespace async
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef UTILS_ALLOC_PROFILE_HPP
+#define UTILS_ALLOC_PROFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/*
+ * make re ALLOC_PROFILE=1로 빌드하면 operator new/delete를 바꿔 힙 할당을
+ * 하위 시스템별로 센다. ALLOC_SCOPE로 표시한 블록 안에서 일어난 할당은 그
+ * 하위 시스템 몫이고, 블록이 겹치면 안쪽이 이긴다. 해제는 할당한 하위
+ * 시스템에서 뺀다. 켜지 않고 빌드하면 두 매크로는 아무 일도 하지 않는다.
+ */
+namespace ft
+{
+namespace alloc
+{
+enum subsystem_e
+{
+	SUBSYSTEM_OTHER,
+	SUBSYSTEM_PARSER,
+	SUBSYSTEM_HANDLER,
+	SUBSYSTEM_CGI,
+	SUBSYSTEM_LOGGER,
+	SUBSYSTEM_IO,
+	N_SUBSYSTEMS
+};
+
+struct Stats
+{
+	unsigned long long allocs;
+	unsigned long long frees;
+	unsigned long long bytes; // 지금까지 할당한 바이트
+	long long live_bytes;
+	long long peak_bytes;
+};
+
+// 블록이 끝나면 앞의 하위 시스템으로 돌아간다
+class Scope
+{
+  private:
+	const int _prev;
+
+	Scope(const Scope &orig);
+	Scope &operator=(const Scope &orig);
+
+  public:
+	explicit Scope(int subsystem);
+	~Scope();
+};
+
+bool enabled(void);
+const char *subsystemName(int subsystem);
+void countRequest(void);
+unsigned long long requestCount(void);
+void snapshot(Stats (&stats)[N_SUBSYSTEMS], Stats &total);
+void threadTotals(unsigned long long &allocs, unsigned long long &bytes);
+void requestDump(void); // 시그널 핸들러에서 부른다
+bool takeDumpRequest(void);
+std::string report(void);
+} // namespace alloc
+} // namespace ft
+
+#ifdef ALLOC_PROFILE
+#define ALLOC_SCOPE(subsystem)                                                 \
+	ft::alloc::Scope alloc_scope_(ft::alloc::subsystem)
+#define ALLOC_COUNT_REQUEST() ft::alloc::countRequest()
+#else
+#define ALLOC_SCOPE(subsystem)
+#define ALLOC_COUNT_REQUEST()
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef UTILS_ARENA_HPP
+#define UTILS_ARENA_HPP
+
+#include <cstddef>
+
+namespace ft
+{
+/*
+ * 연결 하나가 만드는 요청 단위 객체를 담는 bump 할당기. 해제는 개수만
+ * 세고, 마지막 객체가 해제되면 (응답을 넘기고 핸들러가 사라지면) 첫 청크의
+ * 처음으로 되감는다. 청크의 절반보다 큰 객체는 힙에서 받는다.
+ *
+ * 블록 앞에 어느 아레나에서 왔는지 적어 두므로 해제할 때 아레나를 몰라도
+ * 된다. 연결이 끊겨도 아직 살아 있는 객체가 있으면 그것이 해제될 때까지
+ * 아레나를 지우지 않는다. 한 스레드에서만 쓴다.
+ *
+ * 핸들러가 값으로 가진 FileReader는 핸들러와 함께 담긴다. 그 밖의 두 가지는
+ * 힙에 남는다. FileReader의 PathTask는 FileTaskPool 스레드가 마지막으로
+ * 놓을 수 있어 해제가 이 스레드에서 일어난다는 보장이 없다. fd로 읽고 쓸 때
+ * 만드는 SingleIOProcessor는 CGI 핸들러와 업스트림/FastCGI 연결 풀만 쓰는데,
+ * 모두 연결보다 오래 살 수 있다.
+ */
+class Arena
+{
+  public:
+	// 프로세스 전체 값 (stub_status)
+	struct Stats
+	{
+		unsigned long long allocs;
+		unsigned long long heap_fallbacks;
+		unsigned long long resets;
+		long long arenas;      // 살아 있는 아레나 수
+		long long chunk_bytes; // 모든 아레나가 잡고 있는 청크 크기 합
+		long long high_water;  // 한 아레나가 한 번에 내준 가장 큰 바이트 수
+	};
+
+  private:
+	struct Chunk
+	{
+		Chunk *next;
+		size_t size;
+	};
+
+	static const size_t _chunk_size;
+	static const size_t _align;
+	static const size_t _header_size;
+
+	Chunk *_head;
+	Chunk *_current;
+	size_t _offset; // _current 안에서 다음에 내줄 위치
+	size_t _used;   // 되감은 뒤로 내준 바이트
+	size_t _live;   // 아직 해제되지 않은 블록 수
+	bool _retired;
+
+	Arena(const Arena &orig);
+	Arena &operator=(const Arena &orig);
+	~Arena();
+
+	Chunk *newChunk(void);
+	void release(void);
+	void rewind(void);
+
+  public:
+	Arena();
+
+	bool idle(void) const; // 살아 있는 객체가 없어 되감긴 상태
+	void *allocate(size_t size);
+	static void *allocateHeap(size_t size);
+	static void deallocate(void *ptr);
+	// 주인이 더는 쓰지 않는다. 살아 있는 객체가 없으면 바로 지운다
+	void retire(void);
+
+	static void snapshot(Stats &stats);
+};
+
+/*
+ * 상속하면 new (arena) T(...)로 아레나에 만들 수 있다. 그냥 new로 만든
+ * 객체는 힙에 있고, 어느 쪽이든 delete로 지운다.
+ */
+class ArenaObject
+{
+  public:
+	static void *operator new(size_t size);
+	static void *operator new(size_t size, Arena &arena);
+	static void operator delete(void *ptr);
+	static void operator delete(void *ptr, Arena &arena);
+};
+} // namespace ft
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef FT_LOCK_GUARD_HPP
+#define FT_LOCK_GUARD_HPP
+
+#include <pthread.h>
+
+namespace ft
+{
+class lock_guard
+{
+  private:
+	pthread_mutex_t &_mutex;
+
+	lock_guard(const lock_guard &orig);
+	lock_guard &operator=(const lock_guard &orig);
+
+  public:
+	explicit lock_guard(pthread_mutex_t &mutex)
+		: _mutex(mutex)
+	{
+		pthread_mutex_lock(&_mutex);
+	}
+
+	~lock_guard()
+	{
+		pthread_mutex_unlock(&_mutex);
+	}
+};
+} // namespace ft
+
+#endif
@@ -6,53 +6,227 @@
 namespace ft
 {
 template <typename T>
+class shared_ptr;
+
+/*
+ * 참조 카운트를 객체 안에 두는 기반 클래스. 이를 상속한 타입은
+ * shared_ptr<T>(new T(...))로 만들어도 카운트를 따로 할당하지 않는다.
+ * 카운트는 원자적이지 않다. 이벤트 루프 스레드는 각자 만든 객체만
+ * 소유하므로, 여러 스레드가 함께 복사하거나 해제할 객체만 AtomicRefCounted를
+ * 상속한다.
+ */
+class RefCounted
+{
+  private:
+	mutable size_t _refs;
+	const bool _atomic;
+
+	template <typename T>
+	friend class shared_ptr;
+
+	void retain(void) const
+	{
+		if (_atomic)
+			__sync_add_and_fetch(&_refs, 1);
+		else
+			_refs++;
+	}
+
+	// 마지막 참조였으면 true
+	bool release(void) const
+	{
+		if (_atomic)
+			return (__sync_sub_and_fetch(&_refs, 1) == 0);
+		return (--_refs == 0);
+	}
+
+  protected:
+	explicit RefCounted(const bool atomic = false)
+		: _refs(0)
+		, _atomic(atomic)
+	{
+	}
+
+	// 복사본은 새 객체이므로 카운트를 물려받지 않는다
+	RefCounted(const RefCounted &orig)
+		: _refs(0)
+		, _atomic(orig._atomic)
+	{
+	}
+
+	RefCounted &operator=(const RefCounted &orig)
+	{
+		(void)orig;
+		return (*this);
+	}
+
+  public:
+	virtual ~RefCounted()
+	{
+	}
+};
+
+class AtomicRefCounted : public RefCounted
+{
+  protected:
+	AtomicRefCounted()
+		: RefCounted(true)
+	{
+	}
+};
+
+namespace detail
+{
+// RefCounted를 상속하지 않은 객체의 카운트. 해제할 때 객체도 지운다
+template <typename T>
+class PointerHolder : public RefCounted
+{
+  private:
+	T *_ptr;
+
+	PointerHolder(const PointerHolder &orig);
+	PointerHolder &operator=(const PointerHolder &orig);
+
+  public:
+	explicit PointerHolder(T *ptr)
+		: _ptr(ptr)
+	{
+	}
+
+	virtual ~PointerHolder()
+	{
+		delete _ptr;
+	}
+};
+
+// make_shared가 카운트와 객체를 한 번에 할당할 때 쓴다
+template <typename T>
+class InlineHolder : public RefCounted
+{
+  private:
+	InlineHolder(const InlineHolder &orig);
+	InlineHolder &operator=(const InlineHolder &orig);
+
+  public:
+	T value;
+
+	InlineHolder()
+		: value()
+	{
+	}
+
+	template <typename A1>
+	explicit InlineHolder(const A1 &a1)
+		: value(a1)
+	{
+	}
+
+	template <typename A1, typename A2>
+	InlineHolder(const A1 &a1, const A2 &a2)
+		: value(a1, a2)
+	{
+	}
+
+	template <typename A1, typename A2, typename A3>
+	InlineHolder(const A1 &a1, const A2 &a2, const A3 &a3)
+		: value(a1, a2, a3)
+	{
+	}
+
+	template <typename A1, typename A2, typename A3, typename A4>
+	InlineHolder(const A1 &a1, const A2 &a2, const A3 &a3, const A4 &a4)
+		: value(a1, a2, a3, a4)
+	{
+	}
+};
+
+// T*에서 RefCounted*로의 변환이 void*로의 변환보다 우선하므로 RefCounted를
+// 상속한 타입은 첫 번째 함수로 간다
+template <typename T>
+RefCounted *adopt(T *ptr, const RefCounted *)
+{
+	return (ptr);
+}
+
+template <typename T>
+RefCounted *adopt(T *ptr, const void *)
+{
+	return (new PointerHolder<T>(ptr));
+}
+} // namespace detail
+
+// 참조 카운트의 원자성은 위 RefCounted의 설명을 따른다. NULL을 가리키는
+// shared_ptr은 아무것도 할당하지 않는다.
+template <typename T>
 class shared_ptr
 {
   private:
 	T *_ptr;
-	size_t *_count;
+	RefCounted *_owner; // _ptr의 수명을 관리하는 카운트. NULL이면 빈 포인터
+
+	template <typename U>
+	friend class shared_ptr;
+
+	void release(void)
+	{
+		if (_owner != NULL && _owner->release())
+			delete _owner;
+	}
 
   public:
 	shared_ptr(T *ptr = NULL)
 		: _ptr(ptr)
-		, _count(new size_t(1))
+		, _owner(ptr == NULL ? NULL : detail::adopt(ptr, ptr))
 	{
-		(*_count) = 1;
+		if (_owner != NULL)
+			_owner->retain();
+	}
+
+	// owner가 수명을 관리하는 객체 안의 ptr을 가리킨다 (make_shared)
+	shared_ptr(T *ptr, RefCounted *owner)
+		: _ptr(ptr)
+		, _owner(owner)
+	{
+		if (_owner != NULL)
+			_owner->retain();
 	}
 
 	shared_ptr(const shared_ptr &orig)
 		: _ptr(orig._ptr)
-		, _count(orig._count)
+		, _owner(orig._owner)
 	{
-		(*_count)++;
+		if (_owner != NULL)
+			_owner->retain();
 	}
 
-	shared_ptr &operator=(const shared_ptr &orig)
+	// 파생 클래스를 가리키는 포인터를 기반 클래스 포인터로 옮길 때
+	template <typename U>
+	shared_ptr(const shared_ptr<U> &orig)
+		: _ptr(orig._ptr)
+		, _owner(orig._owner)
 	{
-		if (this == &orig)
-			return (*this);
-
-		(*_count)--;
-		if ((*_count) == 0)
-		{
-			delete _ptr;
-			delete _count;
-		}
+		if (_owner != NULL)
+			_owner->retain();
+	}
 
+	shared_ptr &operator=(const shared_ptr &orig)
+	{
+		if (orig._owner != NULL)
+			orig._owner->retain();
+		release();
 		_ptr = orig._ptr;
-		_count = orig._count;
-		(*_count)++;
+		_owner = orig._owner;
 		return (*this);
 	}
 
 	~shared_ptr()
 	{
-		(*_count)--;
-		if ((*_count) == 0)
-		{
-			delete _ptr;
-			delete _count;
-		}
+		release();
+	}
+
+	T *get(void) const
+	{
+		return (_ptr);
 	}
 
 	T &operator*(void)
@@ -75,6 +249,49 @@ class shared_ptr
 		return (_ptr);
 	}
 };
+
+/*
+ * 카운트와 객체를 한 번에 할당한다. C++98에는 완벽한 전달이 없으므로 인자는
+ * const 참조로만 넘어간다. 비 const 참조를 받는 생성자는 new로 만들고,
+ * 그런 타입은 RefCounted를 상속해 할당을 한 번으로 줄인다.
+ */
+template <typename T>
+shared_ptr<T> make_shared(void)
+{
+	detail::InlineHolder<T> *holder = new detail::InlineHolder<T>();
+	return (shared_ptr<T>(&holder->value, holder));
+}
+
+template <typename T, typename A1>
+shared_ptr<T> make_shared(const A1 &a1)
+{
+	detail::InlineHolder<T> *holder = new detail::InlineHolder<T>(a1);
+	return (shared_ptr<T>(&holder->value, holder));
+}
+
+template <typename T, typename A1, typename A2>
+shared_ptr<T> make_shared(const A1 &a1, const A2 &a2)
+{
+	detail::InlineHolder<T> *holder = new detail::InlineHolder<T>(a1, a2);
+	return (shared_ptr<T>(&holder->value, holder));
+}
+
+template <typename T, typename A1, typename A2, typename A3>
+shared_ptr<T> make_shared(const A1 &a1, const A2 &a2, const A3 &a3)
+{
+	detail::InlineHolder<T> *holder
+		= new detail::InlineHolder<T>(a1, a2, a3);
+	return (shared_ptr<T>(&holder->value, holder));
+}
+
+template <typename T, typename A1, typename A2, typename A3, typename A4>
+shared_ptr<T>
+make_shared(const A1 &a1, const A2 &a2, const A3 &a3, const A4 &a4)
+{
+	detail::InlineHolder<T> *holder
+		= new detail::InlineHolder<T>(a1, a2, a3, a4);
+	return (shared_ptr<T>(&holder->value, holder));
+}
 } // namespace ft
 
 #endif
@@ -0,0 +1,12 @@
+#ifndef UTILS_TIME_HPP
+#define UTILS_TIME_HPP
+
+typedef unsigned long long msec_t;
+typedef unsigned long long usec_t;
+
+// 시스템 시각이 바뀌어도 거꾸로 가지 않는 벽시계 (밀리초).
+// clock(3)은 프로세스의 CPU 시간이라 이벤트 루프가 쉬는 동안 멈춘다.
+msec_t monotonicMs(void);
+usec_t monotonicUs(void);
+
+#endif
@@ -0,0 +1,231 @@
+#include "CGI/FastCGIPool.hpp"
+#include "CGI/spawn.hpp"
+#include "async/status.hpp"
+#include "utils/string.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace CGI;
+
+const int FastCGIPool::_max_requests_per_worker = 1000;
+const time_t FastCGIPool::_respawn_interval = 1;
+volatile int FastCGIPool::_n_pools = 0;
+
+FastCGIPool::Connection::Connection(const int fd)
+	: fd(fd)
+	, io(fd, async::SingleIOProcessor::IO_RW)
+{
+}
+
+FastCGIPool::Connection::~Connection()
+{
+	::close(fd);
+}
+
+FastCGIPool::FastCGIPool(const std::string &exec_path,
+						 const std::string &socket_dir,
+						 const size_t n_workers)
+	: _exec_path(exec_path)
+	, _socket_path(socket_dir + "/fcgi_" + toStr(getpid()) + "_"
+				   + toStr(__sync_fetch_and_add(&_n_pools, 1)) + ".sock")
+	, _n_workers(n_workers)
+	, _listen_fd(-1)
+	, _n_busy(0)
+	, _respawn_after(0)
+	, _logger(async::Logger::getLogger("FastCGIPool"))
+{
+}
+
+FastCGIPool::~FastCGIPool()
+{
+	while (!_idle.empty())
+	{
+		delete _idle.front();
+		_idle.pop_front();
+	}
+	for (std::set<pid_t>::iterator it = _workers.begin(); it != _workers.end();
+		 it++)
+		::kill(*it, SIGTERM);
+	for (std::set<pid_t>::iterator it = _workers.begin(); it != _workers.end();
+		 it++)
+		::waitpid(*it, NULL, 0);
+	if (_listen_fd >= 0)
+	{
+		::close(_listen_fd);
+		::unlink(_socket_path.c_str());
+	}
+}
+
+void FastCGIPool::start(void)
+{
+	struct sockaddr_un addr;
+
+	if (_socket_path.size() >= sizeof(addr.sun_path))
+		throw(std::runtime_error("FastCGI socket path too long: "
+								 + _socket_path));
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strcpy(addr.sun_path, _socket_path.c_str());
+
+	_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (_listen_fd < 0)
+		throw(std::runtime_error(std::string("Failed to create socket: ")
+								 + strerror(errno)));
+	::fcntl(_listen_fd, F_SETFD, FD_CLOEXEC);
+	::unlink(_socket_path.c_str());
+	if (::bind(_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+		|| ::listen(_listen_fd, SOMAXCONN) < 0)
+	{
+		std::string reason = strerror(errno);
+		::close(_listen_fd);
+		_listen_fd = -1;
+		throw(std::runtime_error("Failed to listen on " + _socket_path + ": "
+								 + reason));
+	}
+	LOG_INFO("Starting " << _n_workers << " FastCGI workers for "
+						 << _exec_path << " at " << _socket_path);
+	for (size_t i = 0; i < _n_workers; i++)
+		spawn();
+}
+
+pid_t FastCGIPool::spawn(void)
+{
+	const std::string max_requests
+		= "FCGI_MAX_REQUESTS=" + toStr(_max_requests_per_worker);
+	char *argv[] = {const_cast<char *>(_exec_path.c_str()), NULL};
+	char *envp[] = {const_cast<char *>(max_requests.c_str()), NULL};
+	posix_spawn_file_actions_t file_actions;
+
+	if (posix_spawn_file_actions_init(&file_actions) != 0)
+	{
+		LOG_ERROR("Failed to initialize spawn file actions");
+		return (-1);
+	}
+	posix_spawn_file_actions_adddup2(&file_actions, _listen_fd, STDIN_FILENO);
+	inheritFd(file_actions, STDOUT_FILENO);
+	inheritFd(file_actions, STDERR_FILENO);
+	pid_t pid = spawnProcess(_exec_path, argv, envp, &file_actions);
+	int error = errno;
+	posix_spawn_file_actions_destroy(&file_actions);
+	if (pid < 0)
+	{
+		LOG_ERROR("Failed to spawn FastCGI worker: " << strerror(error));
+		return (pid);
+	}
+	_workers.insert(pid);
+	LOG_VERBOSE("Spawned FastCGI worker " << pid);
+	return (pid);
+}
+
+// 종료된 워커를 거두고 빈 자리를 채운다. 실행 자체가 실패하는 경우 spawn을
+// 반복하지 않도록 비정상 종료 뒤에는 일정 시간 기다린다.
+void FastCGIPool::maintain(void)
+{
+	int wait_status;
+	for (std::set<pid_t>::iterator it = _workers.begin(); it != _workers.end();)
+	{
+		pid_t pid = *it++;
+		if (::waitpid(pid, &wait_status, WNOHANG) != pid)
+			continue;
+		_workers.erase(pid);
+		if (WIFEXITED(wait_status) && WEXITSTATUS(wait_status) == 0)
+			LOG_VERBOSE("FastCGI worker " << pid << " recycled");
+		else
+		{
+			LOG_WARNING("FastCGI worker " << pid << " of " << _exec_path
+										  << " exited abnormally");
+			_respawn_after = time(NULL) + _respawn_interval;
+		}
+	}
+	if (time(NULL) < _respawn_after)
+		return;
+	while (_workers.size() < _n_workers && spawn() > 0)
+		;
+}
+
+FastCGIPool::Connection *FastCGIPool::connect(void)
+{
+	struct sockaddr_un addr;
+
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strcpy(addr.sun_path, _socket_path.c_str());
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		LOG_WARNING("Failed to create socket: " << strerror(errno));
+		return (NULL);
+	}
+	::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	::fcntl(fd, F_SETFL, O_NONBLOCK);
+	// 워커가 밀려 있어도 이벤트 루프를 막지 않는다. 진행 중이면 UpstreamPool
+	// 처럼 쓰기 이벤트로 끝난 것을 안다. 리눅스는 backlog가 차면 EAGAIN을
+	// 주므로 NULL을 돌려주고 다음 루프에서 다시 시도한다
+	if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+		&& errno != EINPROGRESS)
+	{
+		if (errno == EAGAIN)
+			LOG_DEBUG("FastCGI backlog of " << _socket_path << " is full");
+		else
+			LOG_WARNING("Failed to connect to " << _socket_path << ": "
+												<< strerror(errno));
+		::close(fd);
+		return (NULL);
+	}
+	return (new Connection(fd));
+}
+
+FastCGIPool::Connection *FastCGIPool::acquire(bool &reused)
+{
+	if (_listen_fd < 0)
+		start();
+	maintain();
+	while (!_idle.empty())
+	{
+		Connection *conn = _idle.front();
+		_idle.pop_front();
+		// 재활용되어 종료된 워커와의 연결은 버린다
+		if (conn->io.stat() >= async::status::ERROR_GENERIC)
+		{
+			delete conn;
+			continue;
+		}
+		reused = true;
+		_n_busy++;
+		return (conn);
+	}
+	if (_n_busy >= _workers.size())
+		return (NULL);
+	Connection *conn = connect();
+	if (conn == NULL)
+		return (NULL);
+	reused = false;
+	_n_busy++;
+	return (conn);
+}
+
+void FastCGIPool::release(Connection *conn, const bool reusable)
+{
+	_n_busy--;
+	if (reusable && conn->io.stat() < async::status::ERROR_GENERIC)
+		_idle.push_back(conn);
+	else
+		delete conn;
+}
+
+const std::string &FastCGIPool::getExecPath(void) const
+{
+	return (_exec_path);
+}
+
+size_t FastCGIPool::nWorkers(void) const
+{
+	return (_n_workers);
+}
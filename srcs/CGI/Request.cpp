@@ -2,73 +2,85 @@
 #include "CGI/const_values.hpp"
 #include "utils/string.hpp"
 #include <algorithm>
+#include <cctype>
 
 using namespace CGI;
 
 const std::string Request::_version = "1.1";
 
+static std::map<std::string, std::string>
+buildDefaultMetaVariables(const std::string &version)
+{
+	std::map<std::string, std::string> defaults;
+
+	for (size_t i = 0; i < META_VARIABLES.size(); i++)
+		defaults.insert(defaults.end(), std::make_pair(META_VARIABLES[i], ""));
+	defaults["GATEWAY_INTERFACE"] = "CGI/" + version;
+	defaults["SERVER_PROTOCOL"] = "HTTP/1.1";
+	return (defaults);
+}
+
+// 요청과 상관없는 값은 한 번만 만들어 두고 요청마다 복사해 시작한다
+const Request::_MetaVariables &Request::defaultMetaVariables(void)
+{
+	static const _MetaVariables defaults = buildDefaultMetaVariables(_version);
+
+	return (defaults);
+}
+
 Request::Request(const HTTP::Request &http_req,
 				 const std::string &resource_path)
-	: _message_body(http_req.getBody())
+	: _meta_variables(defaultMetaVariables())
+	, _message_body(http_req.getBody())
 	, _logger(async::Logger::getLogger("CGIRequest"))
 {
-	for (size_t i = 0; i < META_VARIABLES.size(); i++)
-	{
-		const std::string &name = META_VARIABLES[i];
-		_meta_variables.insert(std::pair<std::string, std::string>(name, ""));
-	}
-	std::string content_length = toStr<size_t>(http_req.getBody().size());
-	std::string content_type = http_req.hasHeaderValue("Content-Type")
-								   ? http_req.getHeaderValue("Content-Type", 0)
-								   : "";
-	std::string host_header = http_req.getHeaderValue("Host", 0);
-	size_t colon_pos = host_header.find(':');
-	std::string server_name;
-	std::string server_port;
+	const std::string &host_header = http_req.getHeaderValue("Host", 0);
+	const size_t colon_pos = host_header.find(':');
+
+	_meta_variables["CONTENT_LENGTH"] = toStr<size_t>(_message_body.size());
+	if (http_req.hasHeaderValue("Content-Type"))
+		_meta_variables["CONTENT_TYPE"]
+			= http_req.getHeaderValue("Content-Type", 0);
+	_meta_variables["PATH_INFO"] = http_req.getURIPath();
+	_meta_variables["PATH_TRANSLATED"] = resource_path;
+	_meta_variables["QUERY_STRING"] = http_req.getQueryString();
+	_meta_variables["REQUEST_METHOD"] = http_req.getMethodString();
 	if (colon_pos == std::string::npos)
 	{
-		server_name = host_header;
-		server_port = "80";
+		_meta_variables["SERVER_NAME"] = host_header;
+		_meta_variables["SERVER_PORT"] = "80";
 	}
 	else
 	{
-		server_name = getfrontstr(host_header, colon_pos);
-		server_port = getbackstr(host_header, colon_pos + 1);
+		_meta_variables["SERVER_NAME"] = getfrontstr(host_header, colon_pos);
+		_meta_variables["SERVER_PORT"] = getbackstr(host_header, colon_pos + 1);
 	}
 
-	_meta_variables["CONTENT_LENGTH"] = content_length;
-	_meta_variables["CONTENT_TYPE"] = content_type;
-	_meta_variables["GATEWAY_INTERFACE"] = "CGI/" + _version;
-	_meta_variables["PATH_INFO"] = http_req.getURIPath();
-	_meta_variables["PATH_TRANSLATED"] = resource_path;
-	_meta_variables["QUERY_STRING"] = http_req.getQueryString();
-	_meta_variables["REQUEST_METHOD"] = http_req.getMethodString();
-	_meta_variables["SERVER_PROTOCOL"] = "HTTP/1.1";
-	_meta_variables["SERVER_NAME"] = server_name;
-	_meta_variables["SERVER_PORT"] = server_port;
-
 	const Header &header = http_req.getHeader();
 	for (Header::const_iterator it = header.begin(); it != header.end(); it++)
 	{
 		if (!isProtocolSpecificHeader(it->first))
 			continue;
 
-		const std::string http_meta_variable_name = toHTTPvarname(it->first);
-		std::string value;
-
 		const std::vector<std::string> &values = it->second;
+		size_t value_size = 0;
+		for (size_t i = 0; i < values.size(); i++)
+			value_size += values[i].size() + 2;
+
+		std::string value;
+		value.reserve(value_size);
 		for (size_t i = 0; i < values.size(); i++)
 		{
-			value += values[i];
-			if (i + 1 != values.size())
+			if (i > 0)
 				value += ", ";
+			value += values[i];
 		}
-		addMetaVariable(http_meta_variable_name, value);
-		LOG_VERBOSE("name:" << http_meta_variable_name << ": " << value);
+		_meta_variables[toHTTPvarname(it->first)].swap(value);
 	}
 
-	for (std::map<std::string, std::string>::iterator it
-		 = _meta_variables.begin();
+	if (!LOG_ENABLED(VERBOSE))
+		return;
+	for (_MetaVariables::iterator it = _meta_variables.begin();
 		 it != _meta_variables.end();
 		 it++)
 		LOG_VERBOSE("CGI metavariable \"" << it->first << "\"=\"" << it->second
@@ -98,15 +110,17 @@ bool Request::isProtocolSpecificHeader(const std::string &name) const
 
 std::string Request::toHTTPvarname(const std::string &var_name) const
 {
-	static const std::string prefix = "HTTP_";
-	std::string http_var_name = var_name;
-
-	std::transform(http_var_name.begin(),
-				   http_var_name.end(),
-				   http_var_name.begin(),
-				   ::toupper);
-	std::replace(http_var_name.begin(), http_var_name.end(), '-', '_');
-	return (prefix + http_var_name);
+	static const char prefix[] = "HTTP_";
+	std::string http_var_name;
+
+	http_var_name.reserve(sizeof(prefix) - 1 + var_name.size());
+	http_var_name = prefix;
+	for (size_t i = 0; i < var_name.size(); i++)
+	{
+		const char c = var_name[i];
+		http_var_name += (c == '-') ? '_' : std::toupper(c);
+	}
+	return (http_var_name);
 }
 
 const Request &Request::operator=(const Request &orig)
@@ -115,25 +129,44 @@ const Request &Request::operator=(const Request &orig)
 	{
 		_meta_variables = orig._meta_variables;
 		_message_body = orig._message_body;
+		_env_arena.clear();
+		_envp.clear();
 	}
 	return (*this);
 }
 
+// 변수마다 할당하지 않도록 크기를 먼저 재서 버퍼 하나에 모두 담는다
 char *const *Request::getEnv(void) const
 {
-	char **env = new char *[_meta_variables.size() + 1];
-	int i = 0;
-	for (std::map<std::string, std::string>::const_iterator it
-		 = _meta_variables.begin();
+	if (!_envp.empty())
+		return (&_envp[0]);
+
+	size_t arena_size = 0;
+	for (_MetaVariables::const_iterator it = _meta_variables.begin();
+		 it != _meta_variables.end();
+		 it++)
+		arena_size += it->first.size() + it->second.size() + 2;
+	_env_arena.resize(arena_size);
+	_envp.reserve(_meta_variables.size() + 1);
+
+	char *cursor = &_env_arena[0];
+	for (_MetaVariables::const_iterator it = _meta_variables.begin();
 		 it != _meta_variables.end();
 		 it++)
 	{
-		const std::string &name = it->first;
-		const std::string &value = it->second;
-		env[i++] = duplicateStr((name + "=" + value));
+		_envp.push_back(cursor);
+		cursor = std::copy(it->first.begin(), it->first.end(), cursor);
+		*cursor++ = '=';
+		cursor = std::copy(it->second.begin(), it->second.end(), cursor);
+		*cursor++ = '\0';
 	}
-	env[_meta_variables.size()] = NULL;
-	return ((char *const *)env);
+	_envp.push_back(NULL);
+	return (&_envp[0]);
+}
+
+const std::map<std::string, std::string> &Request::getMetaVariables(void) const
+{
+	return (_meta_variables);
 }
 
 const std::string &Request::getMessageBody(void) const
@@ -148,9 +181,9 @@ const std::string &Request::getPath() const
 
 void Request::addMetaVariable(const std::string &name, const std::string &value)
 {
-	if (_meta_variables.find(name) == _meta_variables.end())
-		_meta_variables.insert(std::pair<std::string, std::string>(name, ""));
 	_meta_variables[name] = value;
+	_env_arena.clear();
+	_envp.clear();
 }
 
 std::string Request::getMethod(void) const
@@ -1,13 +1,19 @@
 #include "CGI/RequestHandler.hpp"
+#include "CGI/const_values.hpp"
+#include "HTTP/ParsingFail.hpp"
 #include "utils/string.hpp"
+#include <cerrno>
 #include <cstdlib>
+#include <csignal>
+#include <cstring>
 #include <sys/wait.h>
 #include <unistd.h>
 
 using namespace CGI;
-typedef unsigned long long ull_t;
 
-const size_t RequestHandler::pipeThreshold = 1024;
+const size_t RequestHandler::_max_header_size = 64 * 1024;
+const size_t RequestHandler::_output_high_watermark = 256 * 1024;
+const size_t RequestHandler::_output_low_watermark = 64 * 1024;
 
 RequestHandler::RequestHandler(const Request &request,
 							   const std::string &exec_path,
@@ -17,16 +23,41 @@ RequestHandler::RequestHandler(const Request &request,
 	, _writer(NULL)
 	, _exec_path(exec_path)
 	, _pid(-1)
+	, _watcher(NULL)
 	, _waitpid_status(-1)
 	, _status(CGI_RESPONSE_INNER_STATUS_BEGIN)
 	, _timeout_ms(timeout_ms)
 	, _timeout(0)
 	, _logger(async::Logger::getLogger("CGIRequestHandler"))
+	, _head_parsed(false)
+	, _head_retrieved(false)
+	, _chunked(false)
+	, _body_remaining(0)
+	, _output_paused(false)
+	, _caching(false)
+	, _cache_ttl_ms(0)
+	, _cache_stale_ms(0)
 {
 }
 
 RequestHandler::~RequestHandler()
 {
+	// 채우지 못한 항목을 기다리는 핸들러가 직접 실행하도록 알린다
+	if (_caching)
+	{
+		if (_cache_entry->state == ResponseCache::Entry::PENDING)
+			_cache_entry->state = ResponseCache::Entry::FAILED;
+		_cache_entry->revalidating = false;
+	}
+	delete _watcher;
+	// 제한 시간을 넘겼거나 클라이언트가 떠나 거두지 못한 자식이 좀비로
+	// 남지 않게 한다
+	if (_pid > 0)
+	{
+		kill(_pid, SIGKILL);
+		::waitpid(_pid, NULL, 0);
+		LOG_DEBUG("killed CGI process " << _pid);
+	}
 }
 
 char **RequestHandler::getArgv(void)
@@ -38,6 +69,37 @@ char **RequestHandler::getArgv(void)
 	return (output);
 }
 
+// argv는 요청마다 한 번 만들고 spawn 직후 해제한다. envp는 _request가
+// 가지고 있다. file_actions도 여기서 해제한다.
+void RequestHandler::spawnChild(posix_spawn_file_actions_t &file_actions)
+{
+	char **argv = getArgv();
+	char *const *envp = _request.getEnv();
+
+	// CGI의 오류 메시지가 서버의 stderr로 가도록 물려준다
+	inheritFd(file_actions, STDERR_FILENO);
+	_pid = spawnProcess(_exec_path, argv, envp, &file_actions);
+	int error = errno;
+	posix_spawn_file_actions_destroy(&file_actions);
+	deleteStrArray(argv);
+	if (_pid < 0)
+		throw(std::runtime_error("failed to spawn " + _exec_path + ": "
+								 + strerror(error)));
+	_watcher = new async::ProcessWatcher(_pid);
+	LOG_DEBUG("spawned CGI process " << _pid);
+}
+
+// 종료 통지를 받기 전에는 waitpid(2)를 부르지 않는다. 거두었으면 true.
+bool RequestHandler::reapChild(void)
+{
+	if (!_watcher->exited())
+		return (false);
+	if (::waitpid(_pid, &_waitpid_status, 0) < 0)
+		throw(std::runtime_error("failed to waitpid"));
+	_pid = -1;
+	return (true);
+}
+
 void RequestHandler::setTimeout(void)
 {
 	if (_timeout_ms == 0)
@@ -45,14 +107,14 @@ void RequestHandler::setTimeout(void)
 		_timeout = 0;
 		return;
 	}
-	_timeout = clock() + ((ull_t)_timeout_ms * (ull_t)(CLOCKS_PER_SEC / 1000));
+	_timeout = monotonicMs() + _timeout_ms;
 }
 
 bool RequestHandler::checkTimeout(void)
 {
 	if (_timeout == 0)
 		return (false);
-	if (clock() > _timeout)
+	if (monotonicMs() > _timeout)
 		throw(std::runtime_error("Timeout occured while executing CGI "
 								 + _exec_path));
 	return (false);
@@ -65,7 +127,177 @@ const CGI::Response &RequestHandler::retrieve(void)
 	return (_response);
 }
 
+// CGI 출력이 도착하는 대로 넘긴다. 빈 줄까지 모이면 헤더를 파싱하고
+// 그 뒤로는 본문을 바로 _body_buf에 쌓는다.
+void RequestHandler::feedOutput(const std::string &data)
+{
+	std::string body;
+
+	if (data.empty())
+		return;
+	if (_caching)
+	{
+		_cache_output += data;
+		if (_cache_output.size() > ResponseCache::max_output_size)
+		{
+			LOG_DEBUG("CGI output is too large to cache");
+			_caching = false;
+			_cache_output.clear();
+			if (_cache_entry->state == ResponseCache::Entry::PENDING)
+				_cache_entry->state = ResponseCache::Entry::FAILED;
+			_cache_entry->revalidating = false;
+		}
+	}
+	if (_head_parsed)
+		body = data;
+	else
+	{
+		_header_buf += data;
+		if (!_response.parseHeader(_header_buf))
+		{
+			if (_header_buf.size() > _max_header_size)
+				throw(HTTP::InvalidFormat());
+			return;
+		}
+		_head_parsed = true;
+		_chunked = !_response.hasContentLength();
+		if (!_chunked)
+			_body_remaining = _response.getContentLength();
+		body.swap(_header_buf);
+		_disk_capture.setHead(
+			_response.getStatusCode(), "", _response.getHeader());
+		LOG_DEBUG("CGI header parsed, streaming body"
+				  << (_chunked ? " as chunked" : ""));
+	}
+	if (body.empty())
+		return;
+	if (_chunked)
+	{
+		_disk_capture.appendBody(body);
+		std::ostringstream chunk_size;
+		chunk_size << std::hex << body.size();
+		_body_buf += chunk_size.str() + CRLF + body + CRLF;
+		return;
+	}
+	if (body.size() > _body_remaining)
+	{
+		LOG_WARNING(_exec_path << " wrote more than its Content-Length");
+		body.erase(_body_remaining);
+	}
+	_disk_capture.appendBody(body);
+	_body_buf += body;
+	_body_remaining -= body.size();
+}
+
+// CGI 출력이 끝났을 때 부른다
+void RequestHandler::finishOutput(void)
+{
+	if (!_head_parsed)
+		throw(HTTP::InvalidFormat());
+	if (_chunked)
+		_body_buf += "0" + CRLF + CRLF;
+	else if (_body_remaining > 0)
+		throw(std::runtime_error(_exec_path
+								 + " wrote less than its Content-Length"));
+	_disk_capture.end();
+	if (_caching)
+		storeCacheEntry();
+}
+
+void RequestHandler::cacheOutput(const ResponseCache::EntryPtr &entry,
+								 const msec_t ttl_ms,
+								 const msec_t stale_ms)
+{
+	_caching = true;
+	_cache_entry = entry;
+	_cache_ttl_ms = ttl_ms;
+	_cache_stale_ms = stale_ms;
+}
+
+// 다시 실행해 얻은 출력이 캐시할 수 없는 것이면 옛 항목을 그대로 둔다.
+// 옛 항목도 stale_until이 지나면 쓰이지 않는다.
+void RequestHandler::storeCacheEntry(void)
+{
+	_caching = false;
+	_cache_entry->revalidating = false;
+	try
+	{
+		if (ResponseCache::fill(
+				*_cache_entry, _cache_output, _cache_ttl_ms, _cache_stale_ms))
+			LOG_DEBUG("stored CGI output of " << _exec_path << " in cache");
+		else if (_cache_entry->state == ResponseCache::Entry::PENDING)
+			_cache_entry->state = ResponseCache::Entry::FAILED;
+	}
+	catch (const std::exception &e)
+	{
+		if (_cache_entry->state == ResponseCache::Entry::PENDING)
+			_cache_entry->state = ResponseCache::Entry::FAILED;
+	}
+	_cache_output.clear();
+}
+
+// 아직 클라이언트에 넘기지 않은 응답 헤더가 있는지
+bool RequestHandler::hasHead(void) const
+{
+	return (_head_parsed && !_head_retrieved);
+}
+
+HTTP::Response RequestHandler::retrieveHead(void)
+{
+	HTTP::Response head = _response.toHTTPResponseHead();
+
+	_head_retrieved = true;
+	_disk_capture.annotate(head);
+	return (head);
+}
+
+// 헤더를 이미 보냈으면 오류 응답으로 바꿀 수 없다
+bool RequestHandler::headRetrieved(void) const
+{
+	return (_head_retrieved);
+}
+
+bool RequestHandler::hasBody(void) const
+{
+	return (_head_retrieved && !_body_buf.empty());
+}
+
+std::string RequestHandler::retrieveBody(void)
+{
+	std::string body;
+
+	body.swap(_body_buf);
+	return (body);
+}
+
+HTTP::DiskCache::Capture &RequestHandler::diskCapture(void)
+{
+	return (_disk_capture);
+}
+
 std::string RequestHandler::getMethod(void) const
 {
 	return (_request.getMethod());
 }
+
+const Request &RequestHandler::getRequest(void) const
+{
+	return (_request);
+}
+
+const std::string &RequestHandler::getExecPath(void) const
+{
+	return (_exec_path);
+}
+
+// 요청마다 자식 프로세스를 띄우는지. Server가 동시 실행 수를 제한할 때 쓴다
+bool RequestHandler::spawnsProcess(void) const
+{
+	return (true);
+}
+
+// 출력을 feedOutput으로 흘려보내 디스크 캐시에 담을 수 있는지
+bool RequestHandler::capturesOutput(void) const
+{
+	return (true);
+}
@@ -0,0 +1,48 @@
+#include "CGI/RequestHandler.hpp"
+
+using namespace CGI;
+
+RequestHandlerCached::RequestHandlerCached(const Request &request,
+										   const std::string &exec_path,
+										   const ResponseCache::EntryPtr &entry,
+										   const unsigned int timeout_ms)
+	: RequestHandler(request, exec_path, timeout_ms)
+	, _entry(entry)
+{
+	setTimeout();
+}
+
+RequestHandlerCached::~RequestHandlerCached()
+{
+}
+
+int RequestHandlerCached::task(void)
+{
+	if (_status == CGI_RESPONSE_INNER_STATUS_OK)
+		return (CGI_RESPONSE_STATUS_OK);
+	switch (_entry->state)
+	{
+	case ResponseCache::Entry::READY: {
+		std::string output = _entry->output;
+		_response.makeResponse(output);
+		_status = CGI_RESPONSE_INNER_STATUS_OK;
+		return (CGI_RESPONSE_STATUS_OK);
+	}
+	case ResponseCache::Entry::PENDING:
+		checkTimeout();
+		return (CGI_RESPONSE_STATUS_AGAIN);
+	default:
+		throw(ResponseCache::Unavailable());
+	}
+}
+
+bool RequestHandlerCached::spawnsProcess(void) const
+{
+	return (false);
+}
+
+// 이미 ResponseCache에 있는 출력이므로 다시 담지 않는다
+bool RequestHandlerCached::capturesOutput(void) const
+{
+	return (false);
+}
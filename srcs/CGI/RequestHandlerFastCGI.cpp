@@ -0,0 +1,143 @@
+#include "CGI/RequestHandler.hpp"
+#include "CGI/fastcgi.hpp"
+
+using namespace CGI;
+
+const int RequestHandlerFastCGI::_request_id = 1;
+
+RequestHandlerFastCGI::RequestHandlerFastCGI(const Request &request,
+											 const FastCGIPoolPtr &pool,
+											 const unsigned int timeout_ms)
+	: RequestHandler(request, pool->getExecPath(), timeout_ms)
+	, _pool(pool)
+	, _conn(NULL)
+	, _reused(false)
+	, _received(false)
+	, _retried(false)
+{
+	const std::map<std::string, std::string> &meta_variables
+		= _request.getMetaVariables();
+	std::string params;
+
+	for (std::map<std::string, std::string>::const_iterator it
+		 = meta_variables.begin();
+		 it != meta_variables.end();
+		 it++)
+		fcgi::appendNameValue(params, it->first, it->second);
+	fcgi::appendBeginRequest(_request_records, _request_id, true);
+	fcgi::appendStream(_request_records, fcgi::PARAMS, _request_id, params);
+	fcgi::appendStream(_request_records,
+					   fcgi::STDIN,
+					   _request_id,
+					   _request.getMessageBody());
+	// 워커를 기다리는 시간까지 포함해 제한 시간을 잰다
+	setTimeout();
+}
+
+RequestHandlerFastCGI::~RequestHandlerFastCGI()
+{
+	// 응답을 끝까지 받지 못한 연결은 다음 요청에 쓸 수 없다
+	if (_conn)
+		releaseConnection(false);
+}
+
+void RequestHandlerFastCGI::releaseConnection(const bool reusable)
+{
+	_pool->release(_conn, reusable);
+	_conn = NULL;
+}
+
+int RequestHandlerFastCGI::acquireConnection(void)
+{
+	_conn = _pool->acquire(_reused);
+	if (_conn == NULL)
+	{
+		LOG_DEBUG("all FastCGI workers are busy");
+		checkTimeout();
+		_status = CGI_RESPONSE_INNER_STATUS_CONNECT_AGAIN;
+		return (CGI_RESPONSE_STATUS_AGAIN);
+	}
+	_conn->io.setWriteBuf(_request_records);
+	_status = CGI_RESPONSE_INNER_STATUS_RW_AGAIN;
+	return (CGI_RESPONSE_STATUS_AGAIN);
+}
+
+int RequestHandlerFastCGI::waitResponse(void)
+{
+	fcgi::Record record;
+
+	if (_output_paused)
+	{
+		if (_body_buf.size() > _output_low_watermark)
+			return (CGI_RESPONSE_STATUS_AGAIN);
+		_conn->io.resumeRead();
+		_output_paused = false;
+	}
+	_conn->io.getReadBuf(_rdbuf);
+	if (!_rdbuf.empty())
+		_received = true;
+	while (fcgi::consumeRecord(_rdbuf, record))
+	{
+		if (record.request_id != _request_id)
+			continue;
+		if (record.type == fcgi::STDOUT)
+			feedOutput(record.content);
+		else if (record.type == fcgi::STDERR)
+			LOG_WARNING(_exec_path << ": " << record.content);
+		else if (record.type == fcgi::END_REQUEST)
+		{
+			int app_status = fcgi::decodeEndRequestStatus(record.content);
+			releaseConnection(_rdbuf.empty());
+			if (app_status != 0)
+				throw(std::runtime_error("FastCGI application " + _exec_path
+										 + " failed"));
+			finishOutput();
+			_status = CGI_RESPONSE_INNER_STATUS_OK;
+			return (CGI_RESPONSE_STATUS_OK);
+		}
+	}
+
+	if (_body_buf.size() >= _output_high_watermark)
+	{
+		LOG_DEBUG("client is slow, pause reading FastCGI output");
+		_conn->io.pauseRead();
+		_output_paused = true;
+		return (CGI_RESPONSE_STATUS_AGAIN);
+	}
+	if (_conn->io.stat() >= async::status::ERROR_GENERIC)
+	{
+		releaseConnection(false);
+		// 재사용한 연결의 워커가 그새 재활용되었으면 한 번만 다시 보낸다
+		if (_reused && !_received && !_retried)
+		{
+			LOG_DEBUG("FastCGI connection was closed, retrying");
+			_retried = true;
+			return (acquireConnection());
+		}
+		throw(std::runtime_error("FastCGI connection to " + _exec_path
+								 + " closed before end of request"));
+	}
+	checkTimeout();
+	return (CGI_RESPONSE_STATUS_AGAIN);
+}
+
+int RequestHandlerFastCGI::task(void)
+{
+	LOG_DEBUG("status : " << _status);
+	switch (_status)
+	{
+	case CGI_RESPONSE_INNER_STATUS_BEGIN:
+	case CGI_RESPONSE_INNER_STATUS_CONNECT_AGAIN:
+		return (acquireConnection());
+	case CGI_RESPONSE_INNER_STATUS_RW_AGAIN:
+		return (waitResponse());
+	default:
+		return (CGI_RESPONSE_STATUS_OK);
+	}
+}
+
+// 워커 수는 풀이 제한하므로 동시 실행 제한에서 뺀다
+bool RequestHandlerFastCGI::spawnsProcess(void) const
+{
+	return (false);
+}
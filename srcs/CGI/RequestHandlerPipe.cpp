@@ -1,5 +1,6 @@
 #include "CGI/RequestHandler.hpp"
 #include <cstdlib>
+#include <fcntl.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -33,6 +34,13 @@ RequestHandlerPipe::RequestHandlerPipe(const Request &request,
 		closeAllPipes();
 		throw(std::runtime_error("Constructor: Failed to create pipe."));
 	}
+	// 동시에 실행되는 다른 CGI 자식에게 파이프가 새지 않도록 한다.
+	// 자식의 stdin/stdout으로 dup2된 사본은 플래그가 지워진다.
+	for (int i = 0; i < 2; i++)
+	{
+		::fcntl(_read_pipe_fd[i], F_SETFD, FD_CLOEXEC);
+		::fcntl(_write_pipe_fd[i], F_SETFD, FD_CLOEXEC);
+	}
 
 	LOG_DEBUG("read_pipe[0]: " << _read_pipe_fd[0]);
 	LOG_DEBUG("read_pipe[1]: " << _read_pipe_fd[1]);
@@ -52,39 +60,22 @@ RequestHandlerPipe::~RequestHandlerPipe()
 	delete _reader;
 }
 
-int RequestHandlerPipe::fork()
+int RequestHandlerPipe::spawn()
 {
-	_pid = ::fork();
-	if (_pid < 0)
-	{
-		throw(std::runtime_error("failed to fork"));
-	}
-	else if (_pid == 0)
-	{
-		if (::dup2(_write_pipe_fd[0], STDIN_FILENO) < 0
-			|| ::dup2(_read_pipe_fd[1], STDOUT_FILENO) < 0)
-		{
-			LOG_DEBUG("failed to dup2");
-			std::exit(2);
-		}
-		closePipe(_write_pipe_fd[0]);
-		closePipe(_write_pipe_fd[1]);
-		closePipe(_read_pipe_fd[0]);
-		closePipe(_read_pipe_fd[1]);
-		LOG_DEBUG("calling execve(" << _exec_path.c_str() << "), good bye!");
-		execve(_exec_path.c_str(), getArgv(), _request.getEnv());
-		std::exit(2);
-	}
-	else
-	{
-		LOG_DEBUG("successed to fork.");
-		closePipe(_write_pipe_fd[0]);
-		closePipe(_read_pipe_fd[1]);
+	posix_spawn_file_actions_t file_actions;
+
+	if (posix_spawn_file_actions_init(&file_actions) != 0)
+		throw(std::runtime_error("failed to initialize spawn file actions"));
+	posix_spawn_file_actions_adddup2(
+		&file_actions, _write_pipe_fd[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(
+		&file_actions, _read_pipe_fd[1], STDOUT_FILENO);
+	spawnChild(file_actions);
+	closePipe(_write_pipe_fd[0]);
+	closePipe(_read_pipe_fd[1]);
 
-		_status = CGI_RESPONSE_INNER_STATUS_RW_AGAIN;
-		return (CGI_RESPONSE_STATUS_AGAIN);
-	}
-	return (CGI_RESPONSE_STATUS_OK);
+	_status = CGI_RESPONSE_INNER_STATUS_RW_AGAIN;
+	return (CGI_RESPONSE_STATUS_AGAIN);
 }
 
 int RequestHandlerPipe::waitRWOperation()
@@ -110,23 +101,35 @@ int RequestHandlerPipe::waitRWOperation()
 		}
 	}
 
-	if (_reader)
+	if (_reader && _output_paused
+		&& _body_buf.size() <= _output_low_watermark)
+	{
+		LOG_DEBUG("resume reading CGI output");
+		_reader->resume();
+		_output_paused = false;
+	}
+	if (_reader && !_output_paused)
 	{
 		switch (_reader->task())
 		{
 		case async::status::OK_DONE: {
 			LOG_DEBUG("read status is ok");
-			LOG_DEBUG("buffer: " << _reader->retrieve());
-
-			std::string cgi_output = _reader->retrieve();
+			feedOutput(_reader->retrievePartial());
+			finishOutput();
 			closePipe(_read_pipe_fd[0]);
-			_response.makeResponse(cgi_output);
 			delete _reader;
 			_reader = NULL;
 			break;
 		}
 		case async::status::OK_AGAIN: {
 			LOG_DEBUG("read status is again");
+			feedOutput(_reader->retrievePartial());
+			if (_body_buf.size() >= _output_high_watermark)
+			{
+				LOG_DEBUG("client is slow, pause reading CGI output");
+				_reader->pause();
+				_output_paused = true;
+			}
 			break;
 		}
 		case async::status::ERROR_TIMEOUT:
@@ -148,13 +151,7 @@ int RequestHandlerPipe::waitRWOperation()
 
 int RequestHandlerPipe::waitExecution()
 {
-	pid_t pid = ::waitpid(_pid, &_waitpid_status, WNOHANG);
-
-	if (pid < 0)
-	{
-		throw(std::runtime_error("failed to waitpid"));
-	}
-	else if (pid == 0)
+	if (!reapChild())
 	{
 		LOG_DEBUG("waiting child");
 		checkTimeout();
@@ -179,7 +176,7 @@ int RequestHandlerPipe::task(void)
 	switch (_status)
 	{
 	case CGI_RESPONSE_INNER_STATUS_BEGIN:
-		return (fork());
+		return (spawn());
 	case CGI_RESPONSE_INNER_STATUS_RW_AGAIN:
 		return (waitRWOperation());
 	case CGI_RESPONSE_INNER_STATUS_WAITPID_AGAIN:
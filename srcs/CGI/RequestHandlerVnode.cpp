@@ -4,6 +4,7 @@
 #include "utils/string.hpp"
 #include <cstdio>
 #include <cstdlib>
+#include <fcntl.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -57,57 +58,31 @@ int RequestHandlerVnode::waitWriteInputOperation(void)
 	return (CGI_RESPONSE_STATUS_OK);
 }
 
-int RequestHandlerVnode::fork()
+int RequestHandlerVnode::spawn()
 {
-	_pid = ::fork();
-	if (_pid < 0)
-	{
-		throw(std::runtime_error("failed to fork"));
-	}
-	else if (_pid == 0)
-	{
-		FILE *input_stream = fopen(_input_file_path.c_str(), "r");
-		FILE *output_stream = fopen(_output_file_path.c_str(), "w");
-		if (!input_stream || !output_stream)
-		{
-			LOG_ERROR("Failed to create temporary files");
-			async::Logger::blockingWriteAll();
-			std::exit(2);
-		}
-		int input_fd = fileno(input_stream);
-		int output_fd = fileno(output_stream);
-		if (::dup2(input_fd, STDIN_FILENO) < 0
-			|| ::dup2(output_fd, STDOUT_FILENO) < 0)
-		{
-			LOG_ERROR("failed to dup2");
-			async::Logger::blockingWriteAll();
-			std::exit(2);
-		}
-		fclose(input_stream);
-		fclose(output_stream);
-		LOG_DEBUG("calling execve(" << _exec_path.c_str() << "), good bye!");
-		execve(_exec_path.c_str(), getArgv(), _request.getEnv());
-		std::exit(2);
-	}
-	else
-	{
-		LOG_DEBUG("successed to fork.");
-		setTimeout();
-		_status = CGI_RESPONSE_INNER_STATUS_WAITPID_AGAIN;
-		return (CGI_RESPONSE_STATUS_AGAIN);
-	}
-	return (CGI_RESPONSE_STATUS_OK);
+	posix_spawn_file_actions_t file_actions;
+
+	if (posix_spawn_file_actions_init(&file_actions) != 0)
+		throw(std::runtime_error("failed to initialize spawn file actions"));
+	posix_spawn_file_actions_addopen(&file_actions,
+									 STDIN_FILENO,
+									 _input_file_path.c_str(),
+									 O_RDONLY,
+									 0);
+	posix_spawn_file_actions_addopen(&file_actions,
+									 STDOUT_FILENO,
+									 _output_file_path.c_str(),
+									 O_WRONLY | O_CREAT | O_TRUNC,
+									 0644);
+	spawnChild(file_actions);
+	setTimeout();
+	_status = CGI_RESPONSE_INNER_STATUS_WAITPID_AGAIN;
+	return (CGI_RESPONSE_STATUS_AGAIN);
 }
 
 int RequestHandlerVnode::waitExecution()
 {
-	pid_t pid = ::waitpid(_pid, &_waitpid_status, WNOHANG);
-
-	if (pid < 0)
-	{
-		throw(std::runtime_error("failed to waitpid"));
-	}
-	else if (pid == 0)
+	if (!reapChild())
 	{
 		LOG_DEBUG("waiting child");
 		checkTimeout();
@@ -133,8 +108,8 @@ int RequestHandlerVnode::waitReadOutputOperation(void)
 	{
 	case async::status::OK_DONE: {
 		LOG_DEBUG("read status is ok");
-		LOG_DEBUG("buffer: " << _reader->retrieve());
 		std::string cgi_output = _reader->retrieve();
+		LOG_DEBUG("buffer: " << cgi_output);
 		_response.makeResponse(cgi_output);
 		delete _reader;
 		_reader = NULL;
@@ -163,7 +138,7 @@ int RequestHandlerVnode::task(void)
 	case CGI_RESPONSE_INNER_STATUS_BEGIN:
 		return (waitWriteInputOperation());
 	case CGI_RESPONSE_INNER_STATUS_FORK_AGAIN:
-		return (fork());
+		return (spawn());
 	case CGI_RESPONSE_INNER_STATUS_WAITPID_AGAIN:
 		return (waitExecution());
 	case CGI_RESPONSE_INNER_STATUS_READ_AGAIN:
@@ -172,3 +147,9 @@ int RequestHandlerVnode::task(void)
 		return (CGI_RESPONSE_STATUS_OK);
 	}
 }
+
+// 출력을 파일에서 한 번에 읽어 오므로 feedOutput을 거치지 않는다
+bool RequestHandlerVnode::capturesOutput(void) const
+{
+	return (false);
+}
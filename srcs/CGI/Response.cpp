@@ -1,5 +1,6 @@
 #include "CGI/Response.hpp"
 #include "CGI/const_values.hpp"
+#include "HTTP/DiskCache.hpp"
 #include "HTTP/ParsingFail.hpp"
 #include "HTTP/Response.hpp"
 #include "utils/string.hpp"
@@ -34,7 +35,18 @@ const CGI::Response &CGI::Response::operator=(const Response &orig)
 
 void CGI::Response::makeResponse(std::string &cgi_output)
 {
-	while (cgi_output.substr(0, CRLF_LEN) != CRLF)
+	if (!parseHeader(cgi_output))
+		throw(HTTP::InvalidFormat());
+	_response_body = cgi_output;
+}
+
+// 빈 줄까지 도착했으면 헤더를 소비하고 true, 아직이면 그대로 두고 false
+bool CGI::Response::parseHeader(std::string &cgi_output)
+{
+	if (cgi_output.compare(0, CRLF_LEN, CRLF) != 0
+		&& cgi_output.find(CRLF + CRLF) == std::string::npos)
+		return (false);
+	while (cgi_output.compare(0, CRLF_LEN, CRLF) != 0)
 		consumeHeader(cgi_output);
 	consumestr(cgi_output, CRLF_LEN);
 
@@ -50,8 +62,7 @@ void CGI::Response::makeResponse(std::string &cgi_output)
 	}
 	else
 		_status_code = 200;
-
-	_response_body = cgi_output;
+	return (true);
 }
 
 void CGI::Response::consumeHeader(std::string &buffer)
@@ -81,6 +92,35 @@ void CGI::Response::consumeHeader(std::string &buffer)
 		_header.insert(name, values);
 }
 
+bool CGI::Response::hasContentLength(void) const
+{
+	return (_header.hasValue("Content-Length"));
+}
+
+size_t CGI::Response::getContentLength(void) const
+{
+	const std::vector<std::string> values = _header.getValues("Content-Length");
+	if (values.size() != 1 || !isUnsignedIntStr(values[0]))
+		throw(HTTP::InvalidFormat());
+	return (toNum<size_t>(values[0]));
+}
+
+int CGI::Response::getStatusCode(void) const
+{
+	return (_status_code);
+}
+
+// 응답을 캐시해도 되는 시간(초). 아무 지시도 없으면 -1, 캐시하면 안 되면 0.
+long CGI::Response::getMaxAge(void) const
+{
+	return (HTTP::DiskCache::getMaxAge(_header));
+}
+
+const Header &CGI::Response::getHeader(void) const
+{
+	return (_header);
+}
+
 HTTP::Response CGI::Response::toHTTPResponse(void) const
 {
 	HTTP::Response http_response(_header);
@@ -90,3 +130,14 @@ HTTP::Response CGI::Response::toHTTPResponse(void) const
 	http_response.setStatus(_status_code);
 	return (http_response);
 }
+
+// 본문은 따로 흘려보낸다. 길이를 모르면 chunked로 보낸다.
+HTTP::Response CGI::Response::toHTTPResponseHead(void) const
+{
+	HTTP::Response http_response(_header);
+
+	if (!hasContentLength())
+		http_response.setValue("Transfer-Encoding", "chunked");
+	http_response.setStatus(_status_code);
+	return (http_response);
+}
@@ -0,0 +1,123 @@
+#include "CGI/ResponseCache.hpp"
+#include "CGI/Response.hpp"
+
+using namespace CGI;
+
+const size_t ResponseCache::max_output_size = 1024 * 1024;
+const size_t ResponseCache::_max_entries = 256;
+
+ResponseCache::Unavailable::Unavailable(void)
+	: std::runtime_error("cached CGI output is not available")
+{
+}
+
+ResponseCache::Entry::Entry(void)
+	: state(PENDING)
+	, fresh_until(0)
+	, stale_until(0)
+	, revalidating(false)
+{
+}
+
+ResponseCache::ResponseCache()
+{
+}
+
+ResponseCache::~ResponseCache()
+{
+}
+
+// 실행 파일, 스크립트, 쿼리 문자열과 설정에서 고른 요청 헤더로 구분한다
+std::string ResponseCache::makeKey(const std::string &exec_path,
+								   const Request &request,
+								   const std::vector<std::string> &vary)
+{
+	const std::map<std::string, std::string> &meta_variables
+		= request.getMetaVariables();
+	std::map<std::string, std::string>::const_iterator it;
+	std::string key = exec_path + '\0' + request.getPath() + '\0';
+
+	it = meta_variables.find("QUERY_STRING");
+	if (it != meta_variables.end())
+		key += it->second;
+	for (size_t i = 0; i < vary.size(); i++)
+	{
+		key += '\0';
+		it = meta_variables.find(request.toHTTPvarname(vary[i]));
+		if (it != meta_variables.end())
+			key += it->second;
+	}
+	return (key);
+}
+
+// 실행이 끝난 출력으로 항목을 채운다. 200이 아니거나 CGI가 캐시를
+// 막았으면 false. 유효 기간은 CGI 헤더가 정하고 없으면 설정값을 쓴다.
+bool ResponseCache::fill(Entry &entry,
+						 std::string output,
+						 const msec_t default_ttl_ms,
+						 const msec_t stale_ms)
+{
+	const std::string raw = output;
+	Response response;
+	msec_t ttl_ms = default_ttl_ms;
+
+	response.makeResponse(output);
+	if (response.getStatusCode() != 200)
+		return (false);
+	const long max_age = response.getMaxAge();
+	if (max_age == 0)
+		return (false);
+	if (max_age > 0)
+		ttl_ms = (msec_t)max_age * 1000;
+	entry.output = raw;
+	// 스트리밍할 때처럼 Content-Length 뒤의 출력은 버린다
+	if (response.hasContentLength()
+		&& output.size() > response.getContentLength())
+		entry.output.erase(raw.size() - output.size()
+						   + response.getContentLength());
+	entry.fresh_until = monotonicMs() + ttl_ms;
+	entry.stale_until = entry.fresh_until + stale_ms;
+	entry.state = Entry::READY;
+	return (true);
+}
+
+bool ResponseCache::find(const std::string &key, EntryPtr &entry)
+{
+	std::map<std::string, EntryPtr>::iterator it = _entries.find(key);
+
+	if (it == _entries.end())
+		return (false);
+	entry = it->second;
+	return (true);
+}
+
+// 키의 항목을 새 PENDING 항목으로 바꾼다. 옛 항목을 기다리던 핸들러는
+// 자신이 가진 포인터로 계속 기다린다.
+ResponseCache::EntryPtr ResponseCache::reserve(const std::string &key)
+{
+	EntryPtr entry = ft::make_shared<Entry>();
+
+	if (_entries.find(key) == _entries.end() && _entries.size() >= _max_entries)
+		evict();
+	_entries[key] = entry;
+	return (entry);
+}
+
+// 쓸 수 없게 된 항목을 먼저 버리고, 그래도 가득 차 있으면 아무거나 버린다
+void ResponseCache::evict(void)
+{
+	const msec_t now = monotonicMs();
+	std::map<std::string, EntryPtr>::iterator it = _entries.begin();
+
+	while (it != _entries.end())
+	{
+		if (it->second->state == Entry::FAILED
+			|| (it->second->state == Entry::READY
+				&& it->second->stale_until < now))
+			_entries.erase(it++);
+		else
+			it++;
+	}
+	if (_entries.size() >= _max_entries)
+		_entries.erase(_entries.begin());
+}
@@ -0,0 +1,167 @@
+#include "CGI/fastcgi.hpp"
+
+using namespace CGI;
+
+const unsigned char fcgi::VERSION = 1;
+const int fcgi::ROLE_RESPONDER = 1;
+const int fcgi::FLAG_KEEP_CONN = 1;
+const size_t fcgi::HEADER_LEN = 8;
+const size_t fcgi::MAX_CONTENT_LEN = 65535;
+
+static unsigned char byteAt(const std::string &str, const size_t idx)
+{
+	return (static_cast<unsigned char>(str[idx]));
+}
+
+// 본문을 8바이트 단위로 맞추도록 패딩을 붙인다
+void fcgi::appendRecord(std::string &out,
+						const int type,
+						const int request_id,
+						const std::string &content)
+{
+	const size_t content_len = content.size();
+	const size_t padding_len = (8 - content_len % 8) % 8;
+
+	out += static_cast<char>(VERSION);
+	out += static_cast<char>(type);
+	out += static_cast<char>((request_id >> 8) & 0xff);
+	out += static_cast<char>(request_id & 0xff);
+	out += static_cast<char>((content_len >> 8) & 0xff);
+	out += static_cast<char>(content_len & 0xff);
+	out += static_cast<char>(padding_len);
+	out += '\0';
+	out += content;
+	out.append(padding_len, '\0');
+}
+
+// 스트림 레코드는 최대 길이 단위로 나누어 보내고 빈 레코드로 끝을 알린다
+void fcgi::appendStream(std::string &out,
+						const int type,
+						const int request_id,
+						const std::string &content)
+{
+	for (size_t pos = 0; pos < content.size(); pos += MAX_CONTENT_LEN)
+		appendRecord(
+			out, type, request_id, content.substr(pos, MAX_CONTENT_LEN));
+	appendRecord(out, type, request_id, "");
+}
+
+void fcgi::appendBeginRequest(std::string &out,
+							  const int request_id,
+							  const bool keep_conn)
+{
+	std::string body(8, '\0');
+
+	body[0] = static_cast<char>((ROLE_RESPONDER >> 8) & 0xff);
+	body[1] = static_cast<char>(ROLE_RESPONDER & 0xff);
+	body[2] = static_cast<char>(keep_conn ? FLAG_KEEP_CONN : 0);
+	appendRecord(out, BEGIN_REQUEST, request_id, body);
+}
+
+void fcgi::appendEndRequest(std::string &out,
+							const int request_id,
+							const int app_status,
+							const int protocol_status)
+{
+	std::string body(8, '\0');
+
+	body[0] = static_cast<char>((app_status >> 24) & 0xff);
+	body[1] = static_cast<char>((app_status >> 16) & 0xff);
+	body[2] = static_cast<char>((app_status >> 8) & 0xff);
+	body[3] = static_cast<char>(app_status & 0xff);
+	body[4] = static_cast<char>(protocol_status);
+	appendRecord(out, END_REQUEST, request_id, body);
+}
+
+static void appendLength(std::string &out, const size_t len)
+{
+	if (len < 128)
+	{
+		out += static_cast<char>(len);
+		return;
+	}
+	out += static_cast<char>(((len >> 24) & 0x7f) | 0x80);
+	out += static_cast<char>((len >> 16) & 0xff);
+	out += static_cast<char>((len >> 8) & 0xff);
+	out += static_cast<char>(len & 0xff);
+}
+
+void fcgi::appendNameValue(std::string &out,
+						   const std::string &name,
+						   const std::string &value)
+{
+	appendLength(out, name.size());
+	appendLength(out, value.size());
+	out += name;
+	out += value;
+}
+
+// 레코드 하나가 온전히 도착했으면 버퍼에서 떼어내고 true를 반환
+bool fcgi::consumeRecord(std::string &buffer, Record &record)
+{
+	if (buffer.size() < HEADER_LEN)
+		return (false);
+	const size_t content_len = (byteAt(buffer, 4) << 8) | byteAt(buffer, 5);
+	const size_t padding_len = byteAt(buffer, 6);
+	const size_t total_len = HEADER_LEN + content_len + padding_len;
+	if (buffer.size() < total_len)
+		return (false);
+	record.type = byteAt(buffer, 1);
+	record.request_id = (byteAt(buffer, 2) << 8) | byteAt(buffer, 3);
+	record.content = buffer.substr(HEADER_LEN, content_len);
+	buffer.erase(0, total_len);
+	return (true);
+}
+
+static bool consumeLength(const std::string &content, size_t &pos, size_t &len)
+{
+	if (pos >= content.size())
+		return (false);
+	if (!(byteAt(content, pos) & 0x80))
+	{
+		len = byteAt(content, pos++);
+		return (true);
+	}
+	if (pos + 4 > content.size())
+		return (false);
+	len = ((byteAt(content, pos) & 0x7f) << 24)
+		  | (byteAt(content, pos + 1) << 16) | (byteAt(content, pos + 2) << 8)
+		  | byteAt(content, pos + 3);
+	pos += 4;
+	return (true);
+}
+
+bool fcgi::decodeNameValues(const std::string &content,
+							std::map<std::string, std::string> &params)
+{
+	size_t pos = 0;
+	while (pos < content.size())
+	{
+		size_t name_len;
+		size_t value_len;
+		if (!consumeLength(content, pos, name_len)
+			|| !consumeLength(content, pos, value_len)
+			|| pos + name_len + value_len > content.size())
+			return (false);
+		const std::string name = content.substr(pos, name_len);
+		params[name] = content.substr(pos + name_len, value_len);
+		pos += name_len + value_len;
+	}
+	return (true);
+}
+
+int fcgi::decodeBeginRequestFlags(const std::string &content)
+{
+	if (content.size() < 3)
+		return (0);
+	return (byteAt(content, 2));
+}
+
+// 앱의 종료 상태를 반환. 요청이 정상 완료되지 않았으면 -1
+int fcgi::decodeEndRequestStatus(const std::string &content)
+{
+	if (content.size() < 5 || byteAt(content, 4) != REQUEST_COMPLETE)
+		return (-1);
+	return ((byteAt(content, 0) << 24) | (byteAt(content, 1) << 16)
+			| (byteAt(content, 2) << 8) | byteAt(content, 3));
+}
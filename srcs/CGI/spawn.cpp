@@ -0,0 +1,58 @@
+#include "CGI/spawn.hpp"
+#include <cerrno>
+#include <csignal>
+
+pid_t CGI::spawnProcess(const std::string &exec_path,
+						char *const *argv,
+						char *const *envp,
+						const posix_spawn_file_actions_t *file_actions)
+{
+	posix_spawnattr_t attr;
+	sigset_t signals;
+	short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+	pid_t pid;
+	int rc;
+
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+	// file action으로 넘긴 fd 외에는 아무것도 물려주지 않는다 (macOS)
+	flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#endif
+	if ((rc = posix_spawnattr_init(&attr)) != 0)
+	{
+		errno = rc;
+		return (-1);
+	}
+	sigemptyset(&signals);
+	posix_spawnattr_setsigmask(&attr, &signals);
+	sigaddset(&signals, SIGPIPE);
+	posix_spawnattr_setsigdefault(&attr, &signals);
+	posix_spawnattr_setflags(&attr, flags);
+	rc = posix_spawn(&pid, exec_path.c_str(), file_actions, &attr, argv, envp);
+	posix_spawnattr_destroy(&attr);
+	if (rc != 0)
+	{
+		errno = rc;
+		return (-1);
+	}
+	return (pid);
+}
+
+// POSIX_SPAWN_CLOEXEC_DEFAULT가 없으면 닫히지 않으므로 할 일이 없다
+void CGI::inheritFd(posix_spawn_file_actions_t &file_actions, const int fd)
+{
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+	posix_spawn_file_actions_addinherit_np(&file_actions, fd);
+#else
+	(void)file_actions;
+	(void)fd;
+#endif
+}
+
+void CGI::deleteStrArray(char *const *arr)
+{
+	if (!arr)
+		return;
+	for (size_t i = 0; arr[i]; i++)
+		delete[] arr[i];
+	delete[] arr;
+}
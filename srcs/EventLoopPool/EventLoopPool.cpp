@@ -0,0 +1,183 @@
+#include "EventLoopPool.hpp"
+#include "WebServer.hpp"
+#include "async/IOProcessor.hpp"
+#include "async/TCPIOProcessor.hpp"
+#include "async/status.hpp"
+#include "utils/lock_guard.hpp"
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+
+EventLoopPool::Loop::Loop(EventLoopPool &pool, const int id)
+	: pool(pool)
+	, id(id)
+	, n_clients(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+EventLoopPool::Loop::~Loop()
+{
+	while (!inbox.empty())
+	{
+		close(inbox.front().second);
+		inbox.pop();
+	}
+	pthread_mutex_destroy(&mutex);
+}
+
+void EventLoopPool::Loop::push(int port, int client_fd)
+{
+	ft::lock_guard lock(mutex);
+	inbox.push(std::pair<int, int>(port, client_fd));
+}
+
+size_t EventLoopPool::Loop::load(void)
+{
+	ft::lock_guard lock(mutex);
+	return (n_clients + inbox.size());
+}
+
+EventLoopPool::EventLoopPool(const ConfigContext &root_context,
+							 const int n_threads,
+							 const int balance,
+							 const int tcp_options)
+	: _root_context(root_context)
+	, _n_threads(n_threads)
+	, _balance(balance)
+	, _tcp_options(tcp_options)
+	, _next(0)
+	, _logger(async::Logger::getLogger("EventLoopPool"))
+{
+}
+
+EventLoopPool::~EventLoopPool()
+{
+	join();
+}
+
+void *EventLoopPool::runLoop(void *arg)
+{
+	Loop &loop = *static_cast<Loop *>(arg);
+	async::Logger &_logger = loop.pool._logger;
+
+	// 시그널은 acceptor가 있는 메인 스레드에서만 받는다
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	try
+	{
+		WebServer webserver(loop.pool._root_context,
+							loop.pool._tcp_options
+								| async::TCPIOProcessor::TCP_OPTION_NOLISTEN);
+		LOG_INFO("Event loop " << loop.id << " started");
+		while (true)
+		{
+			{
+				ft::lock_guard lock(loop.mutex);
+				while (!loop.inbox.empty())
+				{
+					webserver.adoptClient(loop.inbox.front().first,
+										  loop.inbox.front().second);
+					loop.inbox.pop();
+				}
+				loop.n_clients = webserver.nClients();
+			}
+			int rc = webserver.task();
+			if (rc != async::status::OK_AGAIN)
+				break;
+		}
+	}
+	catch (const std::exception &e)
+	{
+		LOG_ERROR("Event loop " << loop.id << " failed: " << e.what());
+		WebServer::setTerminationFlag();
+	}
+	LOG_INFO("Event loop " << loop.id << " stopped");
+	async::Logger::flush();
+	async::IOProcessor::releaseThread();
+	return (NULL);
+}
+
+void EventLoopPool::start(void)
+{
+	for (int i = 0; i < _n_threads; i++)
+	{
+		Loop *loop = new Loop(*this, i);
+		int result = pthread_create(&loop->thread, NULL, runLoop, loop);
+		if (result != 0)
+		{
+			delete loop;
+			WebServer::setTerminationFlag();
+			join();
+			throw(std::runtime_error(
+				std::string("Failed to create event loop thread: ")
+				+ strerror(result)));
+		}
+		_loops.push_back(loop);
+	}
+	LOG_INFO("Started " << _n_threads << " event loop threads");
+}
+
+void EventLoopPool::join(void)
+{
+	for (size_t i = 0; i < _loops.size(); i++)
+	{
+		pthread_join(_loops[i]->thread, NULL);
+		delete _loops[i];
+	}
+	_loops.clear();
+}
+
+EventLoopPool::Loop &EventLoopPool::pick(void)
+{
+	size_t picked = _next;
+	if (_balance == BALANCE_LEAST_CONN)
+	{
+		size_t min_load = _loops[picked]->load();
+		for (size_t i = 1; i < _loops.size() && min_load > 0; i++)
+		{
+			size_t idx = (_next + i) % _loops.size();
+			size_t load = _loops[idx]->load();
+			if (load < min_load)
+			{
+				min_load = load;
+				picked = idx;
+			}
+		}
+	}
+	_next = (picked + 1) % _loops.size();
+	return (*_loops[picked]);
+}
+
+int EventLoopPool::run(void)
+{
+	WebServer acceptor(_root_context,
+					   _tcp_options
+						   | async::TCPIOProcessor::TCP_OPTION_HANDOFF);
+	start();
+	try
+	{
+		int port;
+		int client_fd;
+		while (true)
+		{
+			int rc = acceptor.task();
+			while (acceptor.popAcceptedClient(port, client_fd))
+				pick().push(port, client_fd);
+			if (rc != async::status::OK_AGAIN)
+				break;
+		}
+	}
+	catch (...)
+	{
+		WebServer::setTerminationFlag();
+		join();
+		throw;
+	}
+	join();
+	return (0);
+}
@@ -0,0 +1,328 @@
+#include "HTTP/AccessLog.hpp"
+#include "utils/lock_guard.hpp"
+#include "utils/string.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace HTTP;
+
+int AccessLog::_fd = -1;
+int AccessLog::_format = AccessLog::FORMAT_COMBINED;
+std::string AccessLog::_path;
+volatile sig_atomic_t AccessLog::_reopen = 0;
+pthread_mutex_t AccessLog::_mutex = PTHREAD_MUTEX_INITIALIZER;
+const size_t AccessLog::_flush_size = 64 * 1024;
+const usec_t AccessLog::_flush_interval_us = 1000 * 1000;
+const size_t AccessLog::_max_buffer_size = 4 * 1024 * 1024;
+
+AccessLogTask::AccessLogTask(const int fd, std::string &data)
+	: fd(fd)
+{
+	this->data.swap(data);
+}
+
+void AccessLogTask::run(void)
+{
+	size_t written = 0;
+	while (written < data.size())
+	{
+		ssize_t n = ::write(fd, data.c_str() + written, data.size() - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		written += n;
+	}
+}
+
+AccessLog::Entry::Entry(void)
+	: status(0)
+	, bytes_sent(0)
+	, ready_at(0)
+	, first_byte_at(0)
+	, parsed_at(0)
+{
+}
+
+AccessLog::AccessLog(void)
+	: _last_flush(monotonicUs())
+	, _task(NULL)
+	, _dropped(0)
+	, _cached_sec(0)
+	, _logger(async::Logger::getLogger("AccessLog"))
+{
+}
+
+// 남은 줄을 모두 쓰고 끝낸다
+AccessLog::~AccessLog()
+{
+	flush(true);
+	if (_task)
+	{
+		while (!_task->isDone())
+			usleep(1000);
+		_task->release();
+	}
+}
+
+// 워커를 fork하기 전에 한 번 연다. 자식은 fd를 물려받는다
+void AccessLog::open(const std::string &path, const std::string &format)
+{
+	if (format == "combined")
+		_format = FORMAT_COMBINED;
+	else if (format == "json")
+		_format = FORMAT_JSON;
+	else
+		throw(std::runtime_error("Unknown access log format " + format));
+
+	int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+					0644);
+	if (fd < 0)
+		throw(std::runtime_error("Failed to open access log " + path + ": "
+								 + strerror(errno)));
+	if (_fd >= 0)
+		::close(_fd);
+	_fd = fd;
+	_path = path;
+}
+
+bool AccessLog::enabled(void)
+{
+	return (_fd >= 0);
+}
+
+// 시그널 핸들러에서 부른다
+void AccessLog::requestReopen(void)
+{
+	_reopen = 1;
+}
+
+// 새 파일을 원래 fd 번호에 덮어써서, 쓰는 중인 작업도 그대로 둔다
+void AccessLog::reopenIfRequested(void)
+{
+	if (!_reopen)
+		return;
+	ft::lock_guard lock(_mutex);
+	if (!_reopen)
+		return;
+	_reopen = 0;
+
+	async::Logger &_logger = async::Logger::getLogger("AccessLog");
+	int fd = ::open(_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+					0644);
+	if (fd < 0)
+	{
+		LOG_ERROR("Failed to reopen access log " << _path << ": "
+												 << strerror(errno));
+		return;
+	}
+	::dup2(fd, _fd);
+	::close(fd);
+	LOG_INFO("Reopened access log " << _path);
+}
+
+// 같은 초 안에서는 시각 문자열을 다시 만들지 않는다
+const std::string &AccessLog::localTime(void)
+{
+	const time_t now = time(NULL);
+
+	if (now != _cached_sec)
+	{
+		struct tm tstruct;
+		char buf[64];
+		localtime_r(&now, &tstruct);
+		if (_format == FORMAT_JSON)
+			strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S%z", &tstruct);
+		else
+			strftime(buf, sizeof(buf), "%d/%b/%Y:%H:%M:%S %z", &tstruct);
+		_cached_time = buf;
+		_cached_sec = now;
+	}
+	return (_cached_time);
+}
+
+static usec_t elapsed(usec_t from, usec_t to)
+{
+	if (from == 0 || to < from)
+		return (0);
+	return (to - from);
+}
+
+// nginx처럼 따옴표와 출력할 수 없는 문자는 \xHH로 쓴다
+static void appendEscaped(std::string &out, const std::string &value)
+{
+	for (size_t i = 0; i < value.size(); i++)
+	{
+		const unsigned char c = value[i];
+		if (c == '"' || c == '\\' || c < 0x20 || c >= 0x7f)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\x%02X", c);
+			out.append(buf);
+		}
+		else
+			out.push_back(c);
+	}
+}
+
+static void appendQuoted(std::string &out, const std::string &value)
+{
+	out.push_back('"');
+	if (value.empty())
+		out.push_back('-');
+	appendEscaped(out, value);
+	out.push_back('"');
+}
+
+static void appendJSONString(std::string &out, const std::string &value)
+{
+	out.push_back('"');
+	for (size_t i = 0; i < value.size(); i++)
+	{
+		const unsigned char c = value[i];
+		if (c == '"' || c == '\\')
+		{
+			out.push_back('\\');
+			out.push_back(c);
+		}
+		else if (c < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			out.append(buf);
+		}
+		else
+			out.push_back(c);
+	}
+	out.push_back('"');
+}
+
+/* 127.0.0.1 - - [19/Oct/2026:10:34:43 +0900] "GET /index.html HTTP/1.1" 200
+ * 612 "-" "curl/7.88.1" wait_us=120 parse_us=15 handler_us=340 */
+void AccessLog::appendCombined(const Entry &entry, usec_t done_at)
+{
+	std::string &out = _buffer;
+
+	out.append(entry.remote_addr.empty() ? "-" : entry.remote_addr);
+	out.append(" - - [");
+	out.append(localTime());
+	out.append("] \"");
+	if (entry.method.empty())
+		out.push_back('-');
+	else
+	{
+		appendEscaped(out, entry.method);
+		out.push_back(' ');
+		appendEscaped(out, entry.uri);
+		out.push_back(' ');
+		appendEscaped(out, entry.protocol);
+	}
+	out.append("\" ");
+	out.append(toStr(entry.status));
+	out.push_back(' ');
+	out.append(toStr(entry.bytes_sent));
+	out.push_back(' ');
+	appendQuoted(out, entry.referer);
+	out.push_back(' ');
+	appendQuoted(out, entry.user_agent);
+	out.append(" wait_us=");
+	out.append(toStr(elapsed(entry.ready_at, entry.first_byte_at)));
+	out.append(" parse_us=");
+	out.append(toStr(elapsed(entry.first_byte_at, entry.parsed_at)));
+	out.append(" handler_us=");
+	out.append(toStr(elapsed(entry.parsed_at, done_at)));
+	out.push_back('\n');
+}
+
+void AccessLog::appendJSON(const Entry &entry, usec_t done_at)
+{
+	std::string &out = _buffer;
+
+	out.append("{\"time\":\"");
+	out.append(localTime());
+	out.append("\",\"remote_addr\":");
+	appendJSONString(out, entry.remote_addr);
+	out.append(",\"method\":");
+	appendJSONString(out, entry.method);
+	out.append(",\"uri\":");
+	appendJSONString(out, entry.uri);
+	out.append(",\"protocol\":");
+	appendJSONString(out, entry.protocol);
+	out.append(",\"host\":");
+	appendJSONString(out, entry.host);
+	out.append(",\"status\":");
+	out.append(toStr(entry.status));
+	out.append(",\"bytes_sent\":");
+	out.append(toStr(entry.bytes_sent));
+	out.append(",\"referer\":");
+	appendJSONString(out, entry.referer);
+	out.append(",\"user_agent\":");
+	appendJSONString(out, entry.user_agent);
+	out.append(",\"wait_us\":");
+	out.append(toStr(elapsed(entry.ready_at, entry.first_byte_at)));
+	out.append(",\"parse_us\":");
+	out.append(toStr(elapsed(entry.first_byte_at, entry.parsed_at)));
+	out.append(",\"handler_us\":");
+	out.append(toStr(elapsed(entry.parsed_at, done_at)));
+	out.append("}\n");
+}
+
+// 파일 쓰기가 밀려 버퍼가 상한을 넘으면 줄을 버리고 센다
+void AccessLog::append(const Entry &entry, usec_t done_at)
+{
+	if (!enabled())
+		return;
+	if (_buffer.size() >= _max_buffer_size)
+	{
+		_dropped++;
+		return;
+	}
+	if (_format == FORMAT_JSON)
+		appendJSON(entry, done_at);
+	else
+		appendCombined(entry, done_at);
+	if (_buffer.size() >= _flush_size)
+		flush();
+}
+
+void AccessLog::submit(void)
+{
+	_task = new AccessLogTask(_fd, _buffer);
+	_buffer.clear();
+	_last_flush = monotonicUs();
+	async::FileTaskPool::submit(_task);
+}
+
+// 이벤트 루프가 매번 부른다. 쓰는 작업은 한 번에 하나만 둔다
+void AccessLog::flush(bool force)
+{
+	if (!enabled())
+		return;
+	reopenIfRequested();
+	if (_task)
+	{
+		if (force)
+			while (!_task->isDone())
+				usleep(1000);
+		if (!_task->isDone())
+			return;
+		_task->release();
+		_task = NULL;
+	}
+	if (_dropped > 0)
+	{
+		LOG_WARNING(_dropped << " access log lines dropped, "
+							 << "writes are falling behind");
+		_dropped = 0;
+	}
+	if (_buffer.empty())
+		return;
+	if (!force && _buffer.size() < _flush_size
+		&& monotonicUs() - _last_flush < _flush_interval_us)
+		return;
+	submit();
+}
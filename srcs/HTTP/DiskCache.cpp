@@ -0,0 +1,469 @@
+#include "HTTP/DiskCache.hpp"
+#include "HTTP/const_values.hpp"
+#include "utils/hash.hpp"
+#include "utils/string.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace HTTP;
+
+const size_t DiskCache::max_object_size = 8 * 1024 * 1024;
+const size_t DiskCache::_max_size_default = 64 * 1024 * 1024;
+
+DiskCacheTask::DiskCacheTask(const int mode,
+							 const std::string &path,
+							 const std::string &data)
+	: mode(mode)
+	, path(path)
+	, data(data)
+	, ok(false)
+{
+}
+
+void DiskCacheTask::run(void)
+{
+	if (mode == MODE_REMOVE)
+	{
+		ok = (::unlink(path.c_str()) == 0);
+		return;
+	}
+	// 상위 디렉토리부터 차례로 만든다. 이미 있으면 EEXIST
+	for (size_t pos = path.find('/', 1); pos != std::string::npos;
+		 pos = path.find('/', pos + 1))
+	{
+		if (::mkdir(path.substr(0, pos).c_str(), 0700) < 0 && errno != EEXIST)
+			return;
+	}
+	int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return;
+	size_t written = 0;
+	while (written < data.size())
+	{
+		ssize_t n = ::write(fd, data.c_str() + written, data.size() - written);
+		if (n < 0)
+			break;
+		written += n;
+	}
+	::close(fd);
+	ok = (written == data.size());
+	if (!ok)
+		::unlink(path.c_str());
+}
+
+DiskCache::Entry::Entry(const std::string &key,
+						const std::string &path,
+						const size_t size,
+						const msec_t ttl_ms)
+	: key(key)
+	, path(path)
+	, size(size)
+	, stored_at(monotonicMs())
+	, expires(stored_at + ttl_ms)
+	, stored(false)
+	, task(NULL)
+{
+}
+
+// 적중한 응답을 읽는 핸들러도 참조를 가지므로 그동안은 파일이 남는다
+DiskCache::Entry::~Entry()
+{
+	if (task)
+		task->release();
+	if (!stored)
+		return;
+	DiskCacheTask *remove_task
+		= new DiskCacheTask(DiskCacheTask::MODE_REMOVE, path, "");
+	async::FileTaskPool::submit(remove_task);
+	remove_task->release();
+}
+
+DiskCache::Capture::Capture(void)
+	: cache_status(STATUS_NONE)
+	, enabled(false)
+	, complete(false)
+	, ttl_ms(0)
+	, status_code(0)
+{
+}
+
+void DiskCache::Capture::begin(const std::string &key, const msec_t ttl_ms)
+{
+	cache_status = STATUS_MISS;
+	enabled = true;
+	this->key = key;
+	this->ttl_ms = ttl_ms;
+}
+
+// 200이 아니거나, 쿠키를 심거나, 요청 헤더에 따라 달라지거나, 백엔드가
+// 캐시를 막은 응답은 보관하지 않는다. 유효 기간은 응답 헤더가 우선한다.
+void DiskCache::Capture::setHead(const int status_code,
+								 const std::string &reason,
+								 const Header &header)
+{
+	static const char *skipped[]
+		= {"Transfer-Encoding", "Content-Length", "Connection", "Keep-Alive",
+		   "Date", "Status", "X-Cache", "Age", NULL};
+
+	if (!enabled)
+		return;
+	if (status_code != 200)
+	{
+		enabled = false;
+		return;
+	}
+	const long max_age = getMaxAge(header);
+	if (max_age == 0)
+	{
+		enabled = false;
+		return;
+	}
+	if (max_age > 0)
+		ttl_ms = static_cast<msec_t>(max_age) * 1000;
+	this->status_code = status_code;
+	this->reason = reason;
+	if (this->reason.empty())
+	{
+		std::map<int, std::string>::const_iterator it
+			= STATUS_CODE.find(status_code);
+		this->reason = (it != STATUS_CODE.end()) ? it->second : "OK";
+	}
+	for (Header::const_iterator it = header.begin(); it != header.end(); it++)
+	{
+		const char *name = it->first.c_str();
+		if (strcasecmp(name, "Set-Cookie") == 0
+			|| strcasecmp(name, "Vary") == 0)
+		{
+			enabled = false;
+			return;
+		}
+		bool skip = false;
+		for (size_t i = 0; skipped[i] && !skip; i++)
+			skip = (strcasecmp(name, skipped[i]) == 0);
+		if (!skip)
+			this->header.insert(it->first, it->second);
+	}
+}
+
+void DiskCache::Capture::appendBody(const std::string &data)
+{
+	if (!enabled)
+		return;
+	if (body.size() + data.size() > max_object_size)
+	{
+		enabled = false;
+		body.clear();
+		return;
+	}
+	body += data;
+}
+
+void DiskCache::Capture::end(void)
+{
+	complete = true;
+}
+
+void DiskCache::Capture::annotate(Response &head) const
+{
+	if (cache_status == STATUS_BYPASS)
+		head.setValue("X-Cache", "BYPASS");
+	else if (cache_status == STATUS_MISS)
+		head.setValue("X-Cache", "MISS");
+}
+
+DiskCache::DiskCache()
+	: _max_size(_max_size_default)
+	, _serial(0)
+{
+	_stats.hits = 0;
+	_stats.misses = 0;
+	_stats.bypasses = 0;
+	_stats.stores = 0;
+	_stats.evictions = 0;
+	_stats.entries = 0;
+	_stats.bytes = 0;
+}
+
+// 종료할 때는 쓰는 중인 파일을 기다렸다가 모두 직접 지운다
+DiskCache::~DiskCache()
+{
+	for (size_t i = 0; i < _pending.size(); i++)
+	{
+		while (!_pending[i]->task->isDone())
+			::usleep(1000);
+		if (_pending[i]->task->ok)
+			::unlink(_pending[i]->path.c_str());
+	}
+	_pending.clear();
+	for (std::map<std::string, EntryPtr>::iterator it = _index.begin();
+		 it != _index.end();
+		 it++)
+	{
+		::unlink(it->second->path.c_str());
+		it->second->stored = false;
+	}
+	_index.clear();
+	// 깊은 디렉토리부터 지운다. 비어 있지 않으면 남는다
+	for (std::set<std::string>::reverse_iterator it = _dirs.rbegin();
+		 it != _dirs.rend();
+		 it++)
+		::rmdir(it->c_str());
+	::rmdir(_root.c_str());
+}
+
+// 프로세스와 Server마다 다른 디렉토리를 쓴다
+void DiskCache::configure(const std::string &temp_dir_path,
+						  const size_t max_size)
+{
+	static volatile size_t n_instances = 0;
+
+	_root = temp_dir_path + "/webserv_cache_" + toStr(getpid()) + "_"
+			+ toStr(__sync_fetch_and_add(&n_instances, 1));
+	_max_size = max_size;
+}
+
+// 다른 사람의 응답이 섞이면 안 되는 요청은 캐시를 거치지 않는다
+bool DiskCache::isCacheable(const Request &request)
+{
+	if (request.getMethod() != METHOD_GET)
+		return (false);
+	const Header &header = request.getHeader();
+	for (Header::const_iterator it = header.begin(); it != header.end(); it++)
+	{
+		const char *name = it->first.c_str();
+		if (strcasecmp(name, "Authorization") == 0
+			|| strcasecmp(name, "Cookie") == 0)
+			return (false);
+		if (strcasecmp(name, "Cache-Control") != 0
+			&& strcasecmp(name, "Pragma") != 0)
+			continue;
+		for (size_t i = 0; i < it->second.size(); i++)
+		{
+			if (it->second[i].find("no-cache") != std::string::npos
+				|| it->second[i].find("no-store") != std::string::npos)
+				return (false);
+		}
+	}
+	return (true);
+}
+
+std::string DiskCache::makeKey(const Request &request)
+{
+	std::string key = request.getMethodString() + '\0';
+
+	if (request.hasHeaderValue("Host"))
+		key += request.getHeaderValue("Host", 0);
+	key += '\0' + request.getURIPath();
+	if (!request.getQueryString().empty())
+		key += "?" + request.getQueryString();
+	return (key);
+}
+
+// 응답을 캐시해도 되는 시간(초). Cache-Control이 Expires보다 우선한다.
+// 아무 지시도 없으면 -1, 캐시하면 안 되면 0.
+long DiskCache::getMaxAge(const Header &header)
+{
+	if (header.hasValue("Cache-Control"))
+	{
+		const std::vector<std::string> values
+			= header.getValues("Cache-Control");
+		long max_age = -1;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			// 헤더를 어디서 나눴는지에 상관없이 지시어 단위로 본다
+			const std::vector<std::string> tokens = split(values[i], ',');
+			for (size_t j = 0; j < tokens.size(); j++)
+			{
+				std::string token = tokens[j];
+				strtrim(token, " \t");
+				for (size_t k = 0; k < token.size(); k++)
+					token[k] = std::tolower(token[k]);
+				if (token == "no-store" || token == "no-cache"
+					|| token == "private")
+					return (0);
+				if (token.compare(0, 9, "s-maxage=") == 0)
+					return (std::atol(token.c_str() + 9));
+				if (token.compare(0, 8, "max-age=") == 0)
+					max_age = std::atol(token.c_str() + 8);
+			}
+		}
+		if (max_age >= 0)
+			return (max_age);
+	}
+	if (header.hasValue("Expires"))
+	{
+		const std::vector<std::string> values = header.getValues("Expires");
+		std::string date;
+		for (size_t i = 0; i < values.size(); i++)
+			date += (i ? " " : "") + values[i];
+		struct tm expires = {};
+		if (strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &expires)
+			== NULL)
+			return (0); // 잘못된 날짜는 이미 만료된 것으로 본다
+		const long remaining = timegm(&expires) - time(NULL);
+		return (remaining > 0 ? remaining : 0);
+	}
+	return (-1);
+}
+
+// 파일 앞부분: "200 OK" 줄, 헤더 줄들, 빈 줄. 그 뒤가 본문이다
+std::string DiskCache::serializeHead(const Capture &capture)
+{
+	std::string head = toStr(capture.status_code) + SP + capture.reason + CRLF;
+
+	for (Header::const_iterator it = capture.header.begin();
+		 it != capture.header.end();
+		 it++)
+	{
+		if (it->second.empty())
+			continue;
+		head += it->first + ": ";
+		for (size_t i = 0; i < it->second.size(); i++)
+			head += (i ? ", " : "") + it->second[i];
+		head += CRLF;
+	}
+	return (head + CRLF);
+}
+
+bool DiskCache::parseHead(const std::string &head,
+						  int &status_code,
+						  std::string &reason,
+						  Header &header)
+{
+	const std::vector<std::string> lines = split(head, CRLF);
+
+	if (lines.empty())
+		return (false);
+	const size_t sp_pos = lines[0].find(' ');
+	if (sp_pos == std::string::npos
+		|| !isUnsignedIntStr(lines[0].substr(0, sp_pos)))
+		return (false);
+	status_code = toNum<int>(lines[0].substr(0, sp_pos));
+	reason = lines[0].substr(sp_pos + 1);
+	for (size_t i = 1; i < lines.size(); i++)
+	{
+		const size_t colon_pos = lines[i].find(": ");
+		if (colon_pos == std::string::npos)
+			return (false);
+		header.insert(lines[i].substr(0, colon_pos),
+					  lines[i].substr(colon_pos + 2));
+	}
+	return (true);
+}
+
+// 찾은 항목은 가장 최근에 쓰인 것으로 옮긴다
+bool DiskCache::find(const std::string &key, EntryPtr &entry)
+{
+	std::map<std::string, EntryPtr>::iterator it = _index.find(key);
+
+	if (it == _index.end())
+		return (false);
+	if (it->second->expires <= monotonicMs())
+	{
+		erase(key);
+		return (false);
+	}
+	_lru.splice(_lru.begin(), _lru, it->second->lru);
+	entry = it->second;
+	_stats.hits++;
+	return (true);
+}
+
+// 파일을 다 쓴 뒤에야 poll()이 색인에 넣는다
+// 헤더가 기록되지 않았거나 본문이 중간에 끊긴 응답은 보관하지 않는다
+void DiskCache::store(const Capture &capture)
+{
+	if (!capture.enabled || capture.status_code != 200 || !capture.complete
+		|| _root.empty())
+		return;
+	const std::string data = serializeHead(capture) + capture.body;
+	if (data.size() > _max_size)
+		return;
+	const std::string hash = generateHash(capture.key);
+	const std::string dir = _root + "/" + hash.substr(0, 2);
+	const std::string path
+		= dir + "/" + hash.substr(2, 2) + "/" + hash + "_" + toStr(_serial++);
+
+	_dirs.insert(dir);
+	_dirs.insert(dir + "/" + hash.substr(2, 2));
+
+	EntryPtr entry = ft::make_shared<Entry>(
+		capture.key, path, data.size(), capture.ttl_ms);
+	entry->task = new DiskCacheTask(DiskCacheTask::MODE_STORE, path, data);
+	async::FileTaskPool::submit(entry->task);
+	_pending.push_back(entry);
+}
+
+void DiskCache::poll(void)
+{
+	for (size_t i = 0; i < _pending.size();)
+	{
+		EntryPtr entry = _pending[i];
+		if (!entry->task->isDone())
+		{
+			i++;
+			continue;
+		}
+		entry->stored = entry->task->ok;
+		entry->task->release();
+		entry->task = NULL;
+		_pending.erase(_pending.begin() + i);
+		if (entry->stored)
+		{
+			insert(entry);
+			_stats.stores++;
+		}
+	}
+	evict();
+}
+
+void DiskCache::insert(EntryPtr entry)
+{
+	erase(entry->key);
+	_lru.push_front(entry->key);
+	entry->lru = _lru.begin();
+	_index[entry->key] = entry;
+	_stats.bytes += entry->size;
+}
+
+void DiskCache::erase(const std::string &key)
+{
+	std::map<std::string, EntryPtr>::iterator it = _index.find(key);
+
+	if (it == _index.end())
+		return;
+	_lru.erase(it->second->lru);
+	_stats.bytes -= it->second->size;
+	_index.erase(it);
+}
+
+void DiskCache::evict(void)
+{
+	while (_stats.bytes > _max_size && !_lru.empty())
+	{
+		erase(_lru.back());
+		_stats.evictions++;
+	}
+}
+
+void DiskCache::countBypass(void)
+{
+	_stats.bypasses++;
+}
+
+void DiskCache::countMiss(void)
+{
+	_stats.misses++;
+}
+
+const DiskCache::Stats &DiskCache::getStats(void)
+{
+	_stats.entries = _index.size();
+	return (_stats);
+}
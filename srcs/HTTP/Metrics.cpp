@@ -0,0 +1,502 @@
+#include "HTTP/Metrics.hpp"
+#include "async/Logger.hpp"
+#include "utils/alloc_profile.hpp"
+#include "utils/arena.hpp"
+#include "utils/lock_guard.hpp"
+#include "utils/string.hpp"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+using namespace HTTP;
+
+const int LatencyHistogram::n_buckets;
+const int Metrics::n_methods;
+const int Metrics::n_status_classes;
+bool Metrics::_enabled = false;
+std::vector<const Metrics *> Metrics::_instances;
+pthread_mutex_t Metrics::_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+LatencyHistogram::LatencyHistogram(void)
+	: count(0)
+	, sum_us(0)
+{
+	std::memset(buckets, 0, sizeof(buckets));
+}
+
+// 4 미만은 값 그대로, 그 위로는 [2^e, 2^(e+1))을 4칸으로 나눈다
+int LatencyHistogram::bucketOf(usec_t us)
+{
+	if (us < 4)
+		return (static_cast<int>(us));
+	const int exponent = 63 - __builtin_clzll(us);
+	const int sub_bucket = static_cast<int>((us >> (exponent - 2)) & 3);
+	const int bucket = 4 * (exponent - 1) + sub_bucket;
+	return ((bucket < n_buckets) ? bucket : n_buckets - 1);
+}
+
+usec_t LatencyHistogram::upperBound(int bucket)
+{
+	if (bucket < 4)
+		return (bucket + 1);
+	const int exponent = bucket / 4 + 1;
+	return (static_cast<usec_t>(4 + bucket % 4 + 1) << (exponent - 2));
+}
+
+void LatencyHistogram::record(usec_t us)
+{
+	buckets[bucketOf(us)]++;
+	count++;
+	sum_us += us;
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other)
+{
+	for (int i = 0; i < n_buckets; i++)
+		buckets[i] += other.buckets[i];
+	count += other.count;
+	sum_us += other.sum_us;
+}
+
+Metrics::Counters::Counters(void)
+	: loop_events(0)
+{
+	std::memset(requests, 0, sizeof(requests));
+}
+
+Metrics::Metrics(void)
+{
+	std::memset(&_gauges, 0, sizeof(_gauges));
+	ft::lock_guard lock(_mutex);
+	_instances.push_back(this);
+}
+
+Metrics::~Metrics()
+{
+	ft::lock_guard lock(_mutex);
+	for (std::vector<const Metrics *>::iterator it = _instances.begin();
+		 it != _instances.end();
+		 it++)
+	{
+		if (*it == this)
+		{
+			_instances.erase(it);
+			break;
+		}
+	}
+}
+
+// stub_status location이 하나라도 있으면 켠다
+void Metrics::enable(void)
+{
+	_enabled = true;
+}
+
+bool Metrics::enabled(void)
+{
+	return (_enabled);
+}
+
+void Metrics::countRequest(int method, int status)
+{
+	if (method < 0 || method >= n_methods || status < 100 || status >= 600)
+		return;
+	_counters.requests[method][status / 100 - 1]++;
+}
+
+void Metrics::recordStage(int stage, usec_t us)
+{
+	_counters.stages[stage].record(us);
+}
+
+void Metrics::recordLoopPhase(int phase, usec_t us)
+{
+	_counters.loop_phases[phase].record(us);
+}
+
+void Metrics::countLoopEvents(size_t n_events)
+{
+	_counters.loop_events += n_events;
+}
+
+// 주인 스레드가 부른다. render가 읽는 복사본을 잠근 채 바꾼다
+void Metrics::publish(const Gauges &gauges)
+{
+	ft::lock_guard lock(_mutex);
+	_published = _counters;
+	_gauges = gauges;
+}
+
+static void addGauges(Metrics::Gauges &sum, const Metrics::Gauges &gauges)
+{
+	sum.connections_active += gauges.connections_active;
+	sum.connections_idle += gauges.connections_idle;
+	sum.connections_accepted += gauges.connections_accepted;
+	sum.bytes_received += gauges.bytes_received;
+	sum.bytes_sent += gauges.bytes_sent;
+	sum.request_handlers += gauges.request_handlers;
+	sum.cgi_handlers += gauges.cgi_handlers;
+	sum.proxy_handlers += gauges.proxy_handlers;
+	sum.error_handlers += gauges.error_handlers;
+	sum.queued_responses += gauges.queued_responses;
+	sum.cgi_running += gauges.cgi_running;
+	sum.cgi_waiting += gauges.cgi_waiting;
+	sum.cgi_rejected += gauges.cgi_rejected;
+	sum.disk_cache_hits += gauges.disk_cache_hits;
+	sum.disk_cache_misses += gauges.disk_cache_misses;
+	sum.slow_tasks += gauges.slow_tasks;
+}
+
+static std::string toSeconds(usec_t us)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%llu.%06llu", us / 1000000, us % 1000000);
+	return (buf);
+}
+
+static void appendHeader(std::string &out,
+						 const char *name,
+						 const char *type,
+						 const char *help)
+{
+	out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+	out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+template <typename T>
+static void appendSample(std::string &out,
+						 const char *name,
+						 const std::string &labels,
+						 T value)
+{
+	out.append(name);
+	if (!labels.empty())
+		out.append("{").append(labels).append("}");
+	out.append(" ").append(toStr(value)).append("\n");
+}
+
+// 비어 있는 칸은 건너뛴다. 누적 값이므로 빠진 칸은 앞 칸과 같다
+static void appendHistogram(std::string &out,
+							const char *name,
+							const std::string &labels,
+							const LatencyHistogram &histogram)
+{
+	const std::string prefix
+		= std::string(name) + "_bucket{" + labels + ",le=\"";
+	unsigned long long cumulative = 0;
+
+	for (int i = 0; i < LatencyHistogram::n_buckets; i++)
+	{
+		if (histogram.buckets[i] == 0)
+			continue;
+		cumulative += histogram.buckets[i];
+		out.append(prefix)
+			.append(toSeconds(LatencyHistogram::upperBound(i)))
+			.append("\"} ")
+			.append(toStr(cumulative))
+			.append("\n");
+	}
+	out.append(prefix).append("+Inf\"} ").append(toStr(histogram.count));
+	out.append("\n");
+	out.append(name).append("_sum{").append(labels).append("} ");
+	out.append(toSeconds(histogram.sum_us)).append("\n");
+	out.append(name).append("_count{").append(labels).append("} ");
+	out.append(toStr(histogram.count)).append("\n");
+}
+
+// 연결마다 핸들러를 담는 아레나. 프로세스 전체 값이다
+static void appendArenaStats(std::string &out)
+{
+	ft::Arena::Stats stats;
+	ft::Arena::snapshot(stats);
+
+	appendHeader(out,
+				 "webserv_arena_allocations_total",
+				 "counter",
+				 "Request handlers placed in per-connection arenas.");
+	appendSample(out, "webserv_arena_allocations_total", "", stats.allocs);
+	appendHeader(out,
+				 "webserv_arena_heap_fallbacks_total",
+				 "counter",
+				 "Arena requests too large for a chunk, served by the heap.");
+	appendSample(
+		out, "webserv_arena_heap_fallbacks_total", "", stats.heap_fallbacks);
+	appendHeader(out,
+				 "webserv_arena_resets_total",
+				 "counter",
+				 "Times an arena was rewound after its last handler ended.");
+	appendSample(out, "webserv_arena_resets_total", "", stats.resets);
+	appendHeader(out, "webserv_arenas", "gauge", "Live per-connection arenas.");
+	appendSample(out, "webserv_arenas", "", stats.arenas);
+	appendHeader(out,
+				 "webserv_arena_chunk_bytes",
+				 "gauge",
+				 "Chunk memory currently held by all arenas.");
+	appendSample(out, "webserv_arena_chunk_bytes", "", stats.chunk_bytes);
+	appendHeader(out,
+				 "webserv_arena_high_water_bytes",
+				 "gauge",
+				 "Most bytes a single arena has handed out between resets.");
+	appendSample(out, "webserv_arena_high_water_bytes", "", stats.high_water);
+}
+
+template <typename T>
+static void appendAllocSamples(std::string &out,
+							   const char *name,
+							   const ft::alloc::Stats *stats,
+							   T ft::alloc::Stats::*field)
+{
+	for (int i = 0; i < ft::alloc::N_SUBSYSTEMS; i++)
+		appendSample(out,
+					 name,
+					 std::string("subsystem=\"")
+						 + ft::alloc::subsystemName(i) + "\"",
+					 stats[i].*field);
+}
+
+// ALLOC_PROFILE로 빌드했을 때만 내보낸다. 프로세스 전체 값이다
+static void appendAllocStats(std::string &out)
+{
+	if (!ft::alloc::enabled())
+		return;
+
+	ft::alloc::Stats stats[ft::alloc::N_SUBSYSTEMS];
+	ft::alloc::Stats total;
+	ft::alloc::snapshot(stats, total);
+
+	appendHeader(out,
+				 "webserv_alloc_total",
+				 "counter",
+				 "Heap allocations by subsystem.");
+	appendAllocSamples(
+		out, "webserv_alloc_total", stats, &ft::alloc::Stats::allocs);
+	appendHeader(out,
+				 "webserv_alloc_bytes_total",
+				 "counter",
+				 "Bytes allocated on the heap by subsystem.");
+	appendAllocSamples(
+		out, "webserv_alloc_bytes_total", stats, &ft::alloc::Stats::bytes);
+	appendHeader(out,
+				 "webserv_alloc_live_bytes",
+				 "gauge",
+				 "Heap bytes not yet freed, by allocating subsystem.");
+	appendAllocSamples(out,
+					   "webserv_alloc_live_bytes",
+					   stats,
+					   &ft::alloc::Stats::live_bytes);
+	appendHeader(out,
+				 "webserv_alloc_peak_bytes",
+				 "gauge",
+				 "Highest live heap bytes seen, by allocating subsystem.");
+	appendAllocSamples(out,
+					   "webserv_alloc_peak_bytes",
+					   stats,
+					   &ft::alloc::Stats::peak_bytes);
+	// 요청당 할당 수는 webserv_alloc_total을 이 값으로 나눠 구한다
+	appendHeader(out,
+				 "webserv_alloc_requests_total",
+				 "counter",
+				 "Requests seen by the allocation profiler.");
+	appendSample(
+		out, "webserv_alloc_requests_total", "", ft::alloc::requestCount());
+}
+
+// 이 프로세스의 모든 이벤트 루프 스레드 값을 합쳐 Prometheus 형식으로 쓴다
+std::string Metrics::render(void)
+{
+	static const char *stage_names[N_STAGES] = {"parse", "handler", "write"};
+	static const char *phase_names[N_LOOP_PHASES]
+		= {"flush", "io", "parse", "handlers", "total"};
+	unsigned long long requests[n_methods][n_status_classes];
+	LatencyHistogram stages[N_STAGES];
+	LatencyHistogram loop_phases[N_LOOP_PHASES];
+	unsigned long long loop_events = 0;
+	Gauges gauges;
+	size_t n_loops;
+
+	std::memset(requests, 0, sizeof(requests));
+	std::memset(&gauges, 0, sizeof(gauges));
+	{
+		ft::lock_guard lock(_mutex);
+		n_loops = _instances.size();
+		for (size_t i = 0; i < _instances.size(); i++)
+		{
+			const Counters &counters = _instances[i]->_published;
+			for (int m = 0; m < n_methods; m++)
+				for (int s = 0; s < n_status_classes; s++)
+					requests[m][s] += counters.requests[m][s];
+			for (int s = 0; s < N_STAGES; s++)
+				stages[s].add(counters.stages[s]);
+			for (int p = 0; p < N_LOOP_PHASES; p++)
+				loop_phases[p].add(counters.loop_phases[p]);
+			loop_events += counters.loop_events;
+			addGauges(gauges, _instances[i]->_gauges);
+		}
+	}
+
+	std::string out;
+	out.append("# webserv worker ").append(toStr(getpid())).append("\n");
+	appendHeader(out,
+				 "webserv_event_loops",
+				 "gauge",
+				 "Event loops in this worker, including the acceptor.");
+	appendSample(out, "webserv_event_loops", "", n_loops);
+
+	appendHeader(out,
+				 "webserv_connections",
+				 "gauge",
+				 "Open client connections by state.");
+	appendSample(out,
+				 "webserv_connections",
+				 "state=\"active\"",
+				 gauges.connections_active);
+	appendSample(out,
+				 "webserv_connections",
+				 "state=\"idle\"",
+				 gauges.connections_idle);
+	appendHeader(out,
+				 "webserv_connections_accepted_total",
+				 "counter",
+				 "Accepted client connections.");
+	appendSample(out,
+				 "webserv_connections_accepted_total",
+				 "",
+				 gauges.connections_accepted);
+
+	appendHeader(out,
+				 "webserv_requests_total",
+				 "counter",
+				 "Finished requests by method and status class.");
+	for (int m = 0; m < n_methods; m++)
+	{
+		const std::string method
+			= (m == METHOD_NONE) ? "other" : METHOD.getKeyByValue(m);
+		for (int s = 0; s < n_status_classes; s++)
+		{
+			if (requests[m][s] == 0)
+				continue;
+			appendSample(out,
+						 "webserv_requests_total",
+						 "method=\"" + method + "\",status=\"" + toStr(s + 1)
+							 + "xx\"",
+						 requests[m][s]);
+		}
+	}
+
+	appendHeader(out,
+				 "webserv_received_bytes_total",
+				 "counter",
+				 "Bytes read from clients.");
+	appendSample(
+		out, "webserv_received_bytes_total", "", gauges.bytes_received);
+	appendHeader(out,
+				 "webserv_sent_bytes_total",
+				 "counter",
+				 "Bytes written to clients.");
+	appendSample(out, "webserv_sent_bytes_total", "", gauges.bytes_sent);
+
+	appendHeader(out,
+				 "webserv_handler_queue_depth",
+				 "gauge",
+				 "Request handlers waiting or running, by kind.");
+	appendSample(out,
+				 "webserv_handler_queue_depth",
+				 "handler=\"static\"",
+				 gauges.request_handlers);
+	appendSample(out,
+				 "webserv_handler_queue_depth",
+				 "handler=\"cgi\"",
+				 gauges.cgi_handlers);
+	appendSample(out,
+				 "webserv_handler_queue_depth",
+				 "handler=\"proxy\"",
+				 gauges.proxy_handlers);
+	appendSample(out,
+				 "webserv_handler_queue_depth",
+				 "handler=\"error\"",
+				 gauges.error_handlers);
+	appendHeader(out,
+				 "webserv_queued_responses",
+				 "gauge",
+				 "Responses made but not yet moved to a write buffer.");
+	appendSample(out, "webserv_queued_responses", "", gauges.queued_responses);
+
+	appendHeader(out,
+				 "webserv_cgi_processes",
+				 "gauge",
+				 "CGI processes running or waiting for a slot.");
+	appendSample(
+		out, "webserv_cgi_processes", "state=\"running\"", gauges.cgi_running);
+	appendSample(
+		out, "webserv_cgi_processes", "state=\"waiting\"", gauges.cgi_waiting);
+	appendHeader(out,
+				 "webserv_cgi_rejected_total",
+				 "counter",
+				 "CGI requests rejected because the queue was full.");
+	appendSample(out, "webserv_cgi_rejected_total", "", gauges.cgi_rejected);
+	appendHeader(out,
+				 "webserv_disk_cache_requests_total",
+				 "counter",
+				 "Disk cache lookups by result.");
+	appendSample(out,
+				 "webserv_disk_cache_requests_total",
+				 "result=\"hit\"",
+				 gauges.disk_cache_hits);
+	appendSample(out,
+				 "webserv_disk_cache_requests_total",
+				 "result=\"miss\"",
+				 gauges.disk_cache_misses);
+	appendHeader(out,
+				 "webserv_log_dropped_total",
+				 "counter",
+				 "Log records dropped because the log buffer was full.");
+	appendSample(out,
+				 "webserv_log_dropped_total",
+				 "",
+				 async::Logger::getDroppedCount());
+
+	appendHeader(out,
+				 "webserv_stage_duration_seconds",
+				 "histogram",
+				 "Time spent in each request stage.");
+	for (int s = 0; s < N_STAGES; s++)
+		appendHistogram(out,
+						"webserv_stage_duration_seconds",
+						std::string("stage=\"") + stage_names[s] + "\"",
+						stages[s]);
+
+	appendArenaStats(out);
+	appendAllocStats(out);
+
+	// event_loop_profile이 꺼져 있으면 비어 있으므로 내보내지 않는다
+	if (loop_phases[LOOP_TOTAL].count == 0)
+		return (out);
+	appendHeader(out,
+				 "webserv_loop_iterations_total",
+				 "counter",
+				 "Event loop iterations.");
+	appendSample(out,
+				 "webserv_loop_iterations_total",
+				 "",
+				 loop_phases[LOOP_TOTAL].count);
+	appendHeader(out,
+				 "webserv_loop_events_total",
+				 "counter",
+				 "Kernel events handled by the event loops.");
+	appendSample(out, "webserv_loop_events_total", "", loop_events);
+	appendHeader(out,
+				 "webserv_slow_tasks_total",
+				 "counter",
+				 "Handler task() calls slower than event_loop_profile.");
+	appendSample(out, "webserv_slow_tasks_total", "", gauges.slow_tasks);
+	appendHeader(out,
+				 "webserv_loop_phase_duration_seconds",
+				 "histogram",
+				 "Time spent in each phase of an event loop iteration.");
+	for (int p = 0; p < N_LOOP_PHASES; p++)
+		appendHistogram(out,
+						"webserv_loop_phase_duration_seconds",
+						std::string("phase=\"") + phase_names[p] + "\"",
+						loop_phases[p]);
+	return (out);
+}
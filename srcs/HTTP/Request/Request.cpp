@@ -8,6 +8,7 @@ using namespace HTTP;
 
 Request::Request(void)
 	: _method(METHOD_NONE)
+	, _version_num(0)
 	, _current_state(PARSE_STATE_STARTLINE)
 	, _content_length(0)
 	, _logger(async::Logger::getLogger("Request"))
@@ -21,7 +22,9 @@ Request::~Request()
 Request::Request(const Request &orig)
 	: _method(orig._method)
 	, _uri(orig._uri)
+	, _query_string(orig._query_string)
 	, _version(orig._version)
+	, _version_num(orig._version_num)
 	, _header(orig._header)
 	, _body(orig._body)
 	, _current_state(orig._current_state)
@@ -36,7 +39,9 @@ Request &Request::operator=(const Request &orig)
 	{
 		_method = orig._method;
 		_uri = orig._uri;
+		_query_string = orig._query_string;
 		_version = orig._version;
+		_version_num = orig._version_num;
 		_header = orig._header;
 		_body = orig._body;
 		_current_state = orig._current_state;
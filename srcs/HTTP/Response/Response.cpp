@@ -12,7 +12,11 @@ using namespace HTTP;
 const std::string Response::_http_version = "HTTP/1.1";
 
 Response::Response(void)
-	: _logger(async::Logger::getLogger("Response"))
+	: _is_fragment(false)
+	, _is_streaming(false)
+	, _is_end_of_stream(false)
+	, _close_after_write(false)
+	, _logger(async::Logger::getLogger("Response"))
 {
 	initGeneralHeaderFields();
 	initResponseHeaderFields();
@@ -22,6 +26,10 @@ Response::Response(void)
 
 Response::Response(Header header)
 	: _header(header)
+	, _is_fragment(false)
+	, _is_streaming(false)
+	, _is_end_of_stream(false)
+	, _close_after_write(false)
 	, _logger(async::Logger::getLogger("Response"))
 {
 }
@@ -32,6 +40,10 @@ Response::Response(Response const &other)
 	, _reason_phrase(other._reason_phrase)
 	, _header(other._header)
 	, _body(other._body)
+	, _is_fragment(other._is_fragment)
+	, _is_streaming(other._is_streaming)
+	, _is_end_of_stream(other._is_end_of_stream)
+	, _close_after_write(other._close_after_write)
 	, _logger(other._logger)
 {
 }
@@ -45,6 +57,10 @@ Response &Response::operator=(Response const &other)
 		_reason_phrase = other._reason_phrase;
 		_header = other._header;
 		_body = other._body;
+		_is_fragment = other._is_fragment;
+		_is_streaming = other._is_streaming;
+		_is_end_of_stream = other._is_end_of_stream;
+		_close_after_write = other._close_after_write;
 	}
 	return (*this);
 }
@@ -53,9 +69,31 @@ Response::~Response(void)
 {
 }
 
+// 상태줄과 헤더 없이 data를 그대로 내보내는 응답.
+// 헤더를 먼저 보낸 응답의 본문을 나눠 보낼 때 쓴다.
+Response Response::fragment(const std::string &data)
+{
+	Response response;
+
+	response._is_fragment = true;
+	response._body = data;
+	return (response);
+}
+
+// 나눠 보낸 응답이 끝났음을 알리는 빈 조각
+Response Response::endOfStream(void)
+{
+	Response response = fragment("");
+
+	response._is_end_of_stream = true;
+	return (response);
+}
+
 // convert to string
 const std::string &Response::toString(void)
 {
+	if (_is_fragment)
+		return (_body);
 	setDate();
 	_response.clear();
 	makeStatusLine();
@@ -101,7 +139,9 @@ void Response::makeBody(void)
 	_response.append(_body);
 }
 
-void Response::alignAutoIndex(size_t minus_len, int to_align)
+void Response::alignAutoIndex(std::string &body,
+							  size_t minus_len,
+							  int to_align)
 {
 	if (!(AUTOINDEX_ALIGN_FILE_NAME <= to_align
 		  && to_align <= AUTOINDEX_ALIGN_FILE_SIZE))
@@ -110,24 +150,37 @@ void Response::alignAutoIndex(size_t minus_len, int to_align)
 	const int size[] = {51, 20};
 	int align_size = size[to_align] - minus_len;
 	for (int i = 0; i < align_size; i++)
-		_body.append(" ");
+		body.append(" ");
 }
 
 void Response::makeDirectoryListing(const std::string &path,
 									const std::string &uri)
+{
+	setDirectoryListing(generateDirectoryListing(path, uri));
+}
+
+void Response::setDirectoryListing(const std::string &listing)
 {
 	setContentType("text/html");
+	_body = listing;
+	setContentLength(_body.length());
+}
+
+// 디렉토리를 읽고 항목마다 stat을 호출하므로 이벤트 루프 밖에서도 호출된다
+std::string Response::generateDirectoryListing(const std::string &path,
+											   const std::string &uri)
+{
+	std::string body;
 
-	_body.clear();
-	_body.append("<html>\n"
-				 "<head><title>Index of "
-				 + uri
-				 + "</title></head>\n"
-				   "<body>\n"
-				   "<h1>Index of "
-				 + uri
-				 + "</h1>\n"
-				   "<hr><pre><a href=\"../\">../</a>\n");
+	body.append("<html>\n"
+				"<head><title>Index of "
+				+ uri
+				+ "</title></head>\n"
+				  "<body>\n"
+				  "<h1>Index of "
+				+ uri
+				+ "</h1>\n"
+				  "<hr><pre><a href=\"../\">../</a>\n");
 
 	/* 각 파일에 대한 내용을 추가 */
 	struct stat file_info;
@@ -136,47 +189,82 @@ void Response::makeDirectoryListing(const std::string &path,
 	std::string file_name;
 	std::string file_path;
 	std::string file_size;
-	static char modified_time[18];
+	char modified_time[18];
+	struct tm modified_tm;
 
 	dir_stream = ::opendir(path.c_str());
 
-	for (int i = 0; i < 2; i++)
-		dir_info = ::readdir(dir_stream);
-	while ((dir_info = ::readdir(dir_stream)) != NULL)
+	if (dir_stream)
 	{
-		file_name = dir_info->d_name;
-		file_path = path + "/" + file_name;
-		if (stat(file_path.c_str(), &file_info) == 0)
+		for (int i = 0; i < 2; i++)
+			dir_info = ::readdir(dir_stream);
+		while ((dir_info = ::readdir(dir_stream)) != NULL)
 		{
-			if (file_info.st_mode & S_IFDIR)
-				file_name += '/';
-			_body.append("<a href=\"" + file_name + "\">" + file_name + "</a>");
-			strftime(modified_time,
-					 sizeof(modified_time),
-					 "%d-%b-%Y %R",
-					 gmtime(&file_info.st_mtimespec.tv_sec));
-			alignAutoIndex(file_name.length(), AUTOINDEX_ALIGN_FILE_NAME);
-			_body.append(modified_time);
-			if (file_info.st_mode & S_IFDIR)
-				file_size = "-";
-			else
-				file_size = toStr(file_info.st_size);
-			alignAutoIndex(file_size.length(), AUTOINDEX_ALIGN_FILE_SIZE);
-			_body.append(file_size);
-			_body.append("\n");
+			file_name = dir_info->d_name;
+			file_path = path + "/" + file_name;
+			if (stat(file_path.c_str(), &file_info) == 0)
+			{
+				if (file_info.st_mode & S_IFDIR)
+					file_name += '/';
+				body.append("<a href=\"" + file_name + "\">" + file_name
+							+ "</a>");
+				gmtime_r(&file_info.st_mtimespec.tv_sec, &modified_tm);
+				strftime(modified_time,
+						 sizeof(modified_time),
+						 "%d-%b-%Y %R",
+						 &modified_tm);
+				alignAutoIndex(
+					body, file_name.length(), AUTOINDEX_ALIGN_FILE_NAME);
+				body.append(modified_time);
+				if (file_info.st_mode & S_IFDIR)
+					file_size = "-";
+				else
+					file_size = toStr(file_info.st_size);
+				alignAutoIndex(
+					body, file_size.length(), AUTOINDEX_ALIGN_FILE_SIZE);
+				body.append(file_size);
+				body.append("\n");
+			}
 		}
+		::closedir(dir_stream);
 	}
-	::closedir(dir_stream);
 
-	_body.append("</pre><hr></body>\n"
-				 "</html>\n");
+	body.append("</pre><hr></body>\n"
+				"</html>\n");
+	return (body);
+}
 
-	setContentLength(_body.length());
+bool Response::isFragment(void) const
+{
+	return (_is_fragment);
+}
+
+bool Response::isStreaming(void) const
+{
+	return (_is_streaming);
+}
+
+bool Response::isEndOfStream(void) const
+{
+	return (_is_end_of_stream);
+}
+
+int Response::getStatusCode(void) const
+{
+	return (toNum<int>(_status_code));
+}
+
+bool Response::closeAfterWrite(void) const
+{
+	return (_close_after_write);
 }
 
 const std::string Response::getDescription(void) const
 {
 	const size_t bodylen = 20;
+
+	if (_is_fragment)
+		return ("[+" + toStr(_body.size()) + " bytes]");
 	const int status_code = toNum<int>(_status_code);
 
 	std::stringstream buf;
@@ -13,10 +13,11 @@ void Response::setValue(const std::string &name, const std::string &value)
 void Response::setDate(void)
 {
 	time_t cur_time = std::time(NULL);
-	tm *gmt_time = std::gmtime(&cur_time);
-	static char date[32];
+	tm gmt_time;
+	char date[32];
 
-	std::strftime(date, sizeof(date), "%a, %d %b %Y %T GMT", gmt_time);
+	gmtime_r(&cur_time, &gmt_time);
+	std::strftime(date, sizeof(date), "%a, %d %b %Y %T GMT", &gmt_time);
 	setValue("Date", date);
 }
 
@@ -31,6 +32,14 @@ void Response::setStatus(int status_code)
 	LOG_VERBOSE("Status code set to " << _status_code << " " << _reason_phrase);
 }
 
+// 업스트림이 보낸 상태 코드는 STATUS_CODE에 없을 수도 있어 그대로 옮긴다
+void Response::setStatus(int status_code, const std::string &reason_phrase)
+{
+	_status_code = toStr<int>(status_code);
+	_reason_phrase = reason_phrase;
+	LOG_VERBOSE("Status code set to " << _status_code << " " << _reason_phrase);
+}
+
 void Response::setContent(const std::string &content,
 						  const std::string &file_path)
 {
@@ -73,6 +82,16 @@ void Response::setConnection(bool is_persistent)
 		setValue("Connection", "close");
 }
 
+void Response::setCloseAfterWrite(void)
+{
+	_close_after_write = true;
+}
+
+void Response::setStreaming(void)
+{
+	_is_streaming = true;
+}
+
 void Response::setBody(const std::string &body)
 {
 	_body = body;
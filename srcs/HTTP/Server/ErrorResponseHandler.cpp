@@ -1,20 +1,36 @@
 #include "HTTP/Server.hpp"
 #include "HTTP/const_values.hpp"
 #include "HTTP/error_pages.hpp"
+#include "utils/string.hpp"
 
 using namespace HTTP;
 
+// 설정된 에러 페이지가 없으면 빈 문자열
+const std::string &
+Server::ErrorResponseHandler::errorPagePath(const Server *server,
+											const int code)
+{
+	static const std::string none;
+	std::map<int, std::string>::const_iterator it
+		= server->_error_page_paths.find(code);
+	if (it == server->_error_page_paths.end())
+		return (none);
+	return (it->second);
+}
+
 Server::ErrorResponseHandler::ErrorResponseHandler(
 	Server *server,
 	const int request_method,
 	const int code,
-	const unsigned int timeout_ms)
+	const unsigned int timeout_ms,
+	const unsigned int retry_after_sec)
 	: _request_method(request_method)
 	, _server(server)
 	, _status(RESPONSE_STATUS_AGAIN)
 	, _code(code)
 	, _timeout_ms(timeout_ms)
-	, _reader(NULL)
+	, _retry_after_sec(retry_after_sec)
+	, _reader(timeout_ms, errorPagePath(server, code))
 	, _logger(async::Logger::getLogger("ErrorResponseHandler"))
 {
 	LOG_DEBUG("ErrorResponseHandler " << code << " timeout " << timeout_ms);
@@ -24,11 +40,7 @@ Server::ErrorResponseHandler::ErrorResponseHandler(
 		generateResponse(generateErrorPage(_code),
 						 _request_method == METHOD_HEAD);
 		_status = RESPONSE_STATUS_OK;
-		return;
 	}
-
-	_reader = ft::shared_ptr<async::FileReader>(
-		new async::FileReader(_timeout_ms, _server->_error_page_paths[_code]));
 }
 
 Server::ErrorResponseHandler::~ErrorResponseHandler()
@@ -47,6 +59,8 @@ void Server::ErrorResponseHandler::generateResponse(const std::string &body,
 		_response.setContentLength(body.length());
 	}
 	_response.setContentType("text/html");
+	if (_retry_after_sec > 0)
+		_response.setValue("Retry-After", toStr(_retry_after_sec));
 }
 
 int Server::ErrorResponseHandler::task(void)
@@ -58,10 +72,10 @@ int Server::ErrorResponseHandler::task(void)
 		break;
 
 	case RESPONSE_STATUS_AGAIN:
-		int rc = _reader->task();
+		int rc = _reader.task();
 		if (rc == async::status::OK_DONE)
 		{
-			generateResponse(_reader->retrieve(),
+			generateResponse(_reader.retrieve(),
 							 _request_method == METHOD_HEAD);
 			_status = RESPONSE_STATUS_OK;
 		}
@@ -72,7 +86,7 @@ int Server::ErrorResponseHandler::task(void)
 		else if (rc == async::status::ERROR_TIMEOUT)
 		{
 			LOG_ERROR("Timeout while opening error page: "
-					  + _reader->errorMsg());
+					  + _reader.errorMsg());
 			generateResponse(generateErrorPage(_code),
 							 _request_method == METHOD_HEAD);
 			_status = RESPONSE_STATUS_OK;
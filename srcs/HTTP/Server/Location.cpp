@@ -7,7 +7,14 @@
 using namespace HTTP;
 
 Server::Location::Location()
-	: _logger(async::Logger::getLogger("Location"))
+	: _cgi_cache(false)
+	, _cgi_cache_ttl_ms(0)
+	, _cgi_cache_stale_ms(0)
+	, _proxy_balance(UpstreamPool::BALANCE_ROUND_ROBIN)
+	, _disk_cache(false)
+	, _disk_cache_ttl_ms(0)
+	, _stub_status(false)
+	, _logger(async::Logger::getLogger("Location"))
 {
 }
 
@@ -18,12 +25,23 @@ Server::Location::Location(const ConfigContext &location_context,
 	, _autoindex(false)
 	, _upload_allowed(false)
 	, _max_body_size(max_body_size)
+	, _cgi_cache(false)
+	, _cgi_cache_ttl_ms(0)
+	, _cgi_cache_stale_ms(0)
+	, _proxy_balance(UpstreamPool::BALANCE_ROUND_ROBIN)
+	, _disk_cache(false)
+	, _disk_cache_ttl_ms(0)
+	, _stub_status(false)
 	, _logger(async::Logger::getLogger("Location"))
 {
 	if (location_context.nParameters() != 1)
 		throw(ConfigDirective::InvalidNumberOfArgument(location_context));
 	_path = location_context.parameter(0);
 
+	// 프록시와 stub_status location은 alias가 없어도 된다
+	parseDirectiveStubStatus(location_context);
+	parseDirectiveProxyPass(location_context);
+	parseDirectiveProxyBalance(location_context);
 	parseDirectiveAlias(location_context);
 	parseDirectiveLimitExcept(location_context);
 	parseDirectiveReturn(location_context);
@@ -31,6 +49,9 @@ Server::Location::Location(const ConfigContext &location_context,
 	parseDirectiveIndex(location_context);
 	parseDirectiveUpload(location_context);
 	parseDirectiveMaxBodySize(location_context);
+	parseDirectiveCGICache(location_context);
+	parseDirectiveCGICacheVary(location_context);
+	parseDirectiveDiskCache(location_context);
 }
 
 Server::Location::~Location()
@@ -49,6 +70,15 @@ Server::Location::Location(const Location &orig)
 	, _allowed_methods(orig._allowed_methods)
 	, _upload_store_path(orig._upload_store_path)
 	, _max_body_size(orig._max_body_size)
+	, _cgi_cache(orig._cgi_cache)
+	, _cgi_cache_ttl_ms(orig._cgi_cache_ttl_ms)
+	, _cgi_cache_stale_ms(orig._cgi_cache_stale_ms)
+	, _cgi_cache_vary(orig._cgi_cache_vary)
+	, _proxy_pass(orig._proxy_pass)
+	, _proxy_balance(orig._proxy_balance)
+	, _disk_cache(orig._disk_cache)
+	, _disk_cache_ttl_ms(orig._disk_cache_ttl_ms)
+	, _stub_status(orig._stub_status)
 	, _logger(orig._logger)
 {
 }
@@ -66,6 +96,15 @@ Server::Location &Server::Location::operator=(const Location &orig)
 	_allowed_methods = orig._allowed_methods;
 	_upload_store_path = orig._upload_store_path;
 	_max_body_size = orig._max_body_size;
+	_cgi_cache = orig._cgi_cache;
+	_cgi_cache_ttl_ms = orig._cgi_cache_ttl_ms;
+	_cgi_cache_stale_ms = orig._cgi_cache_stale_ms;
+	_cgi_cache_vary = orig._cgi_cache_vary;
+	_proxy_pass = orig._proxy_pass;
+	_proxy_balance = orig._proxy_balance;
+	_disk_cache = orig._disk_cache;
+	_disk_cache_ttl_ms = orig._disk_cache_ttl_ms;
+	_stub_status = orig._stub_status;
 	return (*this);
 }
 
@@ -154,6 +193,56 @@ bool Server::Location::uploadAllowed() const
 	return (_upload_allowed);
 }
 
+bool Server::Location::cgiCacheEnabled(void) const
+{
+	return (_cgi_cache);
+}
+
+msec_t Server::Location::getCGICacheTTL(void) const
+{
+	return (_cgi_cache_ttl_ms);
+}
+
+msec_t Server::Location::getCGICacheStale(void) const
+{
+	return (_cgi_cache_stale_ms);
+}
+
+const std::vector<std::string> &Server::Location::getCGICacheVary(void) const
+{
+	return (_cgi_cache_vary);
+}
+
+bool Server::Location::isProxy(void) const
+{
+	return (!_proxy_pass.empty());
+}
+
+const std::vector<std::string> &Server::Location::getProxyPass(void) const
+{
+	return (_proxy_pass);
+}
+
+int Server::Location::getProxyBalance(void) const
+{
+	return (_proxy_balance);
+}
+
+bool Server::Location::diskCacheEnabled(void) const
+{
+	return (_disk_cache);
+}
+
+msec_t Server::Location::getDiskCacheTTL(void) const
+{
+	return (_disk_cache_ttl_ms);
+}
+
+bool Server::Location::isStubStatus(void) const
+{
+	return (_stub_status);
+}
+
 Response Server::Location::generateRedirectResponse(void) const
 {
 	Response response;
@@ -1,4 +1,5 @@
 #include "ConfigDirective.hpp"
+#include "HTTP/Metrics.hpp"
 #include "HTTP/Server.hpp"
 #include "HTTP/const_values.hpp"
 #include "utils/string.hpp"
@@ -9,6 +10,9 @@ void Server::Location::parseDirectiveAlias(
 	const ConfigContext &location_context)
 {
 	const char *dir_name = "alias";
+	if ((!_proxy_pass.empty() || _stub_status)
+		&& location_context.countDirectivesByName(dir_name) == 0)
+		return;
 	if (location_context.countDirectivesByName(dir_name) != 1)
 	{
 		LOG_ERROR(location_context.name() << " should have 1 " << dir_name);
@@ -235,3 +239,220 @@ void Server::Location::parseDirectiveMaxBodySize(
 	_max_body_size = toNum<size_t>(body_size_directive.parameter(0));
 	LOG_VERBOSE("max body size for " << _path << " is " << _max_body_size);
 }
+
+// cgi_cache <유효 기간(초)> [<만료 후 옛 응답을 내줄 기간(초)>];
+void Server::Location::parseDirectiveCGICache(
+	const ConfigContext &location_context)
+{
+	const char *dir_name = "cgi_cache";
+	const size_t n_caches = location_context.countDirectivesByName(dir_name);
+	if (n_caches == 0)
+		return;
+	const ConfigDirective &cache_directive
+		= location_context.getNthDirectiveByName(dir_name, 0);
+	if (n_caches > 1)
+	{
+		LOG_ERROR(location_context.name()
+				  << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::DuplicateDirective(cache_directive));
+	}
+	if (cache_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(cache_directive));
+	}
+	if (cache_directive.nParameters() < 1 || cache_directive.nParameters() > 2)
+	{
+		LOG_ERROR(dir_name << " should have 1 or 2 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(cache_directive));
+	}
+	for (size_t i = 0; i < cache_directive.nParameters(); i++)
+	{
+		if (!isUnsignedIntStr(cache_directive.parameter(i)))
+		{
+			LOG_ERROR(dir_name << " should have unsigned integer parameters");
+			throw(ConfigDirective::UndefinedArgument(cache_directive));
+		}
+	}
+	_cgi_cache = true;
+	_cgi_cache_ttl_ms = toNum<msec_t>(cache_directive.parameter(0)) * 1000;
+	if (cache_directive.nParameters() == 2)
+		_cgi_cache_stale_ms
+			= toNum<msec_t>(cache_directive.parameter(1)) * 1000;
+	LOG_VERBOSE("CGI cache for " << _path << " keeps " << _cgi_cache_ttl_ms
+								 << "ms, stale for " << _cgi_cache_stale_ms
+								 << "ms");
+}
+
+void Server::Location::parseDirectiveCGICacheVary(
+	const ConfigContext &location_context)
+{
+	const char *dir_name = "cgi_cache_vary";
+	const size_t n_varys = location_context.countDirectivesByName(dir_name);
+	if (n_varys == 0)
+		return;
+	const ConfigDirective &vary_directive
+		= location_context.getNthDirectiveByName(dir_name, 0);
+	if (n_varys > 1)
+	{
+		LOG_ERROR(location_context.name()
+				  << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::DuplicateDirective(vary_directive));
+	}
+	if (!_cgi_cache)
+	{
+		LOG_ERROR(dir_name << " requires cgi_cache");
+		throw(ConfigDirective::UndefinedDirective(vary_directive));
+	}
+	if (vary_directive.nParameters() == 0)
+	{
+		LOG_ERROR(dir_name << " should have more than 0 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(vary_directive));
+	}
+	for (size_t i = 0; i < vary_directive.nParameters(); i++)
+		_cgi_cache_vary.push_back(vary_directive.parameter(i));
+}
+
+void Server::Location::parseDirectiveProxyPass(
+	const ConfigContext &location_context)
+{
+	const char *dir_name = "proxy_pass";
+	const size_t n_proxies = location_context.countDirectivesByName(dir_name);
+	if (n_proxies == 0)
+		return;
+	const ConfigDirective &proxy_directive
+		= location_context.getNthDirectiveByName(dir_name, 0);
+	if (n_proxies > 1)
+	{
+		LOG_ERROR(location_context.name()
+				  << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::DuplicateDirective(proxy_directive));
+	}
+	if (proxy_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(proxy_directive));
+	}
+	if (proxy_directive.nParameters() == 0)
+	{
+		LOG_ERROR(dir_name << " should have more than 0 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(proxy_directive));
+	}
+	for (size_t i = 0; i < proxy_directive.nParameters(); i++)
+	{
+		if (proxy_directive.parameter(i).compare(0, 7, "http://") != 0)
+		{
+			LOG_ERROR(dir_name << " supports only http:// upstreams");
+			throw(ConfigDirective::UndefinedArgument(proxy_directive));
+		}
+		_proxy_pass.push_back(proxy_directive.parameter(i));
+	}
+}
+
+void Server::Location::parseDirectiveProxyBalance(
+	const ConfigContext &location_context)
+{
+	const char *dir_name = "proxy_balance";
+	const size_t n_balances = location_context.countDirectivesByName(dir_name);
+	if (n_balances == 0)
+		return;
+	const ConfigDirective &balance_directive
+		= location_context.getNthDirectiveByName(dir_name, 0);
+	if (n_balances > 1)
+	{
+		LOG_ERROR(location_context.name()
+				  << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::DuplicateDirective(balance_directive));
+	}
+	if (_proxy_pass.empty())
+	{
+		LOG_ERROR(dir_name << " requires proxy_pass");
+		throw(ConfigDirective::UndefinedDirective(balance_directive));
+	}
+	if (balance_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(balance_directive));
+	}
+	const std::string &balance = balance_directive.parameter(0);
+	if (balance == "round_robin")
+		_proxy_balance = UpstreamPool::BALANCE_ROUND_ROBIN;
+	else if (balance == "least_conn")
+		_proxy_balance = UpstreamPool::BALANCE_LEAST_CONN;
+	else
+	{
+		LOG_ERROR(dir_name << " should be round_robin or least_conn");
+		throw(ConfigDirective::UndefinedArgument(balance_directive));
+	}
+}
+
+void Server::Location::parseDirectiveDiskCache(
+	const ConfigContext &location_context)
+{
+	const char *dir_name = "disk_cache";
+	const size_t n_caches = location_context.countDirectivesByName(dir_name);
+	if (n_caches == 0)
+		return;
+	const ConfigDirective &cache_directive
+		= location_context.getNthDirectiveByName(dir_name, 0);
+	if (n_caches > 1)
+	{
+		LOG_ERROR(location_context.name()
+				  << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::DuplicateDirective(cache_directive));
+	}
+	if (cache_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(cache_directive));
+	}
+	if (cache_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(cache_directive));
+	}
+	if (!isUnsignedIntStr(cache_directive.parameter(0)))
+	{
+		LOG_ERROR(dir_name << " should be an unsigned integer");
+		throw(ConfigDirective::UndefinedArgument(cache_directive));
+	}
+	_disk_cache = true;
+	_disk_cache_ttl_ms = toNum<msec_t>(cache_directive.parameter(0)) * 1000;
+	LOG_VERBOSE("disk cache for " << _path << " keeps " << _disk_cache_ttl_ms
+								  << "ms");
+}
+
+void Server::Location::parseDirectiveStubStatus(
+	const ConfigContext &location_context)
+{
+	const char *dir_name = "stub_status";
+	const size_t n_status = location_context.countDirectivesByName(dir_name);
+	if (n_status == 0)
+		return;
+	const ConfigDirective &status_directive
+		= location_context.getNthDirectiveByName(dir_name, 0);
+	if (n_status > 1)
+	{
+		LOG_ERROR(location_context.name()
+				  << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::DuplicateDirective(status_directive));
+	}
+	if (status_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(status_directive));
+	}
+	if (status_directive.nParameters() != 0)
+	{
+		LOG_ERROR(dir_name << " should have 0 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(status_directive));
+	}
+	if (location_context.countDirectivesByName("proxy_pass") > 0)
+	{
+		LOG_ERROR(dir_name << " cannot be used with proxy_pass");
+		throw(ConfigDirective::UndefinedDirective(status_directive));
+	}
+	_stub_status = true;
+	Metrics::enable();
+	LOG_VERBOSE("location " << _path << " reports server metrics");
+}
@@ -0,0 +1,428 @@
+#include "HTTP/ProxyHandler.hpp"
+#include "HTTP/const_values.hpp"
+#include "async/status.hpp"
+#include "utils/string.hpp"
+#include <algorithm>
+#include <sstream>
+#include <strings.h>
+
+using namespace HTTP;
+
+const size_t Server::ProxyHandler::_max_header_size = 64 * 1024;
+const size_t Server::ProxyHandler::_output_high_watermark = 256 * 1024;
+const size_t Server::ProxyHandler::_output_low_watermark = 64 * 1024;
+
+Server::ProxyHandler::ProxyHandler(const Request &request,
+								   const _UpstreamPoolPtr &pool,
+								   const unsigned int timeout_ms)
+	: _request(request)
+	, _pool(pool)
+	, _conn(NULL)
+	, _timeout_ms(timeout_ms)
+	, _deadline(0)
+	, _reused(false)
+	, _received(false)
+	, _retried(false)
+	, _head_parsed(false)
+	, _head_retrieved(false)
+	, _done(false)
+	, _keep_alive(false)
+	, _output_paused(false)
+	, _timed_out(false)
+	, _body_type(BODY_NONE)
+	, _body_remaining(0)
+	, _chunk_state(CHUNK_SIZE)
+	, _logger(async::Logger::getLogger("ProxyHandler"))
+{
+	buildRequestMessage();
+	acquireConnection();
+}
+
+Server::ProxyHandler::~ProxyHandler()
+{
+	// 응답을 끝까지 받지 못한 연결은 다음 요청에 쓸 수 없다
+	if (_conn)
+		releaseConnection(false);
+}
+
+bool Server::ProxyHandler::isHopByHop(const std::string &name)
+{
+	static const char *hop_by_hop[]
+		= {"Connection", "Keep-Alive", "Proxy-Connection", "TE", "Trailer",
+		   "Transfer-Encoding", "Upgrade", NULL};
+
+	for (size_t i = 0; hop_by_hop[i]; i++)
+	{
+		if (strcasecmp(name.c_str(), hop_by_hop[i]) == 0)
+			return (true);
+	}
+	return (false);
+}
+
+// 본문은 파서가 이미 모두 받아 두었으므로 Content-Length로 보낸다
+void Server::ProxyHandler::buildRequestMessage(void)
+{
+	const Header &header = _request.getHeader();
+	const std::string &body = _request.getBody();
+	const int method = _request.getMethod();
+
+	_request_msg = _request.getMethodString() + SP + _request.getURIPath();
+	if (!_request.getQueryString().empty())
+		_request_msg += "?" + _request.getQueryString();
+	_request_msg += SP + "HTTP/1.1" + CRLF;
+	for (Header::const_iterator it = header.begin(); it != header.end(); it++)
+	{
+		if (it->second.empty() || isHopByHop(it->first)
+			|| strcasecmp(it->first.c_str(), "Content-Length") == 0
+			|| strcasecmp(it->first.c_str(), "Expect") == 0)
+			continue;
+		_request_msg += it->first + ": ";
+		for (size_t i = 0; i < it->second.size(); i++)
+		{
+			if (i > 0)
+				_request_msg += ", ";
+			_request_msg += it->second[i];
+		}
+		_request_msg += CRLF;
+	}
+	_request_msg += "Connection: keep-alive" + CRLF;
+	if (!body.empty() || method == METHOD_POST || method == METHOD_PUT)
+		_request_msg += "Content-Length: " + toStr(body.size()) + CRLF;
+	_request_msg += CRLF + body;
+}
+
+// 업스트림이 요청을 처리했는지 알 수 없으므로 다시 보내도 되는 메소드만
+bool Server::ProxyHandler::retryable(void) const
+{
+	const int method = _request.getMethod();
+	return (method == METHOD_GET || method == METHOD_HEAD);
+}
+
+void Server::ProxyHandler::acquireConnection(const bool fresh)
+{
+	_conn = _pool->acquire(_reused, fresh);
+	if (_conn == NULL)
+		throw(std::runtime_error("cannot connect to upstream"));
+	LOG_DEBUG((_reused ? "reuse" : "open") << " connection " << _conn->fd
+										   << " to "
+										   << _pool->getName(_conn->upstream));
+	_conn->io.setWriteBuf(_request_msg);
+	_deadline = monotonicMs() + _timeout_ms;
+}
+
+// 요청을 다 보내고 응답 뒤에 남은 바이트가 없어야 다음 요청에 쓸 수 있다
+void Server::ProxyHandler::releaseConnection(const bool reusable)
+{
+	_pool->release(_conn,
+				   reusable && _rdbuf.empty() && _conn->io.writeDone());
+	_conn = NULL;
+}
+
+bool Server::ProxyHandler::parseHead(void)
+{
+	while (true)
+	{
+		const size_t head_end = _rdbuf.find(CRLF + CRLF);
+		if (head_end == std::string::npos)
+		{
+			if (_rdbuf.size() > _max_header_size)
+				throw(std::runtime_error("upstream response header too large"));
+			return (false);
+		}
+		const std::vector<std::string> lines
+			= split(_rdbuf.substr(0, head_end), CRLF);
+		trimfrontstr(_rdbuf, head_end + CRLF_LEN * 2);
+
+		// HTTP/1.x SSS reason
+		const std::string &status_line = lines.empty() ? "" : lines[0];
+		if (status_line.size() < 12 || status_line.compare(0, 5, "HTTP/") != 0
+			|| status_line[8] != ' ')
+			throw(std::runtime_error("invalid upstream status line: "
+									 + status_line));
+		const std::string version = status_line.substr(5, 3);
+		const int code = toNum<int>(status_line.substr(9, 3));
+		const std::string reason
+			= (status_line.size() > 13) ? status_line.substr(13) : "";
+		// 100 Continue 같은 중간 응답은 버린다
+		if (100 <= code && code < 200 && code != 101)
+			continue;
+
+		Header header;
+		bool chunked = false;
+		bool has_length = false;
+		size_t length = 0;
+		_keep_alive = (version != "1.0");
+		for (size_t i = 1; i < lines.size(); i++)
+		{
+			const size_t colon_pos = lines[i].find(':');
+			if (colon_pos == std::string::npos)
+				throw(std::runtime_error("invalid upstream header: "
+										 + lines[i]));
+			const std::string name = lines[i].substr(0, colon_pos);
+			std::string value = lines[i].substr(colon_pos + 1);
+			strtrim(value, " \t");
+			if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0)
+				chunked = (value.find("chunked") != std::string::npos);
+			else if (strcasecmp(name.c_str(), "Connection") == 0)
+			{
+				if (value.find("close") != std::string::npos)
+					_keep_alive = false;
+				else if (value.find("keep-alive") != std::string::npos)
+					_keep_alive = true;
+			}
+			else if (strcasecmp(name.c_str(), "Content-Length") == 0)
+			{
+				length = toNum<size_t>(value);
+				has_length = true;
+				header.insert(name, value);
+			}
+			// Date는 Response가 새로 붙인다
+			else if (!isHopByHop(name) && strcasecmp(name.c_str(), "Date") != 0)
+				header.insert(name, value);
+		}
+
+		_disk_capture.setHead(code, reason, header);
+		_response = Response(header);
+		_response.setStatus(code, reason);
+		if (_request.getMethod() == METHOD_HEAD || code < 200 || code == 204
+			|| code == 304)
+		{
+			_body_type = BODY_NONE;
+			if (code == 101)
+				_keep_alive = false;
+		}
+		else if (chunked)
+			_body_type = BODY_CHUNKED;
+		else if (has_length)
+		{
+			_body_type = BODY_LENGTH;
+			_body_remaining = length;
+		}
+		else
+		{
+			// 업스트림이 연결을 닫아야 본문이 끝난다
+			_body_type = BODY_UNTIL_CLOSE;
+			_keep_alive = false;
+		}
+		if (_body_type == BODY_CHUNKED || _body_type == BODY_UNTIL_CLOSE)
+			_response.setValue("Transfer-Encoding", "chunked");
+		_head_parsed = true;
+		LOG_DEBUG("upstream responded " << code << ", body type "
+										<< _body_type);
+		return (true);
+	}
+}
+
+void Server::ProxyHandler::feedBody(void)
+{
+	switch (_body_type)
+	{
+	case BODY_NONE:
+		finish();
+		break;
+
+	case BODY_LENGTH:
+	{
+		const size_t n = std::min(_body_remaining, _rdbuf.size());
+		_disk_capture.appendBody(_rdbuf.substr(0, n));
+		_body_buf.append(_rdbuf, 0, n);
+		trimfrontstr(_rdbuf, n);
+		_body_remaining -= n;
+		if (_body_remaining == 0)
+			finish();
+		break;
+	}
+
+	case BODY_CHUNKED:
+		feedChunked();
+		break;
+
+	case BODY_UNTIL_CLOSE:
+	{
+		if (_rdbuf.empty())
+			break;
+		std::ostringstream chunk_size;
+		chunk_size << std::hex << _rdbuf.size();
+		_disk_capture.appendBody(_rdbuf);
+		_body_buf += chunk_size.str() + CRLF + _rdbuf + CRLF;
+		_rdbuf.clear();
+		break;
+	}
+	}
+}
+
+// chunked 본문은 그대로 넘기되 끝을 알기 위해 조각 경계를 따라간다
+void Server::ProxyHandler::feedChunked(void)
+{
+	while (!_done && !_rdbuf.empty())
+	{
+		if (_chunk_state == CHUNK_DATA)
+		{
+			const size_t n = std::min(_body_remaining, _rdbuf.size());
+			// 조각 뒤의 CRLF는 캐시할 본문이 아니다
+			const size_t data_left = (_body_remaining > CRLF_LEN)
+										 ? _body_remaining - CRLF_LEN
+										 : 0;
+			_disk_capture.appendBody(_rdbuf.substr(0, std::min(n, data_left)));
+			_body_buf.append(_rdbuf, 0, n);
+			trimfrontstr(_rdbuf, n);
+			_body_remaining -= n;
+			if (_body_remaining == 0)
+				_chunk_state = CHUNK_SIZE;
+			continue;
+		}
+		const size_t crlf_pos = _rdbuf.find(CRLF);
+		if (crlf_pos == std::string::npos)
+		{
+			if (_rdbuf.size() > _max_header_size)
+				throw(std::runtime_error("invalid upstream chunk"));
+			return;
+		}
+		const std::string line = _rdbuf.substr(0, crlf_pos);
+		_body_buf.append(_rdbuf, 0, crlf_pos + CRLF_LEN);
+		trimfrontstr(_rdbuf, crlf_pos + CRLF_LEN);
+		if (_chunk_state == CHUNK_TRAILER)
+		{
+			if (line.empty())
+				finish();
+			continue;
+		}
+		std::string size_str = line.substr(0, line.find(';'));
+		strtrim(size_str, " \t");
+		const size_t chunk_size = toHexNum<size_t>(size_str);
+		if (chunk_size == 0)
+			_chunk_state = CHUNK_TRAILER;
+		else
+		{
+			_chunk_state = CHUNK_DATA;
+			_body_remaining = chunk_size + CRLF_LEN; // 조각 뒤의 CRLF까지
+		}
+	}
+}
+
+void Server::ProxyHandler::finish(void)
+{
+	releaseConnection(_keep_alive);
+	_disk_capture.end();
+	_done = true;
+}
+
+void Server::ProxyHandler::checkTimeout(void)
+{
+	if (monotonicMs() < _deadline)
+		return;
+	_timed_out = true;
+	throw(std::runtime_error("upstream timed out after "
+							 + toStr(_timeout_ms) + "ms"));
+}
+
+int Server::ProxyHandler::task(void)
+{
+	if (_done)
+		return (PROXY_STATUS_OK);
+	if (_output_paused)
+	{
+		// 클라이언트를 기다리는 동안은 업스트림 제한 시간을 재지 않는다
+		_deadline = monotonicMs() + _timeout_ms;
+		if (_body_buf.size() > _output_low_watermark)
+			return (PROXY_STATUS_AGAIN);
+		_conn->io.resumeRead();
+		_output_paused = false;
+	}
+	if (_conn->io.eventCount() > 0)
+		_deadline = monotonicMs() + _timeout_ms;
+	const size_t prev_size = _rdbuf.size();
+	_conn->io.getReadBuf(_rdbuf);
+	if (_rdbuf.size() > prev_size)
+		_received = true;
+
+	if (_head_parsed || parseHead())
+		feedBody();
+	if (_done)
+		return (PROXY_STATUS_OK);
+
+	if (_body_buf.size() >= _output_high_watermark)
+	{
+		LOG_DEBUG("client is slow, pause reading upstream response");
+		_conn->io.pauseRead();
+		_output_paused = true;
+		return (PROXY_STATUS_AGAIN);
+	}
+	const int io_status = _conn->io.stat();
+	if (io_status >= async::status::ERROR_GENERIC)
+	{
+		if (io_status == async::status::ERROR_FILECLOSED && _head_parsed
+			&& _body_type == BODY_UNTIL_CLOSE)
+		{
+			_body_buf += "0" + CRLF + CRLF;
+			finish();
+			return (PROXY_STATUS_OK);
+		}
+		const std::string error_msg = _conn->io.errorMsg();
+		releaseConnection(false);
+		// 쉬던 연결을 업스트림이 그새 닫았으면 새 연결로 한 번만 다시 보낸다.
+		// 다른 쉬던 연결도 같이 닫혔을 수 있으니 새로 연결한다
+		if (_reused && !_received && !_retried && retryable())
+		{
+			LOG_DEBUG("upstream connection was closed, retrying");
+			_retried = true;
+			acquireConnection(true);
+			return (PROXY_STATUS_AGAIN);
+		}
+		throw(std::runtime_error("upstream connection failed before end of "
+								 "response: "
+								 + error_msg));
+	}
+	checkTimeout();
+	return (PROXY_STATUS_AGAIN);
+}
+
+bool Server::ProxyHandler::hasHead(void) const
+{
+	return (_head_parsed && !_head_retrieved);
+}
+
+Response Server::ProxyHandler::retrieveHead(void)
+{
+	Response head = _response;
+
+	_head_retrieved = true;
+	_disk_capture.annotate(head);
+	return (head);
+}
+
+bool Server::ProxyHandler::headRetrieved(void) const
+{
+	return (_head_retrieved);
+}
+
+bool Server::ProxyHandler::hasBody(void) const
+{
+	return (_head_retrieved && !_body_buf.empty());
+}
+
+std::string Server::ProxyHandler::retrieveBody(void)
+{
+	std::string body;
+
+	body.swap(_body_buf);
+	return (body);
+}
+
+int Server::ProxyHandler::getMethod(void) const
+{
+	return (_request.getMethod());
+}
+
+DiskCache::Capture &Server::ProxyHandler::diskCapture(void)
+{
+	return (_disk_capture);
+}
+
+// 응답을 받기 전에 실패했을 때 클라이언트에 보낼 상태 코드
+int Server::ProxyHandler::errorCode(void) const
+{
+	if (_timed_out)
+		return (504); // Gateway Timeout
+	return (502);	  // Bad Gateway
+}
@@ -0,0 +1,61 @@
+#include "HTTP/RequestHandler.hpp"
+#include "HTTP/const_values.hpp"
+#include "async/FileIOHandler.hpp"
+#include "utils/string.hpp"
+
+using namespace HTTP;
+
+Server::RequestCachedHandler::RequestCachedHandler(
+	Server *server,
+	const Request &request,
+	const Server::Location &location,
+	const DiskCache::EntryPtr &entry)
+	: RequestHandler(server, request, location, entry->path)
+	, _entry(entry)
+	, _reader(_server->_timeout_ms, _resource_path)
+{
+}
+
+Server::RequestCachedHandler::~RequestCachedHandler()
+{
+}
+
+int Server::RequestCachedHandler::task(void)
+{
+	if (_status == RESPONSE_STATUS_OK || _status == RESPONSE_STATUS_ERROR)
+		return (_status);
+
+	int rc = _reader.task();
+	if (rc == async::status::OK_AGAIN)
+		return (_status);
+	if (rc != async::status::OK_DONE)
+	{
+		LOG_WARNING(_reader.errorMsg());
+		setErrorCode(500); // Internal Server Error
+		return (_status);
+	}
+
+	const std::string &content = _reader.retrieve();
+	const size_t head_end = content.find(CRLF + CRLF);
+	int status_code;
+	std::string reason;
+	Header header;
+	if (head_end == std::string::npos
+		|| !DiskCache::parseHead(
+			content.substr(0, head_end), status_code, reason, header))
+	{
+		LOG_WARNING("broken cache file " << _resource_path);
+		setErrorCode(500); // Internal Server Error
+		return (_status);
+	}
+	const std::string body = content.substr(head_end + CRLF_LEN * 2);
+	_response = Response(header);
+	_response.setStatus(status_code, reason);
+	_response.setBody(body);
+	_response.setContentLength(body.length());
+	_response.setValue("X-Cache", "HIT");
+	_response.setValue("Age",
+					   toStr((monotonicMs() - _entry->stored_at) / 1000));
+	_status = RESPONSE_STATUS_OK;
+	return (_status);
+}
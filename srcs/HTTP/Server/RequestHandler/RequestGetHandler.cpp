@@ -9,11 +9,30 @@ Server::RequestGetHandler::RequestGetHandler(Server *server,
 											 const std::string &resource_path)
 	: RequestHandler(server, request, location, resource_path)
 	, _reader(_server->_timeout_ms, _resource_path)
+	, _listing(NULL)
 {
 }
 
 Server::RequestGetHandler::~RequestGetHandler()
 {
+	if (_listing)
+		_listing->release();
+}
+
+int Server::RequestGetHandler::waitDirectoryListing(void)
+{
+	if (!_listing->isDone())
+	{
+		_status = Server::RequestHandler::RESPONSE_STATUS_AGAIN;
+		return (_status);
+	}
+	_response.setDirectoryListing(_listing->listing);
+	_response.setStatus(200);
+	_listing->release();
+	_listing = NULL;
+	_status = Server::RequestHandler::RESPONSE_STATUS_OK;
+	LOG_VERBOSE("autoindex success");
+	return (_status);
 }
 
 // uri = <스킴>://<사용자
@@ -23,17 +42,8 @@ int Server::RequestGetHandler::task(void)
 {
 	if (_status == RESPONSE_STATUS_OK || _status == RESPONSE_STATUS_ERROR)
 		return (_status);
-
-	if (isInvalidDirectoryFormat())
-	{
-		_response.setStatus(301);
-		_response.setLocation(_request.getURIPath() + "/");
-		_response.setContentLength(0);
-		_status = Server::RequestHandler::RESPONSE_STATUS_OK;
-		LOG_WARNING("invalid directory format, redirect to \""
-					<< _request.getURIPath() + "\"");
-		return (_status);
-	}
+	if (_listing)
+		return (waitDirectoryListing());
 
 	int rc = _reader.task();
 	if (rc == async::status::OK_DONE)
@@ -49,6 +59,15 @@ int Server::RequestGetHandler::task(void)
 	{
 		_status = Server::RequestHandler::RESPONSE_STATUS_AGAIN;
 	}
+	else if (rc == async::status::ERROR_FILEISDIR && !isDirectoryFormat())
+	{
+		_response.setStatus(301);
+		_response.setLocation(_request.getURIPath() + "/");
+		_response.setContentLength(0);
+		_status = Server::RequestHandler::RESPONSE_STATUS_OK;
+		LOG_WARNING("invalid directory format, redirect to \""
+					<< _request.getURIPath() + "\"");
+	}
 	else if (rc == async::status::ERROR_FILEISDIR)
 	{
 		LOG_VERBOSE("Resource " << _resource_path
@@ -56,10 +75,10 @@ int Server::RequestGetHandler::task(void)
 		_status = Server::RequestHandler::RESPONSE_STATUS_OK;
 		if (_location.hasAutoIndex() == true)
 		{
-			_response.makeDirectoryListing(_resource_path,
-										   _request.getURIPath());
-			_response.setStatus(200);
-			LOG_VERBOSE("autoindex success");
+			_listing = new DirectoryListingTask(_resource_path,
+												_request.getURIPath());
+			async::FileTaskPool::submit(_listing);
+			return (waitDirectoryListing());
 		}
 		else
 		{
@@ -1,9 +1,20 @@
 #include "HTTP/RequestHandler.hpp"
-#include "utils/file.hpp"
 #include "utils/string.hpp"
 
 using namespace HTTP;
 
+DirectoryListingTask::DirectoryListingTask(const std::string &path,
+										   const std::string &uri)
+	: path(path)
+	, uri(uri)
+{
+}
+
+void DirectoryListingTask::run(void)
+{
+	listing = Response::generateDirectoryListing(path, uri);
+}
+
 Server::RequestHandler::RequestHandler(Server *server,
 									   const Request &request,
 									   const Server::Location &location,
@@ -38,18 +49,12 @@ Response Server::RequestHandler::retrieve(void)
 	return (_response);
 }
 
-bool Server::RequestHandler::isDirectory(void) const
-{
-	return (::isDirectory(_resource_path));
-}
-
-bool Server::RequestHandler::isInvalidDirectoryFormat(void) const
+// 디렉토리로 확인된 자원의 경로가 '/'로 끝나는지 여부
+bool Server::RequestHandler::isDirectoryFormat(void) const
 {
 	if (_resource_path == "/")
-		return (false);
-	if (isDirectory() && _resource_path[_resource_path.size() - 1] != '/')
 		return (true);
-	return (false);
+	return (_resource_path[_resource_path.size() - 1] == '/');
 }
 
 const int &Server::RequestHandler::errorCode(void) const
@@ -20,17 +20,6 @@ int Server::RequestHeadHandler::task(void)
 	if (_status == RESPONSE_STATUS_OK || _status == RESPONSE_STATUS_ERROR)
 		return (_status);
 
-	if (isInvalidDirectoryFormat())
-	{
-		_response.setStatus(301);
-		_response.setLocation(_request.getURIPath() + "/");
-		_response.setContentLength(0);
-		_status = Server::RequestHandler::RESPONSE_STATUS_OK;
-		LOG_WARNING("invalid directory format, redirect to \""
-					<< _request.getURIPath() + "\"");
-		return (_status);
-	}
-
 	int rc = _reader.task();
 	if (rc == async::status::OK_DONE)
 	{
@@ -44,6 +33,15 @@ int Server::RequestHeadHandler::task(void)
 	{
 		_status = Server::RequestHandler::RESPONSE_STATUS_AGAIN;
 	}
+	else if (rc == async::status::ERROR_FILEISDIR && !isDirectoryFormat())
+	{
+		_response.setStatus(301);
+		_response.setLocation(_request.getURIPath() + "/");
+		_response.setContentLength(0);
+		_status = Server::RequestHandler::RESPONSE_STATUS_OK;
+		LOG_WARNING("invalid directory format, redirect to \""
+					<< _request.getURIPath() + "\"");
+	}
 	else if (rc == async::status::ERROR_FILEISDIR)
 	{
 		LOG_WARNING(_reader.errorMsg());
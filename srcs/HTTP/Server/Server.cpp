@@ -9,12 +9,24 @@ using namespace HTTP;
 
 const int Server::_http_min_version = 1001;
 const int Server::_http_max_version = 1001;
+const size_t Server::_fastcgi_workers_default = 4;
+const size_t Server::_fastcgi_workers_max = 64;
+const size_t Server::_cgi_spill_threshold_default = 1024 * 1024;
+const size_t Server::_cgi_max_processes_default = 64;
+const size_t Server::_cgi_queue_size_default = 128;
+const unsigned int Server::_cgi_retry_after_sec = 1;
+const size_t Server::_disk_cache_max_size_default = 64 * 1024 * 1024;
+const size_t Server::_spare_arenas_max = 64;
 
 Server::Server(const ConfigContext &server_context,
 			   const size_t max_body_size,
 			   const unsigned int timeout_ms)
 	: _cgi_enabled(false)
 	, _temp_dir_path(".")
+	, _cgi_spill_threshold(_cgi_spill_threshold_default)
+	, _cgi_max_processes(_cgi_max_processes_default)
+	, _cgi_queue_size(_cgi_queue_size_default)
+	, _cgi_revalidating(0)
 	, _max_body_size(max_body_size)
 	, _timeout_ms(timeout_ms)
 	, _logger(async::Logger::getLogger("Server"))
@@ -23,11 +35,34 @@ Server::Server(const ConfigContext &server_context,
 	parseDirectiveErrorPage(server_context);
 	parseDirectiveServerName(server_context);
 	parseDirectiveLocation(server_context);
+	// FastCGI 소켓을 temp_dir_path에 만들므로 cgi_pass보다 먼저 읽는다
+	parseDirectiveTmpDirPath(server_context);
 	parseDirectiveCGI(server_context);
 	parseDirectiveCGILimitExcept(server_context);
-	parseDirectiveTmpDirPath(server_context);
+	parseDirectiveCGISpillThreshold(server_context);
+	parseDirectiveCGIMaxProcesses(server_context);
+	parseDirectiveCGIQueueSize(server_context);
+	parseDirectiveDiskCacheMaxSize(server_context);
+	_cgi_stats.admitted = 0;
+	_cgi_stats.rejected = 0;
+	_cgi_stats.waiting = 0;
+	_cgi_stats.running = 0;
+	_cgi_stats.wait_ms_total = 0;
+	_cgi_stats.wait_ms_max = 0;
 }
 
 Server::~Server()
 {
+	// 실행 중이던 CGI의 전역 자리를 돌려준다
+	while (!_cgi_admitted.empty())
+		releaseCGISlot(*_cgi_admitted.begin());
+	for (; _cgi_revalidating > 0; _cgi_revalidating--)
+		releaseGlobalCGISlot();
+	// 핸들러는 이 뒤에 멤버와 함께 사라지므로 아레나는 그때 지워진다
+	for (std::map<int, ft::Arena *>::iterator it = _arenas.begin();
+		 it != _arenas.end();
+		 it++)
+		it->second->retire();
+	for (size_t i = 0; i < _spare_arenas.size(); i++)
+		_spare_arenas[i]->retire();
 }
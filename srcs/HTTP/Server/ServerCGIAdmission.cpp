@@ -0,0 +1,104 @@
+#include "HTTP/Server.hpp"
+
+using namespace HTTP;
+
+size_t Server::_cgi_max_processes_global = 0;
+volatile size_t Server::_cgi_processes_global = 0;
+
+void Server::setGlobalCGIMaxProcesses(const size_t max_processes)
+{
+	_cgi_max_processes_global = max_processes;
+}
+
+bool Server::acquireGlobalCGISlot(void)
+{
+	size_t running;
+
+	do
+	{
+		running = _cgi_processes_global;
+		if (_cgi_max_processes_global != 0
+			&& running >= _cgi_max_processes_global)
+			return (false);
+	} while (!__sync_bool_compare_and_swap(
+		&_cgi_processes_global, running, running + 1));
+	return (true);
+}
+
+void Server::releaseGlobalCGISlot(void)
+{
+	__sync_fetch_and_sub(&_cgi_processes_global, 1);
+}
+
+bool Server::cgiSlotAvailable(void) const
+{
+	if (_cgi_admitted.size() + _cgi_revalidating >= _cgi_max_processes)
+		return (false);
+	return (_cgi_max_processes_global == 0
+			|| _cgi_processes_global < _cgi_max_processes_global);
+}
+
+// 대기열 앞에서부터 자리가 나는 만큼 실행을 허락한다
+void Server::admitWaitingCGIHandlers(void)
+{
+	while (!_cgi_waiting.empty()
+		   && _cgi_admitted.size() + _cgi_revalidating < _cgi_max_processes)
+	{
+		if (!acquireGlobalCGISlot())
+			return;
+		const int client_fd = _cgi_waiting.front().first;
+		const msec_t waited = monotonicMs() - _cgi_waiting.front().second;
+		_cgi_waiting.pop_front();
+		_cgi_admitted.insert(client_fd);
+		_cgi_stats.admitted++;
+		_cgi_stats.wait_ms_total += waited;
+		if (waited > _cgi_stats.wait_ms_max)
+			_cgi_stats.wait_ms_max = waited;
+		LOG_VERBOSE("CGI for client " << client_fd << " admitted after "
+									  << waited << "ms");
+	}
+}
+
+// 클라이언트의 맨 앞 CGI 핸들러가 실행되어도 되는지. 처음 물으면 대기열
+// 뒤에 세운다.
+bool Server::admitCGIHandler(int client_fd)
+{
+	if (_cgi_admitted.count(client_fd))
+		return (true);
+	std::deque<std::pair<int, msec_t> >::iterator it = _cgi_waiting.begin();
+	while (it != _cgi_waiting.end() && it->first != client_fd)
+		it++;
+	if (it == _cgi_waiting.end())
+		_cgi_waiting.push_back(std::make_pair(client_fd, monotonicMs()));
+	admitWaitingCGIHandlers();
+	return (_cgi_admitted.count(client_fd) > 0);
+}
+
+void Server::releaseCGISlot(int client_fd)
+{
+	if (_cgi_admitted.erase(client_fd) == 0)
+		return;
+	releaseGlobalCGISlot();
+}
+
+void Server::cancelWaitingCGIHandler(int client_fd)
+{
+	for (std::deque<std::pair<int, msec_t> >::iterator it
+		 = _cgi_waiting.begin();
+		 it != _cgi_waiting.end();
+		 it++)
+	{
+		if (it->first == client_fd)
+		{
+			_cgi_waiting.erase(it);
+			return;
+		}
+	}
+}
+
+const Server::CGIAdmissionStats &Server::getCGIAdmissionStats(void)
+{
+	_cgi_stats.waiting = _cgi_waiting.size();
+	_cgi_stats.running = _cgi_admitted.size() + _cgi_revalidating;
+	return (_cgi_stats);
+}
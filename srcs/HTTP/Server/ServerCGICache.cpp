@@ -0,0 +1,123 @@
+#include "HTTP/Server.hpp"
+#include "async/TaskTimer.hpp"
+#include "utils/alloc_profile.hpp"
+
+using namespace HTTP;
+
+// 캐시를 켠 location의 GET 요청. 쓸 수 있는 항목이 있거나 채워지는
+// 중이면 그것을 기다리는 핸들러를, 아니면 항목을 채울 핸들러를 만든다.
+Server::_CGIRequestHandlerPtr Server::createCachedCGIHandler(
+	const CGI::Request &cgi_request,
+	const Location &location,
+	const std::string &exec_path)
+{
+	const std::string key = CGI::ResponseCache::makeKey(
+		exec_path, cgi_request, location.getCGICacheVary());
+	CGI::ResponseCache::EntryPtr entry;
+
+	if (_cgi_cache.find(key, entry))
+	{
+		const msec_t now = monotonicMs();
+		bool usable = false;
+		if (entry->state == CGI::ResponseCache::Entry::PENDING)
+		{
+			LOG_VERBOSE("CGI cache: waiting for running " << exec_path);
+			usable = true;
+		}
+		else if (entry->state == CGI::ResponseCache::Entry::READY
+				 && now < entry->fresh_until)
+		{
+			LOG_VERBOSE("CGI cache: hit for " << cgi_request.getPath());
+			usable = true;
+		}
+		else if (entry->state == CGI::ResponseCache::Entry::READY
+				 && now < entry->stale_until)
+		{
+			LOG_VERBOSE("CGI cache: stale hit for " << cgi_request.getPath());
+			if (!entry->revalidating)
+				revalidateCGICache(cgi_request, location, exec_path, entry);
+			usable = true;
+		}
+		if (usable)
+			return (_CGIRequestHandlerPtr(new CGI::RequestHandlerCached(
+				cgi_request, exec_path, entry, _timeout_ms)));
+	}
+
+	LOG_VERBOSE("CGI cache: miss for " << cgi_request.getPath());
+	_CGIRequestHandlerPtr handler = createCGIHandler(cgi_request, exec_path);
+	handler->cacheOutput(_cgi_cache.reserve(key),
+						 location.getCGICacheTTL(),
+						 location.getCGICacheStale());
+	return (handler);
+}
+
+// 옛 응답을 내주는 동안 뒤에서 한 번 다시 실행한다. 자리가 없으면 다음
+// 요청 때 다시 시도한다.
+void Server::revalidateCGICache(const CGI::Request &cgi_request,
+								const Location &location,
+								const std::string &exec_path,
+								CGI::ResponseCache::EntryPtr &entry)
+{
+	_CGIRequestHandlerPtr handler;
+
+	try
+	{
+		handler = createCGIHandler(cgi_request, exec_path);
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOG_WARNING("CGI cache: cannot revalidate: " << e.what());
+		return;
+	}
+	if (handler->spawnsProcess())
+	{
+		if (_cgi_admitted.size() + _cgi_revalidating >= _cgi_max_processes
+			|| !acquireGlobalCGISlot())
+			return;
+		_cgi_revalidating++;
+	}
+	handler->cacheOutput(
+		entry, location.getCGICacheTTL(), location.getCGICacheStale());
+	entry->revalidating = true;
+	_cgi_revalidations.push_back(handler);
+}
+
+// 다시 실행한 결과는 캐시에만 넣고 버린다
+void Server::iterateCGIRevalidations(void)
+{
+	ALLOC_SCOPE(SUBSYSTEM_CGI);
+	std::vector<_CGIRequestHandlerPtr>::iterator it
+		= _cgi_revalidations.begin();
+
+	while (it != _cgi_revalidations.end())
+	{
+		_CGIRequestHandlerPtr &handler = *it;
+		bool done = true;
+		try
+		{
+			async::TaskTimer timer;
+			int rc = handler->task();
+			timer.check(typeid(*handler), -1); // 클라이언트 없이 실행한다
+			if (handler->hasHead())
+				handler->retrieveHead();
+			if (handler->hasBody())
+				handler->retrieveBody();
+			done = (rc == CGI::RequestHandler::CGI_RESPONSE_STATUS_OK);
+		}
+		catch (std::exception &e)
+		{
+			LOG_WARNING("CGI cache: revalidation failed: " << e.what());
+		}
+		if (!done)
+		{
+			it++;
+			continue;
+		}
+		if (handler->spawnsProcess())
+		{
+			_cgi_revalidating--;
+			releaseGlobalCGISlot();
+		}
+		it = _cgi_revalidations.erase(it);
+	}
+}
@@ -0,0 +1,50 @@
+#include "HTTP/Server.hpp"
+#include "HTTP/const_values.hpp"
+
+using namespace HTTP;
+
+// 신선한 항목이 있으면 정적 파일처럼 읽어 보낸다
+bool Server::serveFromDiskCache(int client_fd,
+								const Request &request,
+								const Location &location)
+{
+	DiskCache::EntryPtr entry;
+
+	if (!location.diskCacheEnabled() || !DiskCache::isCacheable(request)
+		|| !_disk_cache.find(DiskCache::makeKey(request), entry))
+		return (false);
+
+	_RequestHandlerPtr handler(
+		new (arena(client_fd))
+			RequestCachedHandler(this, request, location, entry));
+	if (_request_handlers.find(client_fd) == _request_handlers.end())
+		_request_handlers[client_fd] = std::queue<_RequestHandlerPtr>();
+	if (_output_queue.find(client_fd) == _output_queue.end())
+		_output_queue[client_fd] = std::queue<Response>();
+	_request_handlers[client_fd].push(handler);
+	_turns[client_fd].push(TURN_REQUEST);
+	LOG_VERBOSE("Serving " << request.getURIPath() << " from disk cache");
+	return (true);
+}
+
+// 백엔드로 보내는 요청이면 응답을 모아 두도록 핸들러에 알린다
+void Server::prepareDiskCache(const Request &request,
+							  const Location &location,
+							  DiskCache::Capture &capture)
+{
+	if (!location.diskCacheEnabled())
+		return;
+	if (!DiskCache::isCacheable(request))
+	{
+		capture.cache_status = DiskCache::STATUS_BYPASS;
+		_disk_cache.countBypass();
+		return;
+	}
+	capture.begin(DiskCache::makeKey(request), location.getDiskCacheTTL());
+	_disk_cache.countMiss();
+}
+
+const DiskCache::Stats &Server::getDiskCacheStats(void)
+{
+	return (_disk_cache.getStats());
+}
@@ -1,7 +1,10 @@
 #include "ConfigDirective.hpp"
+#include "HTTP/Metrics.hpp"
 #include "HTTP/Server.hpp"
 #include "HTTP/const_values.hpp"
 #include "HTTP/error_pages.hpp"
+#include "async/TaskTimer.hpp"
+#include "utils/alloc_profile.hpp"
 #include "utils/string.hpp"
 #include <cctype>
 
@@ -11,11 +14,69 @@ void Server::task(void)
 {
 	iterateRequestHandlers();
 	iterateCGIHandlers();
+	iterateCGIRevalidations();
+	iterateProxyHandlers();
+	_disk_cache.poll();
 	iterateErrorHandlers();
 }
 
+// 핸들러가 모두 사라질 때마다 되감으므로 keep-alive 연결은 청크 하나를 계속
+// 다시 쓴다. 짧은 연결도 할당하지 않도록 끊긴 연결의 아레나를 물려받는다
+ft::Arena &Server::arena(int client_fd)
+{
+	std::map<int, ft::Arena *>::iterator it = _arenas.find(client_fd);
+	if (it != _arenas.end())
+		return (*it->second);
+
+	ft::Arena *arena;
+	if (_spare_arenas.empty())
+		arena = new ft::Arena();
+	else
+	{
+		arena = _spare_arenas.back();
+		_spare_arenas.pop_back();
+	}
+	_arenas[client_fd] = arena;
+	return (*arena);
+}
+
+bool Server::isTurnOf(int client_fd, int kind) const
+{
+	std::map<int, std::queue<int> >::const_iterator it
+		= _turns.find(client_fd);
+	return (it != _turns.end() && !it->second.empty()
+			&& it->second.front() == kind);
+}
+
+// 맨 앞 차례가 끝났다. 그 뒤에서 기다리던 응답을 순서대로 내보낸다
+void Server::finishTurn(int client_fd)
+{
+	std::queue<int> &turns = _turns[client_fd];
+	turns.pop();
+	while (!turns.empty() && turns.front() == TURN_RESPONSE)
+	{
+		_output_queue[client_fd].push(_held_responses[client_fd].front());
+		_held_responses[client_fd].pop();
+		turns.pop();
+	}
+}
+
+// 핸들러 없이 바로 만든 응답도 앞선 요청의 응답이 끝난 뒤에 내보낸다
+void Server::pushResponse(int client_fd, const Response &response)
+{
+	std::queue<int> &turns = _turns[client_fd];
+	if (turns.empty())
+	{
+		_output_queue[client_fd].push(response);
+		return;
+	}
+	_held_responses[client_fd].push(response);
+	turns.push(TURN_RESPONSE);
+}
+
 void Server::iterateRequestHandlers(void)
 {
+	ALLOC_SCOPE(SUBSYSTEM_HANDLER);
 	for (std::map<int, std::queue<_RequestHandlerPtr> >::iterator it
 		 = _request_handlers.begin();
 		 it != _request_handlers.end();
@@ -23,14 +84,17 @@ void Server::iterateRequestHandlers(void)
 	{
 		int client_fd = it->first;
 		std::queue<_RequestHandlerPtr> &handlers = it->second;
-		if (handlers.empty())
+		if (handlers.empty() || !isTurnOf(client_fd, TURN_REQUEST))
 			continue;
 		_RequestHandlerPtr &handler = handlers.front();
+		async::TaskTimer timer;
 		int rc = handler->task();
+		timer.check(typeid(*handler), client_fd);
 		if (rc == RequestHandler::RESPONSE_STATUS_OK)
 		{
 			_output_queue[client_fd].push(handler->retrieve());
 			handlers.pop();
+			finishTurn(client_fd);
 			LOG_VERBOSE("Response for client " << client_fd
 											   << " has been retrieved");
 		}
@@ -38,18 +102,20 @@ void Server::iterateRequestHandlers(void)
 			continue;
 		else if (rc == RequestHandler::RESPONSE_STATUS_ERROR)
 		{
-			registerErrorResponseHandler(client_fd,
-										 handler->getRequest().getMethod(),
-										 handler->errorCode());
-			handlers.pop();
 			LOG_ERROR("RequestHandler return code " << rc << ", causing code "
 													<< handler->errorCode());
+			replaceTurnWithError(client_fd,
+								 handler->getRequest().getMethod(),
+								 handler->errorCode());
+			handlers.pop();
 		}
 	}
 }
 
 void Server::iterateCGIHandlers(void)
 {
+	ALLOC_SCOPE(SUBSYSTEM_CGI);
+	admitWaitingCGIHandlers();
 	for (std::map<int, std::queue<_CGIRequestHandlerPtr> >::iterator it
 		 = _cgi_handlers.begin();
 		 it != _cgi_handlers.end();
@@ -57,53 +123,179 @@ void Server::iterateCGIHandlers(void)
 	{
 		int client_fd = it->first;
 		std::queue<_CGIRequestHandlerPtr> &handlers = it->second;
-		if (handlers.empty())
+		if (handlers.empty() || !isTurnOf(client_fd, TURN_CGI))
 			continue;
 
+		_CGIRequestHandlerPtr &handler = handlers.front();
+		if (handler->spawnsProcess() && !admitCGIHandler(client_fd))
+			continue;
 		try
 		{
-			int rc = handlers.front()->task();
+			async::TaskTimer timer;
+			int rc = handler->task();
+			timer.check(typeid(*handler), client_fd);
+			// 헤더가 준비되면 CGI가 끝나기를 기다리지 않고 먼저 보낸다
+			if (handler->hasHead())
+			{
+				Response head = handler->retrieveHead();
+				head.setStreaming();
+				_output_queue[client_fd].push(head);
+			}
+			// 끝났으면 남은 본문은 클라이언트가 느려도 한꺼번에 넘긴다
+			if (handler->hasBody()
+				&& (rc == CGI::RequestHandler::CGI_RESPONSE_STATUS_OK
+					|| !_paused_clients.count(client_fd)))
+				_output_queue[client_fd].push(
+					Response::fragment(handler->retrieveBody()));
 			if (rc == CGI::RequestHandler::CGI_RESPONSE_STATUS_OK)
 			{
-				const CGI::Response &cgi_response
-					= handlers.front()->retrieve();
-				_output_queue[client_fd].push(cgi_response.toHTTPResponse());
+				if (!handler->headRetrieved())
+					_output_queue[client_fd].push(
+						handler->retrieve().toHTTPResponse());
+				else
+					_output_queue[client_fd].push(Response::endOfStream());
+				_disk_cache.store(handler->diskCapture());
 				handlers.pop();
+				finishTurn(client_fd);
+				releaseCGISlot(client_fd);
 				LOG_VERBOSE("Response for client " << client_fd
 												   << " has been retrieved");
 			}
 			else if (rc == CGI::RequestHandler::CGI_RESPONSE_STATUS_AGAIN)
 				continue;
 		}
+		catch (const CGI::ResponseCache::Unavailable &e)
+		{
+			// 함께 기다리던 실행이 캐시를 채우지 못했으면 직접 실행한다
+			LOG_VERBOSE("CGI cache entry failed, running "
+						<< handler->getExecPath() << " for client "
+						<< client_fd);
+			try
+			{
+				handler = createCGIHandler(handler->getRequest(),
+										   handler->getExecPath());
+			}
+			catch (const std::runtime_error &e)
+			{
+				LOG_ERROR(e.what());
+				replaceTurnWithError(client_fd,
+									 METHOD[handler->getMethod()],
+									 500); // Internal Server Error
+				handlers.pop();
+			}
+		}
 		catch (std::exception &e)
 		{
-			registerErrorResponseHandler(client_fd,
-										 METHOD[handlers.front()->getMethod()],
-										 500); // Internal Server Error}
+			LOG_ERROR(e.what());
+			if (handler->headRetrieved())
+			{
+				// 이미 보낸 응답을 되돌릴 수 없으니 연결을 끊어 알린다
+				Response abort = Response::endOfStream();
+				abort.setCloseAfterWrite();
+				_output_queue[client_fd].push(abort);
+				finishTurn(client_fd);
+				LOG_ERROR("CGI failed after sending header, closing client");
+			}
+			else
+			{
+				replaceTurnWithError(client_fd,
+									 METHOD[handler->getMethod()],
+									 500); // Internal Server Error
+				LOG_ERROR("CGI failed, causing code 500");
+			}
 			handlers.pop();
+			releaseCGISlot(client_fd);
+		}
+	}
+}
+
+void Server::iterateProxyHandlers(void)
+{
+	ALLOC_SCOPE(SUBSYSTEM_HANDLER);
+	for (std::map<int, std::queue<_ProxyHandlerPtr> >::iterator it
+		 = _proxy_handlers.begin();
+		 it != _proxy_handlers.end();
+		 it++)
+	{
+		int client_fd = it->first;
+		std::queue<_ProxyHandlerPtr> &handlers = it->second;
+		if (handlers.empty() || !isTurnOf(client_fd, TURN_PROXY))
+			continue;
+
+		_ProxyHandlerPtr &handler = handlers.front();
+		try
+		{
+			async::TaskTimer timer;
+			int rc = handler->task();
+			timer.check(typeid(*handler), client_fd);
+			if (handler->hasHead())
+			{
+				Response head = handler->retrieveHead();
+				head.setStreaming();
+				_output_queue[client_fd].push(head);
+			}
+			// 끝났으면 남은 본문은 클라이언트가 느려도 한꺼번에 넘긴다
+			if (handler->hasBody()
+				&& (rc == ProxyHandler::PROXY_STATUS_OK
+					|| !_paused_clients.count(client_fd)))
+				_output_queue[client_fd].push(
+					Response::fragment(handler->retrieveBody()));
+			if (rc == ProxyHandler::PROXY_STATUS_OK)
+			{
+				_output_queue[client_fd].push(Response::endOfStream());
+				_disk_cache.store(handler->diskCapture());
+				handlers.pop();
+				finishTurn(client_fd);
+				LOG_VERBOSE("Proxied response for client "
+							<< client_fd << " has been retrieved");
+			}
+		}
+		catch (std::exception &e)
+		{
 			LOG_ERROR(e.what());
-			LOG_ERROR("CGI failed, causing code 500");
+			if (handler->headRetrieved())
+			{
+				// 이미 보낸 응답을 되돌릴 수 없으니 연결을 끊어 알린다
+				Response abort = Response::endOfStream();
+				abort.setCloseAfterWrite();
+				_output_queue[client_fd].push(abort);
+				finishTurn(client_fd);
+				LOG_ERROR("upstream failed after sending header, "
+						  "closing client");
+			}
+			else
+			{
+				LOG_ERROR("upstream failed, causing code "
+						  << handler->errorCode());
+				replaceTurnWithError(
+					client_fd, handler->getMethod(), handler->errorCode());
+			}
+			handlers.pop();
 		}
 	}
 }
 
 void Server::iterateErrorHandlers(void)
 {
-	for (std::map<int, std::queue<_ErrorResponseHandlerPtr> >::iterator it
+	ALLOC_SCOPE(SUBSYSTEM_HANDLER);
+	for (std::map<int, std::deque<_ErrorResponseHandlerPtr> >::iterator it
 		 = _error_handlers.begin();
 		 it != _error_handlers.end();
 		 it++)
 	{
 		int client_fd = it->first;
-		std::queue<_ErrorResponseHandlerPtr> &handlers = it->second;
-		if (handlers.empty())
+		std::deque<_ErrorResponseHandlerPtr> &handlers = it->second;
+		if (handlers.empty() || !isTurnOf(client_fd, TURN_ERROR))
 			continue;
+		async::TaskTimer timer;
 		int rc = handlers.front()->task();
+		timer.check(typeid(*handlers.front()), client_fd);
 		LOG_DEBUG("ErrorResponseHandler rc " << rc);
 		if (rc == RequestHandler::RESPONSE_STATUS_OK)
 		{
 			_output_queue[client_fd].push(handlers.front()->retrieve());
-			handlers.pop();
+			handlers.pop_front();
+			finishTurn(client_fd);
 			LOG_VERBOSE("Error Response for client " << client_fd
 													 << " has been retrieved");
 		}
@@ -130,23 +322,28 @@ void Server::registerHTTPRequest(int client_fd,
 		{
 		case METHOD_GET:
 			handler = _RequestHandlerPtr(
-				new RequestGetHandler(this, request, location, path));
+				new (arena(client_fd))
+					RequestGetHandler(this, request, location, path));
 			break;
 		case METHOD_HEAD:
 			handler = _RequestHandlerPtr(
-				new RequestHeadHandler(this, request, location, path));
+				new (arena(client_fd))
+					RequestHeadHandler(this, request, location, path));
 			break;
 		case METHOD_POST:
 			handler = _RequestHandlerPtr(
-				new RequestPostHandler(this, request, location, path));
+				new (arena(client_fd))
+					RequestPostHandler(this, request, location, path));
 			break;
 		case METHOD_PUT:
 			handler = _RequestHandlerPtr(
-				new RequestPutHandler(this, request, location, path));
+				new (arena(client_fd))
+					RequestPutHandler(this, request, location, path));
 			break;
 		case METHOD_DELETE:
 			handler = _RequestHandlerPtr(
-				new RequestDeleteHandler(this, request, location, path));
+				new (arena(client_fd))
+					RequestDeleteHandler(this, request, location, path));
 			break;
 		default:
 			// Not Implemented
@@ -167,33 +364,50 @@ void Server::registerHTTPRequest(int client_fd,
 	if (_output_queue.find(client_fd) == _output_queue.end())
 		_output_queue[client_fd] = std::queue<Response>();
 	_request_handlers[client_fd].push(handler);
+	_turns[client_fd].push(TURN_REQUEST);
 	LOG_VERBOSE("Registered HTTP RequestHandler for "
 				<< METHOD[request.getMethod()]);
 }
 
+Server::_CGIRequestHandlerPtr Server::createCGIHandler(
+	const CGI::Request &cgi_request,
+	const std::string &exec_path)
+{
+	const size_t body_size = cgi_request.getMessageBody().size();
+
+	if (_fastcgi_pools.find(exec_path) != _fastcgi_pools.end())
+	{
+		LOG_VERBOSE("Create CGI::RequestHandlerFastCGI for " << exec_path);
+		return (_CGIRequestHandlerPtr(new CGI::RequestHandlerFastCGI(
+			cgi_request, _fastcgi_pools[exec_path], _timeout_ms)));
+	}
+	if (body_size > _cgi_spill_threshold)
+	{
+		LOG_VERBOSE("Create CGI::RequestHandlerVnode for body size "
+					<< body_size);
+		return (_CGIRequestHandlerPtr(new CGI::RequestHandlerVnode(
+			cgi_request, exec_path, _timeout_ms, _temp_dir_path)));
+	}
+	LOG_VERBOSE("Create CGI::RequestHandlerPipe for body size " << body_size);
+	return (_CGIRequestHandlerPtr(
+		new CGI::RequestHandlerPipe(cgi_request, exec_path, _timeout_ms)));
+}
+
 void Server::registerCGIRequest(int client_fd,
 								const Request &request,
+								const Location &location,
 								const std::string &exec_path,
 								const std::string &resource_path)
 {
+	ALLOC_SCOPE(SUBSYSTEM_CGI);
 	CGI::Request cgi_request(request, resource_path);
 	_CGIRequestHandlerPtr handler;
 	try
 	{
-		if (request.getBody().size() > CGI::RequestHandler::pipeThreshold)
-		{
-			LOG_VERBOSE("Create CGI::RequestHandlerVnode for body size "
-						<< request.getBody().size());
-			handler = _CGIRequestHandlerPtr(new CGI::RequestHandlerVnode(
-				cgi_request, exec_path, _timeout_ms, _temp_dir_path));
-		}
+		if (request.getMethod() == METHOD_GET && location.cgiCacheEnabled())
+			handler = createCachedCGIHandler(cgi_request, location, exec_path);
 		else
-		{
-			LOG_VERBOSE("Create CGI::RequestHandlerPipe for body size "
-						<< request.getBody().size());
-			handler = _CGIRequestHandlerPtr(new CGI::RequestHandlerPipe(
-				cgi_request, exec_path, _timeout_ms));
-		}
+			handler = createCGIHandler(cgi_request, exec_path);
 	}
 	catch (const std::runtime_error &e)
 	{
@@ -204,27 +418,101 @@ void Server::registerCGIRequest(int client_fd,
 		return;
 	}
 
+	if (handler->capturesOutput())
+		prepareDiskCache(request, location, handler->diskCapture());
+
+	// 자리도 대기열도 가득 차면 프로세스를 더 띄우지 않고 바로 거절한다
+	if (handler->spawnsProcess() && !cgiSlotAvailable()
+		&& _cgi_waiting.size() >= _cgi_queue_size)
+	{
+		_cgi_stats.rejected++;
+		LOG_WARNING("CGI queue is full (" << _cgi_admitted.size()
+										  << " running, "
+										  << _cgi_waiting.size()
+										  << " waiting), rejecting request");
+		registerErrorResponseHandler(client_fd,
+									 request.getMethod(),
+									 503, // Service Unavailable
+									 _cgi_retry_after_sec);
+		return;
+	}
+
 	if (_cgi_handlers.find(client_fd) == _cgi_handlers.end())
 		_cgi_handlers[client_fd] = std::queue<_CGIRequestHandlerPtr>();
 	if (_output_queue.find(client_fd) == _output_queue.end())
 		_output_queue[client_fd] = std::queue<Response>();
 	_cgi_handlers[client_fd].push(handler);
+	_turns[client_fd].push(TURN_CGI);
 	LOG_VERBOSE("Registered CGI RequestHandler for "
 				<< METHOD[request.getMethod()]);
 }
 
-void Server::registerErrorResponseHandler(int client_fd, int method, int code)
+void Server::registerProxyRequest(int client_fd,
+								  const Request &request,
+								  const Location &location)
+{
+	_ProxyHandlerPtr handler;
+	try
+	{
+		handler = _ProxyHandlerPtr(new (arena(client_fd)) ProxyHandler(
+			request, _upstream_pools[location.getPath()], _timeout_ms));
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOG_WARNING(e.what());
+		registerErrorResponseHandler(client_fd,
+									 request.getMethod(),
+									 502); // Bad Gateway
+		return;
+	}
+	prepareDiskCache(request, location, handler->diskCapture());
+
+	if (_proxy_handlers.find(client_fd) == _proxy_handlers.end())
+		_proxy_handlers[client_fd] = std::queue<_ProxyHandlerPtr>();
+	if (_output_queue.find(client_fd) == _output_queue.end())
+		_output_queue[client_fd] = std::queue<Response>();
+	_proxy_handlers[client_fd].push(handler);
+	_turns[client_fd].push(TURN_PROXY);
+	LOG_VERBOSE("Registered ProxyHandler for " << METHOD[request.getMethod()]);
+}
+
+Server::_ErrorResponseHandlerPtr Server::createErrorResponseHandler(
+	int client_fd,
+	int method,
+	int code,
+	unsigned int retry_after_sec)
 {
-	_ErrorResponseHandlerPtr handler(
-		new ErrorResponseHandler(this, method, code, _timeout_ms));
 	if (_error_handlers.find(client_fd) == _error_handlers.end())
-		_error_handlers[client_fd] = std::queue<_ErrorResponseHandlerPtr>();
+		_error_handlers[client_fd] = std::deque<_ErrorResponseHandlerPtr>();
 	if (_output_queue.find(client_fd) == _output_queue.end())
 		_output_queue[client_fd] = std::queue<Response>();
-	_error_handlers[client_fd].push(handler);
+	return (_ErrorResponseHandlerPtr(
+		new (arena(client_fd)) ErrorResponseHandler(
+			this, method, code, _timeout_ms, retry_after_sec)));
+}
+
+void Server::registerErrorResponseHandler(int client_fd,
+										  int method,
+										  int code,
+										  unsigned int retry_after_sec)
+{
+	_error_handlers[client_fd].push_back(createErrorResponseHandler(
+		client_fd, method, code, retry_after_sec));
+	_turns[client_fd].push(TURN_ERROR);
 	LOG_VERBOSE("Registered ErrorResponseHandler for " << METHOD[method]);
 }
 
+// 맨 앞 차례의 핸들러가 응답을 만들지 못했다. 같은 자리에서 오류 응답을
+// 보내도록 오류 핸들러 대기열의 맨 앞에 넣는다
+void Server::replaceTurnWithError(int client_fd, int method, int code)
+{
+	_error_handlers[client_fd].push_front(
+		createErrorResponseHandler(client_fd, method, code, 0));
+	_turns[client_fd].front() = TURN_ERROR;
+	LOG_VERBOSE("Replaced failed handler with ErrorResponseHandler for "
+				<< METHOD[method]);
+}
+
 void Server::registerRequest(int client_fd, const Request &request)
 {
 	const Server::Location &location = getLocation(request.getURIPath());
@@ -245,11 +533,39 @@ void Server::registerRequest(int client_fd, const Request &request)
 		registerErrorResponseHandler(client_fd, method, 413);
 		return;
 	}
+	if (location.isStubStatus())
+	{
+		if (method != METHOD_GET && method != METHOD_HEAD)
+		{
+			registerErrorResponseHandler(client_fd,
+										 method,
+										 405); // Method Not Allowed
+			return;
+		}
+		registerStatusResponse(client_fd, method);
+		return;
+	}
+	if (location.isProxy())
+	{
+		if (!location.isAllowedMethod(method))
+		{
+			LOG_INFO("Method " << METHOD[method] << " is not allowed");
+			registerErrorResponseHandler(client_fd,
+										 method,
+										 405); // Method Not Allowed
+			return;
+		}
+		if (!serveFromDiskCache(client_fd, request, location))
+			registerProxyRequest(client_fd, request, location);
+		return;
+	}
 	if (cgiAllowed(method) && isCGIextension(request.getURIPath()))
 	{
 		const std::string &exec_path
 			= _cgi_ext_to_path[getExtension(request.getURIPath())];
-		registerCGIRequest(client_fd, request, exec_path, resource_path);
+		if (!serveFromDiskCache(client_fd, request, location))
+			registerCGIRequest(
+				client_fd, request, location, exec_path, resource_path);
 		return;
 	}
 
@@ -285,7 +601,22 @@ Response Server::retrieveResponse(int client_fd)
 
 void Server::registerRedirectResponse(int fd, const Server::Location &location)
 {
-	_output_queue[fd].push(location.generateRedirectResponse());
+	pushResponse(fd, location.generateRedirectResponse());
+}
+
+// stub_status location. 파일을 읽을 일이 없으므로 바로 응답을 만든다
+void Server::registerStatusResponse(int client_fd, int method)
+{
+	Response response;
+	const std::string body = Metrics::render();
+
+	response.setStatus(200);
+	response.setValue("Content-Type", "text/plain; version=0.0.4");
+	response.setValue("Cache-Control", "no-store");
+	response.setContentLength(body.length());
+	if (method != METHOD_HEAD)
+		response.setBody(body);
+	pushResponse(client_fd, response);
 }
 
 void Server::disconnect(int client_fd)
@@ -294,6 +625,33 @@ void Server::disconnect(int client_fd)
 	_request_handlers.erase(client_fd);
 	_cgi_handlers.erase(client_fd);
 	_error_handlers.erase(client_fd);
+	_proxy_handlers.erase(client_fd);
+	_turns.erase(client_fd);
+	_held_responses.erase(client_fd);
 	_output_queue.erase(client_fd);
+	_paused_clients.erase(client_fd);
+	std::map<int, ft::Arena *>::iterator arena = _arenas.find(client_fd);
+	if (arena != _arenas.end())
+	{
+		if (arena->second->idle() && _spare_arenas.size() < _spare_arenas_max)
+			_spare_arenas.push_back(arena->second);
+		else
+			arena->second->retire();
+		_arenas.erase(arena);
+	}
+	releaseCGISlot(client_fd);
+	cancelWaitingCGIHandler(client_fd);
 	LOG_INFO("Disconnected client fd " << client_fd);
 }
+
+// 클라이언트가 느려 쓰기 버퍼가 쌓이면 WebServer가 부른다. 멈춘 동안
+// CGI 본문은 핸들러에 쌓이고, 핸들러는 CGI 출력 읽기를 멈춘다.
+void Server::pauseOutput(int client_fd)
+{
+	_paused_clients.insert(client_fd);
+}
+
+void Server::resumeOutput(int client_fd)
+{
+	_paused_clients.erase(client_fd);
+}
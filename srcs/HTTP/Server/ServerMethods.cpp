@@ -54,6 +54,30 @@ bool Server::hasResponses(int client_fd) const
 	return (!_output_queue.find(client_fd)->second.empty());
 }
 
+template <typename Queue>
+static size_t sumQueueSizes(const std::map<int, Queue> &queues)
+{
+	size_t n_items = 0;
+	for (typename std::map<int, Queue>::const_iterator it
+		 = queues.begin();
+		 it != queues.end();
+		 it++)
+		n_items += it->second.size();
+	return (n_items);
+}
+
+Server::QueueDepths Server::getQueueDepths(void) const
+{
+	QueueDepths depths;
+
+	depths.requests = sumQueueSizes(_request_handlers);
+	depths.cgi = sumQueueSizes(_cgi_handlers);
+	depths.proxy = sumQueueSizes(_proxy_handlers);
+	depths.errors = sumQueueSizes(_error_handlers);
+	depths.responses = sumQueueSizes(_output_queue);
+	return (depths);
+}
+
 int Server::hasResponses(void) const
 {
 	for (std::map<int, std::queue<Response> >::const_iterator it
@@ -133,6 +133,21 @@ void Server::parseDirectiveLocation(const ConfigContext &server_context)
 			throw(ConfigDirective::DuplicateArgument(location_context));
 		}
 		_locations[new_location.getPath()] = new_location;
+		if (new_location.isProxy())
+		{
+			try
+			{
+				_upstream_pools[new_location.getPath()]
+					= _UpstreamPoolPtr(new UpstreamPool(
+						new_location.getProxyPass(),
+						new_location.getProxyBalance()));
+			}
+			catch (const std::runtime_error &e)
+			{
+				LOG_ERROR(e.what());
+				throw(ConfigDirective::UndefinedArgument(location_context));
+			}
+		}
 		LOG_VERBOSE("parsed location " << new_location.getPath());
 	}
 }
@@ -152,9 +167,10 @@ void Server::parseDirectiveCGI(const ConfigContext &server_context)
 			LOG_ERROR(dir_name << " should not be context");
 			throw(ConfigDirective::UndefinedDirective(cgi_directive));
 		}
-		if (cgi_directive.nParameters() != 2)
+		// cgi_pass ext path [fastcgi [n_workers]]
+		if (cgi_directive.nParameters() < 2 || cgi_directive.nParameters() > 4)
 		{
-			LOG_ERROR(dir_name << " should have 2 parameter(s)");
+			LOG_ERROR(dir_name << " should have 2 to 4 parameter(s)");
 			throw(ConfigDirective::InvalidNumberOfArgument(cgi_directive));
 		}
 		_cgi_ext_to_path[cgi_directive.parameter(0)]
@@ -162,10 +178,44 @@ void Server::parseDirectiveCGI(const ConfigContext &server_context)
 		LOG_VERBOSE("CGI pass from URI *."
 					<< cgi_directive.parameter(0) << " to exec "
 					<< cgi_directive.parameter(1) << " enabled");
+		if (cgi_directive.nParameters() > 2)
+			parseDirectiveFastCGI(cgi_directive);
 	}
 	_cgi_enabled = true;
 }
 
+void Server::parseDirectiveFastCGI(const ConfigDirective &cgi_directive)
+{
+	const char *dir_name = "cgi_pass";
+
+	if (cgi_directive.parameter(2) != "fastcgi")
+	{
+		LOG_ERROR(dir_name << " only supports \"fastcgi\" as 3rd parameter");
+		throw(ConfigDirective::UndefinedArgument(cgi_directive));
+	}
+	size_t n_workers = _fastcgi_workers_default;
+	if (cgi_directive.nParameters() == 4)
+	{
+		if (!isUnsignedIntStr(cgi_directive.parameter(3)))
+		{
+			LOG_ERROR(dir_name << " number of workers should be integer");
+			throw(ConfigDirective::UndefinedArgument(cgi_directive));
+		}
+		n_workers = toNum<size_t>(cgi_directive.parameter(3));
+		if (n_workers < 1 || n_workers > _fastcgi_workers_max)
+		{
+			LOG_ERROR(dir_name << " number of workers should be between 1 and "
+							   << _fastcgi_workers_max);
+			throw(ConfigDirective::UndefinedArgument(cgi_directive));
+		}
+	}
+	const std::string &exec_path = cgi_directive.parameter(1);
+	_fastcgi_pools[exec_path] = _FastCGIPoolPtr(
+		new CGI::FastCGIPool(exec_path, _temp_dir_path, n_workers));
+	LOG_VERBOSE("FastCGI pool of " << n_workers << " workers for "
+								   << exec_path << " enabled");
+}
+
 void Server::parseDirectiveCGILimitExcept(const ConfigContext &server_context)
 {
 	if (!_cgi_enabled)
@@ -245,6 +295,153 @@ void Server::parseDirectiveTmpDirPath(const ConfigContext &server_context)
 	LOG_VERBOSE("temporary file storage path set to: " << _temp_dir_path);
 }
 
+void Server::parseDirectiveCGISpillThreshold(
+	const ConfigContext &server_context)
+{
+	const char *dir_name = "cgi_spill_threshold";
+	const size_t n_directives = server_context.countDirectivesByName(dir_name);
+	if (n_directives == 0)
+		return;
+	if (n_directives > 1)
+	{
+		LOG_ERROR(server_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfArgument(server_context));
+	}
+	const ConfigDirective &spill_directive
+		= server_context.getNthDirectiveByName(dir_name, 0);
+	if (spill_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(spill_directive));
+	}
+	if (spill_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(spill_directive));
+	}
+	if (!isUnsignedIntStr(spill_directive.parameter(0)))
+	{
+		LOG_ERROR(dir_name << " should be an unsigned integer");
+		throw(ConfigDirective::UndefinedArgument(spill_directive));
+	}
+	_cgi_spill_threshold = toNum<size_t>(spill_directive.parameter(0));
+	LOG_VERBOSE("CGI request bodies larger than "
+				<< _cgi_spill_threshold << " bytes spill to "
+				<< _temp_dir_path);
+}
+
+void Server::parseDirectiveCGIMaxProcesses(const ConfigContext &server_context)
+{
+	const char *dir_name = "cgi_max_processes";
+	const size_t n_directives = server_context.countDirectivesByName(dir_name);
+	if (n_directives == 0)
+		return;
+	if (n_directives > 1)
+	{
+		LOG_ERROR(server_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfArgument(server_context));
+	}
+	const ConfigDirective &max_processes_directive
+		= server_context.getNthDirectiveByName(dir_name, 0);
+	if (max_processes_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(max_processes_directive));
+	}
+	if (max_processes_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(
+			max_processes_directive));
+	}
+	if (!isUnsignedIntStr(max_processes_directive.parameter(0))
+		|| toNum<size_t>(max_processes_directive.parameter(0)) == 0)
+	{
+		LOG_ERROR(dir_name << " should be a positive integer");
+		throw(ConfigDirective::UndefinedArgument(max_processes_directive));
+	}
+	_cgi_max_processes = toNum<size_t>(max_processes_directive.parameter(0));
+	LOG_VERBOSE("at most " << _cgi_max_processes << " CGI processes at once");
+}
+
+void Server::parseDirectiveCGIQueueSize(const ConfigContext &server_context)
+{
+	const char *dir_name = "cgi_queue_size";
+	const size_t n_directives = server_context.countDirectivesByName(dir_name);
+	if (n_directives == 0)
+		return;
+	if (n_directives > 1)
+	{
+		LOG_ERROR(server_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfArgument(server_context));
+	}
+	const ConfigDirective &queue_size_directive
+		= server_context.getNthDirectiveByName(dir_name, 0);
+	if (queue_size_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(queue_size_directive));
+	}
+	if (queue_size_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(queue_size_directive));
+	}
+	if (!isUnsignedIntStr(queue_size_directive.parameter(0)))
+	{
+		LOG_ERROR(dir_name << " should be an unsigned integer");
+		throw(ConfigDirective::UndefinedArgument(queue_size_directive));
+	}
+	_cgi_queue_size = toNum<size_t>(queue_size_directive.parameter(0));
+	LOG_VERBOSE("up to " << _cgi_queue_size << " CGI requests wait for a slot");
+}
+
+// 캐시 디렉토리는 disk_cache를 쓰는 location이 있을 때만 정한다
+void Server::parseDirectiveDiskCacheMaxSize(const ConfigContext &server_context)
+{
+	const char *dir_name = "disk_cache_max_size";
+	const size_t n_directives = server_context.countDirectivesByName(dir_name);
+	size_t max_size = _disk_cache_max_size_default;
+	if (n_directives > 1)
+	{
+		LOG_ERROR(server_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfArgument(server_context));
+	}
+	if (n_directives == 1)
+	{
+		const ConfigDirective &size_directive
+			= server_context.getNthDirectiveByName(dir_name, 0);
+		if (size_directive.is_context())
+		{
+			LOG_ERROR(dir_name << " should not be context");
+			throw(ConfigDirective::UndefinedDirective(size_directive));
+		}
+		if (size_directive.nParameters() != 1)
+		{
+			LOG_ERROR(dir_name << " should have 1 parameter(s)");
+			throw(ConfigDirective::InvalidNumberOfArgument(size_directive));
+		}
+		if (!isUnsignedIntStr(size_directive.parameter(0)))
+		{
+			LOG_ERROR(dir_name << " should be an unsigned integer");
+			throw(ConfigDirective::UndefinedArgument(size_directive));
+		}
+		max_size = toNum<size_t>(size_directive.parameter(0));
+	}
+	for (std::map<std::string, Location>::const_iterator it
+		 = _locations.begin();
+		 it != _locations.end();
+		 it++)
+	{
+		if (!it->second.diskCacheEnabled())
+			continue;
+		_disk_cache.configure(_temp_dir_path, max_size);
+		LOG_VERBOSE("disk cache keeps up to " << max_size << " bytes in "
+											  << _temp_dir_path);
+		break;
+	}
+}
+
 bool Server::isValidStatusCode(const int &status_code)
 {
 	return (STATUS_CODE.find(status_code) != STATUS_CODE.end());
@@ -0,0 +1,172 @@
+#include "HTTP/UpstreamPool.hpp"
+#include "async/status.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace HTTP;
+
+const size_t UpstreamPool::_max_idle_per_upstream = 32;
+
+UpstreamPool::Connection::Connection(const int fd, const size_t upstream)
+	: fd(fd)
+	, upstream(upstream)
+	, io(fd, async::SingleIOProcessor::IO_RW)
+{
+}
+
+UpstreamPool::Connection::~Connection()
+{
+	::close(fd);
+}
+
+// url은 http://host:port 꼴. 이름은 설정을 읽을 때 한 번만 풀어 둔다.
+UpstreamPool::UpstreamPool(const std::vector<std::string> &urls,
+						   const int balance)
+	: _balance(balance)
+	, _next(0)
+	, _logger(async::Logger::getLogger("UpstreamPool"))
+{
+	static const std::string scheme = "http://";
+
+	for (size_t i = 0; i < urls.size(); i++)
+	{
+		const std::string &url = urls[i];
+		if (url.compare(0, scheme.size(), scheme) != 0)
+			throw(std::runtime_error("only http:// upstream is supported: "
+									 + url));
+		std::string hostport = url.substr(scheme.size());
+		if (!hostport.empty() && hostport[hostport.size() - 1] == '/')
+			hostport.erase(hostport.size() - 1);
+		const size_t colon_pos = hostport.rfind(':');
+		const std::string host = hostport.substr(0, colon_pos);
+		const std::string port = (colon_pos == std::string::npos)
+									 ? "80"
+									 : hostport.substr(colon_pos + 1);
+
+		struct addrinfo hints;
+		struct addrinfo *result;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		int rc = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+		if (rc != 0)
+			throw(std::runtime_error("cannot resolve upstream " + url + ": "
+									 + gai_strerror(rc)));
+		Upstream upstream;
+		upstream.name = host + ":" + port;
+		std::memcpy(&upstream.addr, result->ai_addr, sizeof(upstream.addr));
+		upstream.n_busy = 0;
+		::freeaddrinfo(result);
+		_upstreams.push_back(upstream);
+	}
+	if (_upstreams.empty())
+		throw(std::runtime_error("no upstream given"));
+}
+
+UpstreamPool::~UpstreamPool()
+{
+	for (size_t i = 0; i < _upstreams.size(); i++)
+	{
+		while (!_upstreams[i].idle.empty())
+		{
+			delete _upstreams[i].idle.front();
+			_upstreams[i].idle.pop_front();
+		}
+	}
+}
+
+size_t UpstreamPool::pick(void)
+{
+	if (_balance == BALANCE_LEAST_CONN)
+	{
+		// 같으면 돌아가며 고르도록 _next부터 살핀다
+		size_t best = _next % _upstreams.size();
+		for (size_t i = 1; i < _upstreams.size(); i++)
+		{
+			size_t idx = (_next + i) % _upstreams.size();
+			if (_upstreams[idx].n_busy < _upstreams[best].n_busy)
+				best = idx;
+		}
+		_next = best + 1;
+		return (best);
+	}
+	return (_next++ % _upstreams.size());
+}
+
+// connect가 끝나기 전에 돌려준다. 연결이 되면 쓰기 이벤트가 와서 요청이
+// 나가고, 실패하면 io의 상태가 오류가 된다.
+UpstreamPool::Connection *UpstreamPool::connect(const size_t upstream)
+{
+	const Upstream &target = _upstreams[upstream];
+	int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0)
+	{
+		LOG_WARNING("Failed to create socket: " << strerror(errno));
+		return (NULL);
+	}
+	::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	::fcntl(fd, F_SETFL, O_NONBLOCK);
+	if (::connect(fd, (const struct sockaddr *)&target.addr,
+				  sizeof(target.addr))
+			< 0
+		&& errno != EINPROGRESS)
+	{
+		LOG_WARNING("Failed to connect to " << target.name << ": "
+											<< strerror(errno));
+		::close(fd);
+		return (NULL);
+	}
+	LOG_DEBUG("New connection " << fd << " to upstream " << target.name);
+	return (new Connection(fd, upstream));
+}
+
+UpstreamPool::Connection *UpstreamPool::acquire(bool &reused,
+												const bool fresh)
+{
+	const size_t upstream = pick();
+	Upstream &target = _upstreams[upstream];
+
+	while (!fresh && !target.idle.empty())
+	{
+		Connection *conn = target.idle.front();
+		target.idle.pop_front();
+		// 쉬는 동안 업스트림이 닫은 연결은 버린다
+		if (conn->io.stat() >= async::status::ERROR_GENERIC)
+		{
+			delete conn;
+			continue;
+		}
+		reused = true;
+		target.n_busy++;
+		return (conn);
+	}
+	Connection *conn = connect(upstream);
+	if (conn == NULL)
+		return (NULL);
+	reused = false;
+	target.n_busy++;
+	return (conn);
+}
+
+void UpstreamPool::release(Connection *conn, const bool reusable)
+{
+	Upstream &target = _upstreams[conn->upstream];
+
+	target.n_busy--;
+	if (reusable && conn->io.stat() < async::status::ERROR_GENERIC
+		&& target.idle.size() < _max_idle_per_upstream)
+		target.idle.push_back(conn);
+	else
+		delete conn;
+}
+
+const std::string &UpstreamPool::getName(const size_t upstream) const
+{
+	return (_upstreams[upstream].name);
+}
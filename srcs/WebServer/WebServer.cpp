@@ -3,17 +3,24 @@
 #include "async/Logger.hpp"
 #include "utils/string.hpp"
 
-static const int _backlog_size_default = 8;
-bool WebServer::_terminate = false;
+volatile sig_atomic_t WebServer::_terminate = 0;
+const size_t WebServer::_output_high_watermark = 256 * 1024;
+const size_t WebServer::_output_low_watermark = 64 * 1024;
+const size_t WebServer::_cgi_max_processes_default = 256;
+const usec_t WebServer::_metrics_interval_us = 100 * 1000;
 
-WebServer::WebServer(const ConfigContext &root_context)
-	: _backlog_size(_backlog_size_default)
+WebServer::WebServer(const ConfigContext &root_context, const int tcp_options)
+	: _metrics_published_at(0)
+	, _backlog_size(async::TCPIOProcessor::maxBacklogSize())
+	, _tcp_options(tcp_options)
 	, _logger(async::Logger::getLogger("WebServer"))
 {
 	parseMaxBodySize(root_context);
 	parseUploadStore(root_context);
 	parseTimeout(root_context);
 	parseBacklogSize(root_context);
+	parseCGIMaxProcesses(root_context);
+	parseEventLoopProfile(root_context);
 
 	const char *dir_name = "server";
 	size_t n_servers = root_context.countDirectivesByName(dir_name);
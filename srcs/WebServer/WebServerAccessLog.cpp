@@ -0,0 +1,277 @@
+#include "WebServer.hpp"
+#include "async/TaskTimer.hpp"
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static std::string getPeerAddress(int client_fd)
+{
+	struct sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+	char buf[INET6_ADDRSTRLEN];
+
+	if (getpeername(client_fd, reinterpret_cast<struct sockaddr *>(&addr), &len)
+		< 0)
+		return ("");
+	if (addr.ss_family == AF_INET)
+	{
+		const struct sockaddr_in *in
+			= reinterpret_cast<const struct sockaddr_in *>(&addr);
+		if (inet_ntop(AF_INET, &in->sin_addr, buf, sizeof(buf)))
+			return (buf);
+	}
+	else if (addr.ss_family == AF_INET6)
+	{
+		const struct sockaddr_in6 *in6
+			= reinterpret_cast<const struct sockaddr_in6 *>(&addr);
+		if (inet_ntop(AF_INET6, &in6->sin6_addr, buf, sizeof(buf)))
+			return (buf);
+	}
+	return ("");
+}
+
+bool WebServer::tracksRequests(void)
+{
+	return (HTTP::AccessLog::enabled() || HTTP::Metrics::enabled());
+}
+
+// 연결에서 첫 요청을 받을 때 만든다
+WebServer::AccessClient &WebServer::getAccessClient(int port, int client_fd)
+{
+	_AccessFdMap &clients = _access_clients[port];
+	_AccessFdMap::iterator it = clients.find(client_fd);
+	if (it != clients.end())
+		return (it->second);
+
+	AccessClient &client = clients[client_fd];
+	if (HTTP::AccessLog::enabled())
+		client.remote_addr = getPeerAddress(client_fd);
+	client.ready_at = _tcp_procs[port]->adoptedAt(client_fd);
+	client.first_byte_at = 0;
+	return (client);
+}
+
+void WebServer::noteFirstByte(int port, int client_fd)
+{
+	AccessClient &client = getAccessClient(port, client_fd);
+	if (client.first_byte_at == 0)
+		client.first_byte_at = monotonicUs();
+}
+
+void WebServer::openAccessEntry(int port,
+								int client_fd,
+								const HTTP::Request &request)
+{
+	AccessClient &client = getAccessClient(port, client_fd);
+	TrackedRequest tracked;
+	HTTP::AccessLog::Entry &entry = tracked.entry;
+
+	tracked.method = request.getMethod();
+	if (HTTP::AccessLog::enabled())
+	{
+		entry.remote_addr = client.remote_addr;
+		entry.method = request.getMethodString();
+		entry.uri = request.getURIPath();
+		if (!request.getQueryString().empty())
+			entry.uri += "?" + request.getQueryString();
+		entry.protocol = request.getVersionString();
+		if (request.countHeaderValue("Host"))
+			entry.host = request.getHeaderValue("Host", 0);
+		if (request.countHeaderValue("Referer"))
+			entry.referer = request.getHeaderValue("Referer", 0);
+		if (request.countHeaderValue("User-Agent"))
+			entry.user_agent = request.getHeaderValue("User-Agent", 0);
+	}
+	entry.ready_at = client.ready_at;
+	entry.first_byte_at = client.first_byte_at;
+	entry.parsed_at = monotonicUs();
+	client.entries.push_back(tracked);
+	client.first_byte_at = 0;
+}
+
+// 요청을 해석하지 못해 바로 보낸 오류 응답은 그 자리에서 남긴다
+void WebServer::logParseFailure(int port,
+								int client_fd,
+								int status,
+								size_t n_bytes)
+{
+	AccessClient &client = getAccessClient(port, client_fd);
+	TrackedRequest tracked;
+	HTTP::AccessLog::Entry &entry = tracked.entry;
+	const usec_t now = monotonicUs();
+
+	tracked.method = METHOD_NONE;
+	entry.remote_addr = client.remote_addr;
+	entry.status = status;
+	entry.bytes_sent = n_bytes;
+	entry.ready_at = client.ready_at;
+	entry.first_byte_at = client.first_byte_at;
+	entry.parsed_at = now;
+	finishRequest(client, tracked, now);
+	client.first_byte_at = 0;
+}
+
+// 응답은 요청 순서대로 나오므로 맨 앞 요청의 것이다. 나눠 보낸 응답은
+// 마지막 조각이 나올 때 끝난다.
+void WebServer::recordResponse(int port,
+							   int client_fd,
+							   const HTTP::Response &res,
+							   size_t n_bytes)
+{
+	AccessClient &client = getAccessClient(port, client_fd);
+	if (client.entries.empty())
+		return;
+
+	HTTP::AccessLog::Entry &entry = client.entries.front().entry;
+	entry.bytes_sent += n_bytes;
+	if (res.isFragment())
+	{
+		if (!res.isEndOfStream())
+			return;
+	}
+	else
+	{
+		entry.status = res.getStatusCode();
+		if (res.isStreaming())
+			return;
+	}
+	finishRequest(client, client.entries.front(), monotonicUs());
+	client.entries.pop_front();
+}
+
+void WebServer::finishRequest(AccessClient &client,
+							  const TrackedRequest &request,
+							  usec_t done_at)
+{
+	const HTTP::AccessLog::Entry &entry = request.entry;
+
+	_access_log.append(entry, done_at);
+	client.ready_at = done_at;
+	if (!HTTP::Metrics::enabled())
+		return;
+	_metrics.countRequest(request.method, entry.status);
+	client.unsent.push_back(done_at);
+	if (request.method == METHOD_NONE) // 해석하지 못한 요청
+		return;
+	if (entry.first_byte_at != 0 && entry.first_byte_at <= entry.parsed_at)
+		_metrics.recordStage(HTTP::Metrics::STAGE_PARSE,
+							 entry.parsed_at - entry.first_byte_at);
+	if (entry.parsed_at <= done_at)
+		_metrics.recordStage(HTTP::Metrics::STAGE_HANDLER,
+							 done_at - entry.parsed_at);
+}
+
+// 응답을 마치기 전에 끊긴 요청은 nginx처럼 499로 남긴다
+void WebServer::closeAccessEntries(int port, int client_fd)
+{
+	_AccessFdMap &clients = _access_clients[port];
+	_AccessFdMap::iterator it = clients.find(client_fd);
+	if (it == clients.end())
+		return;
+
+	const usec_t now = monotonicUs();
+	std::deque<TrackedRequest> &entries = it->second.entries;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].entry.status == 0)
+			entries[i].entry.status = 499;
+		_access_log.append(entries[i].entry, now);
+		if (HTTP::Metrics::enabled())
+			_metrics.countRequest(entries[i].method, entries[i].entry.status);
+	}
+	clients.erase(it);
+}
+
+// 쓰기 버퍼가 비면 그 안에 있던 응답은 모두 보낸 것이다
+void WebServer::noteDrainedWrites(int port, async::TCPIOProcessor &tcp_proc)
+{
+	_AccessFdMap &clients = _access_clients[port];
+	usec_t now = 0;
+
+	for (_AccessFdMap::iterator it = clients.begin(); it != clients.end(); it++)
+	{
+		std::deque<usec_t> &unsent = it->second.unsent;
+		if (unsent.empty() || !tcp_proc.wrbuf(it->first).empty())
+			continue;
+		if (now == 0)
+			now = monotonicUs();
+		for (size_t i = 0; i < unsent.size(); i++)
+			_metrics.recordStage(HTTP::Metrics::STAGE_WRITE,
+								 (now > unsent[i]) ? now - unsent[i] : 0);
+		unsent.clear();
+	}
+}
+
+// 단계가 끝난 시각을 돌려주어 다음 단계의 시작으로 쓴다
+usec_t WebServer::recordLoopPhase(int phase, usec_t since)
+{
+	const usec_t now = monotonicUs();
+	_metrics.recordLoopPhase(phase, (now > since) ? now - since : 0);
+	return (now);
+}
+
+// 읽는 스레드가 이 스레드의 값을 직접 건드리지 않도록 주기적으로 옮긴다
+void WebServer::publishMetrics(void)
+{
+	const usec_t now = monotonicUs();
+	if (now - _metrics_published_at < _metrics_interval_us)
+		return;
+	_metrics_published_at = now;
+
+	HTTP::Metrics::Gauges gauges;
+	std::memset(&gauges, 0, sizeof(gauges));
+	for (_TCPProcMap::iterator it = _tcp_procs.begin(); it != _tcp_procs.end();
+		 it++)
+	{
+		async::TCPIOProcessor &tcp_proc = *(it->second);
+		const async::TCPIOProcessor::Stats &stats = tcp_proc.getStats();
+		gauges.connections_accepted += stats.accepted;
+		gauges.bytes_received += stats.bytes_received;
+		gauges.bytes_sent += stats.bytes_sent;
+
+		// 받거나 보낼 데이터도, 응답을 기다리는 요청도 없으면 유휴 연결이다
+		_AccessFdMap &clients = _access_clients[it->first];
+		for (async::TCPIOProcessor::iterator fd_it = tcp_proc.begin();
+			 fd_it != tcp_proc.end();
+			 fd_it++)
+		{
+			const int client_fd = *fd_it;
+			_AccessFdMap::iterator client = clients.find(client_fd);
+			if (!tcp_proc.rdbuf(client_fd).empty()
+				|| !tcp_proc.wrbuf(client_fd).empty()
+				|| (client != clients.end() && !client->second.entries.empty()))
+				gauges.connections_active++;
+			else
+				gauges.connections_idle++;
+		}
+	}
+	for (_ServerMap::iterator it = _servers.begin(); it != _servers.end(); it++)
+	{
+		for (_Servers::iterator server = it->second.begin();
+			 server != it->second.end();
+			 server++)
+		{
+			const HTTP::Server::QueueDepths depths
+				= (*server)->getQueueDepths();
+			gauges.request_handlers += depths.requests;
+			gauges.cgi_handlers += depths.cgi;
+			gauges.proxy_handlers += depths.proxy;
+			gauges.error_handlers += depths.errors;
+			gauges.queued_responses += depths.responses;
+
+			const HTTP::Server::CGIAdmissionStats &cgi
+				= (*server)->getCGIAdmissionStats();
+			gauges.cgi_running += cgi.running;
+			gauges.cgi_waiting += cgi.waiting;
+			gauges.cgi_rejected += cgi.rejected;
+
+			const HTTP::DiskCache::Stats &cache
+				= (*server)->getDiskCacheStats();
+			gauges.disk_cache_hits += cache.hits;
+			gauges.disk_cache_misses += cache.misses;
+		}
+	}
+	gauges.slow_tasks = async::TaskTimer::slowTaskCount();
+	_metrics.publish(gauges);
+}
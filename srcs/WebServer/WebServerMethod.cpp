@@ -3,15 +3,57 @@
 #include "HTTP/error_pages.hpp"
 #include "WebServer.hpp"
 #include "async/Logger.hpp"
+#include "async/TaskTimer.hpp"
+#include "utils/alloc_profile.hpp"
 #include "utils/string.hpp"
+#include <unistd.h>
 
 void WebServer::setTerminationFlag(void)
 {
-	WebServer::_terminate = true;
+	WebServer::_terminate = 1;
+}
+
+void WebServer::adoptClient(int port, int client_fd)
+{
+	_TCPProcMap::iterator it = _tcp_procs.find(port);
+	if (it == _tcp_procs.end())
+	{
+		LOG_WARNING("No TCP IO Processor for port " << port);
+		close(client_fd);
+		return;
+	}
+	it->second->adopt(client_fd);
+}
+
+bool WebServer::popAcceptedClient(int &port, int &client_fd)
+{
+	for (_TCPProcMap::iterator it = _tcp_procs.begin(); it != _tcp_procs.end();
+		 it++)
+	{
+		std::queue<int> &accepted = it->second->accepted_clients;
+		if (accepted.empty())
+			continue;
+		port = it->first;
+		client_fd = accepted.front();
+		accepted.pop();
+		return (true);
+	}
+	return (false);
+}
+
+size_t WebServer::nClients(void) const
+{
+	size_t n_clients = 0;
+	for (_TCPProcMap::const_iterator it = _tcp_procs.begin();
+		 it != _tcp_procs.end();
+		 it++)
+		n_clients += it->second->nClients();
+	return (n_clients);
 }
 
 void WebServer::parseRequestForEachFd(int port, async::TCPIOProcessor &tcp_proc)
 {
+	ALLOC_SCOPE(SUBSYSTEM_PARSER);
 	for (async::TCPIOProcessor::iterator it = tcp_proc.begin();
 		 it != tcp_proc.end();
 		 it++)
@@ -19,6 +61,8 @@ void WebServer::parseRequestForEachFd(int port, async::TCPIOProcessor &tcp_proc)
 		int client_fd = *it;
 		if (tcp_proc.rdbuf(client_fd).empty())
 			continue;
+		if (tracksRequests())
+			noteFirstByte(port, client_fd);
 
 		std::map<int, HTTP::Request> &requests
 			= _request_buffer.find(port)->second;
@@ -39,6 +83,8 @@ void WebServer::parseRequestForEachFd(int port, async::TCPIOProcessor &tcp_proc)
 			resetRequestBuffer(port, client_fd);
 			HTTP::Response res = generateErrorResponse(400); // Bad Request
 			_tcp_procs[port]->wrbuf(client_fd) += res.toString();
+			if (tracksRequests())
+				logParseFailure(port, client_fd, 400, res.toString().size());
 			LOG_DEBUG("Added to wrbuf: \"" << res.toString() << "\"");
 			continue;
 		}
@@ -47,6 +93,10 @@ void WebServer::parseRequestForEachFd(int port, async::TCPIOProcessor &tcp_proc)
 		{
 		case HTTP::Request::RETURN_TYPE_OK:
 			LOG_INFO("Inbound request " << getRequestBuffer(port, client_fd));
+			if (tracksRequests())
+				openAccessEntry(port,
+								client_fd,
+								getRequestBuffer(port, client_fd));
 			registerRequest(port, client_fd, getRequestBuffer(port, client_fd));
 			resetRequestBuffer(port, client_fd);
 			break;
@@ -60,6 +110,8 @@ void WebServer::parseRequestForEachFd(int port, async::TCPIOProcessor &tcp_proc)
 			resetRequestBuffer(port, client_fd);
 			HTTP::Response res = generateErrorResponse(500);
 			_tcp_procs[port]->wrbuf(client_fd) += res.toString();
+			if (tracksRequests())
+				logParseFailure(port, client_fd, 500, res.toString().size());
 			LOG_DEBUG("Added to wrbuf: \"" << res.toString() << "\"");
 			break;
 		}
@@ -92,6 +144,8 @@ void WebServer::resetRequestBuffer(int port, int client_fd)
 
 void WebServer::registerRequest(int port, int client_fd, HTTP::Request &request)
 {
+	ALLOC_SCOPE(SUBSYSTEM_HANDLER);
+	ALLOC_COUNT_REQUEST();
 	for (_Servers::iterator it = _servers[port].begin();
 		 it != _servers[port].end();
 		 it++)
@@ -128,6 +182,8 @@ void WebServer::registerRequest(int port, int client_fd, HTTP::Request &request)
 
 void WebServer::retrieveResponseForEachFd(int port, _Servers &servers)
 {
+	ALLOC_SCOPE(SUBSYSTEM_IO);
+	resumePausedClients(port);
 	for (_Servers::iterator server_it = servers.begin();
 		 server_it != servers.end();
 		 server_it++)
@@ -142,13 +198,44 @@ void WebServer::retrieveResponseForEachFd(int port, _Servers &servers)
 			LOG_VERBOSE("Response for client " << client_fd
 											   << " has been found");
 			HTTP::Response res = server->retrieveResponse(client_fd);
-			_tcp_procs[port]->wrbuf(client_fd) += res.toString();
+			std::string &wrbuf = _tcp_procs[port]->wrbuf(client_fd);
+			const size_t n_queued = wrbuf.size();
+			wrbuf += res.toString();
+			if (tracksRequests())
+				recordResponse(port, client_fd, res, wrbuf.size() - n_queued);
 			LOG_DEBUG("Added to wrbuf: \"" << res.toString() << "\"");
-			LOG_INFO("Outbound response " << res);
+			if (res.closeAfterWrite())
+				_tcp_procs[port]->closeAfterWrite(client_fd);
+			if (res.isFragment())
+				LOG_VERBOSE("Outbound response body " << res);
+			else
+				LOG_INFO("Outbound response " << res);
+			if (res.isFragment()
+				&& _tcp_procs[port]->wrbuf(client_fd).size()
+					   > _output_high_watermark)
+			{
+				LOG_DEBUG("Pause output for slow client " << client_fd);
+				server->pauseOutput(client_fd);
+				_paused_clients[port][client_fd] = server;
+			}
 		}
 	}
 }
 
+void WebServer::resumePausedClients(int port)
+{
+	_PausedFdMap &paused = _paused_clients[port];
+	for (_PausedFdMap::iterator it = paused.begin(); it != paused.end();)
+	{
+		_PausedFdMap::iterator cur = it++;
+		if (_tcp_procs[port]->wrbuf(cur->first).size() > _output_low_watermark)
+			continue;
+		LOG_DEBUG("Resume output for client " << cur->first);
+		cur->second->resumeOutput(cur->first);
+		paused.erase(cur);
+	}
+}
+
 HTTP::Response WebServer::generateErrorResponse(const int code)
 {
 	HTTP::Response response;
@@ -164,6 +251,8 @@ HTTP::Response WebServer::generateErrorResponse(const int code)
 void WebServer::disconnect(int port, int client_fd)
 {
 	_request_buffer[port].erase(client_fd);
+	_paused_clients[port].erase(client_fd);
+	closeAccessEntries(port, client_fd);
 	for (_Servers::iterator it = _servers[port].begin();
 		 it != _servers[port].end();
 		 it++)
@@ -206,7 +295,22 @@ int WebServer::task(void)
 		return (async::status::OK_DONE);
 	}
 
-	async::IOProcessor::doAllTasks();
+	const bool profile = async::TaskTimer::enabled();
+	const usec_t started_at = profile ? monotonicUs() : 0;
+	usec_t mark = started_at;
+
+	async::Logger::flush();
+	_access_log.flush();
+	if (ft::alloc::takeDumpRequest())
+		LOG_INFO(ft::alloc::report());
+	if (profile)
+		mark = recordLoopPhase(HTTP::Metrics::LOOP_FLUSH, mark);
+	const size_t n_events = async::IOProcessor::doAllTasks();
+	if (profile)
+	{
+		_metrics.countLoopEvents(n_events);
+		mark = recordLoopPhase(HTTP::Metrics::LOOP_IO, mark);
+	}
 	for (_TCPProcMap::iterator it = _tcp_procs.begin(); it != _tcp_procs.end();
 		 it++)
 	{
@@ -219,9 +323,20 @@ int WebServer::task(void)
 			tcp.disconnected_clients.pop();
 			disconnect(port, disconnected_fd);
 		}
+		if (HTTP::Metrics::enabled())
+			noteDrainedWrites(port, tcp);
 		parseRequestForEachFd(port, tcp);
 	}
+	if (profile)
+		mark = recordLoopPhase(HTTP::Metrics::LOOP_PARSE, mark);
 	for (_ServerMap::iterator it = _servers.begin(); it != _servers.end(); it++)
 		retrieveResponseForEachFd(it->first, it->second);
+	if (profile)
+	{
+		recordLoopPhase(HTTP::Metrics::LOOP_HANDLERS, mark);
+		recordLoopPhase(HTTP::Metrics::LOOP_TOTAL, started_at);
+	}
+	if (HTTP::Metrics::enabled())
+		publishMetrics();
 	return (async::status::OK_AGAIN);
 }
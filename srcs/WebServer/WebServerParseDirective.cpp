@@ -1,6 +1,7 @@
 #include "HTTP/error_pages.hpp"
 #include "WebServer.hpp"
 #include "async/Logger.hpp"
+#include "async/TaskTimer.hpp"
 #include "utils/string.hpp"
 
 void WebServer::parseMaxBodySize(const ConfigContext &root_context)
@@ -116,15 +117,100 @@ void WebServer::parseBacklogSize(const ConfigContext &root_context)
 		throw(ConfigDirective::InvalidNumberOfArgument(backlog_directive));
 	}
 
+	// 커널이 somaxconn보다 큰 값은 잘라버리므로 그 이상은 받지 않는다
+	const int backlog_size_max = async::TCPIOProcessor::maxBacklogSize();
 	_backlog_size = toNum<int>(backlog_directive.parameter(0));
-	if (_backlog_size < 1 || _backlog_size > 128)
+	if (_backlog_size < 1 || _backlog_size > backlog_size_max)
 	{
-		LOG_ERROR(dir_name << " should be between 1 and 128");
+		LOG_ERROR(dir_name << " should be between 1 and " << backlog_size_max);
 		throw(ConfigDirective::InvalidNumberOfArgument(backlog_directive));
 	}
 	LOG_INFO("backlog size is " << _backlog_size);
 }
 
+// 같은 프로세스의 이벤트 루프 스레드가 모두 같은 설정으로 부르므로
+// 전역 값을 덮어써도 된다
+void WebServer::parseCGIMaxProcesses(const ConfigContext &root_context)
+{
+	const char *dir_name = "cgi_max_processes";
+	size_t max_processes = _cgi_max_processes_default;
+
+	if (root_context.countDirectivesByName(dir_name) > 1)
+	{
+		LOG_ERROR(root_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfDirective(root_context));
+	}
+	if (root_context.countDirectivesByName(dir_name) == 1)
+	{
+		const ConfigDirective &max_processes_directive
+			= root_context.getNthDirectiveByName(dir_name, 0);
+
+		if (max_processes_directive.is_context())
+		{
+			LOG_ERROR(dir_name << " should not be context");
+			throw(ConfigDirective::UndefinedDirective(root_context));
+		}
+		if (max_processes_directive.nParameters() != 1)
+		{
+			LOG_ERROR(dir_name << " should have 1 parameter(s)");
+			throw(ConfigDirective::InvalidNumberOfArgument(
+				max_processes_directive));
+		}
+		if (!isUnsignedIntStr(max_processes_directive.parameter(0)))
+		{
+			LOG_ERROR(dir_name << " should be an unsigned integer");
+			throw(ConfigDirective::UndefinedArgument(max_processes_directive));
+		}
+		max_processes = toNum<size_t>(max_processes_directive.parameter(0));
+	}
+	HTTP::Server::setGlobalCGIMaxProcesses(max_processes);
+	if (max_processes == 0)
+		LOG_INFO("global CGI process limit is disabled");
+	else
+		LOG_INFO("global CGI process limit is " << max_processes);
+}
+
+// event_loop_profile <ms>; 루프 단계별 시간을 재고 ms 이상 걸린 task()
+// 호출을 경고한다. parseCGIMaxProcesses처럼 전역 값을 덮어쓴다
+void WebServer::parseEventLoopProfile(const ConfigContext &root_context)
+{
+	const char *dir_name = "event_loop_profile";
+
+	if (root_context.countDirectivesByName(dir_name) == 0)
+		return;
+	if (root_context.countDirectivesByName(dir_name) > 1)
+	{
+		LOG_ERROR(root_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfDirective(root_context));
+	}
+
+	const ConfigDirective &profile_directive
+		= root_context.getNthDirectiveByName(dir_name, 0);
+
+	if (profile_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(root_context));
+	}
+	if (profile_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(profile_directive));
+	}
+	if (!isUnsignedIntStr(profile_directive.parameter(0))
+		|| toNum<unsigned int>(profile_directive.parameter(0)) == 0)
+	{
+		LOG_ERROR(dir_name << " should be a positive integer (ms)");
+		throw(ConfigDirective::UndefinedArgument(profile_directive));
+	}
+
+	const unsigned int threshold_ms
+		= toNum<unsigned int>(profile_directive.parameter(0));
+	async::TaskTimer::enable(static_cast<usec_t>(threshold_ms) * 1000);
+	LOG_INFO("event loop profiling on, slow task threshold is "
+			 << threshold_ms << "ms");
+}
+
 void WebServer::parseServer(const ConfigContext &server_context)
 {
 	_ServerPtr server = _ServerPtr(
@@ -133,8 +219,8 @@ void WebServer::parseServer(const ConfigContext &server_context)
 	LOG_INFO("Created Server at port " << port);
 	if (_tcp_procs.find(port) == _tcp_procs.end())
 	{
-		_tcp_procs[port]
-			= _TCPPtr(new async::TCPIOProcessor(port, _backlog_size));
+		_tcp_procs[port] = _TCPPtr(
+			new async::TCPIOProcessor(port, _backlog_size, _tcp_options));
 		LOG_VERBOSE("Created TCP IO Processor at port " << port);
 		_servers[port] = _Servers();
 		_request_buffer[port] = _ReqBufFdMap();
@@ -0,0 +1,322 @@
+#include "WorkerSupervisor.hpp"
+#include "EventLoopPool.hpp"
+#include "HTTP/AccessLog.hpp"
+#include "WebServer.hpp"
+#include "async/IOProcessor.hpp"
+#include "async/status.hpp"
+#include "utils/alloc_profile.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+
+volatile sig_atomic_t WorkerSupervisor::_terminate = 0;
+volatile sig_atomic_t WorkerSupervisor::_reopen_logs = 0;
+volatile sig_atomic_t WorkerSupervisor::_dump_allocs = 0;
+const int WorkerSupervisor::_n_workers_max = 128;
+const int WorkerSupervisor::_n_threads_max = 64;
+const time_t WorkerSupervisor::_respawn_interval = 1;
+const int WorkerSupervisor::_max_fast_failures = 5;
+const useconds_t WorkerSupervisor::_wait_interval_us = 100000;
+
+static void handleWebServerSignal(int arg)
+{
+	(void)arg;
+	WebServer::setTerminationFlag();
+}
+
+static void handleSupervisorSignal(int arg)
+{
+	(void)arg;
+	WorkerSupervisor::setTerminationFlag();
+}
+
+static void handleWebServerReopen(int arg)
+{
+	(void)arg;
+	HTTP::AccessLog::requestReopen();
+}
+
+static void handleSupervisorReopen(int arg)
+{
+	(void)arg;
+	WorkerSupervisor::setReopenLogsFlag();
+}
+
+static void handleWebServerDump(int arg)
+{
+	(void)arg;
+	ft::alloc::requestDump();
+}
+
+static void handleSupervisorDump(int arg)
+{
+	(void)arg;
+	WorkerSupervisor::setDumpAllocsFlag();
+}
+
+static void installSignalHandler(void (*handler)(int), int flags)
+{
+	struct sigaction action;
+
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = handler;
+	action.sa_flags = flags;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+}
+
+// 로그 회전 후 SIGUSR1을 보내면 access_log를 다시 연다
+static void installReopenHandler(void (*handler)(int), int flags)
+{
+	struct sigaction action;
+
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = handler;
+	action.sa_flags = flags;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGUSR1, &action, NULL);
+}
+
+// SIGUSR2를 보내면 할당 통계를 로그로 남긴다 (ALLOC_PROFILE)
+static void installDumpHandler(void (*handler)(int), int flags)
+{
+	struct sigaction action;
+
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = handler;
+	action.sa_flags = flags;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGUSR2, &action, NULL);
+}
+
+WorkerSupervisor::WorkerSupervisor(const ConfigContext &root_context)
+	: _root_context(root_context)
+	, _n_workers(1)
+	, _n_threads(1)
+	, _balance(EventLoopPool::BALANCE_ROUND_ROBIN)
+	, _terminating(false)
+	, _n_respawns(0)
+	, _respawn_at(0)
+	, _fast_failures(0)
+	, _gave_up(false)
+	, _logger(async::Logger::getLogger("WorkerSupervisor"))
+{
+	parseWorkerProcesses(root_context);
+	parseWorkerThreads(root_context);
+	parseWorkerBalance(root_context);
+	parseFileIOThreads(root_context);
+	parseAccessLog(root_context);
+}
+
+WorkerSupervisor::~WorkerSupervisor()
+{
+}
+
+void WorkerSupervisor::setTerminationFlag(void)
+{
+	_terminate = 1;
+}
+
+void WorkerSupervisor::setReopenLogsFlag(void)
+{
+	_reopen_logs = 1;
+}
+
+void WorkerSupervisor::setDumpAllocsFlag(void)
+{
+	_dump_allocs = 1;
+}
+
+int WorkerSupervisor::nWorkers(void) const
+{
+	return (_n_workers);
+}
+
+int WorkerSupervisor::run(void)
+{
+	// 상대가 닫은 소켓에 쓰더라도 프로세스가 죽지 않고 EPIPE를 받도록 함
+	signal(SIGPIPE, SIG_IGN);
+	if (_n_workers == 1)
+	{
+		installSignalHandler(handleWebServerSignal, SA_RESTART);
+		installReopenHandler(handleWebServerReopen, SA_RESTART);
+		installDumpHandler(handleWebServerDump, SA_RESTART);
+		return (runWebServer(async::TCPIOProcessor::TCP_OPTION_NONE));
+	}
+
+	// usleep(3)이 시그널에 의해 깨어날 수 있도록 SA_RESTART를 주지 않음
+	installSignalHandler(handleSupervisorSignal, 0);
+	installReopenHandler(handleSupervisorReopen, 0);
+	installDumpHandler(handleSupervisorDump, 0);
+	LOG_INFO("Starting " << _n_workers << " worker processes");
+	for (int i = 0; i < _n_workers; i++)
+		spawn();
+
+	while (!_workers.empty() || _n_respawns > 0)
+	{
+		async::Logger::blockingWriteAll();
+		if (_terminate && !_terminating)
+			terminateWorkers();
+		if (_reopen_logs)
+			reopenWorkerLogs();
+		if (_dump_allocs)
+			dumpWorkerAllocs();
+		if (_n_respawns > 0 && monotonicMs() >= _respawn_at)
+			respawnWorkers();
+
+		// 플래그를 확인한 뒤 막히는 waitpid에 들어가기 전에 온 시그널을 놓치지
+		// 않도록 기다리지 않고 확인한 뒤 잠시 쉰다
+		int wait_status;
+		pid_t pid = 0;
+		if (!_workers.empty())
+			pid = ::waitpid(-1, &wait_status, WNOHANG);
+		if (pid < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			throw(std::runtime_error(
+				std::string("Error while waiting workers: ")
+				+ strerror(errno)));
+		}
+		if (pid == 0)
+		{
+			usleep(_wait_interval_us);
+			continue;
+		}
+		reap(pid, wait_status);
+	}
+	LOG_INFO("All workers terminated");
+	return (_gave_up ? 1 : 0);
+}
+
+pid_t WorkerSupervisor::spawn(void)
+{
+	// 아직 출력되지 않은 로그가 자식에게 복제되지 않도록 비워둔다
+	async::Logger::blockingWriteAll();
+	pid_t pid = ::fork();
+	if (pid < 0)
+		throw(std::runtime_error(std::string("Failed to fork worker: ")
+								 + strerror(errno)));
+	if (pid == 0)
+		runWorker();
+	_workers[pid] = time(NULL);
+	LOG_INFO("Spawned worker " << pid);
+	return (pid);
+}
+
+void WorkerSupervisor::runWorker(void)
+{
+	int rc = 1;
+
+	installSignalHandler(handleWebServerSignal, SA_RESTART);
+	installReopenHandler(handleWebServerReopen, SA_RESTART);
+	installDumpHandler(handleWebServerDump, SA_RESTART);
+	try
+	{
+		async::IOProcessor::reinitializeAll();
+		rc = runWebServer(async::TCPIOProcessor::TCP_OPTION_REUSEPORT);
+	}
+	catch (const std::exception &e)
+	{
+		LOG_ERROR("Worker " << getpid() << " failed: " << e.what());
+	}
+	async::Logger::blockingWriteAll();
+	std::exit(rc);
+}
+
+void WorkerSupervisor::reap(pid_t pid, int wait_status)
+{
+	_Workers::iterator it = _workers.find(pid);
+	if (it == _workers.end())
+		return;
+	const time_t spawned_at = it->second;
+	_workers.erase(it);
+
+	if (WIFSIGNALED(wait_status))
+		LOG_WARNING("Worker " << pid << " killed by signal "
+							  << WTERMSIG(wait_status));
+	else if (WIFEXITED(wait_status) && WEXITSTATUS(wait_status) != 0)
+		LOG_WARNING("Worker " << pid << " exited with status "
+							  << WEXITSTATUS(wait_status));
+	else
+		LOG_INFO("Worker " << pid << " exited");
+
+	if (_terminating)
+		return;
+	if (time(NULL) - spawned_at >= _respawn_interval)
+	{
+		_fast_failures = 0;
+		spawn();
+		return;
+	}
+	// 설정이나 bind 오류처럼 다시 띄워도 계속 죽는 경우는 포기하고 끝낸다
+	if (++_fast_failures >= _max_fast_failures)
+	{
+		LOG_ERROR(_fast_failures << " workers failed right after start, "
+								 << "giving up");
+		_gave_up = true;
+		terminateWorkers();
+		return;
+	}
+	// fork를 폭주시키지 않도록 잠시 뒤에 띄운다. 기다리는 동안에도 시그널을
+	// 처리하도록 run의 반복문이 시각을 확인한다
+	if (_n_respawns == 0)
+		_respawn_at = monotonicMs() + _respawn_interval * 1000;
+	_n_respawns++;
+}
+
+void WorkerSupervisor::respawnWorkers(void)
+{
+	for (; _n_respawns > 0; _n_respawns--)
+		spawn();
+}
+
+// 한 번만 보낸다. 기다리던 재시작도 취소한다
+void WorkerSupervisor::terminateWorkers(void)
+{
+	_terminating = true;
+	_n_respawns = 0;
+	for (_Workers::iterator it = _workers.begin(); it != _workers.end(); it++)
+		::kill(it->first, SIGTERM);
+}
+
+// 워커는 fd를 각자 가지므로 시그널을 전달해 다시 열게 한다. 새로 띄울
+// 워커가 옛 파일을 물려받지 않도록 감독 프로세스도 다시 연다
+void WorkerSupervisor::reopenWorkerLogs(void)
+{
+	_reopen_logs = 0;
+	HTTP::AccessLog::requestReopen();
+	HTTP::AccessLog::reopenIfRequested();
+	LOG_INFO("Reopening access logs of " << _workers.size() << " workers");
+	for (_Workers::iterator it = _workers.begin(); it != _workers.end(); it++)
+		::kill(it->first, SIGUSR1);
+}
+
+// 할당 통계는 워커마다 따로 세므로 각자 남기게 한다
+void WorkerSupervisor::dumpWorkerAllocs(void)
+{
+	_dump_allocs = 0;
+	for (_Workers::iterator it = _workers.begin(); it != _workers.end(); it++)
+		::kill(it->first, SIGUSR2);
+}
+
+int WorkerSupervisor::runWebServer(const int tcp_options)
+{
+	if (_n_threads > 1)
+	{
+		EventLoopPool pool(_root_context, _n_threads, _balance, tcp_options);
+		return (pool.run());
+	}
+
+	WebServer webserver(_root_context, tcp_options);
+	while (true)
+	{
+		int rc = webserver.task();
+		if (rc != async::status::OK_AGAIN)
+			break;
+	}
+	return (0);
+}
@@ -0,0 +1,245 @@
+#include "EventLoopPool.hpp"
+#include "HTTP/AccessLog.hpp"
+#include "WorkerSupervisor.hpp"
+#include "async/FileTaskPool.hpp"
+#include "utils/string.hpp"
+#include <unistd.h>
+
+static int countOnlineCPUs(void)
+{
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return ((n_cpus < 1) ? 1 : static_cast<int>(n_cpus));
+}
+
+void WorkerSupervisor::parseWorkerProcesses(const ConfigContext &root_context)
+{
+	const char *dir_name = "worker_processes";
+
+	if (root_context.countDirectivesByName(dir_name) == 0)
+	{
+		LOG_INFO("worker processes is " << _n_workers << " (default)");
+		return;
+	}
+	if (root_context.countDirectivesByName(dir_name) > 1)
+	{
+		LOG_ERROR(root_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfDirective(root_context));
+	}
+
+	const ConfigDirective &worker_directive
+		= root_context.getNthDirectiveByName(dir_name, 0);
+
+	if (worker_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(root_context));
+	}
+	if (worker_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(worker_directive));
+	}
+
+	if (worker_directive.parameter(0) == "auto")
+	{
+		_n_workers = countOnlineCPUs();
+		if (_n_workers > _n_workers_max)
+			_n_workers = _n_workers_max;
+	}
+	else
+	{
+		if (!isUnsignedIntStr(worker_directive.parameter(0)))
+		{
+			LOG_ERROR(dir_name << " should be \"auto\" or integer");
+			throw(ConfigDirective::UndefinedArgument(worker_directive));
+		}
+		_n_workers = toNum<int>(worker_directive.parameter(0));
+	}
+	if (_n_workers < 1 || _n_workers > _n_workers_max)
+	{
+		LOG_ERROR(dir_name << " should be between 1 and " << _n_workers_max);
+		throw(ConfigDirective::UndefinedArgument(worker_directive));
+	}
+	LOG_INFO("worker processes is " << _n_workers);
+}
+
+void WorkerSupervisor::parseWorkerThreads(const ConfigContext &root_context)
+{
+	const char *dir_name = "worker_threads";
+
+	if (root_context.countDirectivesByName(dir_name) == 0)
+	{
+		LOG_INFO("worker threads is " << _n_threads << " (default)");
+		return;
+	}
+	if (root_context.countDirectivesByName(dir_name) > 1)
+	{
+		LOG_ERROR(root_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfDirective(root_context));
+	}
+
+	const ConfigDirective &thread_directive
+		= root_context.getNthDirectiveByName(dir_name, 0);
+
+	if (thread_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(root_context));
+	}
+	if (thread_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(thread_directive));
+	}
+
+	if (thread_directive.parameter(0) == "auto")
+	{
+		// 여러 워커 프로세스가 있으면 코어를 나누어 쓴다
+		_n_threads = countOnlineCPUs() / _n_workers;
+		if (_n_threads < 1)
+			_n_threads = 1;
+		if (_n_threads > _n_threads_max)
+			_n_threads = _n_threads_max;
+	}
+	else
+	{
+		if (!isUnsignedIntStr(thread_directive.parameter(0)))
+		{
+			LOG_ERROR(dir_name << " should be \"auto\" or integer");
+			throw(ConfigDirective::UndefinedArgument(thread_directive));
+		}
+		_n_threads = toNum<int>(thread_directive.parameter(0));
+	}
+	if (_n_threads < 1 || _n_threads > _n_threads_max)
+	{
+		LOG_ERROR(dir_name << " should be between 1 and " << _n_threads_max);
+		throw(ConfigDirective::UndefinedArgument(thread_directive));
+	}
+	LOG_INFO("worker threads is " << _n_threads);
+}
+
+void WorkerSupervisor::parseWorkerBalance(const ConfigContext &root_context)
+{
+	const char *dir_name = "worker_balance";
+
+	if (root_context.countDirectivesByName(dir_name) == 0)
+		return;
+	if (root_context.countDirectivesByName(dir_name) > 1)
+	{
+		LOG_ERROR(root_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfDirective(root_context));
+	}
+
+	const ConfigDirective &balance_directive
+		= root_context.getNthDirectiveByName(dir_name, 0);
+
+	if (balance_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(root_context));
+	}
+	if (balance_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(balance_directive));
+	}
+
+	const std::string &balance = balance_directive.parameter(0);
+	if (balance == "round_robin")
+		_balance = EventLoopPool::BALANCE_ROUND_ROBIN;
+	else if (balance == "least_conn")
+		_balance = EventLoopPool::BALANCE_LEAST_CONN;
+	else
+	{
+		LOG_ERROR(dir_name << " should be round_robin or least_conn");
+		throw(ConfigDirective::UndefinedArgument(balance_directive));
+	}
+	LOG_INFO("worker balance is " << balance);
+}
+
+void WorkerSupervisor::parseFileIOThreads(const ConfigContext &root_context)
+{
+	const char *dir_name = "file_io_threads";
+
+	if (root_context.countDirectivesByName(dir_name) == 0)
+	{
+		LOG_INFO("file io threads is " << async::FileTaskPool::getNumThreads()
+									   << " (default)");
+		return;
+	}
+	if (root_context.countDirectivesByName(dir_name) > 1)
+	{
+		LOG_ERROR(root_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfDirective(root_context));
+	}
+
+	const ConfigDirective &io_directive
+		= root_context.getNthDirectiveByName(dir_name, 0);
+
+	if (io_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(root_context));
+	}
+	if (io_directive.nParameters() != 1)
+	{
+		LOG_ERROR(dir_name << " should have 1 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(io_directive));
+	}
+	if (!isUnsignedIntStr(io_directive.parameter(0)))
+	{
+		LOG_ERROR(dir_name << " should be integer");
+		throw(ConfigDirective::UndefinedArgument(io_directive));
+	}
+
+	// 0이면 풀을 만들지 않고 이벤트 루프 스레드에서 직접 수행한다
+	const size_t n_threads = toNum<size_t>(io_directive.parameter(0));
+	if (n_threads > async::FileTaskPool::getMaxNumThreads())
+	{
+		LOG_ERROR(dir_name << " should be between 0 and "
+						   << async::FileTaskPool::getMaxNumThreads());
+		throw(ConfigDirective::UndefinedArgument(io_directive));
+	}
+	async::FileTaskPool::setNumThreads(n_threads);
+	LOG_INFO("file io threads is " << n_threads);
+}
+
+// 워커가 fd를 물려받도록 fork하기 전에 연다
+void WorkerSupervisor::parseAccessLog(const ConfigContext &root_context)
+{
+	const char *dir_name = "access_log";
+
+	if (root_context.countDirectivesByName(dir_name) == 0)
+		return;
+	if (root_context.countDirectivesByName(dir_name) > 1)
+	{
+		LOG_ERROR(root_context.name() << " should have 0 or 1 " << dir_name);
+		throw(ConfigDirective::InvalidNumberOfDirective(root_context));
+	}
+
+	const ConfigDirective &log_directive
+		= root_context.getNthDirectiveByName(dir_name, 0);
+
+	if (log_directive.is_context())
+	{
+		LOG_ERROR(dir_name << " should not be context");
+		throw(ConfigDirective::UndefinedDirective(root_context));
+	}
+	if (log_directive.nParameters() < 1 || log_directive.nParameters() > 2)
+	{
+		LOG_ERROR(dir_name << " should have 1 or 2 parameter(s)");
+		throw(ConfigDirective::InvalidNumberOfArgument(log_directive));
+	}
+
+	const std::string &path = log_directive.parameter(0);
+	const std::string format
+		= (log_directive.nParameters() == 2) ? log_directive.parameter(1)
+											 : "combined";
+	if (format != "combined" && format != "json")
+	{
+		LOG_ERROR(dir_name << " format should be combined or json");
+		throw(ConfigDirective::UndefinedArgument(log_directive));
+	}
+	HTTP::AccessLog::open(path, format);
+	LOG_INFO("access log is " << path << " (" << format << ")");
+}
@@ -1,81 +1,158 @@
 #include "async/FileIOHandler.hpp"
 #include "async/status.hpp"
-#include "utils/file.hpp"
 #include "utils/string.hpp"
+#include "utils/time.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace async;
-typedef unsigned long long ull_t;
 
-bool FileIOHandler::openFdByPath(const char *mode)
+FileIOHandler::PathTask::PathTask(const int mode,
+								  const std::string &path,
+								  const std::string &content)
+	: mode(mode)
+	, path(path)
+	, buffer(content)
+	, status(status::OK_BEGIN)
 {
-	if (!_should_close)
-		return (false);
-	if (isDirectory(_path))
+}
+
+void FileIOHandler::PathTask::run(void)
+{
+	if (mode == MODE_READ)
+		readFile();
+	else
+		writeFile();
+}
+
+void FileIOHandler::PathTask::readFile(void)
+{
+	struct stat file_info;
+	if (stat(path.c_str(), &file_info) != 0)
 	{
-		_status = status::ERROR_FILEISDIR;
-		_error_msg = generateErrorMsgFileIsDir(_path);
-		return (true);
+		status = status::ERROR_FILEOPENING;
+		error_msg = generateErrorMsgFileOpening(path);
+		return;
 	}
-	_stream = fopen(_path.c_str(), mode);
-	if (!_stream)
+	if (S_ISDIR(file_info.st_mode))
 	{
-		_status = status::ERROR_FILEOPENING;
-		_error_msg = generateErrorMsgFileOpening(_path);
-		return (true);
+		status = status::ERROR_FILEISDIR;
+		error_msg = generateErrorMsgFileIsDir(path);
+		return;
 	}
-	_fd = fileno(_stream);
-	return (false);
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		status = status::ERROR_FILEOPENING;
+		error_msg = generateErrorMsgFileOpening(path);
+		return;
+	}
+
+	char chunk[65536];
+	buffer.reserve(file_info.st_size);
+	while (true)
+	{
+		ssize_t readsize = ::read(fd, chunk, sizeof(chunk));
+		if (readsize == 0)
+			break;
+		if (readsize < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			status = status::ERROR_READ;
+			error_msg = generateErrorMsgRead(fd);
+			close(fd);
+			return;
+		}
+		buffer.append(chunk, readsize);
+	}
+	close(fd);
+	status = status::OK_DONE;
 }
 
-static clock_t msToClockT(const unsigned int ms)
+void FileIOHandler::PathTask::writeFile(void)
 {
-	ull_t result = (((ull_t)ms) * CLOCKS_PER_SEC) / 1000;
-	return (result);
+	struct stat file_info;
+	if (stat(path.c_str(), &file_info) == 0 && S_ISDIR(file_info.st_mode))
+	{
+		status = status::ERROR_FILEISDIR;
+		error_msg = generateErrorMsgFileIsDir(path);
+		return;
+	}
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+	{
+		status = status::ERROR_FILEOPENING;
+		error_msg = generateErrorMsgFileOpening(path);
+		return;
+	}
+
+	size_t written = 0;
+	while (written < buffer.size())
+	{
+		ssize_t writesize
+			= ::write(fd, buffer.c_str() + written, buffer.size() - written);
+		if (writesize < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			status = status::ERROR_WRITE;
+			error_msg = generateErrorMsgWrite(fd);
+			close(fd);
+			return;
+		}
+		written += writesize;
+	}
+	close(fd);
+	status = status::OK_DONE;
 }
 
 FileIOHandler::FileIOHandler(unsigned int timeout_ms, int fd)
 	: _processor(NULL)
-	, _stream(NULL)
+	, _task(NULL)
 	, _fd(fd)
 	, _path("")
 	, _status(status::OK_BEGIN)
 	, _buffer("")
-	, _timeout(msToClockT(timeout_ms))
-	, _next_timeout(clock() + _timeout)
-	, _should_close(false)
+	, _timeout(timeout_ms)
+	, _next_timeout(monotonicMs() + _timeout)
+	, _by_path(false)
 {
 }
 
 FileIOHandler::FileIOHandler(unsigned int timeout_ms, const std::string &path)
 	: _processor(NULL)
-	, _stream(NULL)
+	, _task(NULL)
 	, _fd(-1)
 	, _path(path)
 	, _status(status::OK_BEGIN)
 	, _buffer("")
-	, _timeout(msToClockT(timeout_ms))
-	, _next_timeout(clock() + _timeout)
-	, _should_close(true)
+	, _timeout(timeout_ms)
+	, _next_timeout(monotonicMs() + _timeout)
+	, _by_path(true)
 {
 }
 
 FileIOHandler::~FileIOHandler()
 {
-	if (_should_close && _stream)
-		fclose(_stream);
+	// 풀에서 아직 실행 중이면 작업이 끝난 뒤 풀이 해제한다
+	if (_task)
+		_task->release();
 }
 
+// 마지막으로 진행된 시점부터 다시 잰다
 void FileIOHandler::renewTimeout(void)
 {
-	_next_timeout += _timeout;
+	_next_timeout = monotonicMs() + _timeout;
 }
 
 bool FileIOHandler::checkTimeout(void)
 {
 	if (_timeout == 0)
 		return (false);
-	if (clock() > _next_timeout)
+	if (monotonicMs() > _next_timeout)
 	{
 		_status = status::ERROR_TIMEOUT;
 		_error_msg = generateErrorMsgTimeout(_fd, _timeout);
@@ -84,6 +161,34 @@ bool FileIOHandler::checkTimeout(void)
 	return (false);
 }
 
+void FileIOHandler::submitPathTask(const int mode, const std::string &content)
+{
+	_task = new PathTask(mode, _path, content);
+	_status = status::OK_AGAIN;
+	FileTaskPool::submit(_task);
+}
+
+void FileIOHandler::pollPathTask(void)
+{
+	if (_task == NULL)
+		return;
+	if (!_task->isDone())
+	{
+		if (checkTimeout())
+		{
+			_task->release();
+			_task = NULL;
+		}
+		return;
+	}
+	_status = _task->status;
+	_error_msg = _task->error_msg;
+	if (_task->mode == PathTask::MODE_READ)
+		_buffer.swap(_task->buffer);
+	_task->release();
+	_task = NULL;
+}
+
 std::string FileIOHandler::retrieve(void)
 {
 	if (_status != status::OK_DONE)
@@ -91,6 +196,15 @@ std::string FileIOHandler::retrieve(void)
 	return (_buffer);
 }
 
+// 끝나기 전이라도 지금까지 읽은 내용을 넘기고 비운다
+std::string FileIOHandler::retrievePartial(void)
+{
+	std::string buffer;
+
+	buffer.swap(_buffer);
+	return (buffer);
+}
+
 const std::string &FileIOHandler::errorMsg(void) const
 {
 	return (_error_msg);
@@ -24,12 +24,15 @@ int FileReader::task(void)
 {
 	if (_status == status::OK_DONE)
 		return (_status);
+	if (_by_path)
+	{
+		if (_status == status::OK_BEGIN)
+			submitPathTask(PathTask::MODE_READ, "");
+		pollPathTask();
+		return (_status);
+	}
 	if (_status == status::OK_BEGIN)
 	{
-		if (openFdByPath("r"))
-		{
-			return (_status);
-		}
 		if (!_is_fifo)
 		{
 			_filesize = getFileSize(_path);
@@ -39,8 +42,8 @@ int FileReader::task(void)
 				return (_status);
 			}
 		}
-		_processor = ft::shared_ptr<SingleIOProcessor>(
-			new SingleIOProcessor(_fd, SingleIOProcessor::IO_R));
+		_processor = ft::make_shared<SingleIOProcessor>(
+			_fd, static_cast<int>(SingleIOProcessor::IO_R));
 		_status = status::OK_AGAIN;
 	}
 
@@ -68,3 +71,18 @@ int FileReader::task(void)
 	}
 	return (_status);
 }
+
+// fd로 읽는 경우에만 의미가 있다. 멈춘 동안에는 task()를 부르지 않아야
+// 제한 시간이 흐르지 않는다.
+void FileReader::pause(void)
+{
+	if (!_by_path && _status == status::OK_AGAIN)
+		_processor->pauseRead();
+}
+
+void FileReader::resume(void)
+{
+	if (!_by_path && _status == status::OK_AGAIN)
+		_processor->resumeRead();
+	renewTimeout();
+}
@@ -27,12 +27,17 @@ int FileWriter::task(void)
 {
 	if (_status == status::OK_DONE)
 		return (_status);
+	if (_by_path)
+	{
+		if (_status == status::OK_BEGIN)
+			submitPathTask(PathTask::MODE_WRITE, _content);
+		pollPathTask();
+		return (_status);
+	}
 	if (_status == status::OK_BEGIN)
 	{
-		if (openFdByPath("w"))
-			return (_status);
-		_processor = ft::shared_ptr<SingleIOProcessor>(
-			new SingleIOProcessor(_fd, SingleIOProcessor::IO_W));
+		_processor = ft::make_shared<SingleIOProcessor>(
+			_fd, static_cast<int>(SingleIOProcessor::IO_W));
 		_processor->setWriteBuf(_content);
 		_status = status::OK_AGAIN;
 	}
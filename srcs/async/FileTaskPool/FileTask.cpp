@@ -0,0 +1,34 @@
+#include "async/FileTaskPool.hpp"
+
+using namespace async;
+
+FileTask::FileTask(void)
+	: _refcount(1)
+	, _done(0)
+{
+}
+
+FileTask::~FileTask()
+{
+}
+
+bool FileTask::isDone(void)
+{
+	return (__sync_fetch_and_add(&_done, 0) != 0);
+}
+
+void FileTask::complete(void)
+{
+	__sync_lock_test_and_set(&_done, 1);
+}
+
+void FileTask::retain(void)
+{
+	__sync_fetch_and_add(&_refcount, 1);
+}
+
+void FileTask::release(void)
+{
+	if (__sync_sub_and_fetch(&_refcount, 1) == 0)
+		delete this;
+}
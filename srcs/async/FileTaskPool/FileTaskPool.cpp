@@ -0,0 +1,178 @@
+#include "async/FileTaskPool.hpp"
+#include "utils/lock_guard.hpp"
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace async;
+
+FileTaskPool *FileTaskPool::_pool = NULL;
+size_t FileTaskPool::_n_threads = 4;
+const size_t FileTaskPool::_n_threads_max = 64;
+const size_t FileTaskPool::_queue_limit = 1024;
+pthread_mutex_t FileTaskPool::_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+FileTaskPool::Worker::Worker(FileTaskPool &pool, const size_t index)
+	: pool(pool)
+	, index(index)
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+FileTaskPool::Worker::~Worker()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+FileTaskPool::FileTaskPool(const size_t n_threads)
+	: _n_queued(0)
+	, _next(0)
+{
+	pthread_mutex_init(&_idle_mutex, NULL);
+	pthread_cond_init(&_idle_cond, NULL);
+
+	// 워커 스레드는 시그널을 받지 않는다
+	sigset_t signals;
+	sigset_t old_signals;
+	sigfillset(&signals);
+	pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+	for (size_t i = 0; i < n_threads; i++)
+	{
+		Worker *worker = new Worker(*this, i);
+		int result = pthread_create(&worker->thread, NULL, runWorker, worker);
+		if (result != 0)
+		{
+			delete worker;
+			break;
+		}
+		_workers.push_back(worker);
+	}
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+}
+
+// 풀은 프로세스가 끝날 때까지 유지된다
+FileTaskPool::~FileTaskPool()
+{
+}
+
+FileTaskPool *FileTaskPool::getPool(void)
+{
+	ft::lock_guard lock(_pool_mutex);
+	if (_pool == NULL && _n_threads > 0)
+	{
+		_pool = new FileTaskPool(_n_threads);
+		if (_pool->_workers.empty())
+		{
+			delete _pool;
+			_pool = NULL;
+			_n_threads = 0;
+		}
+	}
+	return (_pool);
+}
+
+void *FileTaskPool::runWorker(void *arg)
+{
+	Worker &worker = *static_cast<Worker *>(arg);
+	FileTaskPool &pool = worker.pool;
+
+	while (true)
+	{
+		// 작업 하나를 예약한 뒤 아무 큐에서나 가져온다
+		pthread_mutex_lock(&pool._idle_mutex);
+		while (pool._n_queued == 0)
+			pthread_cond_wait(&pool._idle_cond, &pool._idle_mutex);
+		pool._n_queued--;
+		pthread_mutex_unlock(&pool._idle_mutex);
+
+		FileTask *task = NULL;
+		while (task == NULL)
+			task = pool.take(worker.index);
+		task->run();
+		task->complete();
+		task->release();
+	}
+	return (NULL);
+}
+
+bool FileTaskPool::push(FileTask *task)
+{
+	// 한도 확인과 자리 예약을 한 번에 해야 여러 스레드가 동시에 넣어도
+	// 한도를 넘지 않는다. 예약을 먼저 본 워커는 큐에 들어올 때까지 잠깐
+	// take()를 반복한다
+	{
+		ft::lock_guard lock(_idle_mutex);
+		if (_n_queued >= _queue_limit)
+			return (false);
+		_n_queued++;
+	}
+
+	Worker *worker
+		= _workers[__sync_fetch_and_add(&_next, 1) % _workers.size()];
+	task->retain();
+	{
+		ft::lock_guard lock(worker->mutex);
+		worker->tasks.push_back(task);
+	}
+	ft::lock_guard lock(_idle_mutex);
+	pthread_cond_signal(&_idle_cond);
+	return (true);
+}
+
+FileTask *FileTaskPool::take(const size_t index)
+{
+	FileTask *task = NULL;
+	Worker &own = *_workers[index];
+	{
+		ft::lock_guard lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			return (task);
+		}
+	}
+	for (size_t i = 1; i < _workers.size(); i++)
+	{
+		Worker &victim = *_workers[(index + i) % _workers.size()];
+		ft::lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			return (task);
+		}
+	}
+	return (NULL);
+}
+
+void FileTaskPool::setNumThreads(const size_t n_threads)
+{
+	if (n_threads > _n_threads_max)
+		throw(std::invalid_argument("Too many file task threads"));
+	ft::lock_guard lock(_pool_mutex);
+	// 이미 시작된 풀의 크기는 바꾸지 않는다
+	if (_pool == NULL)
+		_n_threads = n_threads;
+}
+
+size_t FileTaskPool::getNumThreads(void)
+{
+	ft::lock_guard lock(_pool_mutex);
+	return (_n_threads);
+}
+
+size_t FileTaskPool::getMaxNumThreads(void)
+{
+	return (_n_threads_max);
+}
+
+void FileTaskPool::submit(FileTask *task)
+{
+	FileTaskPool *pool = getPool();
+	if (pool && pool->push(task))
+		return;
+	task->run();
+	task->complete();
+}
@@ -1,6 +1,8 @@
 #include "async/IOProcessor.hpp"
 #include "async/status.hpp"
+#include "utils/alloc_profile.hpp"
 #include "utils/string.hpp"
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <sstream>
@@ -8,12 +10,16 @@
 
 using namespace async;
 
-std::vector<IOProcessor *> IOProcessor::_objs;
+__thread std::vector<IOProcessor *> *IOProcessor::_objs = NULL;
+__thread int IOProcessor::_master_kq = -1;
+__thread size_t IOProcessor::_n_kevents = 0;
 const size_t IOProcessor::_buffsize = 2048;
+const int IOProcessor::_size_eventbuf = 64;
 static const timespec zerosec = {0, 0};
 
 IOProcessor::IOProcessor(void)
-	: _status(status::OK_BEGIN)
+	: _idle(false)
+	, _status(status::OK_BEGIN)
 {
 	initializeKQueue();
 	registerObject(this);
@@ -25,34 +31,131 @@ IOProcessor::~IOProcessor()
 	unregisterObject(this);
 }
 
+std::vector<IOProcessor *> &IOProcessor::objs(void)
+{
+	if (_objs == NULL)
+		_objs = new std::vector<IOProcessor *>();
+	return (*_objs);
+}
+
+int IOProcessor::masterKQueue(void)
+{
+	if (_master_kq < 0)
+		_master_kq = kqueue();
+	return (_master_kq);
+}
+
+// kqueue fd는 이벤트가 쌓이면 읽기 가능 상태가 되므로 다른 kqueue로 감시할 수
+// 있다. 객체의 kqueue가 닫히면 등록도 함께 사라진다.
+void IOProcessor::watchKQueue(IOProcessor *obj)
+{
+	struct kevent change;
+
+	if (masterKQueue() < 0)
+		return;
+	EV_SET(&change, obj->_kq, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, obj);
+	kevent(_master_kq, &change, 1, NULL, 0, &zerosec);
+}
+
 void IOProcessor::registerObject(IOProcessor *obj)
 {
+	std::vector<IOProcessor *> &registry = objs();
 	std::vector<IOProcessor *>::iterator it
-		= std::lower_bound(_objs.begin(), _objs.end(), obj);
-	if (it != _objs.end() && *it == obj)
+		= std::lower_bound(registry.begin(), registry.end(), obj);
+	if (it != registry.end() && *it == obj)
 		return;
-	_objs.insert(it, obj);
+	registry.insert(it, obj);
+	watchKQueue(obj);
 }
 
 void IOProcessor::unregisterObject(IOProcessor *obj)
 {
+	std::vector<IOProcessor *> &registry = objs();
 	std::vector<IOProcessor *>::iterator it
-		= std::lower_bound(_objs.begin(), _objs.end(), obj);
-	if (it == _objs.end())
+		= std::lower_bound(registry.begin(), registry.end(), obj);
+	if (it == registry.end() || *it != obj)
+		return;
+	registry.erase(it);
+}
+
+// kevent 한 번으로 처리할 이벤트가 없는 객체를 골라낸다. 결과를 믿을 수 없으면
+// 모든 객체가 각자 kevent를 호출하도록 둔다.
+void IOProcessor::markIdleObjects(void)
+{
+	std::vector<IOProcessor *> &registry = objs();
+	struct kevent events[_size_eventbuf];
+
+	if (_master_kq < 0)
+		return;
+	int n_events
+		= kevent(_master_kq, NULL, 0, events, _size_eventbuf, &zerosec);
+	if (n_events < 0 || n_events == _size_eventbuf)
 		return;
-	_objs.erase(it);
+	for (size_t i = 0; i < registry.size(); i++)
+		registry[i]->_idle = true;
+	for (int i = 0; i < n_events; i++)
+	{
+		IOProcessor *obj = static_cast<IOProcessor *>(events[i].udata);
+		std::vector<IOProcessor *>::iterator it
+			= std::lower_bound(registry.begin(), registry.end(), obj);
+		if (it != registry.end() && *it == obj)
+			obj->_idle = false;
+	}
 }
 
-void IOProcessor::doAllTasks(void)
+// 모든 객체가 받은 이벤트 수를 돌려준다
+size_t IOProcessor::doAllTasks(void)
 {
-	for (size_t i = 0; i < _objs.size(); i++)
-		_objs[i]->task();
+	ALLOC_SCOPE(SUBSYSTEM_IO);
+	std::vector<IOProcessor *> &registry = objs();
+	_n_kevents = 0;
+	markIdleObjects();
+	for (size_t i = 0; i < registry.size(); i++)
+		registry[i]->task();
+	for (size_t i = 0; i < registry.size(); i++)
+		registry[i]->_idle = false;
+	return (_n_kevents);
 }
 
 void IOProcessor::blockingWriteAll(void)
 {
-	for (size_t i = 0; i < _objs.size(); i++)
-		_objs[i]->blockingWrite();
+	std::vector<IOProcessor *> &registry = objs();
+	for (size_t i = 0; i < registry.size(); i++)
+		registry[i]->blockingWrite();
+}
+
+// kqueue는 fork(2)로 상속되지 않으므로 자식 프로세스에서 호출해 큐를 새로
+// 만들고 각 객체가 감시하던 fd를 다시 등록한다.
+void IOProcessor::reinitializeAll(void)
+{
+	std::vector<IOProcessor *> &registry = objs();
+	if (_master_kq >= 0)
+		close(_master_kq);
+	_master_kq = -1;
+	for (size_t i = 0; i < registry.size(); i++)
+	{
+		close(registry[i]->_kq);
+		registry[i]->initializeKQueue();
+		watchKQueue(registry[i]);
+		registry[i]->_watchlist.clear();
+		registry[i]->_eventlist.clear();
+		registry[i]->watch();
+	}
+}
+
+// 스레드 로컬인 레지스트리와 master kqueue를 놓는다. 이벤트 루프 스레드가 끝날
+// 때 호출한다. 남은 객체는 레지스트리가 소유하지 않으므로 그대로 둔다.
+void IOProcessor::releaseThread(void)
+{
+	if (_master_kq >= 0)
+		close(_master_kq);
+	_master_kq = -1;
+	delete _objs;
+	_objs = NULL;
+}
+
+void IOProcessor::watch(void)
+{
 }
 
 void IOProcessor::initializeKQueue(void)
@@ -64,12 +167,18 @@ void IOProcessor::initializeKQueue(void)
 
 void IOProcessor::flushKQueue(void)
 {
-	static const int size_eventbuf = 8;
 	struct kevent *newevents;
-	struct kevent events[size_eventbuf];
+	struct kevent events[_size_eventbuf];
 	int n_events;
 	int n_newevents;
 
+	// doAllTasks에서 쌓인 이벤트가 없다고 확인된 객체는 kevent를 생략한다
+	if (_idle && _watchlist.empty())
+	{
+		_idle = false;
+		return;
+	}
+	_idle = false;
 	if (_watchlist.empty())
 	{
 		newevents = NULL;
@@ -81,35 +190,38 @@ void IOProcessor::flushKQueue(void)
 		n_events = _watchlist.size();
 	}
 	n_newevents
-		= kevent(_kq, newevents, n_events, events, size_eventbuf, &zerosec);
+		= kevent(_kq, newevents, n_events, events, _size_eventbuf, &zerosec);
 	_watchlist.clear();
 	if (n_newevents < 0)
 		throw(std::runtime_error(std::string("Error while running kevent: ")
 								 + strerror(errno)));
 	_eventlist.insert(_eventlist.end(), events, events + n_newevents);
+	_n_kevents += n_newevents;
 }
 
+// 임시 버퍼 없이 읽기 버퍼 끝에 바로 읽어들인다
 int IOProcessor::read(const int fd, const size_t size)
 {
-	char *buff = new char[size];
-	ssize_t readsize = ::read(fd, buff, size);
+	std::string &rdbuf = _rdbuf[fd];
+	const size_t prev_size = rdbuf.size();
+
+	rdbuf.resize(prev_size + size);
+	ssize_t readsize
+		= ::read(fd, (size > 0) ? &rdbuf[prev_size] : NULL, size);
+	rdbuf.resize(prev_size + ((readsize > 0) ? readsize : 0));
 	if (readsize == 0)
 	{
-		delete[] buff;
 		_status = status::ERROR_FILECLOSED;
 		_error_msg = generateErrorMsgFileClosed(fd);
 		return (_status);
 	}
 	if (readsize < 0)
 	{
-		delete[] buff;
 		_status = status::ERROR_READ;
 		_error_msg = generateErrorMsgRead(fd);
 		return (_status);
 	}
-	_rdbuf[fd].append(buff, readsize);
 	_event_count++;
-	delete[] buff;
 	_status = status::OK_AGAIN;
 	return (_status);
 }
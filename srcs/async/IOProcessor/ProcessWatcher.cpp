@@ -0,0 +1,42 @@
+#include "async/ProcessWatcher.hpp"
+
+using namespace async;
+
+ProcessWatcher::ProcessWatcher(const pid_t pid)
+	: _pid(pid)
+	, _exited(false)
+{
+	watch();
+	flushKQueue();
+}
+
+ProcessWatcher::~ProcessWatcher()
+{
+}
+
+void ProcessWatcher::watch(void)
+{
+	struct kevent event;
+
+	EV_SET(&event, _pid, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0, NULL);
+	_watchlist.push_back(event);
+}
+
+void ProcessWatcher::task(void)
+{
+	flushKQueue();
+	while (!_eventlist.empty())
+	{
+		const struct kevent &event = _eventlist.front();
+		// 등록하기 전에 이미 끝났으면 ESRCH로 실패한다
+		if ((event.flags & EV_ERROR) || (event.fflags & NOTE_EXIT))
+			_exited = true;
+		_eventlist.pop_front();
+	}
+	_status = _exited ? status::OK_DONE : status::OK_AGAIN;
+}
+
+bool ProcessWatcher::exited(void)
+{
+	return (_exited);
+}
@@ -1,5 +1,6 @@
 #include "async/SingleIOProcessor.hpp"
 #include "async/status.hpp"
+#include "utils/lock_guard.hpp"
 #include "utils/string.hpp"
 #include <algorithm>
 #include <cerrno>
@@ -10,35 +11,42 @@
 using namespace async;
 
 SingleIOProcessor::SingleIOProcessor()
+	: _read_paused(false)
 {
+	pthread_mutex_init(&_mutex, NULL);
 }
 
 SingleIOProcessor::SingleIOProcessor(const int fd, const int event_option)
 	: _fd(fd)
 	, _event_option(event_option)
+	, _read_paused(false)
 {
+	pthread_mutex_init(&_mutex, NULL);
 	int result = fcntl(_fd, F_SETFL, O_NONBLOCK);
 	if (result < 0)
 		throw(std::runtime_error(std::string("Error while running fcntl at fd ")
 								 + toStr(_fd) + ": " + strerror(errno)));
-	if (_event_option == IO_R)
-		_watchlist.push_back(constructKevent(_fd, IOEVENT_READ));
-	else if (_event_option == IO_W)
-		_watchlist.push_back(constructKevent(_fd, IOEVENT_WRITE));
-	else
-	{
-		_watchlist.push_back(constructKevent(_fd, IOEVENT_READ));
-		_watchlist.push_back(constructKevent(_fd, IOEVENT_WRITE));
-	}
+	watch();
 	flushKQueue();
 }
 
 SingleIOProcessor::~SingleIOProcessor()
 {
+	pthread_mutex_destroy(&_mutex);
+}
+
+void SingleIOProcessor::watch(void)
+{
+	if (_event_option != IO_W && !_read_paused)
+		_watchlist.push_back(constructKevent(_fd, IOEVENT_READ));
+	if (_event_option != IO_R)
+		_watchlist.push_back(constructKevent(_fd, IOEVENT_WRITE));
 }
 
 void SingleIOProcessor::task(void)
 {
+	ft::lock_guard lock(_mutex);
+
 	flushKQueue();
 	while (!_eventlist.empty())
 	{
@@ -54,6 +62,10 @@ void SingleIOProcessor::task(void)
 		}
 		else if (event == EVFILT_READ)
 		{
+			/* 여러 프로세스가 같은 일반 파일에 쓰고 있으면 현재 오프셋이 파일
+			 * 끝을 넘어 data가 음수가 될 수 있음 */
+			if (data < 0 || _read_paused)
+				continue;
 			if (read(_fd, data) >= status::ERROR_GENERIC)
 				return;
 			if (flags & EV_EOF)
@@ -74,19 +86,44 @@ void SingleIOProcessor::task(void)
 	_status = status::OK_AGAIN;
 }
 
+// 읽은 내용을 가져가지 못하는 동안 읽기 이벤트를 끈다.
+// 파이프라면 반대편 프로세스의 write(2)가 막혀 자연스럽게 속도가 맞춰진다.
+void SingleIOProcessor::pauseRead(void)
+{
+	ft::lock_guard lock(_mutex);
+	if (_read_paused || _event_option == IO_W)
+		return;
+	struct kevent event = constructKevent(_fd, IOEVENT_READ);
+	event.flags = EV_DISABLE;
+	_watchlist.push_back(event);
+	_read_paused = true;
+}
+
+void SingleIOProcessor::resumeRead(void)
+{
+	ft::lock_guard lock(_mutex);
+	if (!_read_paused)
+		return;
+	_watchlist.push_back(constructKevent(_fd, IOEVENT_READ));
+	_read_paused = false;
+}
+
 void SingleIOProcessor::setWriteBuf(const std::string &str)
 {
+	ft::lock_guard lock(_mutex);
 	_wrbuf[_fd] += str;
 }
 
 void SingleIOProcessor::getReadBuf(std::string &str)
 {
+	ft::lock_guard lock(_mutex);
 	str += _rdbuf[_fd];
 	_rdbuf[_fd] = "";
 }
 
 bool SingleIOProcessor::writeDone(void)
 {
+	ft::lock_guard lock(_mutex);
 	return (_wrbuf[_fd].empty());
 }
 
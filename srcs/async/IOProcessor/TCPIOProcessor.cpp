@@ -2,19 +2,76 @@
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
+#include <fstream>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/sysctl.h>
+#endif
 
 using namespace async;
 
-std::queue<int> TCPIOProcessor::disconnected_clients;
+// 다른 소켓의 이벤트가 밀리지 않도록 이벤트 한 번에 받는 연결 수를 제한
+const int TCPIOProcessor::_max_accepts_per_event = 256;
 
-TCPIOProcessor::TCPIOProcessor(const int port, const int backlog)
+// 논블로킹, close-on-exec 상태의 클라이언트 소켓을 받는다. accept4(2)가 없으면
+// fcntl(2)로 같은 상태를 만든다.
+static int acceptNonBlocking(const int listening_socket)
+{
+#ifdef SOCK_NONBLOCK
+	return (::accept4(
+		listening_socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC));
+#else
+	int client_socket = ::accept(listening_socket, NULL, NULL);
+	if (client_socket < 0)
+		return (client_socket);
+	if (fcntl(client_socket, F_SETFL, O_NONBLOCK) < 0
+		|| fcntl(client_socket, F_SETFD, FD_CLOEXEC) < 0)
+	{
+		int err = errno;
+		close(client_socket);
+		errno = err;
+		return (-1);
+	}
+	return (client_socket);
+#endif
+}
+
+int TCPIOProcessor::maxBacklogSize(void)
+{
+	int somaxconn = SOMAXCONN;
+#if defined(__APPLE__) || defined(__FreeBSD__)
+	size_t len = sizeof(somaxconn);
+	if (sysctlbyname("kern.ipc.somaxconn", &somaxconn, &len, NULL, 0) < 0)
+		somaxconn = SOMAXCONN;
+#elif defined(__linux__)
+	std::ifstream proc("/proc/sys/net/core/somaxconn");
+	if (!(proc >> somaxconn))
+		somaxconn = SOMAXCONN;
+#endif
+	if (somaxconn < 1)
+		somaxconn = SOMAXCONN;
+	return (somaxconn);
+}
+
+TCPIOProcessor::TCPIOProcessor(const int port,
+							   const int backlog,
+							   const int options)
 	: _port(port)
 	, _backlog_size(backlog)
+	, _options(options)
+	, _listening_socket(-1)
+	, _reserve_fd(-1)
 	, _logger(Logger::getLogger("TCPIOProcessor"))
 {
+	std::memset(&_stats, 0, sizeof(_stats));
+	if (_options & TCP_OPTION_NOLISTEN)
+	{
+		LOG_VERBOSE("TCPIOProcessor for port " << _port << " without socket");
+		return;
+	}
+
 	int result;
 	_listening_socket = socket(PF_INET, SOCK_STREAM, 0);
 	if (_listening_socket < 0)
@@ -23,6 +80,17 @@ TCPIOProcessor::TCPIOProcessor(const int port, const int backlog)
 	int option = 1;
 	setsockopt(
 		_listening_socket, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+	if (_options & TCP_OPTION_REUSEPORT)
+	{
+		// 워커 프로세스마다 같은 포트에 소켓을 열고 커널이 accept를 분배하게 함
+		result = setsockopt(_listening_socket,
+							SOL_SOCKET,
+							SO_REUSEPORT,
+							&option,
+							sizeof(option));
+		if (result < 0)
+			finalize(strerror(errno));
+	}
 	LOG_INFO("Created socket " << _listening_socket);
 
 	struct sockaddr_in addr;
@@ -45,11 +113,25 @@ TCPIOProcessor::TCPIOProcessor(const int port, const int backlog)
 	result = fcntl(_listening_socket, F_SETFL, O_NONBLOCK);
 	if (result < 0)
 		finalize(strerror(errno));
-	_watchlist.push_back(constructKevent(_listening_socket, IOEVENT_READ));
+	// CGI, FastCGI 워커가 리스닝 소켓을 물려받지 않도록 함
+	fcntl(_listening_socket, F_SETFD, FD_CLOEXEC);
+	_reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	watch();
 	flushKQueue();
 	LOG_VERBOSE("TCPIOProcessor initialization complete");
 }
 
+void TCPIOProcessor::watch(void)
+{
+	if (_listening_socket >= 0)
+		_watchlist.push_back(constructKevent(_listening_socket, IOEVENT_READ));
+	for (_iterator it = _wrbuf.begin(); it != _wrbuf.end(); it++)
+	{
+		_watchlist.push_back(constructKevent(it->first, IOEVENT_READ));
+		_watchlist.push_back(constructKevent(it->first, IOEVENT_WRITE));
+	}
+}
+
 TCPIOProcessor::~TCPIOProcessor()
 {
 	finalize(NULL);
@@ -94,7 +176,9 @@ void TCPIOProcessor::task(void)
 				_status = status::OK_AGAIN;
 				continue;
 			}
+			const size_t n_buffered = _rdbuf[ident].size();
 			int rc = read(ident, data);
+			_stats.bytes_received += _rdbuf[ident].size() - n_buffered;
 			if (rc == status::ERROR_FILECLOSED)
 			{
 				LOG_VERBOSE("client " << ident << " is closed");
@@ -113,16 +197,19 @@ void TCPIOProcessor::task(void)
 		}
 		else if (filter == EVFILT_WRITE)
 		{
-			if (_wrbuf[ident].length() > 0)
+			const size_t n_pending = _wrbuf[ident].length();
+			if (n_pending > 0)
 			{
-				if (write(ident, _wrbuf[ident].length())
-					>= status::ERROR_GENERIC)
+				if (write(ident, n_pending) >= status::ERROR_GENERIC)
 				{
 					LOG_WARNING("Error while writing to client "
 								<< ident << ": " << _error_msg);
 					_status = status::OK_AGAIN;
 				}
+				_stats.bytes_sent += n_pending - _wrbuf[ident].length();
 			}
+			if (_closing.count(ident) && _wrbuf[ident].empty())
+				disconnect(ident);
 		}
 	}
 	_status = status::OK_AGAIN;
@@ -130,32 +217,74 @@ void TCPIOProcessor::task(void)
 
 void TCPIOProcessor::finalize(const char *with_error)
 {
-	if (_listening_socket >= 0)
+	if (_listening_socket >= 0 || (_options & TCP_OPTION_NOLISTEN))
 	{
 		LOG_VERBOSE("Finalize TCPIOProcessor");
 		while (!_wrbuf.empty())
 			disconnect(_wrbuf.begin()->first);
-		close(_listening_socket);
+		while (!accepted_clients.empty())
+		{
+			close(accepted_clients.front());
+			accepted_clients.pop();
+		}
+		if (_listening_socket >= 0)
+			close(_listening_socket);
+		_listening_socket = -1;
+		if (_reserve_fd >= 0)
+			close(_reserve_fd);
+		_reserve_fd = -1;
 		if (with_error)
 			throw(std::runtime_error(std::string("Error from TCPIOProcessor: ")
 									 + with_error));
 	}
-	_listening_socket = -1;
 }
 
+// 대기 중인 연결을 EAGAIN이 날 때까지 한꺼번에 받는다
 void TCPIOProcessor::accept(void)
 {
-	int new_client_socket = ::accept(_listening_socket, NULL, NULL);
-	if (new_client_socket < 0)
-		finalize(strerror(errno));
-	LOG_INFO("Accepted new client: " << new_client_socket);
-	int result = fcntl(new_client_socket, F_SETFL, O_NONBLOCK);
-	if (result < 0)
-		finalize(strerror(errno));
-	_watchlist.push_back(constructKevent(new_client_socket, IOEVENT_READ));
-	_watchlist.push_back(constructKevent(new_client_socket, IOEVENT_WRITE));
-	_rdbuf[new_client_socket] = "";
-	_wrbuf[new_client_socket] = "";
+	for (int i = 0; i < _max_accepts_per_event; i++)
+	{
+		int new_client_socket = acceptNonBlocking(_listening_socket);
+		if (new_client_socket < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			if (errno == EMFILE || errno == ENFILE)
+				shedConnection();
+			else if (errno != EAGAIN && errno != EWOULDBLOCK)
+				LOG_WARNING("Failed to accept client: " << strerror(errno));
+			return;
+		}
+		LOG_INFO("Accepted new client: " << new_client_socket);
+		if (_options & TCP_OPTION_HANDOFF)
+			accepted_clients.push(new_client_socket);
+		else
+			adopt(new_client_socket);
+	}
+}
+
+/* fd가 바닥나면 대기열의 연결을 받을 수 없어 리스닝 소켓이 계속 읽기 가능
+ * 상태로 남는다. 예비 fd를 잠깐 닫고 연결 하나를 받아 바로 끊는다. */
+void TCPIOProcessor::shedConnection(void)
+{
+	LOG_WARNING("Out of file descriptors, dropping a pending connection");
+	if (_reserve_fd < 0)
+		return;
+	close(_reserve_fd);
+	int client_socket = ::accept(_listening_socket, NULL, NULL);
+	if (client_socket >= 0)
+		close(client_socket);
+	_reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+void TCPIOProcessor::adopt(const int client_socket)
+{
+	_watchlist.push_back(constructKevent(client_socket, IOEVENT_READ));
+	_watchlist.push_back(constructKevent(client_socket, IOEVENT_WRITE));
+	_rdbuf[client_socket] = "";
+	_wrbuf[client_socket] = "";
+	_adopted_at[client_socket] = monotonicUs();
+	_stats.accepted++;
 }
 
 void TCPIOProcessor::disconnect(const int client_socket)
@@ -163,10 +292,36 @@ void TCPIOProcessor::disconnect(const int client_socket)
 	close(client_socket);
 	_rdbuf.erase(client_socket);
 	_wrbuf.erase(client_socket);
+	_closing.erase(client_socket);
+	_adopted_at.erase(client_socket);
 	disconnected_clients.push(client_socket);
 	LOG_INFO("Disconnected " << client_socket);
 }
 
+size_t TCPIOProcessor::nClients(void) const
+{
+	return (_wrbuf.size());
+}
+
+usec_t TCPIOProcessor::adoptedAt(const int client_socket) const
+{
+	std::map<int, usec_t>::const_iterator it = _adopted_at.find(client_socket);
+	if (it == _adopted_at.end())
+		return (0);
+	return (it->second);
+}
+
+const TCPIOProcessor::Stats &TCPIOProcessor::getStats(void) const
+{
+	return (_stats);
+}
+
+void TCPIOProcessor::closeAfterWrite(const int client_socket)
+{
+	if (_wrbuf.find(client_socket) != _wrbuf.end())
+		_closing.insert(client_socket);
+}
+
 std::string &TCPIOProcessor::rdbuf(const int fd)
 {
 	return (_rdbuf[fd]);
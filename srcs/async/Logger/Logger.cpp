@@ -1,18 +1,48 @@
 #include "async/Logger.hpp"
+#include "async/IOProcessor.hpp"
+#include "utils/alloc_profile.hpp"
 #include "utils/ansi_escape.h"
+#include "utils/lock_guard.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
 
 using namespace async;
 
 std::map<std::string, ft::shared_ptr<Logger> > Logger::_loggers;
-std::map<int, ft::shared_ptr<SingleIOProcessor> > Logger::_target;
 const std::string Logger::_name_default = "root";
 int Logger::_log_level = INFO;
+const int Logger::compiled_min_level;
 const char *Logger::_level_names[]
 	= {"DEBUG  ", "VERBOSE", "INFO   ", "WARNING", "ERROR  "};
 const char *Logger::_level_prefixes[]
 	= {ANSI_RESET, ANSI_RESET, ANSI_BWHITE, ANSI_BYELLOW, ANSI_BRED};
-bool Logger::_active = false;
+__thread Logger::Pending Logger::_pending;
+pthread_mutex_t Logger::_mutex = PTHREAD_MUTEX_INITIALIZER;
+const size_t Logger::_max_fds = 8;
+int Logger::_fds[Logger::_max_fds];
+size_t Logger::_n_fds = 0;
+
+const size_t Logger::_slot_data_size;
+const size_t Logger::_max_record_slots;
+const size_t Logger::_ring_size = 4096;
+Logger::Slot *Logger::_ring = NULL;
+volatile size_t Logger::_head = 0;
+size_t Logger::_tail = 0;
+volatile size_t Logger::_dropped = 0;
+size_t Logger::_dropped_reported = 0;
+
+pthread_t Logger::_writer;
+volatile bool Logger::_writer_running = false;
+volatile bool Logger::_writer_stop = false;
+pthread_mutex_t Logger::_drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+const long Logger::_idle_min_us = 1000;
+const long Logger::_idle_max_us = 20000;
 
 Logger::Logger(void)
 	: _name(_name_default)
@@ -25,7 +55,8 @@ Logger::Logger(const std::string &name)
 }
 
 Logger::Logger(const Logger &orig)
-	: _name(orig._name)
+	: ft::AtomicRefCounted(orig)
+	, _name(orig._name)
 {
 }
 
@@ -39,47 +70,415 @@ Logger::~Logger()
 {
 }
 
-std::string Logger::getPrefix(int level)
+// 링에 들어갈 수 있는 만큼만 모은다
+void Logger::append(arg_tag_e tag, const void *data, size_t size)
 {
-	time_t now = time(NULL);
-	struct tm *tstruct = localtime(&now);
-	char buf[64];
-	strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tstruct);
+	RecordHead &head = _pending.head;
+	const unsigned int size32 = size;
+	const size_t extra = (tag == ARG_STR) ? sizeof(size32) : 0;
 
-	std::stringstream prefix;
-	prefix << _level_prefixes[level] << buf << ", [" << _level_names[level]
-		   << "]" << _name << ": ";
-	return (prefix.str());
+	if (head.truncated)
+		return;
+	if (head.len + 1 + extra + size > sizeof(_pending.args))
+	{
+		head.truncated = true;
+		return;
+	}
+	char *dst = _pending.args + head.len;
+	*dst++ = static_cast<char>(tag);
+	if (extra)
+	{
+		std::memcpy(dst, &size32, sizeof(size32));
+		dst += sizeof(size32);
+	}
+	std::memcpy(dst, data, size);
+	head.len += 1 + extra + size;
 }
 
+void Logger::begin(int level)
+{
+	commit();
+	if (level < _log_level)
+		return;
+	RecordHead &head = _pending.head;
+	head.sec = time(NULL);
+	head.logger = this;
+	head.len = 0;
+	head.level = level;
+	head.truncated = false;
+	_pending.open = true;
+}
 void Logger::log(const std::string &content)
 {
-	if (!_active)
+	if (isActive())
+		append(ARG_STR, content.data(), content.size());
+}
+
+void Logger::log(const char *content)
+{
+	if (isActive())
+		append(ARG_STR, content, ::strlen(content));
+}
+
+void Logger::log(char content)
+{
+	if (isActive())
+		append(ARG_CHAR, &content, sizeof(content));
+}
+
+void Logger::log(long long content)
+{
+	if (isActive())
+		append(ARG_INT, &content, sizeof(content));
+}
+
+void Logger::log(unsigned long long content)
+{
+	if (isActive())
+		append(ARG_UINT, &content, sizeof(content));
+}
+
+// 링에서 연속된 n_slots칸을 예약한다. 기록 스레드는 칸을 순서대로 비우므로
+// 마지막 칸이 비었으면 앞의 칸들도 모두 비어 있다.
+bool Logger::reserve(size_t n_slots, size_t &pos)
+{
+	pos = _head;
+	while (true)
+	{
+		const size_t last = pos + n_slots - 1;
+		const size_t seq = _ring[last & (_ring_size - 1)].seq;
+		const long diff = static_cast<long>(seq - last);
+		if (diff == 0)
+		{
+			if (__sync_bool_compare_and_swap(&_head, pos, pos + n_slots))
+				return (true);
+		}
+		else if (diff < 0)
+			return (false);
+		pos = _head;
+	}
+}
+
+// 작성 중인 레코드를 링에 넣는다. 자리가 없으면 버린다
+void Logger::commit(void)
+{
+	if (!_pending.open)
+		return;
+	_pending.open = false;
+	if (_ring == NULL)
+		return;
+	startWriter();
+
+	RecordHead &head = _pending.head;
+	head.n_slots = (sizeof(head) + head.len + _slot_data_size - 1)
+				   / _slot_data_size;
+	size_t pos;
+	if (!reserve(head.n_slots, pos))
+	{
+		__sync_fetch_and_add(&_dropped, 1);
+		return;
+	}
+	std::memcpy(_ring[pos & (_ring_size - 1)].data, &head, sizeof(head));
+	size_t copied = 0;
+	for (size_t i = 0; i < head.n_slots; i++)
+	{
+		char *dst = _ring[(pos + i) & (_ring_size - 1)].data;
+		size_t room = _slot_data_size;
+		if (i == 0)
+		{
+			dst += sizeof(head);
+			room -= sizeof(head);
+		}
+		const size_t n = std::min<size_t>(room, head.len - copied);
+		std::memcpy(dst, _pending.args + copied, n);
+		copied += n;
+	}
+	__sync_synchronize();
+	// 첫 칸을 마지막에 공개해야 기록 스레드가 완성된 레코드만 본다
+	for (size_t i = head.n_slots; i > 0; i--)
+		_ring[(pos + i - 1) & (_ring_size - 1)].seq = pos + i;
+}
+
+void Logger::startWriter(void)
+{
+	if (_writer_running)
 		return;
-	for (_Procs::iterator it = _target.begin(); it != _target.end(); it++)
+	ft::lock_guard lock(_mutex);
+	if (_writer_running)
+		return;
+
+	// 기록 스레드는 시그널을 받지 않는다
+	sigset_t signals;
+	sigset_t old_signals;
+	sigfillset(&signals);
+	pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+	_writer_stop = false;
+	const int result = pthread_create(&_writer, NULL, runWriter, NULL);
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+	if (result != 0)
+		return; // flush()나 blockingWriteAll()이 대신 비운다
+	_writer_running = true;
+}
+
+// exit(3)에서 정적 객체가 소멸되기 전에 남은 레코드를 쓰고 멈춘다
+void Logger::stopWriter(void)
+{
+	if (_writer_running)
 	{
-		_SingleIOPtr &logger = it->second;
-		logger->setWriteBuf(content);
+		_writer_stop = true;
+		pthread_join(_writer, NULL);
+		_writer_running = false;
 	}
+	commit();
+	ft::lock_guard lock(_drain_mutex);
+	drain();
 }
 
-bool Logger::isActive(void)
+// 링이 비어 있으면 조금씩 더 오래 쉰다. 생산자는 기록 스레드를 깨우지 않는다
+void *Logger::runWriter(void *arg)
+{
+	long idle_us = _idle_min_us;
+
+	(void)arg;
+	while (!_writer_stop)
+	{
+		size_t n_records;
+		{
+			ft::lock_guard lock(_drain_mutex);
+			n_records = drain();
+		}
+		if (n_records > 0)
+		{
+			idle_us = _idle_min_us;
+			continue;
+		}
+		usleep(idle_us);
+		idle_us = std::min(idle_us * 2, _idle_max_us);
+	}
+	return (NULL);
+}
+
+// 공개된 레코드를 모두 꺼내 문자열로 만들고 쓴다. _drain_mutex를 잡고 부른다
+size_t Logger::drain(void)
+{
+	ALLOC_SCOPE(SUBSYSTEM_LOGGER);
+	const size_t slot_data = _slot_data_size;
+	std::string out;
+	std::string args;
+	size_t n_records = 0;
+
+	while (_ring)
+	{
+		Slot &first = _ring[_tail & (_ring_size - 1)];
+		if (first.seq != _tail + 1)
+			break;
+		__sync_synchronize();
+		RecordHead head;
+		std::memcpy(&head, first.data, sizeof(head));
+
+		const size_t total = sizeof(head) + head.len;
+		args.clear();
+		for (size_t i = 0; i < head.n_slots; i++)
+		{
+			const char *src = _ring[(_tail + i) & (_ring_size - 1)].data;
+			size_t n = std::min(slot_data, total - i * slot_data);
+			if (i == 0)
+			{
+				src += sizeof(head);
+				n -= sizeof(head);
+			}
+			args.append(src, n);
+		}
+		__sync_synchronize();
+		for (size_t i = 0; i < head.n_slots; i++)
+			_ring[(_tail + i) & (_ring_size - 1)].seq = _tail + i + _ring_size;
+		_tail += head.n_slots;
+		format(out, head, args);
+		n_records++;
+	}
+
+	const size_t dropped = _dropped;
+	if (dropped != _dropped_reported)
+	{
+		std::stringstream notice;
+		notice << _level_prefixes[WARNING] << "[" << _level_names[WARNING]
+			   << "]" << _name_default << ": "
+			   << dropped - _dropped_reported
+			   << " log records dropped, ring buffer is full" ANSI_RESET "\n";
+		out.append(notice.str());
+		_dropped_reported = dropped;
+	}
+	if (!out.empty())
+		writeAll(out);
+	return (n_records);
+}
+
+// 기록 스레드에서만 부르므로 시각 문자열을 초 단위로 재사용한다
+void Logger::format(std::string &out,
+					const RecordHead &head,
+					const std::string &args)
+{
+	static long cached_sec = -1;
+	static char cached_time[64];
+
+	if (head.sec != cached_sec)
+	{
+		const time_t sec = head.sec;
+		struct tm tstruct;
+		localtime_r(&sec, &tstruct);
+		strftime(cached_time, sizeof(cached_time), "%Y-%m-%d %H:%M:%S",
+				 &tstruct);
+		cached_sec = head.sec;
+	}
+	out.append(_level_prefixes[head.level]);
+	out.append(cached_time);
+	out.append(", [");
+	out.append(_level_names[head.level]);
+	out.append("]");
+	out.append(head.logger->_name);
+	out.append(": ");
+
+	size_t i = 0;
+	while (i < args.size())
+	{
+		const int tag = args[i++];
+		if (tag == ARG_STR)
+		{
+			unsigned int size;
+			std::memcpy(&size, args.data() + i, sizeof(size));
+			i += sizeof(size);
+			out.append(args, i, size);
+			i += size;
+		}
+		else if (tag == ARG_CHAR)
+			out.push_back(args[i++]);
+		else
+		{
+			unsigned long long value;
+			bool negative = false;
+			std::memcpy(&value, args.data() + i, sizeof(value));
+			i += sizeof(value);
+			if (tag == ARG_INT && static_cast<long long>(value) < 0)
+			{
+				negative = true;
+				value = -value;
+			}
+			char digits[24];
+			char *p = digits + sizeof(digits);
+			do
+			{
+				*--p = '0' + value % 10;
+				value /= 10;
+			} while (value);
+			if (negative)
+				*--p = '-';
+			out.append(p, digits + sizeof(digits) - p);
+		}
+	}
+	if (head.truncated)
+		out.append("...");
+	// 줄 단위로 내보내야 다른 스레드의 로그와 섞이지 않는다
+	if (out[out.size() - 1] == '\n')
+		out.append(ANSI_RESET);
+	else
+		out.append(ANSI_RESET "\n");
+}
+
+// 기록 스레드는 이벤트 루프가 아니므로 fd가 논블로킹이어도 다 쓸 때까지
+// 기다린다
+void Logger::writeAll(const std::string &out)
+{
+	int fds[_max_fds];
+	size_t n_fds;
+	{
+		ft::lock_guard lock(_mutex);
+		n_fds = _n_fds;
+		std::memcpy(fds, _fds, sizeof(int) * n_fds);
+	}
+	for (size_t i = 0; i < n_fds; i++)
+	{
+		size_t written = 0;
+		while (written < out.size())
+		{
+			ssize_t n
+				= ::write(fds[i], out.data() + written, out.size() - written);
+			if (n >= 0)
+			{
+				written += n;
+				continue;
+			}
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN)
+				break;
+			struct pollfd pfd;
+			pfd.fd = fds[i];
+			pfd.events = POLLOUT;
+			::poll(&pfd, 1, 100);
+		}
+	}
+}
+
+// fork(2) 중에 다른 스레드가 잠금을 쥐고 있지 않도록 한다
+void Logger::prepareFork(void)
+{
+	pthread_mutex_lock(&_mutex);
+	pthread_mutex_lock(&_drain_mutex);
+}
+
+void Logger::afterForkParent(void)
 {
-	return (_active);
+	pthread_mutex_unlock(&_drain_mutex);
+	pthread_mutex_unlock(&_mutex);
 }
 
-void Logger::activate(void)
+// 자식에는 기록 스레드가 없다. 부모가 쓸 레코드는 버리고 링을 비운다
+void Logger::afterForkChild(void)
 {
-	_active = true;
+	pthread_mutex_init(&_mutex, NULL);
+	pthread_mutex_init(&_drain_mutex, NULL);
+	_writer_running = false;
+	for (size_t i = 0; i < _ring_size; i++)
+		_ring[i].seq = i;
+	_head = 0;
+	_tail = 0;
+	_dropped = 0;
+	_dropped_reported = 0;
 }
 
-void Logger::deactivate(void)
+void Logger::flush(void)
 {
-	_active = false;
+	commit();
+	// 기록 스레드를 띄우지 못했으면 호출한 스레드에서 쓴다
+	if (!_writer_running && _ring)
+	{
+		ft::lock_guard lock(_drain_mutex);
+		drain();
+	}
 }
 
+bool Logger::isActive(void)
+{
+	return (_pending.open);
+}
+
+// 컴파일 시점 하한보다 낮게 설정하면 하한으로 올린다. 경고는 한 번만 남긴다
 void Logger::setLogLevel(int log_filter)
 {
+	static bool warned = false;
+
+	if (log_filter < compiled_min_level)
+	{
+		if (!warned)
+		{
+			const std::string name(_level_names[compiled_min_level]);
+			getLogger("Logger") << warning << "Log levels below "
+								<< name.substr(0, name.find(' '))
+								<< " are not compiled in";
+			warned = true;
+		}
+		log_filter = compiled_min_level;
+	}
 	_log_level = log_filter;
 }
 
@@ -97,19 +496,35 @@ void Logger::setLogLevel(const std::string &log_level)
 	throw(std::runtime_error("Log level " + log_level + " does not exist."));
 }
 
-int Logger::getLogLevel(void)
+size_t Logger::getDroppedCount(void)
 {
-	return (_log_level);
+	return (_dropped);
 }
 
+// 처음 등록할 때 링을 만든다. 등록된 fd가 없으면 레코드도 만들지 않는다
 void Logger::registerFd(int fd)
 {
-	if (_target.find(fd) == _target.end())
-		_target[fd] = _SingleIOPtr(new SingleIOProcessor(fd));
+	ft::lock_guard lock(_mutex);
+	for (size_t i = 0; i < _n_fds; i++)
+		if (_fds[i] == fd)
+			return;
+	if (_n_fds == _max_fds)
+		throw(std::runtime_error("Too many log targets"));
+	_fds[_n_fds++] = fd;
+	if (_ring)
+		return;
+	Slot *ring = new Slot[_ring_size];
+	for (size_t i = 0; i < _ring_size; i++)
+		ring[i].seq = i;
+	__sync_synchronize();
+	_ring = ring;
+	pthread_atfork(prepareFork, afterForkParent, afterForkChild);
+	std::atexit(stopWriter);
 }
 
 Logger &Logger::getLogger(const std::string &name)
 {
+	ft::lock_guard lock(_mutex);
 	if (_loggers.find(name) == _loggers.end())
 		_loggers[name] = ft::shared_ptr<Logger>(new Logger(name));
 	return (*(_loggers[name]));
@@ -117,21 +532,77 @@ Logger &Logger::getLogger(const std::string &name)
 
 void Logger::doAllTasks(void)
 {
+	flush();
 	IOProcessor::doAllTasks();
 }
 
+// 기록 스레드를 기다리지 않고 호출한 스레드에서 링을 비운다
 void Logger::blockingWriteAll(void)
 {
+	commit();
+	{
+		ft::lock_guard lock(_drain_mutex);
+		drain();
+	}
 	IOProcessor::blockingWriteAll();
 }
 
 Logger &operator<<(Logger &io, const Logger::EndMarker mark)
 {
-	io.log(ANSI_RESET "\n");
-	if (mark.level < Logger::getLogLevel())
-		Logger::deactivate();
-	else
-		Logger::activate();
-	io.log(io.getPrefix(mark.level));
+	io.begin(mark.level);
+	return (io);
+}
+
+Logger &operator<<(Logger &io, const std::string &content)
+{
+	io.log(content);
+	return (io);
+}
+
+Logger &operator<<(Logger &io, const char *content)
+{
+	io.log(content);
+	return (io);
+}
+
+Logger &operator<<(Logger &io, char content)
+{
+	io.log(content);
+	return (io);
+}
+
+Logger &operator<<(Logger &io, int content)
+{
+	io.log(static_cast<long long>(content));
+	return (io);
+}
+
+Logger &operator<<(Logger &io, long content)
+{
+	io.log(static_cast<long long>(content));
+	return (io);
+}
+
+Logger &operator<<(Logger &io, long long content)
+{
+	io.log(content);
+	return (io);
+}
+
+Logger &operator<<(Logger &io, unsigned int content)
+{
+	io.log(static_cast<unsigned long long>(content));
+	return (io);
+}
+
+Logger &operator<<(Logger &io, unsigned long content)
+{
+	io.log(static_cast<unsigned long long>(content));
+	return (io);
+}
+
+Logger &operator<<(Logger &io, unsigned long long content)
+{
+	io.log(content);
 	return (io);
 }
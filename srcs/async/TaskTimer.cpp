@@ -0,0 +1,75 @@
+#include "async/TaskTimer.hpp"
+#include "async/Logger.hpp"
+#include <cstdlib>
+#include <cxxabi.h>
+#include <string>
+
+using namespace async;
+
+usec_t TaskTimer::_threshold_us = 0;
+const usec_t TaskTimer::_warning_interval_us = 1000 * 1000;
+__thread unsigned long long TaskTimer::_n_slow = 0;
+__thread usec_t TaskTimer::_last_warning = 0;
+__thread size_t TaskTimer::_suppressed = 0;
+
+TaskTimer::TaskTimer(void)
+	: _started_at(_threshold_us ? monotonicUs() : 0)
+{
+}
+
+// 워커를 만들기 전 설정을 읽을 때 정한다
+void TaskTimer::enable(usec_t threshold_us)
+{
+	_threshold_us = threshold_us;
+}
+
+bool TaskTimer::enabled(void)
+{
+	return (_threshold_us != 0);
+}
+
+// 이 스레드에서 기준을 넘은 호출 수
+unsigned long long TaskTimer::slowTaskCount(void)
+{
+	return (_n_slow);
+}
+
+void TaskTimer::check(const std::type_info &type, int fd) const
+{
+	if (_started_at == 0)
+		return;
+	const usec_t elapsed = monotonicUs() - _started_at;
+	if (elapsed >= _threshold_us)
+		report(type, fd, elapsed);
+}
+
+static std::string demangle(const char *name)
+{
+	int status;
+	char *demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+	if (demangled == NULL)
+		return (name);
+	std::string result(demangled);
+	std::free(demangled);
+	return (result);
+}
+
+void TaskTimer::report(const std::type_info &type, int fd, usec_t elapsed)
+{
+	Logger &_logger = Logger::getLogger("TaskTimer");
+	const usec_t now = monotonicUs();
+
+	_n_slow++;
+	if (_last_warning != 0 && now - _last_warning < _warning_interval_us)
+	{
+		_suppressed++;
+		return;
+	}
+	_last_warning = now;
+	if (_suppressed > 0)
+		LOG_WARNING(_suppressed << " more slow tasks since last warning");
+	_suppressed = 0;
+	LOG_WARNING(demangle(type.name())
+				<< "::task() for fd " << fd << " blocked the event loop for "
+				<< elapsed << "us (threshold " << _threshold_us << "us)");
+}
@@ -21,9 +21,10 @@ std::string async::generateErrorMsgFileIsDir(const std::string &path)
 	return (std::string("File ") + path + " is directory");
 }
 
-std::string async::generateErrorMsgTimeout(const int fd, const clock_t timeout)
+std::string async::generateErrorMsgTimeout(const int fd,
+											 const unsigned int timeout_ms)
 {
-	return (std::string("Timeout (") + toStr(timeout / (CLOCKS_PER_SEC / 1000))
+	return (std::string("Timeout (") + toStr(timeout_ms)
 			+ " ms) occured while reading from fd ")
 		   + toStr(fd);
 }
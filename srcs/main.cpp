@@ -1,17 +1,10 @@
 #include "ConfigDirective.hpp"
-#include "WebServer.hpp"
+#include "WorkerSupervisor.hpp"
 #include "async/SingleIOProcessor.hpp"
 #include "parseConfig.hpp"
-#include <csignal>
 #include <iostream>
 #include <unistd.h>
 
-void setWebServerTerminationFlag(int arg)
-{
-	(void)arg;
-	WebServer::setTerminationFlag();
-}
-
 void parseLogLevel(ConfigDirectivePtr root_config)
 {
 	const char *dir_name = "log_level";
@@ -75,26 +68,22 @@ int main(int argc, char **argv)
 	}
 
 	async::Logger &root_logger = async::Logger::getLogger("root");
-	signal(SIGINT, setWebServerTerminationFlag);
 
+	int rc = 0;
 	try
 	{
-		WebServer webserver((ConfigContext &)(*rootConfig));
-		while (true)
-		{
-			int rc = webserver.task();
-			if (rc != async::status::OK_AGAIN)
-				break;
-		}
+		WorkerSupervisor supervisor((ConfigContext &)(*rootConfig));
+		rc = supervisor.run();
 	}
 	catch (const std::exception &e)
 	{
 		root_logger << async::error
 					<< "Error while running WebServer: " << e.what();
+		rc = 1;
 	}
 
 	root_logger << async::info << "Server terminated\n";
 	async::Logger::blockingWriteAll();
 
-	return (0);
+	return (rc);
 }
@@ -0,0 +1,274 @@
+#include "utils/alloc_profile.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace ft
+{
+namespace alloc
+{
+static const char *subsystem_names[N_SUBSYSTEMS]
+	= {"other", "parser", "handler", "cgi", "logger", "io"};
+static volatile sig_atomic_t dump_requested = 0;
+
+#ifdef ALLOC_PROFILE
+// 모든 스레드가 함께 바꾸므로 원자적으로 더한다
+static Stats stats[N_SUBSYSTEMS];
+static Stats total;
+static unsigned long long n_requests = 0;
+static __thread int current = SUBSYSTEM_OTHER;
+static __thread unsigned long long thread_allocs = 0;
+static __thread unsigned long long thread_bytes = 0;
+
+// 크기와 하위 시스템을 블록 앞에 적는다. 정렬을 지키려고 두 칸을 쓴다
+static const size_t header_words = 2;
+
+static void raisePeak(long long &peak, long long live)
+{
+	long long prev = peak;
+	while (live > prev)
+	{
+		if (__sync_bool_compare_and_swap(&peak, prev, live))
+			return;
+		prev = peak;
+	}
+}
+
+static void record(Stats &counter, size_t size)
+{
+	__sync_fetch_and_add(&counter.allocs, 1);
+	__sync_fetch_and_add(&counter.bytes, size);
+	raisePeak(counter.peak_bytes,
+			  __sync_add_and_fetch(&counter.live_bytes, (long long)size));
+}
+
+static void release(Stats &counter, size_t size)
+{
+	__sync_fetch_and_add(&counter.frees, 1);
+	__sync_fetch_and_sub(&counter.live_bytes, (long long)size);
+}
+
+static void *allocate(size_t size)
+{
+	size_t *block = static_cast<size_t *>(
+		std::malloc(size + sizeof(size_t) * header_words));
+	if (block == NULL)
+		return (NULL);
+	block[0] = size;
+	block[1] = current;
+	record(stats[current], size);
+	record(total, size);
+	thread_allocs++;
+	thread_bytes += size;
+	return (block + header_words);
+}
+
+static void deallocate(void *ptr)
+{
+	if (ptr == NULL)
+		return;
+	size_t *block = static_cast<size_t *>(ptr) - header_words;
+	release(stats[block[1]], block[0]);
+	release(total, block[0]);
+	std::free(block);
+}
+
+Scope::Scope(int subsystem)
+	: _prev(current)
+{
+	current = subsystem;
+}
+
+Scope::~Scope()
+{
+	current = _prev;
+}
+
+bool enabled(void)
+{
+	return (true);
+}
+
+void countRequest(void)
+{
+	__sync_fetch_and_add(&n_requests, 1);
+}
+
+unsigned long long requestCount(void)
+{
+	return (n_requests);
+}
+
+// 다른 스레드가 바꾸는 중인 값이라 칸끼리 조금 어긋날 수 있다
+void snapshot(Stats (&out)[N_SUBSYSTEMS], Stats &out_total)
+{
+	std::memcpy(out, stats, sizeof(stats));
+	out_total = total;
+}
+
+void threadTotals(unsigned long long &allocs, unsigned long long &bytes)
+{
+	allocs = thread_allocs;
+	bytes = thread_bytes;
+}
+#else
+Scope::Scope(int subsystem)
+	: _prev(subsystem)
+{
+}
+
+Scope::~Scope()
+{
+}
+
+bool enabled(void)
+{
+	return (false);
+}
+
+void countRequest(void)
+{
+}
+
+unsigned long long requestCount(void)
+{
+	return (0);
+}
+
+void snapshot(Stats (&out)[N_SUBSYSTEMS], Stats &out_total)
+{
+	std::memset(out, 0, sizeof(out));
+	std::memset(&out_total, 0, sizeof(out_total));
+}
+
+void threadTotals(unsigned long long &allocs, unsigned long long &bytes)
+{
+	allocs = 0;
+	bytes = 0;
+}
+#endif
+
+const char *subsystemName(int subsystem)
+{
+	return (subsystem_names[subsystem]);
+}
+
+void requestDump(void)
+{
+	dump_requested = 1;
+}
+
+// 여러 이벤트 루프 스레드 중 하나만 true를 받는다
+bool takeDumpRequest(void)
+{
+	if (!dump_requested)
+		return (false);
+	return (__sync_bool_compare_and_swap(&dump_requested, 1, 0));
+}
+
+static void appendRow(std::string &out,
+					  const char *name,
+					  const Stats &stats,
+					  unsigned long long n_requests)
+{
+	char buf[160];
+	const double per_request
+		= n_requests ? static_cast<double>(stats.allocs) / n_requests : 0;
+	snprintf(buf,
+			 sizeof(buf),
+			 "\n%-8s %12llu %12llu %14llu %12lld %12lld %10.1f",
+			 name,
+			 stats.allocs,
+			 stats.frees,
+			 stats.bytes,
+			 stats.live_bytes,
+			 stats.peak_bytes,
+			 per_request);
+	out.append(buf);
+}
+
+// SIGUSR2를 받으면 로그로 남기는 표
+std::string report(void)
+{
+	if (!enabled())
+		return ("allocation profiling is not compiled in "
+				"(make re ALLOC_PROFILE=1)");
+
+	Stats by_subsystem[N_SUBSYSTEMS];
+	Stats sum;
+	const unsigned long long n_requests = requestCount();
+	snapshot(by_subsystem, sum);
+
+	char buf[128];
+	snprintf(buf,
+			 sizeof(buf),
+			 "heap allocations after %llu requests",
+			 n_requests);
+	std::string out(buf);
+	snprintf(buf,
+			 sizeof(buf),
+			 "\n%-8s %12s %12s %14s %12s %12s %10s",
+			 "",
+			 "allocs",
+			 "frees",
+			 "bytes",
+			 "live",
+			 "peak",
+			 "allocs/req");
+	out.append(buf);
+	for (int i = 0; i < N_SUBSYSTEMS; i++)
+		appendRow(out, subsystem_names[i], by_subsystem[i], n_requests);
+	appendRow(out, "total", sum, n_requests);
+	return (out);
+}
+} // namespace alloc
+} // namespace ft
+
+#ifdef ALLOC_PROFILE
+// new[]와 nothrow 버전도 모두 바꿔야 다른 쪽에서 받은 포인터를 잘못 풀지
+// 않는다
+void *operator new(std::size_t size) throw(std::bad_alloc)
+{
+	void *ptr = ft::alloc::allocate(size);
+	if (ptr == NULL)
+		throw(std::bad_alloc());
+	return (ptr);
+}
+
+void *operator new[](std::size_t size) throw(std::bad_alloc)
+{
+	return (operator new(size));
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) throw()
+{
+	return (ft::alloc::allocate(size));
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) throw()
+{
+	return (ft::alloc::allocate(size));
+}
+
+void operator delete(void *ptr) throw()
+{
+	ft::alloc::deallocate(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+	ft::alloc::deallocate(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) throw()
+{
+	ft::alloc::deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) throw()
+{
+	ft::alloc::deallocate(ptr);
+}
+#endif
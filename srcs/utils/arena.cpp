@@ -0,0 +1,183 @@
+#include "utils/arena.hpp"
+#include <new>
+
+namespace ft
+{
+const size_t Arena::_chunk_size = 4096;
+const size_t Arena::_align = 16;
+const size_t Arena::_header_size = 16; // Arena * 하나지만 정렬을 지킨다
+
+// 모든 이벤트 루프 스레드가 함께 바꾸므로 원자적으로 더한다
+static Arena::Stats stats;
+
+static size_t alignUp(size_t size, size_t align)
+{
+	return ((size + align - 1) & ~(align - 1));
+}
+
+static void raiseHighWater(long long used)
+{
+	long long prev = stats.high_water;
+	while (used > prev)
+	{
+		if (__sync_bool_compare_and_swap(&stats.high_water, prev, used))
+			return;
+		prev = stats.high_water;
+	}
+}
+
+Arena::Arena()
+	: _head(NULL)
+	, _current(NULL)
+	, _offset(0)
+	, _used(0)
+	, _live(0)
+	, _retired(false)
+{
+	__sync_fetch_and_add(&stats.arenas, 1);
+}
+
+Arena::~Arena()
+{
+	while (_head != NULL)
+	{
+		Chunk *next = _head->next;
+		__sync_fetch_and_sub(&stats.chunk_bytes, (long long)_head->size);
+		::operator delete(_head);
+		_head = next;
+	}
+	__sync_fetch_and_sub(&stats.arenas, 1);
+}
+
+Arena::Chunk *Arena::newChunk(void)
+{
+	Chunk *chunk = static_cast<Chunk *>(::operator new(_chunk_size));
+	chunk->next = NULL;
+	chunk->size = _chunk_size;
+	__sync_fetch_and_add(&stats.chunk_bytes, (long long)_chunk_size);
+	return (chunk);
+}
+
+bool Arena::idle(void) const
+{
+	return (_live == 0);
+}
+
+void *Arena::allocate(size_t size)
+{
+	const size_t total = alignUp(size + _header_size, _align);
+	if (total > _chunk_size / 2)
+	{
+		__sync_fetch_and_add(&stats.heap_fallbacks, 1);
+		return (allocateHeap(size));
+	}
+
+	const size_t begin = alignUp(sizeof(Chunk), _align);
+	if (_current == NULL)
+	{
+		_head = newChunk();
+		_current = _head;
+		_offset = begin;
+	}
+	else if (_offset + total > _current->size)
+	{
+		if (_current->next == NULL)
+			_current->next = newChunk();
+		_current = _current->next;
+		_offset = begin;
+	}
+	char *block = reinterpret_cast<char *>(_current) + _offset;
+	_offset += total;
+	_used += total;
+	_live++;
+	__sync_fetch_and_add(&stats.allocs, 1);
+	raiseHighWater(_used);
+
+	*reinterpret_cast<Arena **>(block) = this;
+	return (block + _header_size);
+}
+
+void *Arena::allocateHeap(size_t size)
+{
+	char *block = static_cast<char *>(::operator new(size + _header_size));
+	*reinterpret_cast<Arena **>(block) = NULL;
+	return (block + _header_size);
+}
+
+void Arena::deallocate(void *ptr)
+{
+	if (ptr == NULL)
+		return;
+	char *block = static_cast<char *>(ptr) - _header_size;
+	Arena *arena = *reinterpret_cast<Arena **>(block);
+	if (arena == NULL)
+		::operator delete(block);
+	else
+		arena->release();
+}
+
+void Arena::release(void)
+{
+	if (--_live > 0)
+		return;
+	if (_retired)
+		delete this;
+	else
+		rewind();
+}
+
+// 파이프라이닝으로 늘어난 청크는 돌려주고 첫 청크만 남긴다. 보통은 하나뿐이다
+void Arena::rewind(void)
+{
+	if (_head == NULL)
+		return;
+	Chunk *extra = _head->next;
+	while (extra != NULL)
+	{
+		Chunk *next = extra->next;
+		__sync_fetch_and_sub(&stats.chunk_bytes, (long long)extra->size);
+		::operator delete(extra);
+		extra = next;
+	}
+	_head->next = NULL;
+	_current = _head;
+	_offset = alignUp(sizeof(Chunk), _align);
+	_used = 0;
+	__sync_fetch_and_add(&stats.resets, 1);
+}
+
+void Arena::retire(void)
+{
+	_retired = true;
+	if (_live == 0)
+		delete this;
+}
+
+// 다른 스레드가 바꾸는 중인 값이라 칸끼리 조금 어긋날 수 있다
+void Arena::snapshot(Stats &out)
+{
+	out = stats;
+}
+
+void *ArenaObject::operator new(size_t size)
+{
+	return (Arena::allocateHeap(size));
+}
+
+void *ArenaObject::operator new(size_t size, Arena &arena)
+{
+	return (arena.allocate(size));
+}
+
+void ArenaObject::operator delete(void *ptr)
+{
+	Arena::deallocate(ptr);
+}
+
+// 생성자가 예외를 던지면 불린다
+void ArenaObject::operator delete(void *ptr, Arena &arena)
+{
+	(void)arena;
+	Arena::deallocate(ptr);
+}
+} // namespace ft
@@ -0,0 +1,18 @@
+#include "utils/time.hpp"
+#include <ctime>
+
+msec_t monotonicMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((msec_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+usec_t monotonicUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((usec_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
@@ -0,0 +1,217 @@
+#include "WorkerSupervisor.hpp"
+#include "parseConfig.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * usage: ./bench_accept_storm [connections] [port]
+ * 레포지토리 루트에서 실행. 연결을 한꺼번에 맺고 GET / 요청을 보내
+ * backlog 크기에 따라 성공한 응답 수와 모두 처리하는 데 걸린 시간을 출력한다.
+ */
+
+static const char *config_path = "/tmp/bench_accept_storm.conf";
+static int port = 18182;
+
+struct Client
+{
+	int fd;
+	bool sent;
+	bool done;
+	std::string buf;
+};
+
+static void writeConfig(int backlog_size)
+{
+	std::ofstream conf(config_path);
+	conf << "client_max_body_size 1024;\n"
+		 << "upload_store ./www/fortune/db;\n"
+		 << "timeout 10000;\n";
+	if (backlog_size > 0)
+		conf << "backlog_size " << backlog_size << ";\n";
+	conf << "server {\n"
+		 << "    listen " << port << ";\n"
+		 << "    location / {\n"
+		 << "        alias ./www/fortune/;\n"
+		 << "        index index.html;\n"
+		 << "    }\n"
+		 << "}\n";
+}
+
+static pid_t startServer(void)
+{
+	pid_t pid = fork();
+	if (pid != 0)
+		return (pid);
+	try
+	{
+		ConfigDirectivePtr root = parseConfig(config_path);
+		WorkerSupervisor supervisor((ConfigContext &)(*root));
+		supervisor.run();
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "server failed: " << e.what() << "\n";
+		_exit(1);
+	}
+	_exit(0);
+}
+
+static int connectNonBlocking(void)
+{
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return (-1);
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+		&& errno != EINPROGRESS)
+	{
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+static bool responseComplete(const std::string &buf)
+{
+	size_t header_end = buf.find("\r\n\r\n");
+	if (header_end == std::string::npos)
+		return (false);
+	size_t content_length = 0;
+	size_t pos = buf.find("Content-Length: ");
+	if (pos != std::string::npos && pos < header_end)
+		content_length = std::strtoul(buf.c_str() + pos + 16, NULL, 10);
+	return (buf.size() >= header_end + 4 + content_length);
+}
+
+static double elapsedMs(const struct timeval &begin)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return ((now.tv_sec - begin.tv_sec) * 1000.0
+			+ (now.tv_usec - begin.tv_usec) / 1000.0);
+}
+
+// 모든 연결을 동시에 열고 응답을 받은 연결 수를 돌려준다
+static int storm(int n_connections, double &elapsed)
+{
+	const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n"
+								"User-Agent: bench\r\n\r\n";
+	std::vector<Client> clients(n_connections);
+	struct timeval begin;
+	int n_ok = 0;
+	int n_open = 0;
+
+	gettimeofday(&begin, NULL);
+	for (int i = 0; i < n_connections; i++)
+	{
+		clients[i].fd = connectNonBlocking();
+		clients[i].sent = false;
+		clients[i].done = (clients[i].fd < 0);
+		if (!clients[i].done)
+			n_open++;
+	}
+	while (n_open > 0 && elapsedMs(begin) < 10000)
+	{
+		std::vector<struct pollfd> pfds;
+		std::vector<int> index;
+		for (int i = 0; i < n_connections; i++)
+		{
+			if (clients[i].done)
+				continue;
+			struct pollfd pfd;
+			pfd.fd = clients[i].fd;
+			pfd.events = clients[i].sent ? POLLIN : POLLOUT;
+			pfd.revents = 0;
+			pfds.push_back(pfd);
+			index.push_back(i);
+		}
+		if (poll(&pfds[0], pfds.size(), 100) < 0)
+			break;
+		for (size_t k = 0; k < pfds.size(); k++)
+		{
+			Client &client = clients[index[k]];
+			if (pfds[k].revents == 0)
+				continue;
+			bool failed = false;
+			if (!client.sent)
+			{
+				failed = (write(client.fd, request.c_str(), request.size())
+						  < 0);
+				client.sent = true;
+			}
+			else
+			{
+				char chunk[4096];
+				ssize_t n = read(client.fd, chunk, sizeof(chunk));
+				if (n > 0)
+					client.buf.append(chunk, n);
+				failed = (n <= 0);
+			}
+			if (failed || responseComplete(client.buf))
+			{
+				if (!failed)
+					n_ok++;
+				close(client.fd);
+				client.done = true;
+				n_open--;
+			}
+		}
+	}
+	for (int i = 0; i < n_connections; i++)
+		if (!clients[i].done)
+			close(clients[i].fd);
+	elapsed = elapsedMs(begin);
+	return (n_ok);
+}
+
+int main(int argc, char **argv)
+{
+	int n_connections = (argc > 1) ? std::atoi(argv[1]) : 512;
+	if (argc > 2)
+		port = std::atoi(argv[2]);
+	signal(SIGPIPE, SIG_IGN);
+
+	// 0은 backlog_size를 설정하지 않아 somaxconn을 쓰는 경우
+	const int backlogs[] = {8, 128, 0};
+	std::cout << "backlog\tok\tfailed\tms\n";
+	for (size_t i = 0; i < sizeof(backlogs) / sizeof(backlogs[0]); i++)
+	{
+		writeConfig(backlogs[i]);
+		pid_t server = startServer();
+		usleep(500000);
+
+		double elapsed;
+		int n_ok = storm(n_connections, elapsed);
+		kill(server, SIGINT);
+		waitpid(server, NULL, 0);
+
+		if (backlogs[i] > 0)
+			std::cout << backlogs[i];
+		else
+			std::cout << "default";
+		std::cout << "\t" << n_ok << "\t" << n_connections - n_ok << "\t"
+				  << static_cast<long>(elapsed) << std::endl;
+	}
+	std::remove(config_path);
+	return (0);
+}
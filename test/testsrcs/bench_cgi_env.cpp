@@ -0,0 +1,108 @@
+#include "CGI/Request.hpp"
+#include "CGI/const_values.hpp"
+#include "utils/string.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+
+/*
+ * usage: ./bench_cgi_env [iterations] [number of headers]
+ * 헤더가 많은 요청에서 CGI::Request 생성과 getEnv()에 걸리는 시간을
+ * 변수마다 문자열을 복제하던 이전 방식과 비교한다.
+ */
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0);
+}
+
+// 이전 구현: 빈 값으로 맵을 채운 뒤 덮어쓰고, 변수마다 new로 복제한다
+static char **legacyEnv(const HTTP::Request &http_req,
+						const std::string &resource_path)
+{
+	std::map<std::string, std::string> meta;
+	for (size_t i = 0; i < CGI::META_VARIABLES.size(); i++)
+		meta.insert(std::make_pair(CGI::META_VARIABLES[i], ""));
+	meta["CONTENT_LENGTH"] = toStr<size_t>(http_req.getBody().size());
+	meta["GATEWAY_INTERFACE"] = "CGI/1.1";
+	meta["PATH_INFO"] = http_req.getURIPath();
+	meta["PATH_TRANSLATED"] = resource_path;
+	meta["QUERY_STRING"] = http_req.getQueryString();
+	meta["REQUEST_METHOD"] = http_req.getMethodString();
+	meta["SERVER_PROTOCOL"] = "HTTP/1.1";
+	meta["SERVER_NAME"] = http_req.getHeaderValue("Host", 0);
+	meta["SERVER_PORT"] = "80";
+
+	const Header &header = http_req.getHeader();
+	for (Header::const_iterator it = header.begin(); it != header.end(); it++)
+	{
+		std::string name = it->first;
+		std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+		std::replace(name.begin(), name.end(), '-', '_');
+		std::string value;
+		for (size_t i = 0; i < it->second.size(); i++)
+		{
+			value += it->second[i];
+			if (i + 1 != it->second.size())
+				value += ", ";
+		}
+		if (meta.find("HTTP_" + name) == meta.end())
+			meta.insert(std::make_pair("HTTP_" + name, ""));
+		meta["HTTP_" + name] = value;
+	}
+
+	char **env = new char *[meta.size() + 1];
+	size_t i = 0;
+	for (std::map<std::string, std::string>::iterator it = meta.begin();
+		 it != meta.end();
+		 it++)
+		env[i++] = duplicateStr(it->first + "=" + it->second);
+	env[i] = NULL;
+	return (env);
+}
+
+int main(int argc, char **argv)
+{
+	const int iterations = (argc > 1) ? std::atoi(argv[1]) : 100000;
+	const int n_headers = (argc > 2) ? std::atoi(argv[2]) : 50;
+	const std::string resource_path = "./www/cgi_script/bench.cgi";
+	std::string buffer = "GET /bench.cgi?name=bench&lang=ko HTTP/1.1\r\n"
+						 "Host: localhost:8080\r\n";
+	for (int i = 0; i < n_headers - 1; i++)
+		buffer += "X-Bench-Header-" + toStr(i) + ": value-" + toStr(i)
+				  + " with some padding text\r\n";
+	buffer += "\r\n";
+
+	async::Logger::setLogLevel("ERROR");
+	HTTP::Request http_request;
+	http_request.parse(buffer);
+
+	size_t checksum = 0;
+	double begin = now();
+	for (int i = 0; i < iterations; i++)
+	{
+		char **env = legacyEnv(http_request, resource_path);
+		checksum += env[0][0];
+		for (size_t j = 0; env[j]; j++)
+			delete[] env[j];
+		delete[] env;
+	}
+	const double legacy_us = (now() - begin) * 1000.0 / iterations;
+
+	begin = now();
+	for (int i = 0; i < iterations; i++)
+	{
+		CGI::Request cgi_request(http_request, resource_path);
+		checksum += cgi_request.getEnv()[0][0];
+	}
+	const double arena_us = (now() - begin) * 1000.0 / iterations;
+
+	std::cout << n_headers << " headers, " << iterations << " iterations\n"
+			  << "per-variable new:\t" << legacy_us << " us/request\n"
+			  << "single arena:\t\t" << arena_us << " us/request\n"
+			  << "(checksum " << checksum << ")" << std::endl;
+	return (0);
+}
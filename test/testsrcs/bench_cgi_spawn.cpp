@@ -0,0 +1,102 @@
+#include "CGI/RequestHandler.hpp"
+#include "async/IOProcessor.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * usage: ./bench_cgi_spawn [iterations] [max RSS in MiB]
+ * 레포지토리 루트에서 실행. 서버 힙을 흉내 낸 메모리를 채워가며
+ * fork+execve와 RequestHandlerPipe(posix_spawn)의 CGI 요청 지연을 비교한다.
+ */
+
+static const char *script_path = "./www/cgi_script/fortune_cookie.fcgi";
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0);
+}
+
+static double runFork(int iterations)
+{
+	char *argv[] = {const_cast<char *>(script_path), NULL};
+	char *envp[] = {const_cast<char *>("REQUEST_METHOD=GET"),
+					const_cast<char *>("QUERY_STRING=name=bench"),
+					NULL};
+	double begin = now();
+	for (int i = 0; i < iterations; i++)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			int null_fd = open("/dev/null", O_RDWR);
+			dup2(null_fd, STDIN_FILENO);
+			dup2(null_fd, STDOUT_FILENO);
+			execve(script_path, argv, envp);
+			_exit(2);
+		}
+		waitpid(pid, NULL, 0);
+	}
+	return ((now() - begin) / iterations);
+}
+
+static double runHandler(int iterations)
+{
+	std::string buffer = "GET /bench.fcgi?name=bench HTTP/1.1\r\n"
+						 "Host: localhost\r\n"
+						 "\r\n";
+	HTTP::Request http_request;
+	http_request.parse(buffer);
+	CGI::Request cgi_request(http_request, script_path);
+
+	double begin = now();
+	for (int i = 0; i < iterations; i++)
+	{
+		CGI::RequestHandlerPipe handler(cgi_request, script_path, 10000);
+		while (handler.task() != CGI::RequestHandler::CGI_RESPONSE_STATUS_OK)
+			async::IOProcessor::doAllTasks();
+	}
+	return ((now() - begin) / iterations);
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = (argc > 1) ? std::atoi(argv[1]) : 50;
+	size_t max_mib = (argc > 2) ? std::atoi(argv[2]) : 1024;
+
+	if (access(script_path, X_OK) != 0)
+	{
+		std::cerr << script_path << " not found; run make " << script_path + 2
+				  << " first\n";
+		return (1);
+	}
+	async::Logger::setLogLevel("ERROR");
+	std::vector<char *> ballast;
+	size_t rss_mib = 0;
+	std::cout << "RSS(MiB)\tfork+execve(ms)\tposix_spawn(ms)\n";
+	for (size_t target = 0; target <= max_mib;
+		 target = target ? target * 4 : 16)
+	{
+		// 페이지를 실제로 건드려야 fork가 복사할 페이지 테이블이 생긴다
+		for (; rss_mib < target; rss_mib++)
+		{
+			char *chunk = new char[1024 * 1024];
+			std::memset(chunk, 1, 1024 * 1024);
+			ballast.push_back(chunk);
+		}
+		double fork_ms = runFork(iterations);
+		double spawn_ms = runHandler(iterations);
+		std::cout << rss_mib << "\t\t" << fork_ms << "\t\t" << spawn_ms
+				  << std::endl;
+	}
+	for (size_t i = 0; i < ballast.size(); i++)
+		delete[] ballast[i];
+	return (0);
+}
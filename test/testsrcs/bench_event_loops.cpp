@@ -0,0 +1,182 @@
+#include "WorkerSupervisor.hpp"
+#include "parseConfig.hpp"
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * usage: ./bench_event_loops [seconds per run] [connections] [port]
+ * 레포지토리 루트에서 실행. worker_threads를 1부터 16까지 늘려가며
+ * keep-alive GET / 요청을 반복해 초당 처리량을 출력한다.
+ */
+
+static const char *config_path = "/tmp/bench_event_loops.conf";
+static volatile bool stop_clients = false;
+static int port = 18181;
+
+static void writeConfig(int n_threads)
+{
+	std::ofstream conf(config_path);
+	conf << "client_max_body_size 1024;\n"
+		 << "upload_store ./www/fortune/db;\n"
+		 << "timeout 10000;\n"
+		 << "backlog_size 128;\n"
+		 << "worker_threads " << n_threads << ";\n"
+		 << "worker_balance least_conn;\n"
+		 << "server {\n"
+		 << "    listen " << port << ";\n"
+		 << "    location / {\n"
+		 << "        alias ./www/fortune/;\n"
+		 << "        index index.html;\n"
+		 << "    }\n"
+		 << "}\n";
+}
+
+static pid_t startServer(void)
+{
+	pid_t pid = fork();
+	if (pid != 0)
+		return (pid);
+	try
+	{
+		ConfigDirectivePtr root = parseConfig(config_path);
+		WorkerSupervisor supervisor((ConfigContext &)(*root));
+		supervisor.run();
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "server failed: " << e.what() << "\n";
+		_exit(1);
+	}
+	_exit(0);
+}
+
+static int connectServer(void)
+{
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+// 응답 하나를 끝까지 읽으면 true
+static bool readResponse(int fd, std::string &buf)
+{
+	char chunk[4096];
+	size_t header_end;
+	while ((header_end = buf.find("\r\n\r\n")) == std::string::npos)
+	{
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n <= 0)
+			return (false);
+		buf.append(chunk, n);
+	}
+	size_t content_length = 0;
+	size_t pos = buf.find("Content-Length: ");
+	if (pos != std::string::npos && pos < header_end)
+		content_length = std::strtoul(buf.c_str() + pos + 16, NULL, 10);
+	size_t total = header_end + 4 + content_length;
+	while (buf.size() < total)
+	{
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n <= 0)
+			return (false);
+		buf.append(chunk, n);
+	}
+	buf.erase(0, total);
+	return (true);
+}
+
+static void *runClient(void *arg)
+{
+	size_t &n_done = *static_cast<size_t *>(arg);
+	const std::string request
+		= "GET / HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench\r\n\r\n";
+	int fd = -1;
+	std::string buf;
+
+	while (!stop_clients)
+	{
+		if (fd < 0)
+		{
+			fd = connectServer();
+			buf.clear();
+			if (fd < 0)
+				continue;
+		}
+		if (write(fd, request.c_str(), request.size()) < 0
+			|| !readResponse(fd, buf))
+		{
+			close(fd);
+			fd = -1;
+			continue;
+		}
+		n_done++;
+	}
+	if (fd >= 0)
+		close(fd);
+	return (NULL);
+}
+
+static double runOnce(int n_threads, int seconds, int n_connections)
+{
+	writeConfig(n_threads);
+	pid_t server = startServer();
+	usleep(500000);
+
+	std::vector<pthread_t> clients(n_connections);
+	std::vector<size_t> counts(n_connections, 0);
+	stop_clients = false;
+	for (int i = 0; i < n_connections; i++)
+		pthread_create(&clients[i], NULL, runClient, &counts[i]);
+	sleep(seconds);
+	stop_clients = true;
+	kill(server, SIGINT);
+	size_t total = 0;
+	for (int i = 0; i < n_connections; i++)
+	{
+		pthread_join(clients[i], NULL);
+		total += counts[i];
+	}
+	waitpid(server, NULL, 0);
+	return (static_cast<double>(total) / seconds);
+}
+
+int main(int argc, char **argv)
+{
+	int seconds = (argc > 1) ? std::atoi(argv[1]) : 3;
+	int n_connections = (argc > 2) ? std::atoi(argv[2]) : 64;
+	if (argc > 3)
+		port = std::atoi(argv[3]);
+	signal(SIGPIPE, SIG_IGN);
+
+	std::cout << "threads\treq/s\n";
+	for (int n_threads = 1; n_threads <= 16; n_threads *= 2)
+	{
+		double rps = runOnce(n_threads, seconds, n_connections);
+		std::cout << n_threads << "\t" << static_cast<long>(rps) << std::endl;
+	}
+	std::remove(config_path);
+	return (0);
+}
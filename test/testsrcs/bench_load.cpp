@@ -0,0 +1,717 @@
+#include "WorkerSupervisor.hpp"
+#include "parseConfig.hpp"
+#include "utils/string.hpp"
+#include "utils/time.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * usage: ./bench_load [scenarios] [seconds] [connections] [results file]
+ *        ./bench_load compare <results file> <base commit> <commit>
+ * 레포지토리 루트에서 실행 (make bench). 시나리오마다 configs/bench.conf로
+ * 서버를 새로 띄우고 연결 수만큼 클라이언트 스레드가 요청을 반복한다.
+ * 0.5초 예열한 뒤부터 재서 초당 요청 수, 지연 시간 p50/p99/p99.9, 서버
+ * 프로세스 RSS 합의 최댓값을 출력하고, 커밋 해시와 함께 결과 파일에 JSON
+ * 한 줄씩 덧붙인다. compare는 두 커밋의 마지막 결과를 시나리오별로 비교한다.
+ *
+ * 시나리오 (쉼표로 여러 개, all이면 전부)
+ *   keepalive  한 연결에서 GET /를 반복
+ *   close      요청마다 새로 연결 (Connection: close)
+ *   pipeline   GET / 8개를 한 번에 보내고 응답 8개를 읽는다
+ *   largefile  8MiB 파일 GET
+ *   upload     64KiB 본문 PUT
+ *   cgi        CGI 실행 (www/cgi_script/fortune.teapot)
+ */
+
+static const char *config_path = "configs/bench.conf";
+static const char *bench_dir = "/tmp/webserv_bench";
+static const size_t large_file_size = 8 * 1024 * 1024;
+static const size_t upload_size = 64 * 1024;
+static const int pipeline_depth = 8;
+static const usec_t warmup_us = 500 * 1000;
+
+static volatile bool stop_clients = false;
+static volatile bool measuring = false;
+static int port = 18180;
+
+struct Scenario
+{
+	const char *name;
+	bool keep_alive;
+	int depth; // 한 번에 보내는 요청 수
+	std::string (*request)(int client_id);
+};
+
+static std::string getRoot(int client_id)
+{
+	(void)client_id;
+	return ("GET / HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench\r\n\r\n");
+}
+
+static std::string getRootClose(int client_id)
+{
+	(void)client_id;
+	return ("GET / HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench\r\n"
+			"Connection: close\r\n\r\n");
+}
+
+static std::string getLargeFile(int client_id)
+{
+	(void)client_id;
+	return ("GET /large/large.bin HTTP/1.1\r\nHost: localhost\r\n"
+			"User-Agent: bench\r\n\r\n");
+}
+
+static std::string putUpload(int client_id)
+{
+	return ("PUT /upload/client" + toStr(client_id)
+			+ ".bin HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench\r\n"
+			  "Content-Type: application/octet-stream\r\nContent-Length: "
+			+ toStr(upload_size) + "\r\n\r\n" + std::string(upload_size, 'x'));
+}
+
+static std::string getCGI(int client_id)
+{
+	return ("GET /bench.teapot?name=client" + toStr(client_id)
+			+ " HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench\r\n\r\n");
+}
+
+static const Scenario scenarios[] = {
+	{"keepalive", true, 1, getRoot},
+	{"close", false, 1, getRootClose},
+	{"pipeline", true, pipeline_depth, getRoot},
+	{"largefile", true, 1, getLargeFile},
+	{"upload", true, 1, putUpload},
+	{"cgi", true, 1, getCGI},
+};
+static const size_t n_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+struct Client
+{
+	const Scenario *scenario;
+	int id;
+	pthread_t thread;
+	std::vector<usec_t> latencies; // 성공한 요청만
+	size_t n_errors;
+	unsigned long long n_bytes;
+};
+
+struct Result
+{
+	std::string scenario;
+	double seconds;
+	size_t n_requests;
+	size_t n_errors;
+	unsigned long long n_bytes;
+	usec_t p50;
+	usec_t p99;
+	usec_t p999;
+	usec_t max;
+	long rss_kb;
+};
+
+// ------------------------------- 서버 준비 -------------------------------- //
+
+static void prepareFiles(void)
+{
+	const std::string upload_dir = std::string(bench_dir) + "/upload";
+	mkdir(bench_dir, 0755);
+	mkdir(upload_dir.c_str(), 0755);
+
+	const std::string large_path = std::string(bench_dir) + "/large.bin";
+	struct stat st;
+	if (stat(large_path.c_str(), &st) == 0
+		&& static_cast<size_t>(st.st_size) == large_file_size)
+		return;
+	std::ofstream large(large_path.c_str(), std::ios::binary);
+	const std::string block(64 * 1024, 'L');
+	for (size_t written = 0; written < large_file_size; written += block.size())
+		large.write(block.c_str(), block.size());
+}
+
+// 설정의 첫 server가 듣는 포트로 요청을 보낸다
+static void readPort(void)
+{
+	ConfigDirectivePtr root = parseConfig(config_path);
+	const ConfigContext &root_context = (const ConfigContext &)(*root);
+	const ConfigContext &server = (const ConfigContext &)(
+		root_context.getNthDirectiveByName("server", 0));
+	port = std::atoi(server.getNthDirectiveByName("listen", 0)
+						 .parameter(0)
+						 .c_str());
+}
+
+static int connectServer(void)
+{
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+static pid_t startServer(void)
+{
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		try
+		{
+			ConfigDirectivePtr root = parseConfig(config_path);
+			WorkerSupervisor supervisor((ConfigContext &)(*root));
+			supervisor.run();
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "server failed: " << e.what() << "\n";
+			_exit(1);
+		}
+		_exit(0);
+	}
+	for (int i = 0; i < 100; i++)
+	{
+		usleep(50000);
+		int fd = connectServer();
+		if (fd >= 0)
+		{
+			close(fd);
+			return (pid);
+		}
+	}
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	throw(std::runtime_error("server did not start listening"));
+}
+
+static void stopServer(pid_t pid)
+{
+	kill(pid, SIGINT);
+	waitpid(pid, NULL, 0);
+}
+
+// 워커 프로세스까지 포함한 서버 RSS의 합 (KiB). ps는 Linux와 macOS 모두 KiB
+static long serverRSS(pid_t server)
+{
+	FILE *ps = popen("ps -A -o pid= -o ppid= -o rss=", "r");
+	if (ps == NULL)
+		return (0);
+	std::map<long, long> parent;
+	std::map<long, long> rss;
+	long pid, ppid, kb;
+	while (fscanf(ps, "%ld %ld %ld", &pid, &ppid, &kb) == 3)
+	{
+		parent[pid] = ppid;
+		rss[pid] = kb;
+	}
+	pclose(ps);
+
+	long total = 0;
+	for (std::map<long, long>::iterator it = rss.begin(); it != rss.end();
+		 it++)
+	{
+		for (long p = it->first; p > 1; p = parent[p])
+		{
+			if (p == server)
+			{
+				total += it->second;
+				break;
+			}
+		}
+	}
+	return (total);
+}
+
+// ------------------------------- 클라이언트 ------------------------------- //
+
+static bool fill(int fd, std::string &buf)
+{
+	char chunk[65536];
+	ssize_t n = read(fd, chunk, sizeof(chunk));
+	if (n <= 0)
+		return (false);
+	buf.append(chunk, n);
+	return (true);
+}
+
+// 버퍼 앞에서 n바이트를 버린다. 모자라면 읽으면서 버린다
+static bool consume(int fd, std::string &buf, size_t n)
+{
+	while (buf.size() < n)
+	{
+		n -= buf.size();
+		buf.clear();
+		if (!fill(fd, buf))
+			return (false);
+	}
+	buf.erase(0, n);
+	return (true);
+}
+
+static bool consumeLine(int fd, std::string &buf, std::string &line)
+{
+	size_t eol;
+	while ((eol = buf.find("\r\n")) == std::string::npos)
+		if (!fill(fd, buf))
+			return (false);
+	line = buf.substr(0, eol);
+	buf.erase(0, eol + 2);
+	return (true);
+}
+
+static bool consumeChunked(int fd, std::string &buf, size_t &n_bytes)
+{
+	std::string line;
+	while (true)
+	{
+		if (!consumeLine(fd, buf, line))
+			return (false);
+		const size_t size = std::strtoul(line.c_str(), NULL, 16);
+		if (size == 0)
+			break;
+		if (!consume(fd, buf, size + 2))
+			return (false);
+		n_bytes += size;
+	}
+	do // trailer와 마지막 빈 줄
+	{
+		if (!consumeLine(fd, buf, line))
+			return (false);
+	} while (!line.empty());
+	return (true);
+}
+
+// 응답 하나를 끝까지 읽는다. 본문 길이를 알 수 없으면 연결이 닫힐 때까지
+static bool readResponse(int fd,
+						 std::string &buf,
+						 int &status,
+						 size_t &n_bytes,
+						 bool &closed)
+{
+	size_t header_end;
+	while ((header_end = buf.find("\r\n\r\n")) == std::string::npos)
+		if (!fill(fd, buf))
+			return (false);
+	std::string head = buf.substr(0, header_end + 2);
+	buf.erase(0, header_end + 4);
+	for (size_t i = 0; i < head.size(); i++)
+		head[i] = std::tolower(head[i]);
+
+	status = std::atoi(head.c_str() + 9);
+	closed = (head.find("\r\nconnection: close\r\n") != std::string::npos);
+	n_bytes = 0;
+	size_t pos = head.find("\r\ncontent-length:");
+	if (pos != std::string::npos)
+	{
+		n_bytes = std::strtoul(head.c_str() + pos + 17, NULL, 10);
+		return (consume(fd, buf, n_bytes));
+	}
+	if (head.find("\r\ntransfer-encoding: chunked\r\n") != std::string::npos)
+		return (consumeChunked(fd, buf, n_bytes));
+	closed = true;
+	while (fill(fd, buf))
+		;
+	n_bytes = buf.size();
+	buf.clear();
+	return (true);
+}
+
+static bool writeAll(int fd, const std::string &data)
+{
+	size_t written = 0;
+	while (written < data.size())
+	{
+		ssize_t n = write(fd, data.c_str() + written, data.size() - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (false);
+		written += n;
+	}
+	return (true);
+}
+
+static void *runClient(void *arg)
+{
+	Client &client = *static_cast<Client *>(arg);
+	const Scenario &scenario = *client.scenario;
+	std::string batch;
+	std::string buf;
+	int fd = -1;
+
+	for (int i = 0; i < scenario.depth; i++)
+		batch += scenario.request(client.id);
+	while (!stop_clients)
+	{
+		if (fd < 0)
+		{
+			fd = connectServer();
+			buf.clear();
+			if (fd < 0)
+			{
+				if (measuring)
+					client.n_errors++;
+				usleep(1000);
+				continue;
+			}
+		}
+		const bool counted = measuring;
+		const usec_t sent_at = monotonicUs();
+		bool reuse = scenario.keep_alive;
+		if (!writeAll(fd, batch))
+		{
+			if (counted)
+				client.n_errors += scenario.depth;
+			close(fd);
+			fd = -1;
+			continue;
+		}
+		for (int i = 0; i < scenario.depth; i++)
+		{
+			int status;
+			size_t n_bytes;
+			bool closed;
+			if (!readResponse(fd, buf, status, n_bytes, closed))
+			{
+				if (counted)
+					client.n_errors += scenario.depth - i;
+				reuse = false;
+				break;
+			}
+			if (closed)
+				reuse = false;
+			if (!counted)
+				continue;
+			if (status < 200 || status >= 400)
+				client.n_errors++;
+			else
+				client.latencies.push_back(monotonicUs() - sent_at);
+			client.n_bytes += n_bytes;
+		}
+		if (!reuse)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	if (fd >= 0)
+		close(fd);
+	return (NULL);
+}
+
+// --------------------------------- 측정 ---------------------------------- //
+
+// nearest-rank 백분위수
+static usec_t percentile(const std::vector<usec_t> &sorted, double q)
+{
+	if (sorted.empty())
+		return (0);
+	size_t rank = static_cast<size_t>(q * sorted.size() + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	if (rank > sorted.size())
+		rank = sorted.size();
+	return (sorted[rank - 1]);
+}
+
+static Result runScenario(const Scenario &scenario,
+						  int seconds,
+						  int n_connections)
+{
+	pid_t server = startServer();
+	std::vector<Client> clients(n_connections);
+
+	stop_clients = false;
+	measuring = false;
+	for (int i = 0; i < n_connections; i++)
+	{
+		clients[i].scenario = &scenario;
+		clients[i].id = i;
+		clients[i].n_errors = 0;
+		clients[i].n_bytes = 0;
+		pthread_create(&clients[i].thread, NULL, runClient, &clients[i]);
+	}
+	usleep(warmup_us);
+
+	Result result;
+	result.rss_kb = 0;
+	measuring = true;
+	const usec_t started_at = monotonicUs();
+	const usec_t end_at = started_at + seconds * 1000000ULL;
+	while (monotonicUs() < end_at)
+	{
+		result.rss_kb = std::max(result.rss_kb, serverRSS(server));
+		usleep(250000);
+	}
+	measuring = false;
+	const usec_t stopped_at = monotonicUs();
+	stop_clients = true;
+
+	std::vector<usec_t> latencies;
+	result.scenario = scenario.name;
+	result.n_errors = 0;
+	result.n_bytes = 0;
+	for (int i = 0; i < n_connections; i++)
+	{
+		pthread_join(clients[i].thread, NULL);
+		latencies.insert(latencies.end(),
+						 clients[i].latencies.begin(),
+						 clients[i].latencies.end());
+		result.n_errors += clients[i].n_errors;
+		result.n_bytes += clients[i].n_bytes;
+	}
+	stopServer(server);
+
+	std::sort(latencies.begin(), latencies.end());
+	result.seconds = (stopped_at - started_at) / 1e6;
+	result.n_requests = latencies.size();
+	result.p50 = percentile(latencies, 0.50);
+	result.p99 = percentile(latencies, 0.99);
+	result.p999 = percentile(latencies, 0.999);
+	result.max = latencies.empty() ? 0 : latencies.back();
+	return (result);
+}
+
+// ------------------------------- 결과 기록 -------------------------------- //
+
+static std::string runCommand(const char *command)
+{
+	FILE *pipe = popen(command, "r");
+	std::string output;
+	char buf[256];
+	if (pipe == NULL)
+		return (output);
+	while (fgets(buf, sizeof(buf), pipe))
+		output += buf;
+	pclose(pipe);
+	while (!output.empty() && std::isspace(output[output.size() - 1]))
+		output.erase(output.size() - 1);
+	return (output);
+}
+
+// 커밋하지 않은 변경이 있으면 -dirty를 붙인다
+static std::string currentCommit(void)
+{
+	std::string commit = runCommand("git rev-parse --short HEAD 2>/dev/null");
+	if (commit.empty())
+		return ("unknown");
+	if (!runCommand("git status --porcelain --untracked-files=no 2>/dev/null")
+			 .empty())
+		commit += "-dirty";
+	return (commit);
+}
+
+static std::string utcNow(void)
+{
+	char buf[32];
+	time_t now = time(NULL);
+	struct tm tstruct;
+	gmtime_r(&now, &tstruct);
+	strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tstruct);
+	return (buf);
+}
+
+static void appendResult(const std::string &path,
+						 const std::string &commit,
+						 const std::string &date,
+						 int n_connections,
+						 const Result &result)
+{
+	std::ofstream out(path.c_str(), std::ios::app);
+	out << std::fixed << std::setprecision(1) << "{\"commit\":\"" << commit
+		<< "\",\"date\":\"" << date << "\",\"config\":\"" << config_path
+		<< "\",\"cpus\":" << sysconf(_SC_NPROCESSORS_ONLN)
+		<< ",\"scenario\":\"" << result.scenario
+		<< "\",\"connections\":" << n_connections
+		<< ",\"seconds\":" << result.seconds
+		<< ",\"requests\":" << result.n_requests
+		<< ",\"errors\":" << result.n_errors << ",\"bytes\":" << result.n_bytes
+		<< ",\"rps\":" << result.n_requests / result.seconds
+		<< ",\"p50_us\":" << result.p50 << ",\"p99_us\":" << result.p99
+		<< ",\"p999_us\":" << result.p999 << ",\"max_us\":" << result.max
+		<< ",\"rss_kb\":" << result.rss_kb << "}\n";
+}
+
+static void printResult(const Result &result)
+{
+	std::cout << std::left << std::setw(10) << result.scenario << std::right
+			  << std::fixed << std::setprecision(0) << std::setw(10)
+			  << result.n_requests / result.seconds << std::setw(9)
+			  << result.n_errors << std::setw(10) << result.p50
+			  << std::setw(10) << result.p99 << std::setw(10) << result.p999
+			  << std::setw(10) << result.rss_kb << std::endl;
+}
+
+// ---------------------------------- 비교 ---------------------------------- //
+
+// 이 프로그램이 쓴 줄에서 값 하나를 꺼낸다
+static std::string jsonField(const std::string &line, const std::string &key)
+{
+	const std::string pattern = "\"" + key + "\":";
+	size_t pos = line.find(pattern);
+	if (pos == std::string::npos)
+		return ("");
+	pos += pattern.size();
+	if (line[pos] == '"')
+		return (line.substr(pos + 1, line.find('"', pos + 1) - pos - 1));
+	return (line.substr(pos, line.find_first_of(",}", pos) - pos));
+}
+
+static std::string change(double base, double value)
+{
+	if (base == 0)
+		return ("");
+	std::ostringstream ss;
+	ss << std::showpos << std::fixed << std::setprecision(1)
+	   << (value - base) / base * 100 << "%";
+	return (ss.str());
+}
+
+// 두 커밋의 시나리오별 마지막 결과를 비교한다
+static int compare(const std::string &path,
+				   const std::string &base,
+				   const std::string &head)
+{
+	std::ifstream in(path.c_str());
+	std::map<std::string, std::string> base_lines;
+	std::map<std::string, std::string> head_lines;
+	std::string line;
+
+	if (!in)
+	{
+		std::cerr << "cannot open " << path << "\n";
+		return (1);
+	}
+	while (std::getline(in, line))
+	{
+		const std::string commit = jsonField(line, "commit");
+		if (commit == base)
+			base_lines[jsonField(line, "scenario")] = line;
+		if (commit == head)
+			head_lines[jsonField(line, "scenario")] = line;
+	}
+
+	std::cout << std::left << std::setw(10) << "scenario" << std::right
+			  << std::setw(12) << "req/s" << std::setw(10) << "change"
+			  << std::setw(12) << "p99(us)" << std::setw(10) << "change"
+			  << "\n";
+	for (std::map<std::string, std::string>::iterator it = head_lines.begin();
+		 it != head_lines.end();
+		 it++)
+	{
+		if (!base_lines.count(it->first))
+			continue;
+		const std::string &a = base_lines[it->first];
+		const std::string &b = it->second;
+		const double rps = std::atof(jsonField(b, "rps").c_str());
+		const double p99 = std::atof(jsonField(b, "p99_us").c_str());
+		std::cout << std::left << std::setw(10) << it->first << std::right
+				  << std::fixed << std::setprecision(0) << std::setw(12) << rps
+				  << std::setw(10)
+				  << change(std::atof(jsonField(a, "rps").c_str()), rps)
+				  << std::setw(12) << p99 << std::setw(10)
+				  << change(std::atof(jsonField(a, "p99_us").c_str()), p99)
+				  << "\n";
+	}
+	return (0);
+}
+
+// ---------------------------------- main ---------------------------------- //
+
+static std::vector<const Scenario *> selectScenarios(const std::string &list)
+{
+	std::vector<const Scenario *> selected;
+	std::stringstream ss(list);
+	std::string name;
+
+	while (std::getline(ss, name, ','))
+	{
+		bool found = false;
+		for (size_t i = 0; i < n_scenarios; i++)
+		{
+			if (name == "all" || name == scenarios[i].name)
+			{
+				selected.push_back(&scenarios[i]);
+				found = true;
+			}
+		}
+		if (!found)
+			throw(std::runtime_error("unknown scenario " + name));
+	}
+	return (selected);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && std::string(argv[1]) == "compare")
+	{
+		if (argc != 5)
+		{
+			std::cerr << "usage: " << argv[0]
+					  << " compare <results file> <base commit> <commit>\n";
+			return (1);
+		}
+		return (compare(argv[2], argv[3], argv[4]));
+	}
+
+	const std::string list = (argc > 1) ? argv[1] : "all";
+	const int seconds = (argc > 2) ? std::atoi(argv[2]) : 5;
+	const int n_connections = (argc > 3) ? std::atoi(argv[3]) : 32;
+	const std::string results_path = (argc > 4) ? argv[4] : "";
+	signal(SIGPIPE, SIG_IGN);
+
+	try
+	{
+		const std::vector<const Scenario *> selected = selectScenarios(list);
+		const std::string commit = currentCommit();
+		const std::string date = utcNow();
+
+		readPort();
+		prepareFiles();
+		std::cout << "commit " << commit << ", " << n_connections
+				  << " connections, " << seconds << "s per scenario\n";
+		std::cout << "scenario       req/s   errors   p50(us)   p99(us) "
+					 "p99.9(us)  rss(KiB)\n";
+		for (size_t i = 0; i < selected.size(); i++)
+		{
+			const Result result
+				= runScenario(*selected[i], seconds, n_connections);
+			printResult(result);
+			if (!results_path.empty())
+				appendResult(
+					results_path, commit, date, n_connections, result);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << e.what() << "\n";
+		return (1);
+	}
+	return (0);
+}
@@ -0,0 +1,73 @@
+#include "async/Logger.hpp"
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <pthread.h>
+#include <ctime>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * usage: ./bench_logger [messages per thread] [number of threads]
+ * 여러 스레드가 동시에 로그를 남길 때 호출한 스레드가 쓰는 CPU 시간을 잰다.
+ * 기록 스레드가 쓰는 시간은 빠진다. 출력은 /dev/null로 보내고, 링이 가득
+ * 차서 버려진 레코드 수를 함께 센다.
+ */
+
+static int g_messages;
+
+static double threadCPUTime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void *run(void *arg)
+{
+	async::Logger &_logger = async::Logger::getLogger("bench");
+	const long id = reinterpret_cast<long>(arg);
+	double *elapsed = new double;
+
+	const double begin = threadCPUTime();
+	for (int i = 0; i < g_messages; i++)
+		LOG_INFO("thread " << id << " handled request " << i << " in "
+						   << 12u << "ms, status " << 200);
+	async::Logger::flush();
+	*elapsed = threadCPUTime() - begin;
+	return (elapsed);
+}
+
+int main(int argc, char **argv)
+{
+	g_messages = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+	const int n_threads = (argc > 2) ? std::atoi(argv[2]) : 4;
+	const int devnull = open("/dev/null", O_WRONLY);
+
+	async::Logger::registerFd(devnull);
+	async::Logger::setLogLevel(async::Logger::INFO);
+
+	std::vector<pthread_t> threads(n_threads);
+	for (long i = 0; i < n_threads; i++)
+		pthread_create(&threads[i], NULL, run, reinterpret_cast<void *>(i));
+	double elapsed_max = 0;
+	for (int i = 0; i < n_threads; i++)
+	{
+		void *elapsed;
+		pthread_join(threads[i], &elapsed);
+		if (*static_cast<double *>(elapsed) > elapsed_max)
+			elapsed_max = *static_cast<double *>(elapsed);
+		delete static_cast<double *>(elapsed);
+	}
+	const size_t dropped = async::Logger::getDroppedCount();
+	async::Logger::blockingWriteAll();
+
+	const double total = static_cast<double>(g_messages) * n_threads;
+	std::cout << n_threads << " threads, " << g_messages
+			  << " messages each\n"
+			  << "caller cost:\t" << elapsed_max / g_messages
+			  << " ns/message\n"
+			  << "dropped:\t" << dropped << " (" << dropped * 100.0 / total
+			  << "%)" << std::endl;
+	return (0);
+}
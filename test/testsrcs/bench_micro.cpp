@@ -0,0 +1,468 @@
+#include "CGI/Response.hpp"
+#include "HTTP/Request.hpp"
+#include "HTTP/Response.hpp"
+#include "HTTP/Server.hpp"
+#include "Header.hpp"
+#include "async/Logger.hpp"
+#include "parseConfig.hpp"
+#include "utils/alloc_profile.hpp"
+#include "utils/hash.hpp"
+#include "utils/string.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * usage: ./bench_micro [filter] [seconds per benchmark] [results file]
+ * 레포지토리 루트에서 실행 (make microbench). 요청 해석, 헤더 조회, 응답
+ * 직렬화, location 찾기, 해시, 문자열 유틸을 따로 반복해 ns/op와 한 번에
+ * 일어나는 할당 횟수, 할당 바이트를 출력한다. filter가 있으면 이름에 그
+ * 문자열이 들어간 것만 돈다. 결과 파일을 주면 커밋 해시와 함께 JSON 한
+ * 줄씩 덧붙인다.
+ *
+ * 이 파일이 operator new/delete를 바꿔 메인 스레드의 할당을 센다.
+ * ALLOC_PROFILE로 빌드했다면 서버 쪽 operator new가 이미 세고 있으므로 그
+ * 값을 쓴다.
+ */
+
+static const char *corpus_dir = "test/testcase/http_request/";
+static const char *server_config = "configs/fortune.conf";
+
+static volatile size_t sink = 0; // 결과를 써서 최적화로 지워지지 않게 한다
+
+#ifdef ALLOC_PROFILE
+static void allocTotals(unsigned long long &allocs, unsigned long long &bytes)
+{
+	ft::alloc::threadTotals(allocs, bytes);
+}
+#else
+static __thread unsigned long long n_allocs = 0;
+static __thread unsigned long long n_alloc_bytes = 0;
+
+static void allocTotals(unsigned long long &allocs, unsigned long long &bytes)
+{
+	allocs = n_allocs;
+	bytes = n_alloc_bytes;
+}
+
+void *operator new(std::size_t size) throw(std::bad_alloc)
+{
+	n_allocs++;
+	n_alloc_bytes += size;
+	void *ptr = std::malloc(size ? size : 1);
+	if (ptr == NULL)
+		throw(std::bad_alloc());
+	return (ptr);
+}
+
+void operator delete(void *ptr) throw()
+{
+	std::free(ptr);
+}
+#endif
+
+// ------------------------------- 준비한 값 -------------------------------- //
+
+struct Fixture
+{
+	std::vector<std::string> corpus_names;
+	std::vector<std::string> corpus;
+	std::string buffer; // 반복마다 내용을 덮어쓰며 재사용한다
+	Header header;
+	HTTP::Response response;
+	std::string cgi_output;
+	HTTP::Server *server;
+	std::string hash_input;
+	std::string csv;
+	std::string padded;
+	std::string number;
+};
+
+static Fixture fixture;
+
+static std::string loadFile(const std::string &path)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	std::stringstream buf;
+	if (!in.good())
+		throw(std::runtime_error("cannot open " + path));
+	buf << in.rdbuf();
+	return (buf.str());
+}
+
+static void loadCorpus(void)
+{
+	DIR *dir = opendir(corpus_dir);
+	if (dir == NULL)
+		throw(std::runtime_error(std::string("cannot open ") + corpus_dir));
+	std::vector<std::string> names;
+	for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir))
+		if (entry->d_name[0] != '.')
+			names.push_back(entry->d_name);
+	closedir(dir);
+	std::sort(names.begin(), names.end());
+
+	size_t max_size = 0;
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		fixture.corpus_names.push_back(names[i]);
+		fixture.corpus.push_back(loadFile(corpus_dir + names[i]));
+		max_size = std::max(max_size, fixture.corpus.back().size());
+	}
+	fixture.buffer.reserve(max_size * 2);
+}
+
+static void prepare(void)
+{
+	loadCorpus();
+
+	const char *fields[][2] = {{"Host", "localhost:8080"},
+							   {"User-Agent", "curl/8.4.0"},
+							   {"Accept", "*/*"},
+							   {"Accept-Encoding", "gzip, deflate"},
+							   {"Accept-Language", "ko-KR,ko;q=0.9"},
+							   {"Connection", "keep-alive"},
+							   {"Cache-Control", "no-cache"},
+							   {"Content-Type", "text/plain"},
+							   {"Content-Length", "1024"},
+							   {"Referer", "http://localhost:8080/"}};
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+		fixture.header.insert(fields[i][0], fields[i][1]);
+
+	fixture.response.setStatus(200);
+	fixture.response.setContentType("index.html");
+	fixture.response.setBody(std::string(612, 'x'));
+	fixture.response.setContentLength();
+	fixture.response.setConnection(true);
+
+	fixture.cgi_output = "Content-Type: text/html\r\nStatus: 200 OK\r\n"
+						 "Cache-Control: max-age=10\r\n\r\n"
+						 + std::string(512, 'c');
+
+	ConfigDirectivePtr root = parseConfig(server_config);
+	const ConfigContext &root_context = (const ConfigContext &)(*root);
+	fixture.server = new HTTP::Server(
+		(const ConfigContext &)(root_context.getNthDirectiveByName("server",
+																   0)),
+		1024 * 1024,
+		1000);
+
+	fixture.hash_input = "/fortune/index.html?name=bench&lang=ko";
+	fixture.csv = "gzip, deflate, br, zstd, identity, compress";
+	fixture.padded = " \t  keep-alive  \t ";
+	fixture.number = "1048576";
+}
+
+// -------------------------------- 벤치마크 -------------------------------- //
+
+static void benchRequestParse(size_t corpus_index, size_t n)
+{
+	const std::string &content = fixture.corpus[corpus_index];
+	for (size_t i = 0; i < n; i++)
+	{
+		fixture.buffer.assign(content);
+		HTTP::Request request;
+		try
+		{
+			sink += request.parse(fixture.buffer);
+		}
+		catch (const std::exception &e)
+		{
+			sink++;
+		}
+	}
+}
+
+static void benchHeaderHit(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+		sink += fixture.header.getValue("Host", 0).size();
+}
+
+static void benchHeaderHasValue(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+		sink += fixture.header.hasValue("Connection", "keep-alive");
+}
+
+static void benchHeaderMiss(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+		sink += fixture.header.countValue("Transfer-Encoding");
+}
+
+static void benchResponseCopy(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+	{
+		HTTP::Response response(fixture.response);
+		sink += response.getStatusCode();
+	}
+}
+
+// toString은 부를 때마다 Date를 덧붙이므로 서버처럼 응답마다 한 번만
+// 부른다. 복사 비용은 Response::copy에서 따로 잰다
+static void benchResponseToString(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+	{
+		HTTP::Response response(fixture.response);
+		sink += response.toString().size();
+	}
+}
+
+static void benchCGIMakeResponse(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+	{
+		fixture.buffer.assign(fixture.cgi_output);
+		CGI::Response response;
+		response.makeResponse(fixture.buffer);
+		sink += response.getStatusCode();
+	}
+}
+
+static void benchGetLocation(size_t arg, size_t n)
+{
+	static const char *paths[]
+		= {"/", "/fortune/fortune.html", "/yeonhwiki/docs/a/b.html", "/img"};
+	const std::string path = paths[arg];
+	for (size_t i = 0; i < n; i++)
+		sink += fixture.server->getLocation(path).getPath().size();
+}
+
+static void benchGenerateHash(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+		sink += generateHash(fixture.hash_input).size();
+}
+
+static void benchSplitChar(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+		sink += split(fixture.csv, ',').size();
+}
+
+static void benchSplitString(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+		sink += split(fixture.csv, ", ").size();
+}
+
+static void benchStrtrim(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+	{
+		fixture.buffer.assign(fixture.padded);
+		strtrim(fixture.buffer, " \t");
+		sink += fixture.buffer.size();
+	}
+}
+
+static void benchToNum(size_t arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; i++)
+		sink += toNum<size_t>(fixture.number);
+}
+
+// -------------------------------- 하네스 ---------------------------------- //
+
+struct Benchmark
+{
+	std::string name;
+	void (*run)(size_t arg, size_t n);
+	size_t arg;
+};
+
+struct Result
+{
+	std::string name;
+	size_t iterations;
+	double ns_per_op;
+	double allocs_per_op;
+	double bytes_per_op;
+};
+
+static std::vector<Benchmark> listBenchmarks(void)
+{
+	std::vector<Benchmark> list;
+	Benchmark bench;
+
+	for (size_t i = 0; i < fixture.corpus.size(); i++)
+	{
+		bench.name = "Request::parse/" + fixture.corpus_names[i];
+		bench.run = benchRequestParse;
+		bench.arg = i;
+		list.push_back(bench);
+	}
+	const struct
+	{
+		const char *name;
+		void (*run)(size_t arg, size_t n);
+		size_t arg;
+	} fixed[] = {
+		{"Header::getValue/hit", benchHeaderHit, 0},
+		{"Header::hasValue/value", benchHeaderHasValue, 0},
+		{"Header::countValue/miss", benchHeaderMiss, 0},
+		{"Response::copy", benchResponseCopy, 0},
+		{"Response::toString", benchResponseToString, 0},
+		{"CGI::Response::makeResponse", benchCGIMakeResponse, 0},
+		{"Server::getLocation/root", benchGetLocation, 0},
+		{"Server::getLocation/prefix", benchGetLocation, 1},
+		{"Server::getLocation/deep", benchGetLocation, 2},
+		{"Server::getLocation/fallback", benchGetLocation, 3},
+		{"generateHash", benchGenerateHash, 0},
+		{"split/char", benchSplitChar, 0},
+		{"split/string", benchSplitString, 0},
+		{"strtrim", benchStrtrim, 0},
+		{"toNum<size_t>", benchToNum, 0},
+	};
+	for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++)
+	{
+		bench.name = fixed[i].name;
+		bench.run = fixed[i].run;
+		bench.arg = fixed[i].arg;
+		list.push_back(bench);
+	}
+	return (list);
+}
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static double timeRun(const Benchmark &bench, size_t n)
+{
+	const double begin = nowNs();
+	bench.run(bench.arg, n);
+	return (nowNs() - begin);
+}
+
+// 10ms를 넘길 때까지 반복 횟수를 늘린 뒤 목표 시간에 맞춰 한 번 잰다
+static Result measure(const Benchmark &bench, double seconds)
+{
+	size_t n = 1;
+	double elapsed;
+	while ((elapsed = timeRun(bench, n)) < 1e7)
+		n *= 2;
+	n = std::max<size_t>(1, n * (seconds * 1e9 / elapsed));
+
+	unsigned long long allocs_before, bytes_before, allocs_after, bytes_after;
+	allocTotals(allocs_before, bytes_before);
+	elapsed = timeRun(bench, n);
+	allocTotals(allocs_after, bytes_after);
+
+	Result result;
+	result.name = bench.name;
+	result.iterations = n;
+	result.ns_per_op = elapsed / n;
+	result.allocs_per_op
+		= static_cast<double>(allocs_after - allocs_before) / n;
+	result.bytes_per_op = static_cast<double>(bytes_after - bytes_before) / n;
+	return (result);
+}
+
+static std::string runCommand(const char *command)
+{
+	FILE *pipe = popen(command, "r");
+	std::string output;
+	char buf[256];
+	if (pipe == NULL)
+		return (output);
+	while (fgets(buf, sizeof(buf), pipe))
+		output += buf;
+	pclose(pipe);
+	while (!output.empty() && std::isspace(output[output.size() - 1]))
+		output.erase(output.size() - 1);
+	return (output);
+}
+
+// bench_load와 같이 커밋하지 않은 변경이 있으면 -dirty를 붙인다
+static std::string currentCommit(void)
+{
+	std::string commit = runCommand("git rev-parse --short HEAD 2>/dev/null");
+	if (commit.empty())
+		return ("unknown");
+	if (!runCommand("git status --porcelain --untracked-files=no 2>/dev/null")
+			 .empty())
+		commit += "-dirty";
+	return (commit);
+}
+
+static void appendResult(std::ofstream &out,
+						 const std::string &commit,
+						 const Result &result)
+{
+	out << std::fixed << std::setprecision(2) << "{\"commit\":\"" << commit
+		<< "\",\"benchmark\":\"" << result.name
+		<< "\",\"iterations\":" << result.iterations
+		<< ",\"ns_per_op\":" << result.ns_per_op
+		<< ",\"allocs_per_op\":" << result.allocs_per_op
+		<< ",\"bytes_per_op\":" << result.bytes_per_op << "}\n";
+}
+
+int main(int argc, char **argv)
+{
+	const std::string filter = (argc > 1) ? argv[1] : "";
+	const double seconds = (argc > 2) ? std::atof(argv[2]) : 0.5;
+	const std::string results_path = (argc > 3) ? argv[3] : "";
+
+	async::Logger::setLogLevel(async::Logger::ERROR);
+	try
+	{
+		prepare();
+		const std::vector<Benchmark> list = listBenchmarks();
+		const std::string commit = currentCommit();
+		std::ofstream out;
+		if (!results_path.empty())
+			out.open(results_path.c_str(), std::ios::app);
+
+		std::cout << std::left << std::setw(34) << "benchmark" << std::right
+				  << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op"
+				  << std::setw(12) << "bytes/op" << "\n";
+		for (size_t i = 0; i < list.size(); i++)
+		{
+			if (list[i].name.find(filter) == std::string::npos)
+				continue;
+			const Result result = measure(list[i], seconds);
+			std::cout << std::left << std::setw(34) << result.name
+					  << std::right << std::fixed << std::setprecision(1)
+					  << std::setw(12) << result.ns_per_op << std::setw(12)
+					  << result.allocs_per_op << std::setw(12)
+					  << result.bytes_per_op << std::endl;
+			if (out.is_open())
+				appendResult(out, commit, result);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << e.what() << "\n";
+		return (1);
+	}
+	return (0);
+}
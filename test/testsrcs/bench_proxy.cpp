@@ -0,0 +1,288 @@
+#include "WorkerSupervisor.hpp"
+#include "parseConfig.hpp"
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * usage: ./bench_proxy [seconds per run] [connections] [port]
+ * 레포지토리 루트에서 실행. 같은 프로세스에 keep-alive 업스트림 흉내를 띄우고
+ * proxy_pass location으로 요청을 보내 초당 처리량과 업스트림이 받은 연결 수를
+ * 센다. 연결을 재사용하면 연결 수는 요청 수보다 훨씬 작아야 한다.
+ */
+
+static const char *config_path = "/tmp/bench_proxy.conf";
+static const int upstream_ports[] = {18191, 18192};
+static volatile bool stop_clients = false;
+static volatile size_t upstream_connections = 0;
+static volatile size_t upstream_requests = 0;
+static int port = 18190;
+
+static void writeConfig(int n_upstreams, const char *balance)
+{
+	std::ofstream conf(config_path);
+	conf << "client_max_body_size 1024;\n"
+		 << "upload_store ./www/fortune/db;\n"
+		 << "timeout 10000;\n"
+		 << "backlog_size 128;\n"
+		 << "log_level ERROR;\n"
+		 << "server {\n"
+		 << "    listen " << port << ";\n"
+		 << "    location / {\n"
+		 << "        proxy_pass";
+	for (int i = 0; i < n_upstreams; i++)
+		conf << " http://127.0.0.1:" << upstream_ports[i];
+	conf << ";\n"
+		 << "        proxy_balance " << balance << ";\n"
+		 << "    }\n"
+		 << "}\n";
+}
+
+static pid_t startServer(void)
+{
+	pid_t pid = fork();
+	if (pid != 0)
+		return (pid);
+	try
+	{
+		ConfigDirectivePtr root = parseConfig(config_path);
+		WorkerSupervisor supervisor((ConfigContext &)(*root));
+		supervisor.run();
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "server failed: " << e.what() << "\n";
+		_exit(1);
+	}
+	_exit(0);
+}
+
+static int listenOn(int listen_port)
+{
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	int reuse = 1;
+	struct sockaddr_in addr;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(listen_port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+		|| listen(fd, 128) < 0)
+	{
+		perror("upstream");
+		exit(1);
+	}
+	return (fd);
+}
+
+static int connectServer(void)
+{
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+// 응답 하나를 끝까지 읽으면 true
+static bool readResponse(int fd, std::string &buf)
+{
+	char chunk[4096];
+	size_t header_end;
+	while ((header_end = buf.find("\r\n\r\n")) == std::string::npos)
+	{
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n <= 0)
+			return (false);
+		buf.append(chunk, n);
+	}
+	size_t content_length = 0;
+	size_t pos = buf.find("Content-Length: ");
+	if (pos != std::string::npos && pos < header_end)
+		content_length = std::strtoul(buf.c_str() + pos + 16, NULL, 10);
+	size_t total = header_end + 4 + content_length;
+	while (buf.size() < total)
+	{
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n <= 0)
+			return (false);
+		buf.append(chunk, n);
+	}
+	buf.erase(0, total);
+	return (true);
+}
+
+// 업스트림 흉내: 요청 헤더를 받을 때마다 짧은 응답을 돌려주고 연결을 유지한다
+static void *serveUpstreamConnection(void *arg)
+{
+	const int fd = static_cast<int>(reinterpret_cast<long>(arg));
+	const std::string body(256, 'u');
+	std::ostringstream response;
+	response << "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+			 << "Content-Length: " << body.size() << "\r\n\r\n"
+			 << body;
+	const std::string msg = response.str();
+	std::string buf;
+	char chunk[4096];
+
+	__sync_fetch_and_add(&upstream_connections, 1);
+	while (true)
+	{
+		size_t header_end = buf.find("\r\n\r\n");
+		if (header_end == std::string::npos)
+		{
+			ssize_t n = read(fd, chunk, sizeof(chunk));
+			if (n <= 0)
+				break;
+			buf.append(chunk, n);
+			continue;
+		}
+		buf.erase(0, header_end + 4);
+		__sync_fetch_and_add(&upstream_requests, 1);
+		if (write(fd, msg.c_str(), msg.size()) < 0)
+			break;
+	}
+	close(fd);
+	return (NULL);
+}
+
+static void *runUpstream(void *arg)
+{
+	const int listen_fd = static_cast<int>(reinterpret_cast<long>(arg));
+
+	while (true)
+	{
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		pthread_t thread;
+		pthread_create(&thread,
+					   NULL,
+					   serveUpstreamConnection,
+					   reinterpret_cast<void *>(static_cast<long>(fd)));
+		pthread_detach(thread);
+	}
+	return (NULL);
+}
+
+static void *runClient(void *arg)
+{
+	size_t &n_done = *static_cast<size_t *>(arg);
+	const std::string request
+		= "GET /item?id=1 HTTP/1.1\r\nHost: localhost\r\n"
+		  "User-Agent: bench\r\n\r\n";
+	int fd = -1;
+	std::string buf;
+
+	while (!stop_clients)
+	{
+		if (fd < 0)
+		{
+			fd = connectServer();
+			buf.clear();
+			if (fd < 0)
+				continue;
+		}
+		if (write(fd, request.c_str(), request.size()) < 0
+			|| !readResponse(fd, buf))
+		{
+			close(fd);
+			fd = -1;
+			continue;
+		}
+		n_done++;
+	}
+	if (fd >= 0)
+		close(fd);
+	return (NULL);
+}
+
+static double runOnce(int n_upstreams,
+					  const char *balance,
+					  int seconds,
+					  int n_connections)
+{
+	writeConfig(n_upstreams, balance);
+	pid_t server = startServer();
+	usleep(500000);
+
+	std::vector<pthread_t> clients(n_connections);
+	std::vector<size_t> counts(n_connections, 0);
+	stop_clients = false;
+	upstream_connections = 0;
+	upstream_requests = 0;
+	for (int i = 0; i < n_connections; i++)
+		pthread_create(&clients[i], NULL, runClient, &counts[i]);
+	sleep(seconds);
+	stop_clients = true;
+	kill(server, SIGINT);
+	size_t total = 0;
+	for (int i = 0; i < n_connections; i++)
+	{
+		pthread_join(clients[i], NULL);
+		total += counts[i];
+	}
+	waitpid(server, NULL, 0);
+	return (static_cast<double>(total) / seconds);
+}
+
+int main(int argc, char **argv)
+{
+	int seconds = (argc > 1) ? std::atoi(argv[1]) : 3;
+	int n_connections = (argc > 2) ? std::atoi(argv[2]) : 16;
+	if (argc > 3)
+		port = std::atoi(argv[3]);
+	signal(SIGPIPE, SIG_IGN);
+
+	// fork(2)는 부른 스레드만 복제하므로 업스트림 스레드는 서버에 따라가지
+	// 않는다
+	for (size_t i = 0; i < sizeof(upstream_ports) / sizeof(upstream_ports[0]);
+		 i++)
+	{
+		pthread_t thread;
+		pthread_create(&thread,
+					   NULL,
+					   runUpstream,
+					   reinterpret_cast<void *>(
+						   static_cast<long>(listenOn(upstream_ports[i]))));
+		pthread_detach(thread);
+	}
+
+	struct
+	{
+		int n_upstreams;
+		const char *balance;
+	} modes[] = {{1, "round_robin"}, {2, "round_robin"}, {2, "least_conn"}};
+	std::cout << "upstreams\tbalance\t\treq/s\tupstream conns\tupstream reqs\n";
+	for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+	{
+		double rps = runOnce(
+			modes[i].n_upstreams, modes[i].balance, seconds, n_connections);
+		std::cout << modes[i].n_upstreams << "\t\t" << modes[i].balance
+				  << "\t" << static_cast<long>(rps) << "\t"
+				  << upstream_connections << "\t\t" << upstream_requests
+				  << std::endl;
+	}
+	std::remove(config_path);
+	return (0);
+}
@@ -0,0 +1,122 @@
+#include "utils/arena.hpp"
+#include "utils/shared_ptr.hpp"
+#include <iostream>
+#include <stdexcept>
+
+static int n_alive = 0;
+
+class Handler : public ft::RefCounted, public ft::ArenaObject
+{
+  public:
+	char payload[200];
+
+	Handler(bool fail = false)
+	{
+		if (fail)
+			throw(std::runtime_error("constructor failed"));
+		n_alive++;
+	}
+	virtual ~Handler()
+	{
+		n_alive--;
+	}
+};
+
+class Large : public Handler
+{
+  public:
+	char more[4096];
+};
+
+static void check(const char *name, bool ok)
+{
+	std::cout << (ok ? "[OK]   " : "[FAIL] ") << name << std::endl;
+}
+
+static ft::Arena::Stats stats(void)
+{
+	ft::Arena::Stats s;
+	ft::Arena::snapshot(s);
+	return (s);
+}
+
+// 마지막 객체가 사라지면 되감겨 같은 자리를 다시 쓴다
+void testRewind(void)
+{
+	ft::Arena *arena = new ft::Arena();
+	void *first;
+	{
+		ft::shared_ptr<Handler> a(new (*arena) Handler());
+		ft::shared_ptr<Handler> b(new (*arena) Handler());
+		first = a.get();
+		check("bump allocations are distinct", b.get() != first);
+		check("arena not idle while referenced", !arena->idle());
+	}
+	check("objects destroyed", n_alive == 0);
+	check("arena idle after last release", arena->idle());
+	ft::shared_ptr<Handler> c(new (*arena) Handler());
+	check("rewound to the first block", c.get() == first);
+	c = ft::shared_ptr<Handler>();
+	arena->retire();
+}
+
+// 주인이 먼저 떠나도 남은 객체가 사라질 때 아레나가 지워진다
+void testRetireWhileLive(void)
+{
+	const long long arenas_before = stats().arenas;
+	ft::Arena *arena = new ft::Arena();
+	ft::shared_ptr<Handler> a(new (*arena) Handler());
+	arena->retire();
+	check("retired arena kept while referenced",
+		  stats().arenas == arenas_before + 1);
+	a = ft::shared_ptr<Handler>();
+	check("retired arena deleted with last object",
+		  stats().arenas == arenas_before);
+}
+
+// 여러 청크에 걸쳐 할당한 뒤 되감으면 첫 청크만 남는다
+void testGrowAndShrink(void)
+{
+	ft::Arena *arena = new ft::Arena();
+	const long long bytes_before = stats().chunk_bytes;
+	{
+		ft::shared_ptr<Handler> handlers[40];
+		for (int i = 0; i < 40; i++)
+			handlers[i] = ft::shared_ptr<Handler>(new (*arena) Handler());
+		check("grew past one chunk", stats().chunk_bytes > bytes_before + 4096);
+	}
+	check("extra chunks returned", stats().chunk_bytes == bytes_before + 4096);
+	arena->retire();
+}
+
+void testFallbacks(void)
+{
+	ft::Arena *arena = new ft::Arena();
+	const unsigned long long fallbacks = stats().heap_fallbacks;
+	{
+		ft::shared_ptr<Handler> large(new (*arena) Large());
+		ft::shared_ptr<Handler> heap(new Handler());
+		check("large object falls back to heap",
+			  stats().heap_fallbacks == fallbacks + 1);
+		check("heap objects do not pin the arena", arena->idle());
+	}
+	try
+	{
+		ft::shared_ptr<Handler> failed(new (*arena) Handler(true));
+	}
+	catch (const std::exception &e)
+	{
+		check("failed constructor releases its block", arena->idle());
+	}
+	check("all objects destroyed", n_alive == 0);
+	arena->retire();
+}
+
+int main(void)
+{
+	testRewind();
+	testRetireWhileLive();
+	testGrowAndShrink();
+	testFallbacks();
+	return (0);
+}
@@ -0,0 +1,335 @@
+#include "WorkerSupervisor.hpp"
+#include "parseConfig.hpp"
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * usage: ./test_cgi_pipelined [port]
+ * 레포지토리 루트에서 실행. 중간에 쉬면서 본문을 내보내는 CGI 요청과 업스트림
+ * 요청 뒤에 정적 파일과 없는 파일 요청을 한 번에 이어 보내고, 응답이 요청
+ * 순서대로 오는지, 뒤 요청의 응답이 스트리밍 중인 본문 안에 끼지 않는지
+ * 확인한다. 업스트림은 port + 1에서 기다린다.
+ */
+
+static const char *config_path = "/tmp/test_cgi_pipelined.conf";
+static const char *script_dir = "/tmp/webserv_pipelined";
+static const char *static_body = "static body\n";
+static int port = 18186;
+static int upstream_port = 18187;
+
+struct Expected
+{
+	int status;
+	const char *body; // NULL이면 본문을 확인하지 않는다
+};
+
+static void writeFiles(void)
+{
+	mkdir(script_dir, 0755);
+	const std::string script = std::string(script_dir) + "/stream.sh";
+	{
+		std::ofstream out(script.c_str());
+		out << "#!/bin/sh\n"
+			<< "printf 'Content-Type: text/plain\\r\\n"
+			<< "Status: 200 OK\\r\\n\\r\\n'\n"
+			<< "echo first\n"
+			<< "sleep 1\n"
+			<< "echo second\n";
+	}
+	chmod(script.c_str(), 0755);
+	{
+		std::ofstream out((std::string(script_dir) + "/static.txt").c_str());
+		out << static_body;
+	}
+
+	std::ofstream conf(config_path);
+	conf << "client_max_body_size 1024;\n"
+		 << "upload_store " << script_dir << ";\n"
+		 << "timeout 10000;\n"
+		 << "backlog_size 128;\n"
+		 << "log_level ERROR;\n"
+		 << "server {\n"
+		 << "    listen " << port << ";\n"
+		 << "    cgi_pass stream " << script << ";\n"
+		 << "    cgi_limit_except GET;\n"
+		 << "    location / {\n"
+		 << "        alias " << script_dir << "/;\n"
+		 << "        limit_except GET;\n"
+		 << "    }\n"
+		 << "    location /up {\n"
+		 << "        proxy_pass http://127.0.0.1:" << upstream_port << ";\n"
+		 << "    }\n"
+		 << "}\n";
+}
+
+// 업스트림 흉내: 요청마다 본문 앞부분을 보내고 잠시 쉰 뒤 나머지를 보낸다
+static void serveUpstream(int fd)
+{
+	const std::string head = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+							 "Content-Length: 13\r\n\r\nfirst\n";
+	std::string buf;
+	char chunk[4096];
+
+	while (true)
+	{
+		size_t header_end = buf.find("\r\n\r\n");
+		if (header_end == std::string::npos)
+		{
+			ssize_t n_read = read(fd, chunk, sizeof(chunk));
+			if (n_read <= 0)
+				return;
+			buf.append(chunk, n_read);
+			continue;
+		}
+		buf.erase(0, header_end + 4);
+		if (write(fd, head.c_str(), head.size()) < 0)
+			return;
+		sleep(1);
+		if (write(fd, "second\n", 7) < 0)
+			return;
+	}
+}
+
+static pid_t startUpstream(void)
+{
+	int listen_fd = socket(PF_INET, SOCK_STREAM, 0);
+	int reuse = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(upstream_port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+		|| listen(listen_fd, 16) < 0)
+	{
+		std::cerr << "upstream failed to listen on " << upstream_port << "\n";
+		exit(1);
+	}
+	pid_t pid = fork();
+	if (pid != 0)
+	{
+		close(listen_fd);
+		return (pid);
+	}
+	while (true)
+	{
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		serveUpstream(fd);
+		close(fd);
+	}
+}
+
+static int connectServer(void)
+{
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	struct timeval timeout = {5, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+static pid_t startServer(void)
+{
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		try
+		{
+			ConfigDirectivePtr root = parseConfig(config_path);
+			WorkerSupervisor supervisor((ConfigContext &)(*root));
+			supervisor.run();
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "server failed: " << e.what() << "\n";
+			_exit(1);
+		}
+		_exit(0);
+	}
+	for (int i = 0; i < 100; i++)
+	{
+		usleep(50000);
+		int fd = connectServer();
+		if (fd >= 0)
+		{
+			close(fd);
+			return (pid);
+		}
+	}
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	std::cerr << "server did not start listening\n";
+	exit(1);
+}
+
+// 다 받았으면 true. 받은 것이 아직 모자라면 false
+static bool decodeChunked(const std::string &raw,
+						  size_t &pos,
+						  std::string &body)
+{
+	while (true)
+	{
+		size_t line_end = raw.find("\r\n", pos);
+		if (line_end == std::string::npos)
+			return (false);
+		size_t size = std::strtoul(raw.c_str() + pos, NULL, 16);
+		if (size == 0)
+		{
+			if (raw.size() < line_end + 4)
+				return (false);
+			pos = line_end + 4;
+			return (true);
+		}
+		if (line_end + 2 + size + 2 > raw.size())
+			return (false);
+		body.append(raw, line_end + 2, size);
+		pos = line_end + 2 + size + 2;
+	}
+}
+
+// buf의 pos부터 응답 하나를 꺼낸다. 덜 받았으면 false
+static bool parseResponse(const std::string &buf,
+						  size_t &pos,
+						  int &status,
+						  std::string &body)
+{
+	size_t header_end = buf.find("\r\n\r\n", pos);
+	if (header_end == std::string::npos)
+		return (false);
+	const std::string head = buf.substr(pos, header_end - pos);
+	size_t body_pos = header_end + 4;
+	body.clear();
+	if (head.find("Transfer-Encoding: chunked") != std::string::npos)
+	{
+		if (!decodeChunked(buf, body_pos, body))
+			return (false);
+	}
+	else
+	{
+		size_t length = 0;
+		size_t field = head.find("Content-Length: ");
+		if (field != std::string::npos)
+			length = std::strtoul(head.c_str() + field + 16, NULL, 10);
+		if (buf.size() < body_pos + length)
+			return (false);
+		body = buf.substr(body_pos, length);
+		body_pos += length;
+	}
+	status = std::atoi(head.c_str() + 9);
+	pos = body_pos;
+	return (true);
+}
+
+static bool checkResponses(int fd, const Expected *expected, size_t n)
+{
+	std::string buf;
+	size_t pos = 0;
+	char chunk[4096];
+
+	for (size_t i = 0; i < n;)
+	{
+		int status;
+		std::string body;
+		if (parseResponse(buf, pos, status, body))
+		{
+			if (status != expected[i].status
+				|| (expected[i].body && body != expected[i].body))
+			{
+				std::cout << "response " << i << " is " << status << " \""
+						  << body << "\", expected " << expected[i].status
+						  << "\n";
+				return (false);
+			}
+			i++;
+			continue;
+		}
+		ssize_t n_read = read(fd, chunk, sizeof(chunk));
+		if (n_read <= 0)
+		{
+			std::cout << "connection ended after " << i << " responses: \""
+					  << buf.substr(pos, 200) << "\"\n";
+			return (false);
+		}
+		buf.append(chunk, n_read);
+	}
+	if (pos != buf.size())
+	{
+		std::cout << "unexpected trailing bytes: \"" << buf.substr(pos, 200)
+				  << "\"\n";
+		return (false);
+	}
+	return (true);
+}
+
+// 스트리밍되는 첫 요청 뒤에 정적 파일, 없는 파일, 정적 파일을 잇는다
+static bool runPipeline(const char *first_uri)
+{
+	const std::string requests
+		= std::string("GET ") + first_uri
+		  + " HTTP/1.1\r\nHost: localhost\r\n\r\n"
+			"GET /static.txt HTTP/1.1\r\nHost: localhost\r\n\r\n"
+			"GET /missing.txt HTTP/1.1\r\nHost: localhost\r\n\r\n"
+			"GET /static.txt HTTP/1.1\r\nHost: localhost\r\n"
+			"Connection: close\r\n\r\n";
+	const Expected expected[] = {{200, "first\nsecond\n"},
+								 {200, static_body},
+								 {404, NULL},
+								 {200, static_body}};
+	int fd = connectServer();
+	bool ok = fd >= 0
+			  && write(fd, requests.c_str(), requests.size()) >= 0
+			  && checkResponses(
+				  fd, expected, sizeof(expected) / sizeof(expected[0]));
+	if (fd >= 0)
+		close(fd);
+	std::cout << first_uri << ": "
+			  << (ok ? "responses arrived in request order\n"
+					 : "pipelined responses are broken\n");
+	return (ok);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1)
+	{
+		port = std::atoi(argv[1]);
+		upstream_port = port + 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	writeFiles();
+	pid_t upstream = startUpstream();
+	pid_t server = startServer();
+	bool ok = runPipeline("/slow.stream");
+	ok = runPipeline("/up/item") && ok;
+	kill(server, SIGINT);
+	waitpid(server, NULL, 0);
+	kill(upstream, SIGKILL);
+	waitpid(upstream, NULL, 0);
+	std::remove(config_path);
+	return (ok ? 0 : 1);
+}
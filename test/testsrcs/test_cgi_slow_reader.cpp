@@ -0,0 +1,236 @@
+#include "WorkerSupervisor.hpp"
+#include "parseConfig.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * usage: ./test_cgi_slow_reader [body size] [port]
+ * 레포지토리 루트에서 실행. body size 바이트를 내보내는 CGI를 천천히 읽는
+ * 클라이언트로 받아 본문이 잘리지 않았는지 확인한다. 서버는 클라이언트 쪽
+ * 버퍼가 256KiB를 넘으면 본문 조각을 멈추므로, 본문은 그보다 훨씬 커야
+ * 멈춘 채로 CGI가 끝나는 경우를 거친다.
+ */
+
+static const char *config_path = "/tmp/test_cgi_slow_reader.conf";
+static const char *script_dir = "/tmp/webserv_slow_reader";
+static const char *pattern = "0123456789abcde\n";
+static int port = 18185;
+
+static void writeFiles(size_t body_size)
+{
+	mkdir(script_dir, 0755);
+	const std::string script = std::string(script_dir) + "/big.sh";
+	{
+		std::ofstream out(script.c_str());
+		out << "#!/bin/sh\n"
+			<< "printf 'Content-Type: text/plain\\r\\n"
+			<< "Status: 200 OK\\r\\n\\r\\n'\n"
+			<< "yes 0123456789abcde | head -c " << body_size << "\n";
+	}
+	chmod(script.c_str(), 0755);
+
+	std::ofstream conf(config_path);
+	conf << "client_max_body_size 1024;\n"
+		 << "upload_store " << script_dir << ";\n"
+		 << "timeout 10000;\n"
+		 << "backlog_size 128;\n"
+		 << "log_level ERROR;\n"
+		 << "server {\n"
+		 << "    listen " << port << ";\n"
+		 << "    cgi_pass big " << script << ";\n"
+		 << "    cgi_limit_except GET;\n"
+		 << "    location / {\n"
+		 << "        alias " << script_dir << "/;\n"
+		 << "        limit_except GET;\n"
+		 << "    }\n"
+		 << "}\n";
+}
+
+static int connectServer(void)
+{
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	// 수신 버퍼를 줄여 서버 쪽에 보낼 데이터가 빨리 쌓이게 한다
+	int rcvbuf = 4096;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	// 본문이 잘리면 마지막 청크가 오지 않으므로 기다리다 실패로 센다
+	struct timeval timeout = {5, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+static pid_t startServer(void)
+{
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		try
+		{
+			ConfigDirectivePtr root = parseConfig(config_path);
+			WorkerSupervisor supervisor((ConfigContext &)(*root));
+			supervisor.run();
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "server failed: " << e.what() << "\n";
+			_exit(1);
+		}
+		_exit(0);
+	}
+	for (int i = 0; i < 100; i++)
+	{
+		usleep(50000);
+		int fd = connectServer();
+		if (fd >= 0)
+		{
+			close(fd);
+			return (pid);
+		}
+	}
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	std::cerr << "server did not start listening\n";
+	exit(1);
+}
+
+// 마지막 청크를 받거나 연결이 닫힐 때까지 조금씩 쉬면서 읽는다
+static bool readSlowly(int fd, std::string &buf)
+{
+	const std::string last_chunk = "\r\n0\r\n\r\n";
+	char chunk[16384];
+
+	// CGI가 다 쓰기 전에 서버가 본문 조각을 멈추도록 한동안 읽지 않는다
+	usleep(500000);
+	while (true)
+	{
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n < 0)
+		{
+			std::cout << "no data for 5s after " << buf.size() << " bytes\n";
+			return (false);
+		}
+		if (n == 0)
+			return (true);
+		buf.append(chunk, n);
+		if (buf.size() >= last_chunk.size()
+			&& buf.compare(buf.size() - last_chunk.size(),
+						   last_chunk.size(),
+						   last_chunk)
+				   == 0)
+			return (true);
+		usleep(1000);
+	}
+}
+
+static bool decodeChunked(const std::string &raw, std::string &body)
+{
+	size_t pos = 0;
+	while (true)
+	{
+		size_t line_end = raw.find("\r\n", pos);
+		if (line_end == std::string::npos)
+			return (false);
+		size_t size = std::strtoul(raw.c_str() + pos, NULL, 16);
+		pos = line_end + 2;
+		if (size == 0)
+			return (true);
+		if (pos + size + 2 > raw.size())
+			return (false);
+		body.append(raw, pos, size);
+		pos += size + 2;
+	}
+}
+
+static bool checkResponse(const std::string &response, size_t body_size)
+{
+	size_t header_end = response.find("\r\n\r\n");
+	if (header_end == std::string::npos
+		|| response.compare(0, 12, "HTTP/1.1 200") != 0)
+	{
+		std::cout << "bad response head: " << response.substr(0, 200) << "\n";
+		return (false);
+	}
+	const std::string head = response.substr(0, header_end);
+	const std::string raw = response.substr(header_end + 4);
+	std::string body;
+	if (head.find("Transfer-Encoding: chunked") != std::string::npos)
+	{
+		if (!decodeChunked(raw, body))
+		{
+			std::cout << "chunked body ended early after " << body.size()
+					  << " bytes\n";
+			return (false);
+		}
+	}
+	else
+		body = raw;
+	if (body.size() != body_size)
+	{
+		std::cout << "body is " << body.size() << " bytes, expected "
+				  << body_size << "\n";
+		return (false);
+	}
+	const size_t len = std::strlen(pattern);
+	for (size_t i = 0; i < body.size(); i += len)
+	{
+		if (body.compare(i, len, pattern, std::min(len, body.size() - i)) != 0)
+		{
+			std::cout << "body differs at byte " << i << "\n";
+			return (false);
+		}
+	}
+	return (true);
+}
+
+int main(int argc, char **argv)
+{
+	size_t body_size = (argc > 1) ? std::strtoul(argv[1], NULL, 10)
+								   : 4 * 1024 * 1024;
+	if (argc > 2)
+		port = std::atoi(argv[2]);
+	signal(SIGPIPE, SIG_IGN);
+
+	writeFiles(body_size);
+	pid_t server = startServer();
+	const std::string request = "GET /slow.big HTTP/1.1\r\nHost: localhost\r\n"
+								"Connection: close\r\n\r\n";
+	int n_failed = 0;
+	const int n_runs = 3;
+	for (int i = 0; i < n_runs; i++)
+	{
+		int fd = connectServer();
+		std::string response;
+		if (fd < 0 || write(fd, request.c_str(), request.size()) < 0
+			|| !readSlowly(fd, response) || !checkResponse(response, body_size))
+			n_failed++;
+		if (fd >= 0)
+			close(fd);
+	}
+	kill(server, SIGINT);
+	waitpid(server, NULL, 0);
+	std::remove(config_path);
+	std::cout << (n_runs - n_failed) << "/" << n_runs << " responses intact\n";
+	return (n_failed == 0 ? 0 : 1);
+}
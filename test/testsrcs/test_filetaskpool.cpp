@@ -0,0 +1,98 @@
+#include "async/FileTaskPool.hpp"
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+class SleepStatTask : public async::FileTask
+{
+  public:
+	const std::string path;
+	const useconds_t delay;
+	pthread_t thread;
+	bool found;
+
+	SleepStatTask(const std::string &path, const useconds_t delay)
+		: path(path)
+		, delay(delay)
+		, found(false)
+	{
+	}
+
+	virtual void run(void)
+	{
+		struct stat buf;
+
+		// 느린 디스크를 흉내낸다
+		usleep(delay);
+		found = (stat(path.c_str(), &buf) == 0);
+		thread = pthread_self();
+	}
+};
+
+static double elapsedMs(const struct timeval &begin)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return ((now.tv_sec - begin.tv_sec) * 1000.0
+			+ (now.tv_usec - begin.tv_usec) / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+	const size_t n_threads = (argc > 1) ? std::atoi(argv[1]) : 4;
+	const size_t n_tasks = (argc > 2) ? std::atoi(argv[2]) : 64;
+	const std::string path = (argc > 3) ? argv[3] : argv[0];
+
+	async::FileTaskPool::setNumThreads(n_threads);
+
+	// 일부 작업만 오래 걸리게 해서 큐 사이의 불균형을 만든다
+	std::vector<SleepStatTask *> tasks;
+	useconds_t serial_us = 0;
+	for (size_t i = 0; i < n_tasks; i++)
+	{
+		useconds_t delay
+			= (n_threads > 0 && i % n_threads == 0) ? 20000 : 1000;
+		serial_us += delay;
+		tasks.push_back(new SleepStatTask(path, delay));
+	}
+
+	struct timeval begin;
+	gettimeofday(&begin, NULL);
+	for (size_t i = 0; i < tasks.size(); i++)
+		async::FileTaskPool::submit(tasks[i]);
+
+	size_t n_done = 0;
+	while (n_done < tasks.size())
+	{
+		n_done = 0;
+		for (size_t i = 0; i < tasks.size(); i++)
+			if (tasks[i]->isDone())
+				n_done++;
+		usleep(100);
+	}
+	double elapsed = elapsedMs(begin);
+
+	std::set<pthread_t> threads;
+	size_t n_found = 0;
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		threads.insert(tasks[i]->thread);
+		if (tasks[i]->found)
+			n_found++;
+		tasks[i]->release();
+	}
+
+	std::cout << "tasks:          " << n_tasks << "\n";
+	std::cout << "threads used:   " << threads.size() << " / " << n_threads
+			  << "\n";
+	std::cout << "stat succeeded: " << n_found << "\n";
+	std::cout << "elapsed:        " << elapsed << " ms (serial "
+			  << serial_us / 1000 << " ms)" << std::endl;
+	return (n_found == n_tasks ? 0 : 1);
+}
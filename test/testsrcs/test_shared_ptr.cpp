@@ -1,5 +1,61 @@
 #include "utils/shared_ptr.hpp"
 #include <cstdlib>
+#include <iostream>
+#include <string>
+
+static int n_alive = 0;
+
+class Plain
+{
+  public:
+	std::string name;
+
+	Plain(const std::string &name_ = "", int n = 0)
+		: name(name_)
+	{
+		(void)n;
+		n_alive++;
+	}
+	virtual ~Plain()
+	{
+		n_alive--;
+	}
+};
+
+class Intrusive : public ft::RefCounted
+{
+  public:
+	Intrusive()
+	{
+		n_alive++;
+	}
+	virtual ~Intrusive()
+	{
+		n_alive--;
+	}
+};
+
+class Derived : public Intrusive
+{
+};
+
+class Shared : public ft::AtomicRefCounted
+{
+  public:
+	Shared()
+	{
+		n_alive++;
+	}
+	virtual ~Shared()
+	{
+		n_alive--;
+	}
+};
+
+static void check(const char *name, bool ok)
+{
+	std::cout << (ok ? "[OK]   " : "[FAIL] ") << name << std::endl;
+}
 
 void checkleaks(void)
 {
@@ -37,6 +93,59 @@ void testAssignment(void)
 	buf4 = buf2;
 }
 
+void testNull(void)
+{
+	ft::shared_ptr<Plain> empty;
+	ft::shared_ptr<Plain> copy(empty);
+	copy = empty;
+	check("null pointer", copy.get() == NULL);
+}
+
+void testMakeShared(void)
+{
+	{
+		ft::shared_ptr<Plain> a = ft::make_shared<Plain>("plain", 1);
+		ft::shared_ptr<Plain> b(a);
+		a = ft::shared_ptr<Plain>();
+		check("make_shared keeps arguments", b->name == "plain");
+		check("make_shared alive while referenced", n_alive == 1);
+	}
+	check("make_shared released", n_alive == 0);
+}
+
+void testIntrusive(void)
+{
+	{
+		ft::shared_ptr<Intrusive> a(new Derived());
+		Intrusive *raw = a.get();
+		ft::shared_ptr<Intrusive> b(raw); // 카운트가 객체 안에 있으므로 안전
+		a = b;
+		check("intrusive alive while referenced", n_alive == 1);
+	}
+	check("intrusive released", n_alive == 0);
+}
+
+void testUpcast(void)
+{
+	{
+		ft::shared_ptr<Derived> derived(new Derived());
+		ft::shared_ptr<Intrusive> base(derived);
+		derived = ft::shared_ptr<Derived>();
+		check("upcast alive while referenced", n_alive == 1);
+	}
+	check("upcast released", n_alive == 0);
+}
+
+void testAtomic(void)
+{
+	{
+		ft::shared_ptr<Shared> a(new Shared());
+		ft::shared_ptr<Shared> b(a);
+		a = b;
+	}
+	check("atomic released", n_alive == 0);
+}
+
 int main(void)
 {
 	atexit(checkleaks);
@@ -44,6 +153,11 @@ int main(void)
 	testSimple();
 	testCopy();
 	testAssignment();
+	testNull();
+	testMakeShared();
+	testIntrusive();
+	testUpcast();
+	testAtomic();
 
 	return (0);
 }
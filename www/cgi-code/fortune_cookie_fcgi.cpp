@@ -0,0 +1,207 @@
+/**
+**  random_fortune_cookie.cpp의 FastCGI 버전.
+**  fd 0이 리스닝 소켓이면 FastCGI 워커로 동작하고,
+**  그렇지 않으면 일반 CGI 프로그램처럼 요청 하나를 처리하고 종료한다.
+**/
+
+#include "CGI/fastcgi.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace CGI;
+
+std::string makeError(void)
+{
+	std::stringstream out;
+
+	out << "Content-Type: text/html\r\n";
+	out << "Status: 600 Invalid data\r\n\r\n";
+	out << "<html>\n";
+	out << "<head>\n";
+	out << "<title>Invalid data</title>\n";
+	out << "</head>\n";
+	out << "<h1>Invalid data typed</h1>\n";
+	out << "</html>\n";
+	return (out.str());
+}
+
+std::string makeResult(const std::string &name, const std::string &result)
+{
+	std::stringstream out;
+
+	out << "Content-Type: text/html\r\n";
+	out << "Status: 200 ok\r\n\r\n";
+	out << "<html>\n";
+	out << "<head>\n";
+	out << "<title>Fortune Cookie</title>\n";
+	out << "</head>\n";
+	out << "<body>\n";
+	if (name.length() > 0)
+		out << "<h1>Welcome, " << name << "!</h1>\n";
+	else
+		out << "<h1>Welcome!</h1>\n";
+	out << "<img src=\"../fortune/img/fortune_cookie_image.jpg\" "
+		   "alt=\"Fortune Cookie "
+		   "Image\">\n";
+	out << "<h1>Your Fortune : " << result << "</h1>\n";
+	out << "</body>\n";
+	out << "</html>\n";
+	return (out.str());
+}
+
+std::string getRandomFortune(void)
+{
+	static const std::string fortunes[]
+		= {"Nothing astonishes men so much as common sense and plain dealing.",
+		   "The greatest risk is not taking one.",
+		   "You are very talented in many ways.",
+		   "The man or woman you desire feels the same about you.",
+		   "You already know the answer to the questions lingering inside your "
+		   "head.",
+		   "You learn from your mistakes... You will learn a lot today.",
+		   "Never give up. You're not a failure if you don't give up.",
+		   "Be on the lookout for coming events; They cast their shadows "
+		   "beforehand."};
+	const int n_fortunes = sizeof(fortunes) / sizeof(fortunes[0]);
+
+	return (fortunes[std::rand() % n_fortunes]);
+}
+
+std::string getQueryParam(const std::string &query, const std::string &param)
+{
+	size_t param_start_idx = query.find(param + "=");
+
+	if (param_start_idx != std::string::npos)
+	{
+		param_start_idx += param.length() + 1;
+		size_t param_end_idx = query.find("&", param_start_idx);
+		if (param_end_idx == std::string::npos)
+			param_end_idx = query.length();
+		return (query.substr(param_start_idx, param_end_idx - param_start_idx));
+	}
+	return ("");
+}
+
+std::string respond(std::map<std::string, std::string> &params)
+{
+	if (params["REQUEST_METHOD"] == "GET")
+	{
+		const std::string name = getQueryParam(params["QUERY_STRING"], "name");
+		return (makeResult(name, getRandomFortune()));
+	}
+	return (makeError());
+}
+
+bool writeAll(int fd, const std::string &data)
+{
+	size_t written = 0;
+	while (written < data.size())
+	{
+		ssize_t n = write(fd, data.c_str() + written, data.size() - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (false);
+		written += n;
+	}
+	return (true);
+}
+
+// 연결 하나에서 요청을 처리한다. 워커를 종료해야 하면 false
+bool serveConnection(int conn, int &n_served, const int max_requests)
+{
+	std::string buffer;
+	std::string params_content;
+	std::map<std::string, std::string> params;
+	bool keep_conn = false;
+	char chunk[4096];
+
+	while (true)
+	{
+		fcgi::Record record;
+		while (fcgi::consumeRecord(buffer, record))
+		{
+			if (record.type == fcgi::BEGIN_REQUEST)
+			{
+				keep_conn = (fcgi::decodeBeginRequestFlags(record.content)
+							 & fcgi::FLAG_KEEP_CONN);
+				params_content.clear();
+				params.clear();
+			}
+			else if (record.type == fcgi::PARAMS)
+			{
+				params_content += record.content;
+				if (record.content.empty())
+					fcgi::decodeNameValues(params_content, params);
+			}
+			else if (record.type == fcgi::STDIN && record.content.empty())
+			{
+				std::string out;
+				fcgi::appendStream(
+					out, fcgi::STDOUT, record.request_id, respond(params));
+				fcgi::appendEndRequest(
+					out, record.request_id, 0, fcgi::REQUEST_COMPLETE);
+				if (!writeAll(conn, out))
+					return (true);
+				n_served++;
+				if (max_requests > 0 && n_served >= max_requests)
+					return (false);
+				if (!keep_conn)
+					return (true);
+			}
+		}
+		ssize_t n = read(conn, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (true);
+		buffer.append(chunk, n);
+	}
+}
+
+// FastCGI 규약상 웹 서버는 리스닝 소켓을 fd 0으로 넘겨준다
+bool isFastCGI(void)
+{
+	struct sockaddr addr;
+	socklen_t len = sizeof(addr);
+
+	return (getpeername(STDIN_FILENO, &addr, &len) < 0 && errno == ENOTCONN);
+}
+
+int main(void)
+{
+	std::srand(std::time(NULL) ^ getpid());
+	if (!isFastCGI())
+	{
+		std::map<std::string, std::string> params;
+		const char *method = std::getenv("REQUEST_METHOD");
+		const char *query = std::getenv("QUERY_STRING");
+		params["REQUEST_METHOD"] = method ? method : "";
+		params["QUERY_STRING"] = query ? query : "";
+		std::cout << respond(params);
+		return (0);
+	}
+
+	const char *max_requests_env = std::getenv("FCGI_MAX_REQUESTS");
+	const int max_requests = max_requests_env ? std::atoi(max_requests_env) : 0;
+	int n_served = 0;
+	while (true)
+	{
+		int conn = accept(STDIN_FILENO, NULL, NULL);
+		if (conn < 0 && errno == EINTR)
+			continue;
+		if (conn < 0)
+			return (1);
+		bool keep_running = serveConnection(conn, n_served, max_requests);
+		close(conn);
+		if (!keep_running)
+			return (0);
+	}
+}